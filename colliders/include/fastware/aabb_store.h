@@ -4,6 +4,7 @@
 #include <fastware/colliders.h>
 #include <fastware/fastware_def.h>
 #include <fastware/memory.h>
+#include <fastware/slot_map.h>
 #include <fastware/types.h>
 
 namespace fastware {
@@ -17,18 +18,30 @@ struct aabb_store_create_info_t {
 
 struct aabb_store_t;
 
+// Boxes are kept packed for iteration and referred to by generational
+// handles, a handle to a removed box finds nothing instead of the box that
+// took its place
 aabb_store_t *create_aabb_store(aabb_store_create_info_t *info);
 
 void destroy_aabb_store(aabb_store_t *store);
 
-int32_t insert_aabbs(aabb_store_t *store, aabb_t *aabbs, int32_t count);
+// Handles of the inserted boxes go to handles, returns how many fit
+int32_t insert_aabbs(aabb_store_t *store, const aabb_t *aabbs, int32_t count,
+                     memory::slot_handle_t *handles);
 
-void remove_aabbs(aabb_store_t *store, int32_t *idxs, int32_t count);
+// Stale handles are skipped
+void remove_aabbs(aabb_store_t *store, const memory::slot_handle_t *handles,
+                  int32_t count);
 
-aabb_t *get_aabb(aabb_store_t *store, int32_t idx);
+// nullptr for a stale handle, only valid until the next insert or remove
+aabb_t *get_aabb(aabb_store_t *store, memory::slot_handle_t handle);
 
-int32_t get_aabbs(aabb_store_t *store, int32_t *idxs, int32_t count,
-                  aabb_t *aabbs);
+// Copies the boxes still alive in handle order, returns how many
+int32_t get_aabbs(aabb_store_t *store, const memory::slot_handle_t *handles,
+                  int32_t count, aabb_t *aabbs);
+
+// Every live box, packed at the front of the store
+aabb_t *live_aabbs(aabb_store_t *store, int32_t *count);
 
 } // namespace colliders
 } // namespace fastware
@@ -5,36 +5,72 @@ namespace fastware {
 
 namespace colliders {
 
-struct aabb_node_t {
-  aabb_t node;
-  aabb_t *next;
-};
-
 struct aabb_store_t {
   memory::allocator_t *allocator;
-  int32_t count;
-  aabb_node_t *store;
+  memory::memblk block;
+  memory::slot_map_t<aabb_t> aabbs;
 };
 
 aabb_store_t *create_aabb_store(aabb_store_create_info_t *info) {
+  memory::memblk blk =
+      memory::allocate(info->allocator, sizeof(aabb_store_t));
+  if (blk.ptr == nullptr) {
+    return nullptr;
+  }
 
-  return nullptr;
+  aabb_store_t *store = static_cast<aabb_store_t *>(blk.ptr);
+  store->allocator = info->allocator;
+  store->block = blk;
+  store->aabbs = memory::slot_map_t<aabb_t>::create(
+      info->allocator, static_cast<uint32_t>(info->count));
+  if (!store->aabbs.valid()) {
+    memory::deallocate(info->allocator, blk);
+    return nullptr;
+  }
+  return store;
 }
 
-void destroy_aabb_store(aabb_store_t *store) {}
+void destroy_aabb_store(aabb_store_t *store) {
+  store->aabbs.destroy();
+  memory::deallocate(store->allocator, store->block);
+}
 
-int32_t insert_aabbs(aabb_store_t *store, aabb_t *aabbs, int32_t count) {
-  return 0;
+int32_t insert_aabbs(aabb_store_t *store, const aabb_t *aabbs, int32_t count,
+                     memory::slot_handle_t *handles) {
+  int32_t inserted = 0;
+  while (inserted < count && !store->aabbs.full()) {
+    handles[inserted] = store->aabbs.insert(aabbs[inserted]);
+    inserted++;
+  }
+  return inserted;
 }
 
-void remove_aabbs(aabb_store_t *store, int32_t *idxs, int32_t count) {}
+void remove_aabbs(aabb_store_t *store, const memory::slot_handle_t *handles,
+                  int32_t count) {
+  for (int32_t i = 0; i < count; i++) {
+    store->aabbs.erase(handles[i]);
+  }
+}
 
-aabb_t *get_aabb(aabb_store_t *store, int32_t idx) { return nullptr; }
+aabb_t *get_aabb(aabb_store_t *store, memory::slot_handle_t handle) {
+  return store->aabbs.get(handle);
+}
+
+int32_t get_aabbs(aabb_store_t *store, const memory::slot_handle_t *handles,
+                  int32_t count, aabb_t *aabbs) {
+  int32_t found = 0;
+  for (int32_t i = 0; i < count; i++) {
+    if (const aabb_t *aabb = store->aabbs.get(handles[i])) {
+      aabbs[found++] = *aabb;
+    }
+  }
+  return found;
+}
 
-int32_t get_aabbs(aabb_store_t *store, int32_t *idxs, int32_t count,
-                  aabb_t *aabbs) {
-  return 0;
+aabb_t *live_aabbs(aabb_store_t *store, int32_t *count) {
+  *count = static_cast<int32_t>(store->aabbs.count);
+  return store->aabbs.begin();
 }
 
 } // namespace colliders
-} // namespace fastware
\ No newline at end of file
+} // namespace fastware
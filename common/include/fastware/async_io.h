@@ -0,0 +1,72 @@
+#ifndef ASYNC_IO_H
+#define ASYNC_IO_H
+
+#include <fastware/memory.h>
+
+#include <cstdint>
+
+namespace fastware {
+
+namespace io {
+
+// Most reads in flight at once
+constexpr uint32_t max_queue_depth{256};
+
+// io_uring when the kernel has it and lets us use it, blocking pread on a
+// few worker threads otherwise
+enum class io_backend_e { NONE, IO_URING, THREAD_POOL };
+
+// fd is -1 when the file cannot be opened
+struct file_t {
+  int32_t fd;
+  uint64_t size;
+};
+
+// Reads up to buffer.size bytes at offset into the buffer, which is owned
+// by the caller and must stay alive until the read completes
+struct read_request_t {
+  file_t file;
+  uint64_t offset;
+  memory::memblk buffer;
+  void *user_data;
+};
+
+// result is the number of bytes read, less than the buffer size past the
+// end of the file, or -errno when the read failed
+struct read_completion_t {
+  memory::memblk buffer;
+  void *user_data;
+  int64_t result;
+};
+
+// Everything but open_file and close_file is called from the thread that
+// called init, completions come back in the order the reads finish
+void init(uint32_t queue_depth = 64, uint32_t thread_count = 2);
+
+// Waits for the reads in flight, their buffers are not touched after
+void deinit();
+
+io_backend_e backend();
+
+file_t open_file(const char *filename);
+
+void close_file(file_t file);
+
+// Queues the reads in order and returns how many were queued, the ones
+// past a full queue have to be submitted again after a poll
+uint32_t submit(const read_request_t *requests, uint32_t count);
+
+// The reads finished since the last call, never blocks
+uint32_t poll(read_completion_t *completions, uint32_t max_count);
+
+// Like poll but blocks until at least one read finished, 0 right away when
+// none is in flight
+uint32_t wait(read_completion_t *completions, uint32_t max_count);
+
+// Reads submitted and not yet returned by poll or wait
+uint32_t in_flight();
+
+} // namespace io
+} // namespace fastware
+
+#endif // ASYNC_IO_H
@@ -3,6 +3,8 @@
 
 #include <fastware/types.h>
 
+#include <span>
+
 class File {
 public:
   File(const char *filename);
@@ -17,4 +19,29 @@ private:
   size_t size_;
 };
 
+// How a view is going to be read, tells the kernel how far to read ahead
+enum class file_access_e { SEQUENTIAL, RANDOM };
+
+// Read-only mapping of a whole file, parsed straight from the page cache
+// without copying it or allocating. The bytes stay valid for the life of
+// the view, empty when the file cannot be opened or is empty.
+class FileView {
+public:
+  FileView(const char *filename,
+           file_access_e access = file_access_e::SEQUENTIAL);
+  ~FileView();
+
+  FileView(const FileView &) = delete;
+  FileView &operator=(const FileView &) = delete;
+
+  bool valid() const;
+  size_t size() const;
+  const fastware::byte *data() const;
+  std::span<const fastware::byte> bytes() const;
+
+private:
+  const fastware::byte *data_;
+  size_t size_;
+};
+
 #endif // FILE_H
@@ -0,0 +1,478 @@
+#include <fastware/async_io.h>
+
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace fastware {
+
+namespace io {
+
+constexpr uint32_t no_slot{~0u};
+constexpr uint32_t max_thread_count{8};
+// a single read stops short of what pread and io_uring take at once, the
+// rest of the buffer is read by the next one
+constexpr uint64_t max_read_size{1ull << 30};
+
+// One read in flight, taken from the free list by submit and put back when
+// poll reports it
+struct slot_t {
+  read_request_t request;
+  uint64_t done;
+  int64_t result;
+  uint32_t next;
+};
+
+// Slots in order, linked through their next index
+struct slot_list_t {
+  uint32_t head{no_slot};
+  uint32_t tail{no_slot};
+};
+
+// The rings shared with the kernel, mapped from the io_uring fd
+struct ring_t {
+  int fd{-1};
+  uint32_t *sq_head;
+  uint32_t *sq_tail;
+  uint32_t *sq_array;
+  uint32_t sq_mask;
+  uint32_t sq_entries;
+  io_uring_sqe *sqes;
+  uint32_t *cq_head;
+  uint32_t *cq_tail;
+  uint32_t cq_mask;
+  io_uring_cqe *cqes;
+  void *sq_mapping;
+  size_t sq_mapping_size;
+  void *cq_mapping;
+  size_t cq_mapping_size;
+  size_t sqes_size;
+};
+
+static struct {
+  io_backend_e backend{io_backend_e::NONE};
+  uint32_t in_flight{0};
+  uint32_t free_slots{no_slot};
+  slot_t slots[max_queue_depth];
+  ring_t ring{};
+  // thread pool, the lists are only touched with the lock held
+  std::mutex lock;
+  std::condition_variable queued;
+  std::condition_variable finished;
+  slot_list_t pending;
+  slot_list_t completed;
+  bool stopping{false};
+  uint32_t thread_count{0};
+  std::thread threads[max_thread_count];
+} io_data{};
+
+static void push_back(slot_list_t &list, uint32_t index) {
+  io_data.slots[index].next = no_slot;
+  if (list.tail == no_slot) {
+    list.head = index;
+  } else {
+    io_data.slots[list.tail].next = index;
+  }
+  list.tail = index;
+}
+
+static uint32_t pop_front(slot_list_t &list) {
+  const uint32_t index = list.head;
+  if (index != no_slot) {
+    list.head = io_data.slots[index].next;
+    if (list.head == no_slot) {
+      list.tail = no_slot;
+    }
+  }
+  return index;
+}
+
+static uint64_t remaining(const slot_t &slot) {
+  const uint64_t left = slot.request.buffer.size - slot.done;
+  return left < max_read_size ? left : max_read_size;
+}
+
+static uint32_t load_acquire(const uint32_t *value) {
+  return std::atomic_ref<const uint32_t>(*value).load(
+      std::memory_order_acquire);
+}
+
+static void store_release(uint32_t *value, uint32_t new_value) {
+  std::atomic_ref<uint32_t>(*value).store(new_value,
+                                          std::memory_order_release);
+}
+
+// io_uring
+//
+// There is no liburing in the tree, the rings are set up and driven with
+// the raw system calls. Every slot has its own submission entry and two
+// completion entries, neither ring can overflow.
+
+static int ring_enter(uint32_t min_complete, uint32_t flags) {
+  ring_t &ring = io_data.ring;
+  const uint32_t to_submit = *ring.sq_tail - load_acquire(ring.sq_head);
+  int res;
+  do {
+    res = static_cast<int>(syscall(__NR_io_uring_enter, ring.fd, to_submit,
+                                   min_complete, flags, nullptr, 0));
+  } while (res < 0 && errno == EINTR);
+  return res;
+}
+
+static void ring_queue(uint32_t index) {
+  ring_t &ring = io_data.ring;
+  const slot_t &slot = io_data.slots[index];
+  const uint32_t tail = *ring.sq_tail;
+  assert(tail - load_acquire(ring.sq_head) < ring.sq_entries &&
+         "Submission ring full");
+
+  const uint32_t entry = tail & ring.sq_mask;
+  io_uring_sqe *sqe = &ring.sqes[entry];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = slot.request.file.fd;
+  sqe->off = slot.request.offset + slot.done;
+  sqe->addr = slot.request.buffer.addr + slot.done;
+  sqe->len = static_cast<uint32_t>(remaining(slot));
+  sqe->user_data = index;
+  ring.sq_array[entry] = entry;
+  store_release(ring.sq_tail, tail + 1);
+}
+
+static void ring_destroy() {
+  ring_t &ring = io_data.ring;
+  if (ring.sqes) {
+    munmap(ring.sqes, ring.sqes_size);
+  }
+  if (ring.cq_mapping && ring.cq_mapping != ring.sq_mapping) {
+    munmap(ring.cq_mapping, ring.cq_mapping_size);
+  }
+  if (ring.sq_mapping) {
+    munmap(ring.sq_mapping, ring.sq_mapping_size);
+  }
+  close(ring.fd);
+  ring = {};
+}
+
+// False when the kernel is too old for IORING_OP_READ or io_uring is
+// turned off or filtered out, the thread pool takes over then
+static bool ring_create(uint32_t queue_depth) {
+  ring_t &ring = io_data.ring;
+  io_uring_params params{};
+  ring.fd = static_cast<int>(
+      syscall(__NR_io_uring_setup, queue_depth, &params));
+  if (ring.fd < 0) {
+    ring.fd = -1;
+    return false;
+  }
+
+  constexpr uint32_t probe_ops{IORING_OP_READ + 1};
+  alignas(io_uring_probe) char probe_buffer[sizeof(io_uring_probe) +
+                                            probe_ops *
+                                                sizeof(io_uring_probe_op)]{};
+  io_uring_probe *probe = reinterpret_cast<io_uring_probe *>(probe_buffer);
+  if (syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_PROBE, probe,
+              probe_ops) < 0 ||
+      probe->last_op < IORING_OP_READ ||
+      !(probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED)) {
+    ring_destroy();
+    return false;
+  }
+
+  ring.sq_mapping_size =
+      params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  ring.cq_mapping_size =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap && ring.cq_mapping_size > ring.sq_mapping_size) {
+    ring.sq_mapping_size = ring.cq_mapping_size;
+  }
+  ring.sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+
+  void *sq_mapping =
+      mmap(nullptr, ring.sq_mapping_size, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING);
+  ring.sq_mapping = sq_mapping != MAP_FAILED ? sq_mapping : nullptr;
+  void *cq_mapping = ring.sq_mapping;
+  if (!single_mmap) {
+    cq_mapping = mmap(nullptr, ring.cq_mapping_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_CQ_RING);
+  }
+  ring.cq_mapping = cq_mapping != MAP_FAILED ? cq_mapping : nullptr;
+  void *sqes = mmap(nullptr, ring.sqes_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES);
+  ring.sqes = sqes != MAP_FAILED ? static_cast<io_uring_sqe *>(sqes) : nullptr;
+  if (!ring.sq_mapping || !ring.cq_mapping || !ring.sqes) {
+    ring_destroy();
+    return false;
+  }
+
+  char *sq = static_cast<char *>(ring.sq_mapping);
+  ring.sq_head = reinterpret_cast<uint32_t *>(sq + params.sq_off.head);
+  ring.sq_tail = reinterpret_cast<uint32_t *>(sq + params.sq_off.tail);
+  ring.sq_array = reinterpret_cast<uint32_t *>(sq + params.sq_off.array);
+  ring.sq_mask = *reinterpret_cast<uint32_t *>(sq + params.sq_off.ring_mask);
+  ring.sq_entries = params.sq_entries;
+  char *cq = static_cast<char *>(ring.cq_mapping);
+  ring.cq_head = reinterpret_cast<uint32_t *>(cq + params.cq_off.head);
+  ring.cq_tail = reinterpret_cast<uint32_t *>(cq + params.cq_off.tail);
+  ring.cq_mask = *reinterpret_cast<uint32_t *>(cq + params.cq_off.ring_mask);
+  ring.cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+  return true;
+}
+
+// Reads cut short before the end of the file go back into the ring for the
+// rest of the buffer
+static uint32_t ring_poll(read_completion_t *completions, uint32_t max_count) {
+  ring_t &ring = io_data.ring;
+  uint32_t head = *ring.cq_head;
+  const uint32_t tail = load_acquire(ring.cq_tail);
+  uint32_t count = 0;
+  bool requeued = false;
+  while (head != tail && count < max_count) {
+    const io_uring_cqe &cqe = ring.cqes[head & ring.cq_mask];
+    const uint32_t index = static_cast<uint32_t>(cqe.user_data);
+    slot_t &slot = io_data.slots[index];
+    const int32_t res = cqe.res;
+    head++;
+    if (res == -EINTR || res == -EAGAIN) {
+      ring_queue(index);
+      requeued = true;
+      continue;
+    }
+    if (res > 0) {
+      slot.done += static_cast<uint64_t>(res);
+      if (slot.done < slot.request.buffer.size) {
+        ring_queue(index);
+        requeued = true;
+        continue;
+      }
+    }
+    completions[count++] = {slot.request.buffer, slot.request.user_data,
+                            res < 0 ? res : static_cast<int64_t>(slot.done)};
+    slot.next = io_data.free_slots;
+    io_data.free_slots = index;
+  }
+  store_release(ring.cq_head, head);
+  if (requeued) {
+    ring_enter(0, 0);
+  }
+  return count;
+}
+
+// Thread pool
+//
+// Workers take the reads in the order they were queued and run them with a
+// blocking pread until the buffer is full or the file ends.
+
+static void worker() {
+  std::unique_lock<std::mutex> guard(io_data.lock);
+  for (;;) {
+    io_data.queued.wait(guard, [] {
+      return io_data.pending.head != no_slot || io_data.stopping;
+    });
+    const uint32_t index = pop_front(io_data.pending);
+    if (index == no_slot) {
+      return;
+    }
+    guard.unlock();
+
+    slot_t &slot = io_data.slots[index];
+    slot.result = 0;
+    while (slot.done < slot.request.buffer.size) {
+      const ssize_t res =
+          pread(slot.request.file.fd,
+                static_cast<char *>(slot.request.buffer.ptr) + slot.done,
+                remaining(slot),
+                static_cast<off_t>(slot.request.offset + slot.done));
+      if (res < 0 && errno == EINTR) {
+        continue;
+      }
+      if (res < 0) {
+        slot.result = -errno;
+        break;
+      }
+      if (res == 0) {
+        break;
+      }
+      slot.done += static_cast<uint64_t>(res);
+    }
+    if (slot.result == 0) {
+      slot.result = static_cast<int64_t>(slot.done);
+    }
+
+    guard.lock();
+    push_back(io_data.completed, index);
+    io_data.finished.notify_one();
+  }
+}
+
+// With the lock held
+static uint32_t pool_poll(read_completion_t *completions, uint32_t max_count) {
+  uint32_t count = 0;
+  while (count < max_count && io_data.completed.head != no_slot) {
+    const uint32_t index = pop_front(io_data.completed);
+    slot_t &slot = io_data.slots[index];
+    completions[count++] = {slot.request.buffer, slot.request.user_data,
+                            slot.result};
+    slot.next = io_data.free_slots;
+    io_data.free_slots = index;
+  }
+  return count;
+}
+
+void init(uint32_t queue_depth, uint32_t thread_count) {
+  assert(io_data.backend == io_backend_e::NONE && "Already initialized");
+  assert(queue_depth > 0 && queue_depth <= max_queue_depth &&
+         "Queue depth out of range");
+  assert(thread_count > 0 && thread_count <= max_thread_count &&
+         "Thread count out of range");
+
+  io_data.in_flight = 0;
+  io_data.free_slots = no_slot;
+  for (uint32_t i = queue_depth; i > 0; i--) {
+    io_data.slots[i - 1].next = io_data.free_slots;
+    io_data.free_slots = i - 1;
+  }
+
+  if (ring_create(queue_depth)) {
+    io_data.backend = io_backend_e::IO_URING;
+    return;
+  }
+
+  io_data.backend = io_backend_e::THREAD_POOL;
+  io_data.pending = {};
+  io_data.completed = {};
+  io_data.stopping = false;
+  io_data.thread_count = thread_count;
+  for (uint32_t i = 0; i < thread_count; i++) {
+    io_data.threads[i] = std::thread(worker);
+  }
+}
+
+void deinit() {
+  if (io_data.backend == io_backend_e::IO_URING) {
+    read_completion_t completions[16];
+    while (wait(completions, 16) > 0) {
+    }
+    ring_destroy();
+  } else if (io_data.backend == io_backend_e::THREAD_POOL) {
+    // the workers drain the pending reads before they stop
+    {
+      std::lock_guard<std::mutex> guard(io_data.lock);
+      io_data.stopping = true;
+    }
+    io_data.queued.notify_all();
+    for (uint32_t i = 0; i < io_data.thread_count; i++) {
+      io_data.threads[i].join();
+    }
+    io_data.thread_count = 0;
+  }
+  io_data.in_flight = 0;
+  io_data.backend = io_backend_e::NONE;
+}
+
+io_backend_e backend() { return io_data.backend; }
+
+file_t open_file(const char *filename) {
+  file_t file{open(filename, O_RDONLY | O_CLOEXEC), 0};
+  struct stat info;
+  if (file.fd >= 0 && fstat(file.fd, &info) == 0) {
+    file.size = static_cast<uint64_t>(info.st_size);
+  }
+  return file;
+}
+
+void close_file(file_t file) {
+  if (file.fd >= 0) {
+    close(file.fd);
+  }
+}
+
+uint32_t submit(const read_request_t *requests, uint32_t count) {
+  assert(io_data.backend != io_backend_e::NONE && "Not initialized");
+  uint32_t queued = 0;
+  std::unique_lock<std::mutex> guard(io_data.lock, std::defer_lock);
+  if (io_data.backend == io_backend_e::THREAD_POOL) {
+    guard.lock();
+  }
+  while (queued < count && io_data.free_slots != no_slot) {
+    const uint32_t index = io_data.free_slots;
+    slot_t &slot = io_data.slots[index];
+    io_data.free_slots = slot.next;
+    slot.request = requests[queued++];
+    slot.done = 0;
+    slot.result = 0;
+    if (io_data.backend == io_backend_e::IO_URING) {
+      ring_queue(index);
+    } else {
+      push_back(io_data.pending, index);
+    }
+  }
+  io_data.in_flight += queued;
+
+  // one system call or wake up for the whole batch
+  if (io_data.backend == io_backend_e::IO_URING) {
+    ring_enter(0, 0);
+  } else if (queued > 1) {
+    guard.unlock();
+    io_data.queued.notify_all();
+  } else if (queued == 1) {
+    guard.unlock();
+    io_data.queued.notify_one();
+  }
+  return queued;
+}
+
+uint32_t poll(read_completion_t *completions, uint32_t max_count) {
+  assert(io_data.backend != io_backend_e::NONE && "Not initialized");
+  uint32_t count;
+  if (io_data.backend == io_backend_e::IO_URING) {
+    count = ring_poll(completions, max_count);
+  } else {
+    std::lock_guard<std::mutex> guard(io_data.lock);
+    count = pool_poll(completions, max_count);
+  }
+  io_data.in_flight -= count;
+  return count;
+}
+
+uint32_t wait(read_completion_t *completions, uint32_t max_count) {
+  assert(io_data.backend != io_backend_e::NONE && "Not initialized");
+  uint32_t count = 0;
+  if (io_data.backend == io_backend_e::IO_URING) {
+    // short reads go back into the ring without being reported
+    while (io_data.in_flight > 0 && max_count > 0) {
+      count = ring_poll(completions, max_count);
+      if (count > 0) {
+        break;
+      }
+      if (ring_enter(1, IORING_ENTER_GETEVENTS) < 0) {
+        break;
+      }
+    }
+  } else if (io_data.in_flight > 0 && max_count > 0) {
+    std::unique_lock<std::mutex> guard(io_data.lock);
+    io_data.finished.wait(guard,
+                          [] { return io_data.completed.head != no_slot; });
+    count = pool_poll(completions, max_count);
+  }
+  io_data.in_flight -= count;
+  return count;
+}
+
+uint32_t in_flight() { return io_data.in_flight; }
+
+} // namespace io
+} // namespace fastware
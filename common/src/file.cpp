@@ -3,6 +3,11 @@
 #include <cassert>
 #include <cstdio>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 File::File(const char *filename) {
   file_handle_ = fopen(filename, "rb");
   if (file_handle_) {
@@ -33,3 +38,42 @@ size_t File::read(fastware::byte *buffer, size_t read_size) {
   size_t res = fread(buffer, 1, read_size, file_handle_);
   return res;
 }
+
+FileView::FileView(const char *filename, file_access_e access)
+    : data_(nullptr), size_(0) {
+  const int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+  struct stat info;
+  if (fstat(fd, &info) == 0 && info.st_size > 0) {
+    void *mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ,
+                         MAP_PRIVATE, fd, 0);
+    if (mapping != MAP_FAILED) {
+      data_ = static_cast<const fastware::byte *>(mapping);
+      size_ = static_cast<size_t>(info.st_size);
+      // start reading the pages in now, they are needed right away
+      madvise(mapping, size_,
+              access == file_access_e::SEQUENTIAL ? MADV_SEQUENTIAL
+                                                  : MADV_RANDOM);
+      madvise(mapping, size_, MADV_WILLNEED);
+    }
+  }
+  // the mapping keeps the file open
+  close(fd);
+}
+
+FileView::~FileView() {
+  if (data_)
+    munmap(const_cast<fastware::byte *>(data_), size_);
+}
+
+bool FileView::valid() const { return data_ != nullptr; }
+
+size_t FileView::size() const { return size_; }
+
+const fastware::byte *FileView::data() const { return data_; }
+
+std::span<const fastware::byte> FileView::bytes() const {
+  return {data_, size_};
+}
@@ -3,6 +3,7 @@
 #include "geometry.h"
 
 #include <algorithm>
+#include <new>
 #include <random>
 
 #include <fastware/clock.h>
@@ -35,32 +36,38 @@ uint32_t create_program(memory::allocator_t *allocator, shader_source *shaders,
       memory::allocate(local_allocator, shader_count * sizeof(shader_source_t));
   shader_source_t *shader_srcs = static_cast<shader_source_t *>(shader_blk.ptr);
 
+  // sources are compiled straight from the mapped files
+  auto view_blk =
+      memory::allocate(local_allocator, shader_count * sizeof(FileView));
+  FileView *views = static_cast<FileView *>(view_blk.ptr);
+
   for (int32_t i = 0; i < shader_count; i++) {
-    File shader_file(shaders[i].filename);
-    size_t file_size = shader_file.size();
-    memory::memblk blk = memory::allocate(local_allocator, file_size);
-    char *src = static_cast<char *>(blk.ptr);
-    shader_file.read(src, file_size);
-    shader_srcs[i] = shader_source_t{.glsl_source = src,
-                                     .length = static_cast<uint32_t>(file_size),
-                                     .type = shaders[i].type};
+    const FileView *view = new (&views[i]) FileView(shaders[i].filename);
+    shader_srcs[i] = shader_source_t{
+        .glsl_source = reinterpret_cast<const char *>(view->data()),
+        .length = static_cast<uint32_t>(view->size()),
+        .type = shaders[i].type};
   }
 
   auto prog_id = program::create(shader_srcs, shader_count);
 
+  for (int32_t i = 0; i < shader_count; i++) {
+    views[i].~FileView();
+  }
   memory::destroy(local_allocator);
   return prog_id;
 }
 
-uint32_t create_texture(memory::allocator_t *allocator, const char *filename) {
+uint32_t create_texture(const char *filename) {
 
-  File file(filename);
-  size_t size = file.size();
-  memory::memblk blk = memory::allocate(allocator, size);
-  byte *src = static_cast<byte *>(blk.ptr);
-  file.read(src, size);
+  // decoded straight from the page cache
+  const FileView file(filename);
+  return create_texture(file.data(), static_cast<uint32_t>(file.size()));
+}
+
+uint32_t create_texture(const byte *encoded, uint32_t size) {
 
-  image_data img = load(src, size);
+  image_data img = load(encoded, size);
   param_info_t param_infos[2]{
       {parameter_type_e::WRAP_S, wrap_e::CLAMP_TO_EDGE},
       {parameter_type_e::WRAP_T, wrap_e::CLAMP_TO_EDGE}};
@@ -89,8 +96,6 @@ uint32_t create_texture(memory::allocator_t *allocator, const char *filename) {
 
   unload(img);
 
-  memory::deallocate(allocator, blk);
-
   return texture_id;
 }
 
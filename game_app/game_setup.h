@@ -39,7 +39,10 @@ struct shader_source {
 uint32_t create_program(memory::allocator_t *allocator, shader_source *shaders,
                         int32_t shader_count);
 
-uint32_t create_texture(memory::allocator_t *allocator, const char *filename);
+uint32_t create_texture(const char *filename);
+
+// From an encoded image already read into memory
+uint32_t create_texture(const byte *encoded, uint32_t size);
 
 void process_events(event_t *events, int32_t count, key_state_t states,
                     void *context);
@@ -1,10 +1,12 @@
 #include <fastware/window.h>
 #include <fastware/window_system.h>
 
+#include <fastware/async_io.h>
 #include <fastware/clock.h>
 #include <fastware/file.h>
 #include <fastware/logger.h>
 #include <fastware/memory.h>
+#include <fastware/soa_vector.h>
 
 #include <algorithm>
 #include <cassert>
@@ -34,7 +36,9 @@ template <typename T> struct allocator {
     return static_cast<T *>(fastware::memory::allocate(alloc, sizeof(T)).ptr);
   }
 
-  static void dealloc(fastware::memory::allocator_t *alloc, T *ptr) {
+  // the allocator is found from the address
+  static void dealloc(T *ptr) {
+    fastware::memory::allocator_t *alloc = fastware::memory::owner_of(ptr);
     fastware::memory::deallocate(
         alloc, fastware::memory::memblk{
                    .ptr = ptr,
@@ -43,8 +47,10 @@ template <typename T> struct allocator {
 };
 struct SystemAlloc {
   SystemAlloc() {
+    // Only reserved up front, pages are committed as the stack grows
     fastware::memory::stack_alloc_create_info_t alloc_create_info{
-        nullptr, 500 * 1024 * 1024, fastware::memory::alignment_t::b64};
+        nullptr, 4 * fastware::memory::Gb, fastware::memory::alignment_t::b64,
+        fastware::memory::stack_flags_t::virtual_memory};
 
     root_alloc = fastware::memory::create(&alloc_create_info);
   }
@@ -54,21 +60,90 @@ struct SystemAlloc {
   fastware::memory::allocator_t *root_alloc;
 };
 
+void log_budget_limit(fastware::memory::allocator_t *,
+                      fastware::memory::budget_event_t::value event,
+                      const fastware::memory::budget_report_t *report,
+                      void *) {
+  fastware::logger::log(
+      "Memory budget %s over its %s limit: %lu bytes charged, limits %lu / "
+      "%lu",
+      report->tag,
+      event == fastware::memory::budget_event_t::soft_limit ? "soft" : "hard",
+      report->charged_bytes, report->soft_limit, report->hard_limit);
+}
+
+// Charges a subsystem's allocators to a named budget, to be destroyed after
+// them
+struct SubsystemBudget {
+  SubsystemBudget(fastware::memory::allocator_t *inner, const char *tag,
+                  uint64_t soft_limit, uint64_t hard_limit,
+                  fastware::memory::budget_callback_t callback) {
+    fastware::memory::budget_alloc_create_info_t budget_create_info{
+        nullptr, inner, tag, soft_limit, hard_limit, callback};
+
+    budget = fastware::memory::create(&budget_create_info);
+  }
+
+  ~SubsystemBudget() { fastware::memory::destroy(budget); }
+
+  fastware::memory::allocator_t *budget;
+};
+
 int main() {
 
   using namespace fastware;
 
-  constexpr uint32_t instance_count = 200000;
+  // only the geometry of the sphere has to be known at compile time
+  const uint32_t instance_count = 200000;
   constexpr uint32_t units = 32;
   constexpr uint32_t vertex_count = geometry::sphere::vertex_count(units);
   constexpr uint32_t index_count = geometry::sphere::index_count(units);
 
-  constexpr uint64_t vc = uint64_t(instance_count) * uint64_t(vertex_count);
-  constexpr uint64_t tc = uint64_t(instance_count) * uint64_t(index_count) / 3;
+  const uint64_t vc = uint64_t(instance_count) * uint64_t(vertex_count);
+  const uint64_t tc = uint64_t(instance_count) * uint64_t(index_count) / 3;
+
+  // replayable with memory_replay, only written by FASTWARE_MEMORY_TRACE builds
+  memory::trace_begin("memory.trace");
 
   SystemAlloc alloc;
 
-  logger::init_logger(alloc.root_alloc, memory::Mb * 100);
+  // The logger cannot log its own limits, its buffers are not there yet
+  SubsystemBudget logger_budget(alloc.root_alloc, "logger", 200 * memory::Mb,
+                                256 * memory::Mb, nullptr);
+  SubsystemBudget window_budget(alloc.root_alloc, "window", 9 * memory::Mb,
+                                16 * memory::Mb, log_budget_limit);
+  // one program at a time, each with a 1 Mb scratch stack
+  SubsystemBudget shader_budget(alloc.root_alloc, "shaders", 2 * memory::Mb,
+                                4 * memory::Mb, log_budget_limit);
+  // the frame arena, text::update_buffers stages into it
+  SubsystemBudget frame_budget(alloc.root_alloc, "frame", 5 * memory::Mb,
+                               8 * memory::Mb, log_budget_limit);
+
+  logger::init_logger(logger_budget.budget, memory::Mb * 100);
+
+  // The texture is read while the window, the shaders and the meshes are
+  // set up, it is only decoded once they are done
+  io::init();
+  io::file_t texture_file = io::open_file("textures/earth.jpg");
+  io::read_request_t texture_read{
+      .file = texture_file, .offset = 0, .buffer = {}, .user_data = nullptr};
+  // A stack of its own, its pages go back to the OS once the texture is
+  // decoded, the root stack would keep them until it is destroyed
+  memory::allocator_t *texture_alloc = nullptr;
+  if (texture_file.fd >= 0 && texture_file.size > 0) {
+    memory::stack_alloc_create_info_t texture_alloc_info{
+        .parent = nullptr,
+        .size = memory::align(texture_file.size, memory::alignment_t::b64),
+        .alignment = memory::alignment_t::b64,
+        .flags = memory::stack_flags_t::none,
+        .backing = memory::backing_flags_t::none};
+    texture_alloc = memory::create(&texture_alloc_info);
+  }
+  if (texture_alloc) {
+    texture_read.buffer = memory::allocate(texture_alloc, texture_file.size);
+  }
+  const bool texture_pending = texture_read.buffer.ptr != nullptr &&
+                               io::submit(&texture_read, 1) == 1;
 
   setup::control_block control{.cam = camera{vec3_t{50.0f, 50.0f, 300.0f},
                                              vec3_t{0.0f, -0.45f, -1.0f},
@@ -77,7 +152,7 @@ int main() {
                                .mode = 0,
                                .show_bounding_box = false};
 
-  window_system ws(alloc.root_alloc, setup::process_events, &control);
+  window_system ws(window_budget.budget, setup::process_events, &control);
 
   window_create_info window_create_info{"Fastware", 0, 0};
   window_info info;
@@ -91,7 +166,7 @@ int main() {
       {.filename = "shaders/text.frag", .type = shader_type_e::FRAGMENT}};
 
   const uint32_t text_prog_id =
-      setup::create_program(alloc.root_alloc, text_shaders, 2);
+      setup::create_program(shader_budget.budget, text_shaders, 2);
 
   create_text_atlas_info_t atlas_info{.alloc = alloc.root_alloc,
                                       .font_file = "fonts/ttf_FreeSans.ttf"};
@@ -132,7 +207,8 @@ int main() {
       {.filename = "shaders/basic2.vert", .type = shader_type_e::VERTEX},
       {.filename = "shaders/basic2.frag", .type = shader_type_e::FRAGMENT}};
 
-  const uint32_t prog_id = setup::create_program(alloc.root_alloc, shaders, 2);
+  const uint32_t prog_id =
+      setup::create_program(shader_budget.budget, shaders, 2);
 
   struct vertex_data {
     vec3_t positions[vertex_count];
@@ -144,20 +220,29 @@ int main() {
     uint32_t indexes[index_count];
   };
 
-  struct prep_matrixes {
-    mat4_t models[instance_count];
-    mat4_t animations[instance_count];
-    float speeds[instance_count];
-  };
-
-  struct gpu_matrixes {
-    mat4_t model_transforms[instance_count];
-    mat3_t normal_transforms[instance_count];
-  };
+  // models, animations, speeds
+  using prep_matrixes = memory::soa_vector_t<mat4_t, mat4_t, float>;
+  // model and normal transforms, uploaded a column at a time
+  using gpu_matrixes = memory::soa_vector_t<mat4_t, mat3_t>;
+  using bounding_box_instances = memory::soa_vector_t<mat4_t>;
+
+  // Per instance arrays are streamed every frame, keep them on huge pages
+  memory::stack_alloc_create_info_t instance_alloc_info{
+      .parent = nullptr,
+      .size = prep_matrixes::storage_size(instance_count) +
+              gpu_matrixes::storage_size(instance_count) +
+              bounding_box_instances::storage_size(instance_count) +
+              3 * memory::alignment_t::b64,
+      .alignment = memory::alignment_t::b64,
+      .flags = memory::stack_flags_t::none,
+      .backing = memory::backing_flags_t::transparent_huge_pages |
+                 memory::backing_flags_t::populate};
+  memory::allocator_t *instance_alloc = memory::create(&instance_alloc_info);
 
   vertex_data *vert_data = allocator<vertex_data>::alloc(alloc.root_alloc);
   index_data *idx_data = allocator<index_data>::alloc(alloc.root_alloc);
-  gpu_matrixes *gpu_mat_data = allocator<gpu_matrixes>::alloc(alloc.root_alloc);
+  gpu_matrixes gpu_mats = gpu_matrixes::create(instance_alloc, instance_count);
+  gpu_mats.resize(instance_count);
 
   geometry::sphere::generate(vert_data->positions, vert_data->normals,
                              vert_data->uvs, idx_data->indexes, units);
@@ -173,8 +258,8 @@ int main() {
        .data = idx_data},
       {.target = buffer_target_e::ARRAY_BUFFER,
        .type = buffer_type_e::DYNAMIC,
-       .size = sizeof(gpu_matrixes),
-       .data = gpu_mat_data}};
+       .size = instance_count * uint32_t(sizeof(mat4_t) + sizeof(mat3_t)),
+       .data = nullptr}};
 
   uint32_t buffers[3]{0};
   buffer::create(buffer_infos, 3, buffers);
@@ -197,8 +282,8 @@ int main() {
   uint32_t vert_id = 0;
   varray::create(&varray_info, 1, &vert_id);
 
-  allocator<index_data>::dealloc(alloc.root_alloc, idx_data);
-  allocator<vertex_data>::dealloc(alloc.root_alloc, vert_data);
+  allocator<index_data>::dealloc(idx_data);
+  allocator<vertex_data>::dealloc(vert_data);
 
   entity e{.program_id = prog_id,
            .varray_id = vert_id,
@@ -208,16 +293,21 @@ int main() {
            .primitive_type = primitive_type_e::TRIANGLES,
            .render_type = entity::INDEX_INSTANCED};
 
+  // the buffer holds the columns back to back
   buffer_update_info_t gpu_matrix_buffer_update[]{
-      {buffers[2], 0, sizeof(gpu_matrixes), gpu_mat_data}};
+      {buffers[2], 0, instance_count * uint32_t(sizeof(mat4_t)),
+       gpu_mats.data<0>()},
+      {buffers[2], instance_count * uint32_t(sizeof(mat4_t)),
+       instance_count * uint32_t(sizeof(mat3_t)), gpu_mats.data<1>()}};
 
-  prep_matrixes *prep_mat_data =
-      allocator<prep_matrixes>::alloc(alloc.root_alloc);
+  prep_matrixes prep_mats =
+      prep_matrixes::create(instance_alloc, instance_count);
+  prep_mats.resize(instance_count);
 
-  geometry::matrix::fill(prep_mat_data->animations, instance_count,
+  geometry::matrix::fill(prep_mats.data<1>(), instance_count,
                          glms_mat4_identity());
-  setup::create_transforms(prep_mat_data->models, instance_count);
-  setup::create_speeds(prep_mat_data->speeds, instance_count);
+  setup::create_transforms(prep_mats.data<0>(), instance_count);
+  setup::create_speeds(prep_mats.data<2>(), instance_count);
 
   setup::shader_source bounding_shaders[]{
       {.filename = "shaders/bounding_box.vert", .type = shader_type_e::VERTEX},
@@ -225,20 +315,17 @@ int main() {
        .type = shader_type_e::FRAGMENT}};
 
   const uint32_t bounding_prog_id =
-      setup::create_program(alloc.root_alloc, bounding_shaders, 2);
+      setup::create_program(shader_budget.budget, bounding_shaders, 2);
 
   const mat4_t bounds =
       compute_bounding_box(vert_data->positions, vertex_count);
-  struct bounding_box_instances {
-    mat4_t models[instance_count];
-  };
-
-  bounding_box_instances *gpu_bounding_data =
-      allocator<bounding_box_instances>::alloc(alloc.root_alloc);
+  bounding_box_instances bounding_mats =
+      bounding_box_instances::create(instance_alloc, instance_count);
+  bounding_mats.resize(instance_count);
 
   buffer_update_info_t bounding_box_update_buffer;
   const uint32_t bounding_vid = create_bounding_box_vao(
-      gpu_bounding_data->models, instance_count, &bounding_box_update_buffer);
+      bounding_mats.data<0>(), instance_count, &bounding_box_update_buffer);
 
   entity bounding_e[3]{{.program_id = bounding_prog_id,
                         .varray_id = bounding_vid,
@@ -262,8 +349,26 @@ int main() {
                         .primitive_type = primitive_type_e::LINES,
                         .render_type = entity::INDEX_INSTANCED}};
 
-  uint32_t texture_id =
-      setup::create_texture(alloc.root_alloc, "textures/earth.jpg");
+  io::read_completion_t texture_done{};
+  if (texture_pending) {
+    io::wait(&texture_done, 1);
+  }
+  uint32_t texture_id = 0;
+  if (texture_pending &&
+      texture_done.result == static_cast<int64_t>(texture_file.size)) {
+    texture_id = setup::create_texture(
+        static_cast<const byte *>(texture_done.buffer.ptr),
+        static_cast<uint32_t>(texture_file.size));
+  } else {
+    // the whole file or nothing, a partly read image is not decoded
+    logger::log("Cannot read textures/earth.jpg ahead: %ld, reading it now",
+                texture_done.result);
+    texture_id = setup::create_texture("textures/earth.jpg");
+  }
+  if (texture_alloc) {
+    memory::destroy(texture_alloc);
+  }
+  io::close_file(texture_file);
 
   param_info_t param_infos[2]{
       {parameter_type_e::WRAP_S, wrap_e::CLAMP_TO_EDGE},
@@ -300,6 +405,15 @@ int main() {
   uint64_t frames_dur = 1000000000 - 1;
   uint64_t frame_idx = 29;
 
+  // Transient per frame data (text staging), kept for the frame in flight
+  memory::frame_arena_create_info_t frame_alloc_info{
+      .parent = frame_budget.budget,
+      .frame_size = 2 * memory::Mb,
+      .alignment = memory::alignment_t::b64,
+      .frame_count = 2,
+      .backing = memory::backing_flags_t::none};
+  memory::allocator_t *frame_alloc = memory::create(&frame_alloc_info);
+
   while (control.main_window_id != 0) {
 
     METRIC(RenderLoop);
@@ -315,22 +429,23 @@ int main() {
 
     {
       METRIC(PrepModels);
-      setup::update_transforms(prep_mat_data->animations, prep_mat_data->speeds,
+      setup::update_transforms(prep_mats.data<1>(), prep_mats.data<2>(),
                                instance_count);
 
-      setup::compute_gpu_matrixes(
-          gpu_mat_data->model_transforms, gpu_mat_data->normal_transforms,
-          prep_mat_data->models, prep_mat_data->animations, instance_count);
+      setup::compute_gpu_matrixes(gpu_mats.data<0>(), gpu_mats.data<1>(),
+                                  prep_mats.data<0>(), prep_mats.data<1>(),
+                                  instance_count);
     }
     {
       METRIC(PrepBoundBoxModels);
 
-      setup::compute_bounding_model_matrixes(gpu_bounding_data->models,
-                                             gpu_mat_data->model_transforms,
+      setup::compute_bounding_model_matrixes(bounding_mats.data<0>(),
+                                             gpu_mats.data<0>(),
                                              instance_count, bounds);
     }
     {
       METRIC(BeginFrame);
+      memory::begin_frame(frame_alloc);
       renderer::begin_frame();
     }
     {
@@ -348,7 +463,7 @@ int main() {
       uniform::set_value(e.program_id, 10, PV);
       uniform::set_value(e.program_id, 15, control.mode);
 
-      buffer::update(&gpu_matrix_buffer_update[0], 1);
+      buffer::update(gpu_matrix_buffer_update, 2);
 
       renderer::render_targets(&e, 1);
     }
@@ -385,11 +500,12 @@ int main() {
             .length = cast<uint32_t>(fast_max(len, 0)),
             .pos = vec2_t{float_t(20), float_t(info.height - 64)},
             .size = 0.5f};
-        text::update_buffers(alloc.root_alloc, &update_text_info, 1,
+        text::update_buffers(frame_alloc, &update_text_info, 1,
                              &text_entity.count);
 
         printf("Index count: %u, section size: %u\n", text_entity.count,
                text_buffer.section_size);
+        logger::log_budgets();
 
         frame_idx = 0;
         frames_dur = 0;
@@ -444,6 +560,16 @@ int main() {
   buffer::destroy(buffers, 3);
   program::destroy(prog_id);
 
+  logger::log_allocators(nullptr);
+  logger::log_budgets();
+  memory::destroy(frame_alloc);
+  bounding_mats.destroy();
+  prep_mats.destroy();
+  gpu_mats.destroy();
+  memory::destroy(instance_alloc);
+  memory::trace_end();
+  io::deinit();
+
   logger::flush();
   logger::deinit_logger();
 
@@ -16,6 +16,14 @@ void log(const char *__restrict format, ...);
 
 void flush();
 
+// Logs the allocator tree under root (every root allocator when null) with
+// its usage counters, nothing unless memory is built with
+// FASTWARE_MEMORY_STATS
+void log_allocators(memory::allocator_t *root);
+
+// Logs every memory budget with what is charged to it against its limits
+void log_budgets();
+
 void deinit_logger();
 
 } // namespace logger
@@ -95,3 +95,31 @@ void fastware::logger::flush() {
     fflush(stdout);
   }
 }
+
+void fastware::logger::log_allocators(memory::allocator_t *root) {
+  memory::walk_allocators(
+      root,
+      [](memory::allocator_t *alloc, const memory::allocator_stats_t *stats,
+         uint32_t depth, void *) {
+        log("%*s%s %p: %lu / %lu bytes in use, peak %lu, %lu allocs, "
+            "%lu frees, %lu failed, %lu live / %lu blocks",
+            static_cast<int32_t>(depth * 2), "", stats->kind,
+            static_cast<void *>(alloc), stats->bytes_in_use, stats->capacity,
+            stats->peak_bytes, stats->alloc_count, stats->free_count,
+            stats->failed_count, stats->live_count, stats->block_count);
+      },
+      nullptr);
+}
+
+void fastware::logger::log_budgets() {
+  memory::walk_budgets(
+      [](memory::allocator_t *budget, const memory::budget_report_t *report,
+         void *) {
+        log("budget %s %p: %lu bytes charged, peak %lu, limits %lu / %lu, "
+            "%lu refused",
+            report->tag, static_cast<void *>(budget), report->charged_bytes,
+            report->peak_bytes, report->soft_limit, report->hard_limit,
+            report->refused_count);
+      },
+      nullptr);
+}
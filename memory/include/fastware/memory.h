@@ -78,10 +78,59 @@ struct memblk {
   uint64_t size;
 };
 
+// Where a root allocator (null parent) gets its memory from, aligned_alloc
+// when none is set
+struct backing_flags_t {
+  enum value : uint64_t {
+    none = 0,
+    // explicit huge pages (MAP_HUGETLB), falls back to transparent huge
+    // pages when none are reserved
+    huge_pages = 1 << 0,
+    // 2 Mb aligned mapping advised with MADV_HUGEPAGE
+    transparent_huge_pages = 1 << 1,
+    // fault every page in at creation instead of on first touch
+    populate = 1 << 2
+  };
+};
+
+struct stack_flags_t {
+  enum value : uint64_t {
+    none = 0,
+    // size is only reserved address space, pages are committed as the stack
+    // grows. Needs a null parent, the range comes straight from the OS.
+    virtual_memory = 1 << 0,
+    // deallocate_all hands the committed pages back to the OS
+    decommit_on_reset = 1 << 1,
+    // the top of the stack advances with an atomic fetch_add, any number of
+    // threads allocate at once without a lock. deallocate_all is the reset
+    // point and must not race with allocations. Cannot be combined with
+    // virtual_memory.
+    concurrent = 1 << 2
+  };
+};
+
 struct stack_alloc_create_info_t {
   allocator_t *parent;
   uint64_t size;
   alignment_t::value alignment;
+  uint64_t flags;
+  uint64_t backing;
+  // concurrent stacks only, when set every thread reserves chunks of this
+  // size and bumps inside them without atomics. Requests larger than a
+  // chunk go to the shared top.
+  uint64_t chunk_size;
+};
+
+struct pool_flags_t {
+  enum value : uint64_t {
+    none = 0,
+    // free list is a lock-free tagged stack, safe to use from many threads
+    concurrent = 1 << 0,
+    // occupancy bitmap instead of a free list, lowest free block first and
+    // live blocks can be visited in address order with for_each_live.
+    // Single threaded, cannot be combined with concurrent.
+    bitmap = 1 << 1
+  };
 };
 
 struct pool_alloc_create_info_t {
@@ -89,24 +138,318 @@ struct pool_alloc_create_info_t {
   uint64_t block_size;
   alignment_t::value block_alignment;
   uint64_t block_count;
+  uint64_t flags;
+  uint64_t backing;
+};
+
+// Per-thread magazines of blocks in front of a pool. Threads refill from and
+// flush back to the pool in batches of half a magazine, from whichever thread
+// runs out, so the pool must be created with pool_flags_t::concurrent. The
+// pool must outlive the cache, parent only provides the storage for the
+// magazines.
+struct thread_cache_create_info_t {
+  allocator_t *parent;
+  allocator_t *pool;
+  uint64_t magazine_size;
+};
+
+// Power of 2 size classes from min_block_size up to max_block_size, each one
+// served by its own pool of class_capacity bytes, which must hold at least
+// one max_block_size block. Blocks are handed out with the size of their
+// class.
+struct slab_alloc_create_info_t {
+  allocator_t *parent;
+  uint64_t min_block_size;
+  uint64_t max_block_size;
+  uint64_t class_capacity;
+  uint64_t pool_flags;
+};
+
+// Two-Level Segregated Fit heap, O(1) allocate and free with immediate
+// coalescing of free neighbours. Every block pays a header of alignment size
+// (at least 16 bytes).
+struct tlsf_alloc_create_info_t {
+  allocator_t *parent;
+  uint64_t size;
+  alignment_t::value alignment;
+};
+
+constexpr uint64_t max_arena_frames{3};
+
+// frame_count (2 or 3) stacks of frame_size bytes each. begin_frame rotates
+// to the next stack and resets it, so memory handed out in frame N stays
+// valid until frame N + frame_count - 1 ends, long enough for the
+// asynchronous uploads of the frames in flight.
+struct frame_arena_create_info_t {
+  allocator_t *parent;
+  uint64_t frame_size;
+  alignment_t::value alignment;
+  uint64_t frame_count;
+  uint64_t backing;
+};
+
+// The composites below only hold their storage, the allocators they combine
+// are the caller's and must outlive them. Blocks are handed back to the
+// allocator that owns() them.
+
+// Allocates from primary and from secondary when primary runs out, e.g. a
+// stack in front of the root
+struct fallback_alloc_create_info_t {
+  allocator_t *parent;
+  allocator_t *primary;
+  allocator_t *secondary;
+};
+
+// Sizes up to threshold go to small, larger ones to large, e.g. a slab for
+// the small ones and a tlsf heap for the rest
+struct segregator_alloc_create_info_t {
+  allocator_t *parent;
+  uint64_t threshold;
+  allocator_t *small;
+  allocator_t *large;
+};
+
+struct affix_flags_t {
+  enum value : uint64_t {
+    none = 0,
+    // the size of the block is kept in front of it, deallocate may be given
+    // a block of size 0 and affix_size reads it back
+    size = 1 << 0,
+    // a guard word on either side of the block, checked when it is handed
+    // back
+    canary = 1 << 1
+  };
+};
+
+// Wraps every block of inner in a prefix and a suffix. The prefix is padded
+// to alignment so blocks keep the alignment inner gives them.
+struct affix_alloc_create_info_t {
+  allocator_t *parent;
+  allocator_t *inner;
+  uint64_t flags;
+  alignment_t::value alignment;
+};
+
+struct budget_event_t {
+  enum value : uint64_t {
+    // the charged bytes went over the soft limit
+    soft_limit = 0,
+    // an allocation was refused, it would have gone over the hard limit
+    hard_limit
+  };
 };
 
+struct budget_report_t {
+  const char *tag;
+  uint64_t charged_bytes;
+  uint64_t peak_bytes;
+  uint64_t soft_limit;
+  uint64_t hard_limit;
+  uint64_t refused_count;
+};
+
+// Called by the thread whose allocation crossed the limit, it must not
+// allocate from the budget
+typedef void (*budget_callback_t)(allocator_t *budget,
+                                  budget_event_t::value event,
+                                  const budget_report_t *report,
+                                  void *user_data);
+
+// Charges every block handed out from inner against a budget named tag.
+// Allocators created with the budget as parent are charged their storage,
+// so a subsystem is given its budget instead of inner. Limits are checked
+// against the size asked for, 0 means no limit. deallocate_all resets the
+// charge and only makes sense when the budget is the only user of inner.
+struct budget_alloc_create_info_t {
+  allocator_t *parent;
+  allocator_t *inner;
+  const char *tag;
+  uint64_t soft_limit;
+  uint64_t hard_limit;
+  budget_callback_t callback;
+  void *user_data;
+};
+
+// Null when the parent or the OS cannot give the allocator its storage
 allocator_t *create(stack_alloc_create_info_t *info);
 
 allocator_t *create(pool_alloc_create_info_t *info);
 
+allocator_t *create(thread_cache_create_info_t *info);
+
+allocator_t *create(slab_alloc_create_info_t *info);
+
+allocator_t *create(tlsf_alloc_create_info_t *info);
+
+allocator_t *create(frame_arena_create_info_t *info);
+
+allocator_t *create(fallback_alloc_create_info_t *info);
+
+allocator_t *create(segregator_alloc_create_info_t *info);
+
+allocator_t *create(affix_alloc_create_info_t *info);
+
+allocator_t *create(budget_alloc_create_info_t *info);
+
 void destroy(allocator_t *alloc);
 
 memblk allocate(allocator_t *alloc, uint64_t size);
 
+// Up to count blocks of size each in one call, pools unlink a chain of their
+// free list and stacks bump once. Returns how many of out were filled.
+uint64_t allocate_n(allocator_t *alloc, uint64_t size, uint64_t count,
+                    memblk *out);
+
 void deallocate(allocator_t *alloc, memblk blk);
 
+// Hands back count blocks, pools splice them in as a single chain and stacks
+// pop them last to first
+void deallocate_n(allocator_t *alloc, const memblk *blks, uint64_t count);
+
 void deallocate_all(allocator_t *alloc);
 
+// Hands the pages no live block sits on back to the OS and returns how many
+// bytes that was, they read as zero once touched again. Pools drop their
+// untouched blocks and pages of free ones, slabs every size class and
+// stacks what is above the top, other allocators keep their pages. Must not
+// race with allocations from alloc, the concurrent pool only drops its
+// untouched blocks.
+uint64_t trim(allocator_t *alloc);
+
+// Grows blk by at least delta bytes without moving it and updates its size,
+// false when blk stays as it was. Stacks grow their top allocation, pools
+// and size classes a block up to their block size and tlsf heaps into a
+// free neighbour.
+bool expand(allocator_t *alloc, memblk *blk, uint64_t delta);
+
+// blk with room for new_size bytes, grown in place when expand can, else a
+// new block the contents are copied to and blk is deallocated. Blocks are
+// never shrunk. On failure {nullptr, 0} is returned and blk stays valid.
+memblk reallocate(allocator_t *alloc, memblk blk, uint64_t new_size);
+
 uint64_t prefered_size(allocator_t *alloc, uint64_t size);
 
+// Size of the block at ptr that alloc handed out for allocate(alloc, size).
+// Same as prefered_size unless a fallback sits in alloc, the block then has
+// the size of whichever side served it.
+uint64_t allocated_size(allocator_t *alloc, const void *ptr, uint64_t size);
+
 bool owns(allocator_t *alloc, memblk blk);
 
+// The allocator handing out blocks from the memory at ptr, null when there
+// is none. Every allocator with storage of its own enters it in a global
+// page map at create, slabs and thread caches take over the pages of their
+// pools. Composites never own pages, the allocator they forward to does.
+// O(1), pages shared by allocators are searched in the list of ranges.
+allocator_t *owner_of(const void *ptr);
+
+// deallocate on the owner_of blk, for code that does not keep track of
+// where its blocks come from. Blocks of budgets and affix allocators must go
+// back through them, their owner does not know about the charge or affixes.
+void free(memblk blk);
+
+// Starts the next frame of a frame arena, everything allocated
+// frame_count - 1 frames ago is gone
+void begin_frame(allocator_t *alloc);
+
+// Size of the block at ptr, allocated from an affix allocator with
+// affix_flags_t::size
+uint64_t affix_size(allocator_t *alloc, const void *ptr);
+
+budget_report_t query_budget(allocator_t *alloc);
+
+typedef void (*budget_visitor_t)(allocator_t *budget,
+                                 const budget_report_t *report,
+                                 void *user_data);
+
+// Every budget alive in creation order, e.g. to log them once in a while.
+// The visitor must not create or destroy budgets.
+void walk_budgets(budget_visitor_t visitor, void *user_data);
+
+typedef void (*live_visitor_t)(memblk blk, void *user_data);
+
+// Every live block of a bitmap pool in address order. The typed front-end
+// has an inlined version taking any callable.
+void for_each_live(allocator_t *alloc, live_visitor_t visitor,
+                   void *user_data);
+
+#ifdef FASTWARE_MEMORY_STATS
+constexpr bool stats_enabled{true};
+#else
+constexpr bool stats_enabled{false};
+#endif
+
+// Counters kept per allocator when built with FASTWARE_MEMORY_STATS, all
+// zero otherwise. Sizes are the ones of the blocks handed out.
+struct allocator_stats_t {
+  const char *kind;
+  // bytes the allocator hands out from, 0 when it only forwards to others
+  uint64_t capacity;
+  uint64_t bytes_in_use;
+  uint64_t peak_bytes;
+  uint64_t alloc_count;
+  uint64_t free_count;
+  uint64_t failed_count;
+  // live allocations, for pools the occupied blocks out of block_count
+  uint64_t live_count;
+  uint64_t block_count;
+};
+
+// All zero when stats are compiled out, and for the allocators created while
+// 512 others were tracked
+allocator_stats_t query_stats(allocator_t *alloc);
+
+typedef void (*stats_visitor_t)(allocator_t *alloc,
+                                const allocator_stats_t *stats, uint32_t depth,
+                                void *user_data);
+
+// Depth first over root and the allocators carved from it, every root
+// allocator when root is null. The visitor must not create or destroy
+// allocators. Visits nothing when stats are compiled out.
+void walk_allocators(allocator_t *root, stats_visitor_t visitor,
+                     void *user_data);
+
+#ifdef FASTWARE_MEMORY_TRACE
+constexpr bool trace_enabled{true};
+#else
+constexpr bool trace_enabled{false};
+#endif
+
+struct trace_op_t {
+  enum value : uint64_t {
+    create = 0,
+    destroy,
+    allocate,
+    deallocate,
+    deallocate_all,
+    begin_frame
+  };
+};
+
+// One record per call made by the application, the calls allocators make
+// into their parents and pools are not recorded. Batch calls record one
+// allocate or deallocate per block. Allocators are identified by address,
+// unique until their destroy.
+struct trace_event_t {
+  // nanoseconds since trace_begin
+  uint64_t timestamp : 56;
+  uint64_t op : 8;
+  uint64_t alloc;
+  // the block, null for a failed allocate, the parent allocator on create
+  uint64_t ptr;
+  // size asked for on allocate, handed back on deallocate, the alloc_type_e
+  // on create, the frame count of the arena on begin_frame
+  uint64_t size;
+};
+
+// Appends a trace_event_t to the file at path for every create, allocate,
+// deallocate and destroy until trace_end. False when the file cannot be
+// opened or tracing is compiled out (FASTWARE_MEMORY_TRACE).
+bool trace_begin(const char *path);
+
+// Flushes the pending events and closes the trace file
+void trace_end();
+
 } // namespace memory
 } // namespace fastware
 
@@ -0,0 +1,230 @@
+#ifndef SLOT_MAP_H
+#define SLOT_MAP_H
+
+#include <fastware/memory.h>
+
+#include <algorithm>
+#include <cassert>
+#include <new>
+#include <utility>
+
+namespace fastware {
+namespace memory {
+
+// Low 32 bits index a slot, high 32 bits are the generation of the slot
+// when the handle was made. Generations start at 1, so 0 is never a live
+// handle.
+struct slot_handle_t {
+  uint64_t id;
+
+  friend bool operator==(slot_handle_t lhs, slot_handle_t rhs) {
+    return lhs.id == rhs.id;
+  }
+};
+
+constexpr uint32_t slot_index_bits{32};
+constexpr uint64_t slot_index_mask{(1ull << slot_index_bits) - 1};
+// the last index marks the end of the free list
+constexpr uint32_t max_slot_count{~0u};
+constexpr uint32_t max_slot_generation{~0u};
+constexpr slot_handle_t null_slot_handle{0};
+
+// A free slot keeps the generation its next handle gets and links to the
+// next free slot, a live one points at its value in the dense array
+struct slot_t {
+  uint32_t index;
+  uint32_t generation;
+};
+
+// Fixed capacity map from handles to values packed at the front of a dense
+// array. Erase moves the last value into the hole and bumps the generation
+// of the slot, so handles to erased values are caught and iterating touches
+// live values only. A slot whose generation runs out is retired instead of
+// reused, a stale handle never finds a newer value. Values move around,
+// handles stay valid: never keep a pointer to a value across an insert,
+// erase or sort.
+template <typename T> struct slot_map_t {
+  allocator_t *allocator;
+  memblk block;
+  slot_t *slots;
+  // slot of every dense value, to fix up the slot of a moved value
+  uint32_t *owners;
+  T *values;
+  uint32_t capacity;
+  uint32_t count;
+  uint32_t free_head;
+
+  // [slots][owners][values], one block from allocator. An empty map when
+  // the allocator is out of memory.
+  static slot_map_t create(allocator_t *allocator, uint32_t capacity) {
+    assert(capacity > 0 && capacity <= max_slot_count &&
+           "Invalid slot map capacity");
+
+    const uint64_t values_offset =
+        align(capacity * (sizeof(slot_t) + sizeof(uint32_t)),
+              alignment_t::select(alignof(T) < 8 ? 8 : alignof(T)));
+    const memblk block =
+        allocate(allocator, values_offset + capacity * sizeof(T));
+    if (block.ptr == nullptr) {
+      return {allocator};
+    }
+
+    slot_map_t map{allocator, block};
+    map.slots = static_cast<slot_t *>(block.ptr);
+    map.owners = reinterpret_cast<uint32_t *>(map.slots + capacity);
+    map.values = static_cast<T *>((address{.raw = block.ptr} +
+                                   static_cast<int64_t>(values_offset))
+                                      .raw);
+    map.capacity = capacity;
+    map.count = 0;
+    map.free_head = 0;
+    for (uint32_t i = 0; i < capacity; i++) {
+      map.slots[i] = {i + 1, 1};
+    }
+    return map;
+  }
+
+  void destroy() {
+    clear();
+    if (block.ptr) {
+      deallocate(allocator, block);
+    }
+    *this = {};
+  }
+
+  bool valid() const { return block.ptr != nullptr; }
+
+  // No free slot left, fewer than capacity values once slots are retired
+  bool full() const { return free_head == capacity; }
+
+  // null_slot_handle when full
+  template <typename... args_t> slot_handle_t emplace(args_t &&...args) {
+    if (__builtin_expect(free_head == capacity, false)) {
+      return null_slot_handle;
+    }
+    const uint32_t slot = free_head;
+    free_head = slots[slot].index;
+
+    new (&values[count]) T(std::forward<args_t>(args)...);
+    owners[count] = slot;
+    slots[slot].index = count++;
+    return handle_of(slot);
+  }
+
+  slot_handle_t insert(const T &value) { return emplace(value); }
+
+  slot_handle_t handle_of(uint32_t slot) const {
+    return {uint64_t{slots[slot].generation} << slot_index_bits | slot};
+  }
+
+  // Slot of a live handle, capacity for a stale one. Retired slots have
+  // generation 0, no handle ever has.
+  uint32_t slot_of(slot_handle_t handle) const {
+    const uint64_t slot = handle.id & slot_index_mask;
+    const uint64_t generation = handle.id >> slot_index_bits;
+    if (slot >= capacity || generation == 0 ||
+        slots[slot].generation != generation) {
+      return capacity;
+    }
+    return static_cast<uint32_t>(slot);
+  }
+
+  // The value behind handle, nullptr once it was erased
+  T *get(slot_handle_t handle) const {
+    const uint32_t slot = slot_of(handle);
+    return slot != capacity ? &values[slots[slot].index] : nullptr;
+  }
+
+  bool contains(slot_handle_t handle) const { return get(handle) != nullptr; }
+
+  // False for handles already erased
+  bool erase(slot_handle_t handle) {
+    const uint32_t slot = slot_of(handle);
+    if (slot == capacity) {
+      return false;
+    }
+
+    const uint32_t index = slots[slot].index;
+    const uint32_t last = --count;
+    if (index != last) {
+      values[index] = std::move(values[last]);
+      owners[index] = owners[last];
+      slots[owners[index]].index = index;
+    }
+    values[last].~T();
+
+    // retired, wrapping would make the first handles to it valid again
+    if (slots[slot].generation == max_slot_generation) {
+      slots[slot] = {capacity, 0};
+      return true;
+    }
+    slots[slot] = {free_head, slots[slot].generation + 1};
+    free_head = slot;
+    return true;
+  }
+
+  // Erases every value, handles to them go stale
+  void clear() {
+    while (count) {
+      erase(handle_at(count - 1));
+    }
+  }
+
+  // Handle of the value at a dense index
+  slot_handle_t handle_at(uint32_t index) const {
+    assert(index < count && "Dense index out of range");
+    const uint32_t slot = owners[index];
+    return handle_of(slot);
+  }
+
+  // Exchanges two values in the dense array, their handles follow them
+  void swap_at(uint32_t lhs, uint32_t rhs) {
+    assert(lhs < count && rhs < count && "Dense index out of range");
+    std::swap(values[lhs], values[rhs]);
+    std::swap(owners[lhs], owners[rhs]);
+    slots[owners[lhs]].index = lhs;
+    slots[owners[rhs]].index = rhs;
+  }
+
+  // Reorders the dense array by less, e.g. by material or position so
+  // iteration walks memory in the order it is consumed. Needs count indices
+  // of scratch from the allocator, false and nothing moved without them.
+  template <typename less_t> bool sort(less_t &&less) {
+    if (count < 2) {
+      return true;
+    }
+    const memblk scratch = allocate(allocator, count * sizeof(uint32_t));
+    if (scratch.ptr == nullptr) {
+      return false;
+    }
+    // order[i] is where the value that ends up at i is now
+    uint32_t *order = static_cast<uint32_t *>(scratch.ptr);
+    for (uint32_t i = 0; i < count; i++) {
+      order[i] = i;
+    }
+    std::sort(order, order + count, [this, &less](uint32_t lhs, uint32_t rhs) {
+      return less(values[lhs], values[rhs]);
+    });
+    // values before i are in place, one that was at j < i got swapped to
+    // order[j]
+    for (uint32_t i = 0; i < count; i++) {
+      uint32_t from = order[i];
+      while (from < i) {
+        from = order[from];
+      }
+      if (from != i) {
+        swap_at(i, from);
+      }
+    }
+    deallocate(allocator, scratch);
+    return true;
+  }
+
+  T *begin() const { return values; }
+  T *end() const { return values + count; }
+};
+
+} // namespace memory
+} // namespace fastware
+
+#endif // SLOT_MAP_H
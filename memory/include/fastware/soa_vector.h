@@ -0,0 +1,172 @@
+#ifndef SOA_VECTOR_H
+#define SOA_VECTOR_H
+
+#include <fastware/memory.h>
+
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace fastware {
+namespace memory {
+
+// Growable structure of arrays, one column per type, all in a single block
+// of allocator. Every column starts on its own 64 byte boundary so kernels
+// stream them with aligned vector loads. Growing reallocates the block and
+// moves the columns to their new offsets, never keep a column pointer or
+// span across a push_back, reserve or resize.
+template <typename... Ts> struct soa_vector_t {
+  static_assert(sizeof...(Ts) > 0, "No columns");
+  static_assert((std::is_trivially_copyable_v<Ts> && ...),
+                "Columns are moved with memmove");
+  static_assert(((alignof(Ts) <= alignment_t::b64) && ...),
+                "Columns are only 64 byte aligned");
+
+  static constexpr uint64_t column_count{sizeof...(Ts)};
+  static constexpr uint32_t min_capacity{16};
+
+  template <uint64_t I>
+  using column_t = std::tuple_element_t<I, std::tuple<Ts...>>;
+
+  allocator_t *allocator;
+  memblk block;
+  void *columns[column_count];
+  uint32_t capacity;
+  uint32_t count;
+
+  // Offset of every column for capacity values, the last one is the size of
+  // the whole layout
+  static constexpr std::array<uint64_t, column_count + 1>
+  layout(uint32_t capacity) {
+    constexpr uint64_t sizes[]{sizeof(Ts)...};
+    std::array<uint64_t, column_count + 1> offsets{};
+    for (uint64_t i = 0; i < column_count; i++) {
+      offsets[i + 1] =
+          align(offsets[i] + capacity * sizes[i], alignment_t::b64);
+    }
+    return offsets;
+  }
+
+  // Bytes asked from the allocator for capacity values, the block may be
+  // less aligned than the columns
+  static constexpr uint64_t storage_size(uint32_t capacity) {
+    return layout(capacity)[column_count] +
+           alignment_t::mask(alignment_t::b64);
+  }
+
+  // An empty vector when the allocator is out of memory, it still grows on
+  // push_back
+  static soa_vector_t create(allocator_t *allocator, uint32_t capacity) {
+    soa_vector_t vector{allocator};
+    vector.reserve(capacity);
+    return vector;
+  }
+
+  void destroy() {
+    if (block.ptr) {
+      deallocate(allocator, block);
+    }
+    *this = {};
+  }
+
+  bool valid() const { return block.ptr != nullptr; }
+
+  // Room for new_capacity values, false and nothing moved when the
+  // allocator has no room
+  bool reserve(uint32_t new_capacity) {
+    if (new_capacity <= capacity) {
+      return true;
+    }
+    const uint64_t size = storage_size(new_capacity);
+    const memblk grown = block.ptr ? reallocate(allocator, block, size)
+                                   : allocate(allocator, size);
+    if (grown.ptr == nullptr) {
+      return false;
+    }
+
+    // the old columns sit at the same place in the grown block
+    constexpr uint64_t sizes[]{sizeof(Ts)...};
+    address moved[column_count];
+    address placed[column_count];
+    const std::array<uint64_t, column_count + 1> offsets =
+        layout(new_capacity);
+    const address base{.idx = align(grown.addr, alignment_t::b64)};
+    for (uint64_t i = 0; i < column_count; i++) {
+      moved[i] = address{.raw = grown.ptr} +
+                 static_cast<int64_t>(address{.raw = columns[i]} -
+                                      address{.raw = block.ptr});
+      placed[i] = base + static_cast<int64_t>(offsets[i]);
+    }
+    // columns moving down go lowest first and the ones moving up highest
+    // first, so none is overwritten before it moved
+    for (uint64_t i = 0; block.ptr && i < column_count; i++) {
+      if (placed[i].idx < moved[i].idx) {
+        memmove(placed[i], moved[i], count * sizes[i]);
+      }
+    }
+    for (uint64_t i = column_count; block.ptr && i > 0; i--) {
+      if (placed[i - 1].idx > moved[i - 1].idx) {
+        memmove(placed[i - 1], moved[i - 1], count * sizes[i - 1]);
+      }
+    }
+
+    for (uint64_t i = 0; i < column_count; i++) {
+      columns[i] = placed[i];
+    }
+    block = grown;
+    capacity = new_capacity;
+    return true;
+  }
+
+  // New values are left as the allocator hands them out, like the fixed
+  // arrays they replace they are meant to be filled by a kernel
+  bool resize(uint32_t new_count) {
+    if (!reserve(new_count)) {
+      return false;
+    }
+    count = new_count;
+    return true;
+  }
+
+  // Doubles the capacity when full, false when that fails
+  bool push_back(const Ts &...values) {
+    if (__builtin_expect(count == capacity, false) &&
+        !reserve(capacity ? 2 * capacity : min_capacity)) {
+      return false;
+    }
+    [&]<uint64_t... Is>(std::index_sequence<Is...>) {
+      ((data<Is>()[count] = values), ...);
+    }(std::index_sequence_for<Ts...>{});
+    count++;
+    return true;
+  }
+
+  // The last values take the place of the erased ones, order is not kept
+  void swap_remove(uint32_t index) {
+    assert(index < count && "Index out of range");
+    const uint32_t last = --count;
+    [&]<uint64_t... Is>(std::index_sequence<Is...>) {
+      ((data<Is>()[index] = data<Is>()[last]), ...);
+    }(std::index_sequence_for<Ts...>{});
+  }
+
+  void clear() { count = 0; }
+
+  template <uint64_t I> column_t<I> *data() const {
+    return static_cast<column_t<I> *>(columns[I]);
+  }
+
+  // The live values of a column
+  template <uint64_t I> std::span<column_t<I>> column() const {
+    return {data<I>(), count};
+  }
+};
+
+} // namespace memory
+} // namespace fastware
+
+#endif // SOA_VECTOR_H
@@ -0,0 +1,93 @@
+#ifndef STD_ALLOCATOR_H
+#define STD_ALLOCATOR_H
+
+#include <fastware/memory.h>
+
+#include <cassert>
+#include <cstdlib>
+#include <memory_resource>
+
+namespace fastware {
+namespace memory {
+
+// Both adapters ask for prefered_size of the requested bytes and deallocate
+// rebuilds the memblk with allocated_size from the size the container passes
+// back. Out of memory, or a request larger than the allocator serves, aborts
+// since there are no exceptions to throw.
+
+inline void *std_allocate(allocator_t *alloc, size_t bytes) {
+  const uint64_t size = prefered_size(alloc, bytes);
+  const memblk blk =
+      size ? memory::allocate(alloc, size) : memblk{{nullptr}, 0};
+  if (__builtin_expect(blk.ptr == nullptr, false)) {
+    std::abort();
+  }
+  return blk.ptr;
+}
+
+inline void std_deallocate(allocator_t *alloc, void *ptr, size_t bytes) {
+  memory::deallocate(
+      alloc, {{ptr}, allocated_size(alloc, ptr, prefered_size(alloc, bytes))});
+}
+
+// Lets std::pmr containers allocate from any allocator_t. Without rtti
+// another resource cannot be asked what it wraps, so two resources are only
+// equal when they are the same object.
+class memory_resource final : public std::pmr::memory_resource {
+public:
+  explicit memory_resource(allocator_t *alloc) : alloc(alloc) {}
+
+  allocator_t *allocator() const { return alloc; }
+
+private:
+  void *do_allocate(size_t bytes, size_t alignment) override {
+    void *ptr = std_allocate(alloc, bytes);
+    assert(is_aligned(ptr, static_cast<alignment_t::value>(alignment)) &&
+           "Allocator alignment too small for the container");
+    (void)alignment;
+    return ptr;
+  }
+
+  void do_deallocate(void *ptr, size_t bytes, size_t) override {
+    std_deallocate(alloc, ptr, bytes);
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource &other) const
+      noexcept override {
+    return this == &other;
+  }
+
+  allocator_t *alloc;
+};
+
+// Stateful std::allocator replacement for containers outside std::pmr
+template <typename T> struct std_allocator {
+  using value_type = T;
+
+  allocator_t *alloc;
+
+  explicit std_allocator(allocator_t *alloc) : alloc(alloc) {}
+
+  template <typename U>
+  std_allocator(const std_allocator<U> &other) : alloc(other.alloc) {}
+
+  T *allocate(size_t n) {
+    void *ptr = std_allocate(alloc, sizeof(T) * n);
+    assert(is_aligned(ptr, static_cast<alignment_t::value>(alignof(T))) &&
+           "Allocator alignment too small for the type");
+    return static_cast<T *>(ptr);
+  }
+
+  void deallocate(T *ptr, size_t n) {
+    std_deallocate(alloc, ptr, sizeof(T) * n);
+  }
+
+  template <typename U> bool operator==(const std_allocator<U> &other) const {
+    return alloc == other.alloc;
+  }
+};
+
+} // namespace memory
+} // namespace fastware
+
+#endif // STD_ALLOCATOR_H
@@ -0,0 +1,570 @@
+#ifndef TYPED_ALLOCATOR_H
+#define TYPED_ALLOCATOR_H
+
+#include <fastware/memory.h>
+
+#include <cassert>
+
+namespace fastware {
+namespace memory {
+
+// Layouts shared with memory.cpp so the typed front-end can inline the bump
+// and free list paths. Only the allocators with such a path live here.
+struct allocator_t {};
+
+enum class alloc_type_e : uint64_t {
+  none = 0,
+  stack,
+  virtual_stack,
+  concurrent_stack,
+  frame_arena,
+  pool,
+  concurrent_pool,
+  bitmap_pool,
+  thread_cache,
+  slab,
+  tlsf,
+  fallback,
+  segregator,
+  affix,
+  budget
+};
+
+struct stack_allocator_t : allocator_t {
+  alloc_type_e type;
+  address block_start;
+  address mem_space_start;
+  address mem_space_end;
+  alignment_t::value alignment;
+  allocator_t *parent;
+  uint64_t size;
+  uint64_t backing;
+};
+
+// Pools map between a block and its index in the control blocks. Power of 2
+// blocks shift, any other size multiplies by ceil(2^64 / block size) and
+// keeps the high half, exact for offsets that are a multiple of the block
+// size. The reciprocal is 0 for power of 2 blocks.
+constexpr uint64_t block_reciprocal(uint64_t block_size) {
+  return (block_size & (block_size - 1)) ? ~0ul / block_size + 1 : 0;
+}
+
+constexpr uint64_t block_index(uint64_t offset, uint64_t block_shift,
+                               uint64_t reciprocal) {
+  using wide_t = unsigned __int128;
+  return reciprocal
+             ? static_cast<uint64_t>((wide_t{offset} * reciprocal) >> 64)
+             : offset >> block_shift;
+}
+
+constexpr uint64_t block_offset(uint64_t index, uint64_t block_shift,
+                                uint64_t reciprocal, uint64_t block_size) {
+  return reciprocal ? index * block_size : index << block_shift;
+}
+
+struct pool_allocator_t : allocator_t {
+  alloc_type_e type;
+  address mem_space_start;
+  address mem_space_end;
+  allocator_t *parent;
+  uint64_t size;
+  uint64_t block_count;
+  uint64_t aligned_block_size;
+  alignment_t::value alignment;
+  uint64_t block_shift;
+  uint64_t block_reciprocal;
+  uint64_t backing;
+  address *block_start;
+  // Control blocks from untouched on were not handed out since the last
+  // reset, they are free without being on the list starting at block_start
+  address *untouched;
+  address control_blocks[];
+};
+
+// One occupancy bit per block, set while the block is live. Bits past
+// block_count stay clear and are never handed out since every block before
+// them is taken by then. free_word is the lowest word that may have a clear
+// bit.
+struct bitmap_pool_allocator_t : allocator_t {
+  alloc_type_e type;
+  address mem_space_start;
+  address mem_space_end;
+  allocator_t *parent;
+  uint64_t size;
+  uint64_t block_count;
+  uint64_t aligned_block_size;
+  alignment_t::value alignment;
+  uint64_t block_shift;
+  uint64_t block_reciprocal;
+  uint64_t backing;
+  uint64_t word_count;
+  uint64_t free_word;
+  uint64_t live_bits[];
+};
+
+// Statically dispatched view of an allocator made by create(). The static
+// members are the allocator paths themselves, memory.cpp dispatches to them.
+// With FASTWARE_MEMORY_STATS or FASTWARE_MEMORY_TRACE the members go through
+// the type-erased API so the counters and the trace stay right.
+template <typename T> struct typed_allocator;
+
+template <> struct typed_allocator<stack_allocator_t> {
+  stack_allocator_t *alloc;
+
+  static typed_allocator from(allocator_t *alloc) {
+    assert(*reinterpret_cast<alloc_type_e *>(alloc) == alloc_type_e::stack &&
+           "Not a stack allocator");
+    return {static_cast<stack_allocator_t *>(alloc)};
+  }
+
+  static memblk allocate(stack_allocator_t *alloc, uint64_t size) {
+    const uint64_t aligned_size = align(size, alloc->alignment);
+
+    const address current_head = alloc->block_start;
+    const address next_head = current_head + aligned_size;
+
+    if (__builtin_expect(next_head.idx > alloc->mem_space_end.idx, false)) {
+      // out of memory
+      return {nullptr, 0};
+    }
+
+    alloc->block_start = next_head;
+
+    return {current_head, aligned_size};
+  }
+
+  // One bump for as many of the count blocks as fit
+  static uint64_t allocate_n(stack_allocator_t *alloc, uint64_t size,
+                             uint64_t count, memblk *out) {
+    const uint64_t aligned_size = align(size, alloc->alignment);
+    const uint64_t space = alloc->mem_space_end - alloc->block_start;
+    const uint64_t available = aligned_size ? space / aligned_size : count;
+    const uint64_t taken = count < available ? count : available;
+
+    const address head = alloc->block_start;
+    for (uint64_t i = 0; i < taken; i++) {
+      out[i] = {(head + i * aligned_size).raw, aligned_size};
+    }
+    alloc->block_start = head + taken * aligned_size;
+
+    return taken;
+  }
+
+  static void deallocate(stack_allocator_t *alloc, memblk blk) {
+    const address adjusted_head = alloc->block_start - blk.size;
+    if (adjusted_head.raw == blk.ptr) {
+      // This was the last allocation
+      alloc->block_start = adjusted_head;
+    }
+    // We cannot deallocate from the middle of the stack allocator
+  }
+
+  // Last to first, so a batch from allocate_n pops entirely
+  static void deallocate_n(stack_allocator_t *alloc, const memblk *blks,
+                           uint64_t count) {
+    for (uint64_t i = count; i > 0; i--) {
+      deallocate(alloc, blks[i - 1]);
+    }
+  }
+
+  static void deallocate_all(stack_allocator_t *alloc) {
+    alloc->block_start = alloc->mem_space_start;
+  }
+
+  static uint64_t prefered_size(stack_allocator_t *alloc, uint64_t size) {
+    return align(size, alloc->alignment);
+  }
+
+  // Only the top allocation grows, by bumping past its end
+  static bool expand(stack_allocator_t *alloc, memblk *blk, uint64_t delta) {
+    const uint64_t aligned_delta = align(delta, alloc->alignment);
+    const address end = address{.raw = blk->ptr} + blk->size;
+    if (end.raw != alloc->block_start.raw ||
+        aligned_delta > alloc->mem_space_end - end) {
+      return false;
+    }
+    alloc->block_start = end + aligned_delta;
+    blk->size += aligned_delta;
+    return true;
+  }
+
+  static bool owns(stack_allocator_t *alloc, memblk blk) {
+    return (blk.ptr >= alloc->mem_space_start.raw) &
+           (blk.ptr < alloc->mem_space_end.raw);
+  }
+
+#if defined(FASTWARE_MEMORY_STATS) || defined(FASTWARE_MEMORY_TRACE)
+  memblk allocate(uint64_t size) const {
+    return memory::allocate(alloc, size);
+  }
+  uint64_t allocate_n(uint64_t size, uint64_t count, memblk *out) const {
+    return memory::allocate_n(alloc, size, count, out);
+  }
+  void deallocate(memblk blk) const { memory::deallocate(alloc, blk); }
+  void deallocate_n(const memblk *blks, uint64_t count) const {
+    memory::deallocate_n(alloc, blks, count);
+  }
+  void deallocate_all() const { memory::deallocate_all(alloc); }
+  bool expand(memblk *blk, uint64_t delta) const {
+    return memory::expand(alloc, blk, delta);
+  }
+#else
+  memblk allocate(uint64_t size) const { return allocate(alloc, size); }
+  uint64_t allocate_n(uint64_t size, uint64_t count, memblk *out) const {
+    return allocate_n(alloc, size, count, out);
+  }
+  void deallocate(memblk blk) const { deallocate(alloc, blk); }
+  void deallocate_n(const memblk *blks, uint64_t count) const {
+    deallocate_n(alloc, blks, count);
+  }
+  void deallocate_all() const { deallocate_all(alloc); }
+  bool expand(memblk *blk, uint64_t delta) const {
+    return expand(alloc, blk, delta);
+  }
+#endif
+  uint64_t prefered_size(uint64_t size) const {
+    return prefered_size(alloc, size);
+  }
+  bool owns(memblk blk) const { return owns(alloc, blk); }
+};
+
+template <> struct typed_allocator<pool_allocator_t> {
+  pool_allocator_t *alloc;
+
+  static typed_allocator from(allocator_t *alloc) {
+    assert(*reinterpret_cast<alloc_type_e *>(alloc) == alloc_type_e::pool &&
+           "Not a single threaded pool allocator");
+    return {static_cast<pool_allocator_t *>(alloc)};
+  }
+
+  static uint64_t block_offset(const pool_allocator_t *alloc,
+                               const address *control_block) {
+    return memory::block_offset(
+        static_cast<uint64_t>(control_block - alloc->control_blocks),
+        alloc->block_shift, alloc->block_reciprocal, alloc->aligned_block_size);
+  }
+
+  static address *control_of(pool_allocator_t *alloc, memblk blk) {
+    const uint64_t offset = address{.raw = blk.ptr} - alloc->mem_space_start;
+    return &alloc->control_blocks[block_index(offset, alloc->block_shift,
+                                              alloc->block_reciprocal)];
+  }
+
+  static memblk allocate(pool_allocator_t *alloc, uint64_t size) {
+    const uint64_t aligned_size = align(size, alloc->alignment);
+    assert(alloc->aligned_block_size == aligned_size && "Invalid block size");
+
+    address *control_block = alloc->block_start;
+    if (control_block != nullptr) {
+      alloc->block_start = static_cast<address *>(control_block->raw);
+    } else if (alloc->untouched !=
+               &alloc->control_blocks[alloc->block_count]) {
+      control_block = alloc->untouched++;
+    } else {
+      // out of memory
+      return {nullptr, 0};
+    }
+
+    const address offset_address =
+        alloc->mem_space_start + block_offset(alloc, control_block);
+
+    return {offset_address.raw, aligned_size};
+  }
+
+  // Unlinks up to count blocks off the front of the free list, the rest
+  // comes from the untouched blocks
+  static uint64_t allocate_n(pool_allocator_t *alloc, uint64_t size,
+                             uint64_t count, memblk *out) {
+    assert(alloc->aligned_block_size == align(size, alloc->alignment) &&
+           "Invalid block size");
+    (void)size;
+
+    address *node = alloc->block_start;
+    uint64_t taken = 0;
+    while ((node != nullptr) & (taken < count)) {
+      out[taken++] = {
+          (alloc->mem_space_start + block_offset(alloc, node)).raw,
+          alloc->aligned_block_size};
+      node = static_cast<address *>(node->raw);
+    }
+    alloc->block_start = node;
+
+    address *const end = &alloc->control_blocks[alloc->block_count];
+    while ((alloc->untouched != end) & (taken < count)) {
+      out[taken++] = {
+          (alloc->mem_space_start + block_offset(alloc, alloc->untouched++))
+              .raw,
+          alloc->aligned_block_size};
+    }
+
+    return taken;
+  }
+
+  static void deallocate(pool_allocator_t *alloc, memblk blk) {
+    assert(alloc->aligned_block_size == blk.size &&
+           "Not a correct block size");
+    address *control_block = control_of(alloc, blk);
+    control_block->raw = alloc->block_start;
+    alloc->block_start = control_block;
+  }
+
+  // Links the blocks among themselves and splices the chain in once
+  static void deallocate_n(pool_allocator_t *alloc, const memblk *blks,
+                           uint64_t count) {
+    if (count == 0) {
+      return;
+    }
+    address *first = nullptr;
+    address *last = nullptr;
+    for (uint64_t i = 0; i < count; i++) {
+      assert(alloc->aligned_block_size == blks[i].size &&
+             "Not a correct block size");
+      address *control_block = control_of(alloc, blks[i]);
+      if (last) {
+        last->raw = control_block;
+      } else {
+        first = control_block;
+      }
+      last = control_block;
+    }
+    last->raw = alloc->block_start;
+    alloc->block_start = first;
+  }
+
+  // Nothing is linked, every block is untouched again
+  static void deallocate_all(pool_allocator_t *alloc) {
+    alloc->block_start = nullptr;
+    alloc->untouched = &alloc->control_blocks[0];
+  }
+
+  static uint64_t prefered_size(pool_allocator_t *alloc, uint64_t size) {
+    return size > alloc->aligned_block_size ? 0 : alloc->aligned_block_size;
+  }
+
+  // A block grows up to the block size and no further
+  static bool expand(pool_allocator_t *alloc, memblk *blk, uint64_t delta) {
+    if (blk->size + delta > alloc->aligned_block_size) {
+      return false;
+    }
+    blk->size = alloc->aligned_block_size;
+    return true;
+  }
+
+  static bool owns(pool_allocator_t *alloc, memblk blk) {
+    return (blk.ptr >= alloc->mem_space_start.raw) &
+           (blk.ptr < alloc->mem_space_end.raw);
+  }
+
+#if defined(FASTWARE_MEMORY_STATS) || defined(FASTWARE_MEMORY_TRACE)
+  memblk allocate(uint64_t size) const {
+    return memory::allocate(alloc, size);
+  }
+  uint64_t allocate_n(uint64_t size, uint64_t count, memblk *out) const {
+    return memory::allocate_n(alloc, size, count, out);
+  }
+  void deallocate(memblk blk) const { memory::deallocate(alloc, blk); }
+  void deallocate_n(const memblk *blks, uint64_t count) const {
+    memory::deallocate_n(alloc, blks, count);
+  }
+  void deallocate_all() const { memory::deallocate_all(alloc); }
+  bool expand(memblk *blk, uint64_t delta) const {
+    return memory::expand(alloc, blk, delta);
+  }
+#else
+  memblk allocate(uint64_t size) const { return allocate(alloc, size); }
+  uint64_t allocate_n(uint64_t size, uint64_t count, memblk *out) const {
+    return allocate_n(alloc, size, count, out);
+  }
+  void deallocate(memblk blk) const { deallocate(alloc, blk); }
+  void deallocate_n(const memblk *blks, uint64_t count) const {
+    deallocate_n(alloc, blks, count);
+  }
+  void deallocate_all() const { deallocate_all(alloc); }
+  bool expand(memblk *blk, uint64_t delta) const {
+    return expand(alloc, blk, delta);
+  }
+#endif
+  uint64_t prefered_size(uint64_t size) const {
+    return prefered_size(alloc, size);
+  }
+  bool owns(memblk blk) const { return owns(alloc, blk); }
+};
+
+template <> struct typed_allocator<bitmap_pool_allocator_t> {
+  bitmap_pool_allocator_t *alloc;
+
+  static typed_allocator from(allocator_t *alloc) {
+    assert(*reinterpret_cast<alloc_type_e *>(alloc) ==
+               alloc_type_e::bitmap_pool &&
+           "Not a bitmap pool allocator");
+    return {static_cast<bitmap_pool_allocator_t *>(alloc)};
+  }
+
+  static memblk block_of(const bitmap_pool_allocator_t *alloc,
+                         uint64_t index) {
+    return {(alloc->mem_space_start +
+             memory::block_offset(index, alloc->block_shift,
+                                  alloc->block_reciprocal,
+                                  alloc->aligned_block_size))
+                .raw,
+            alloc->aligned_block_size};
+  }
+
+  static uint64_t index_of(const bitmap_pool_allocator_t *alloc, memblk blk) {
+    return block_index(address{.raw = blk.ptr} - alloc->mem_space_start,
+                       alloc->block_shift, alloc->block_reciprocal);
+  }
+
+  // First fit, lowest free block
+  static memblk allocate(bitmap_pool_allocator_t *alloc, uint64_t size) {
+    assert(alloc->aligned_block_size == align(size, alloc->alignment) &&
+           "Invalid block size");
+    (void)size;
+
+    for (uint64_t w = alloc->free_word; w < alloc->word_count; w++) {
+      const uint64_t word = alloc->live_bits[w];
+      if (word == ~0ul) {
+        continue;
+      }
+      alloc->free_word = w;
+      const uint64_t index = w * 64 + __builtin_ctzl(~word);
+      if (__builtin_expect(index >= alloc->block_count, false)) {
+        break;
+      }
+      alloc->live_bits[w] = word | (1ul << (index & 63));
+      return block_of(alloc, index);
+    }
+    // out of memory
+    alloc->free_word = alloc->word_count;
+    return {nullptr, 0};
+  }
+
+  // Takes every clear bit of a word before moving to the next one
+  static uint64_t allocate_n(bitmap_pool_allocator_t *alloc, uint64_t size,
+                             uint64_t count, memblk *out) {
+    assert(alloc->aligned_block_size == align(size, alloc->alignment) &&
+           "Invalid block size");
+    (void)size;
+
+    uint64_t taken = 0;
+    uint64_t w = alloc->free_word;
+    for (; w < alloc->word_count && taken < count; w++) {
+      uint64_t word = alloc->live_bits[w];
+      while (word != ~0ul && taken < count) {
+        const uint64_t index = w * 64 + __builtin_ctzl(~word);
+        if (__builtin_expect(index >= alloc->block_count, false)) {
+          break;
+        }
+        word |= 1ul << (index & 63);
+        out[taken++] = block_of(alloc, index);
+      }
+      alloc->live_bits[w] = word;
+      if (word != ~0ul) {
+        break;
+      }
+    }
+    alloc->free_word = w;
+
+    return taken;
+  }
+
+  static void deallocate(bitmap_pool_allocator_t *alloc, memblk blk) {
+    assert(alloc->aligned_block_size == blk.size &&
+           "Not a correct block size");
+    const uint64_t index = index_of(alloc, blk);
+    const uint64_t w = index >> 6;
+    assert((alloc->live_bits[w] & (1ul << (index & 63))) &&
+           "Block is not live");
+    alloc->live_bits[w] &= ~(1ul << (index & 63));
+    alloc->free_word = w < alloc->free_word ? w : alloc->free_word;
+  }
+
+  static void deallocate_n(bitmap_pool_allocator_t *alloc, const memblk *blks,
+                           uint64_t count) {
+    for (uint64_t i = 0; i < count; i++) {
+      deallocate(alloc, blks[i]);
+    }
+  }
+
+  static void deallocate_all(bitmap_pool_allocator_t *alloc) {
+    for (uint64_t w = 0; w < alloc->word_count; w++) {
+      alloc->live_bits[w] = 0;
+    }
+    alloc->free_word = 0;
+  }
+
+  static uint64_t prefered_size(bitmap_pool_allocator_t *alloc,
+                                uint64_t size) {
+    return size > alloc->aligned_block_size ? 0 : alloc->aligned_block_size;
+  }
+
+  static bool expand(bitmap_pool_allocator_t *alloc, memblk *blk,
+                     uint64_t delta) {
+    if (blk->size + delta > alloc->aligned_block_size) {
+      return false;
+    }
+    blk->size = alloc->aligned_block_size;
+    return true;
+  }
+
+  static bool owns(bitmap_pool_allocator_t *alloc, memblk blk) {
+    return (blk.ptr >= alloc->mem_space_start.raw) &
+           (blk.ptr < alloc->mem_space_end.raw);
+  }
+
+  // Every live block in address order. fn may deallocate the block it is
+  // given but must not allocate from the pool.
+  template <typename fn_t>
+  static void for_each_live(bitmap_pool_allocator_t *alloc, fn_t &&fn) {
+    for (uint64_t w = 0; w < alloc->word_count; w++) {
+      uint64_t word = alloc->live_bits[w];
+      while (word) {
+        const uint64_t index = w * 64 + __builtin_ctzl(word);
+        word &= word - 1;
+        fn(block_of(alloc, index));
+      }
+    }
+  }
+
+#if defined(FASTWARE_MEMORY_STATS) || defined(FASTWARE_MEMORY_TRACE)
+  memblk allocate(uint64_t size) const {
+    return memory::allocate(alloc, size);
+  }
+  uint64_t allocate_n(uint64_t size, uint64_t count, memblk *out) const {
+    return memory::allocate_n(alloc, size, count, out);
+  }
+  void deallocate(memblk blk) const { memory::deallocate(alloc, blk); }
+  void deallocate_n(const memblk *blks, uint64_t count) const {
+    memory::deallocate_n(alloc, blks, count);
+  }
+  void deallocate_all() const { memory::deallocate_all(alloc); }
+  bool expand(memblk *blk, uint64_t delta) const {
+    return memory::expand(alloc, blk, delta);
+  }
+#else
+  memblk allocate(uint64_t size) const { return allocate(alloc, size); }
+  uint64_t allocate_n(uint64_t size, uint64_t count, memblk *out) const {
+    return allocate_n(alloc, size, count, out);
+  }
+  void deallocate(memblk blk) const { deallocate(alloc, blk); }
+  void deallocate_n(const memblk *blks, uint64_t count) const {
+    deallocate_n(alloc, blks, count);
+  }
+  void deallocate_all() const { deallocate_all(alloc); }
+  bool expand(memblk *blk, uint64_t delta) const {
+    return expand(alloc, blk, delta);
+  }
+#endif
+  uint64_t prefered_size(uint64_t size) const {
+    return prefered_size(alloc, size);
+  }
+  bool owns(memblk blk) const { return owns(alloc, blk); }
+  template <typename fn_t> void for_each_live(fn_t &&fn) const {
+    for_each_live(alloc, static_cast<fn_t &&>(fn));
+  }
+};
+
+} // namespace memory
+} // namespace fastware
+
+#endif // TYPED_ALLOCATOR_H
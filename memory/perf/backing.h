@@ -0,0 +1,104 @@
+#include <benchmark/benchmark.h>
+
+#include <fastware/memory.h>
+
+#include <cglm/struct.h>
+
+namespace {
+// Same arrays and pass as setup::compute_gpu_matrixes in game_app
+struct matrix_pass_data_t {
+  mat4s *models;
+  mat4s *animations;
+  mat4s *model_transforms;
+  mat3s *normal_transforms;
+};
+
+matrix_pass_data_t allocate_matrix_pass(fastware::memory::allocator_t *alloc,
+                                        uint64_t count) {
+  using namespace fastware::memory;
+  return {static_cast<mat4s *>(allocate(alloc, sizeof(mat4s) * count).ptr),
+          static_cast<mat4s *>(allocate(alloc, sizeof(mat4s) * count).ptr),
+          static_cast<mat4s *>(allocate(alloc, sizeof(mat4s) * count).ptr),
+          static_cast<mat3s *>(allocate(alloc, sizeof(mat3s) * count).ptr)};
+}
+
+void run_matrix_pass(matrix_pass_data_t *data, uint64_t count) {
+  for (uint64_t i = 0; i < count; ++i) {
+    data->model_transforms[i] =
+        glms_mat4_mul(data->models[i], data->animations[i]);
+    data->normal_transforms[i] = glms_mat4_pick3(
+        glms_mat4_transpose(glms_mat4_inv(data->model_transforms[i])));
+  }
+}
+
+uint64_t matrix_pass_size(uint64_t count) {
+  return count * (3 * sizeof(mat4s) + sizeof(mat3s)) + 4 * 64;
+}
+} // namespace
+
+// Steady state passes, backing pages are already faulted in
+static void memory_backing_matrix_pass(benchmark::State &state) {
+  const uint64_t count = state.range(0);
+  const uint64_t backing = state.range(1);
+  using namespace fastware::memory;
+
+  stack_alloc_create_info_t create_info{nullptr, matrix_pass_size(count),
+                                        alignment_t::b64, stack_flags_t::none,
+                                        backing};
+  allocator_t *alloc = create(&create_info);
+
+  matrix_pass_data_t data = allocate_matrix_pass(alloc, count);
+  for (uint64_t i = 0; i < count; ++i) {
+    data.models[i] = glms_translate_make(vec3s{{float(i), 0.f, 0.f}});
+    data.animations[i] = glms_rotate_make(float(i), vec3s{{0.f, 1.f, 0.f}});
+  }
+
+  for (auto _ : state) {
+    run_matrix_pass(&data, count);
+    benchmark::ClobberMemory();
+  }
+
+  destroy(alloc);
+
+  state.SetBytesProcessed(state.iterations() * matrix_pass_size(count));
+}
+
+// Create the arrays and run the first pass, page fault cost included
+static void memory_backing_first_pass(benchmark::State &state) {
+  const uint64_t count = state.range(0);
+  const uint64_t backing = state.range(1);
+  using namespace fastware::memory;
+
+  for (auto _ : state) {
+    stack_alloc_create_info_t create_info{nullptr, matrix_pass_size(count),
+                                          alignment_t::b64,
+                                          stack_flags_t::none, backing};
+    allocator_t *alloc = create(&create_info);
+
+    matrix_pass_data_t data = allocate_matrix_pass(alloc, count);
+    for (uint64_t i = 0; i < count; ++i) {
+      data.models[i] = glms_mat4_identity();
+      data.animations[i] = glms_mat4_identity();
+    }
+    run_matrix_pass(&data, count);
+    benchmark::ClobberMemory();
+
+    destroy(alloc);
+  }
+
+  state.SetBytesProcessed(state.iterations() * matrix_pass_size(count));
+}
+
+static void backing_args(benchmark::internal::Benchmark *bench) {
+  using namespace fastware::memory;
+  const int64_t backings[]{
+      backing_flags_t::none, backing_flags_t::populate,
+      backing_flags_t::huge_pages, backing_flags_t::transparent_huge_pages,
+      backing_flags_t::transparent_huge_pages | backing_flags_t::populate};
+  for (int64_t backing : backings) {
+    bench->Args({200000, backing});
+  }
+}
+
+BENCHMARK(memory_backing_matrix_pass)->Apply(backing_args);
+BENCHMARK(memory_backing_first_pass)->Apply(backing_args);
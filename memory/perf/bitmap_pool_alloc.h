@@ -0,0 +1,109 @@
+#include <benchmark/benchmark.h>
+
+#include <fastware/memory.h>
+#include <fastware/typed_allocator.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+static void memory_bitmap_pool_allocator_alloc(benchmark::State &state) {
+  const int num_allocs = state.range(0);
+  const int alloc_size = state.range(1);
+  const int alignment = state.range(2);
+  using namespace fastware::memory;
+
+  pool_alloc_create_info_t create_info{
+      nullptr, align(alloc_size, static_cast<alignment_t::value>(alignment)),
+      static_cast<alignment_t::value>(alignment),
+      static_cast<uint64_t>(num_allocs), pool_flags_t::bitmap};
+  allocator_t *alloc = create(&create_info);
+
+  for (auto _ : state) {
+
+    for (int i = 0; i < num_allocs; i++) {
+      auto blk = allocate(alloc, alloc_size);
+      benchmark::DoNotOptimize(blk);
+    }
+    benchmark::ClobberMemory();
+
+    state.PauseTiming();
+    deallocate_all(alloc);
+    benchmark::ClobberMemory();
+    state.ResumeTiming();
+  }
+
+  destroy(alloc);
+
+  state.counters["PerAlloc"] = benchmark::Counter(
+      num_allocs * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(memory_bitmap_pool_allocator_alloc)
+    ->Args({100, 17, 32})
+    ->Args({1000, 17, 32})
+    ->Args({10000, 17, 32});
+BENCHMARK(memory_bitmap_pool_allocator_alloc)
+    ->Args({100, 55, 32})
+    ->Args({1000, 55, 32})
+    ->Args({10000, 55, 32});
+BENCHMARK(memory_bitmap_pool_allocator_alloc)
+    ->Args({100, 256, 32})
+    ->Args({1000, 256, 32})
+    ->Args({10000, 256, 32});
+
+// Per frame "update every live object" pass after churn left the pool half
+// empty and the free list shuffled. The free list pool has to keep its own
+// list of live blocks, the bitmap pool walks its bits in address order.
+static void memory_pool_live_sweep(benchmark::State &state) {
+  const uint64_t num_objects = state.range(0);
+  const uint64_t object_size = state.range(1);
+  const bool bitmap = state.range(2);
+  using namespace fastware::memory;
+
+  pool_alloc_create_info_t create_info{
+      nullptr, object_size, alignment_t::b16, num_objects,
+      bitmap ? pool_flags_t::bitmap : pool_flags_t::none};
+  allocator_t *alloc = create(&create_info);
+
+  std::vector<memblk> live(num_objects);
+  allocate_n(alloc, object_size, num_objects, live.data());
+
+  // free a random half, then bring back a quarter through the free list
+  std::mt19937 rng(42);
+  std::shuffle(live.begin(), live.end(), rng);
+  deallocate_n(alloc, live.data() + num_objects / 2, num_objects / 2);
+  live.resize(num_objects / 2);
+  for (uint64_t i = 0; i < num_objects / 4; i++) {
+    live.push_back(allocate(alloc, object_size));
+  }
+  for (const memblk &blk : live) {
+    *static_cast<uint64_t *>(blk.ptr) = 1;
+  }
+
+  for (auto _ : state) {
+    uint64_t sum = 0;
+    if (bitmap) {
+      typed_allocator<bitmap_pool_allocator_t>::from(alloc).for_each_live(
+          [&sum](memblk blk) { sum += *static_cast<uint64_t *>(blk.ptr); });
+    } else {
+      for (const memblk &blk : live) {
+        sum += *static_cast<uint64_t *>(blk.ptr);
+      }
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+
+  destroy(alloc);
+
+  state.counters["PerObject"] = benchmark::Counter(
+      static_cast<double>(live.size()) * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(memory_pool_live_sweep)
+    ->Args({200000, 64, 0})
+    ->Args({200000, 64, 1})
+    ->Args({200000, 256, 0})
+    ->Args({200000, 256, 1});
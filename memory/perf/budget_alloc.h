@@ -0,0 +1,58 @@
+#include <benchmark/benchmark.h>
+
+#include <fastware/memory.h>
+
+#include <algorithm>
+#include <random>
+
+#include "workload.h"
+
+// memory_tlsf_allocator_mixed through a budget, the price of charging every
+// block with atomics
+static void memory_budget_allocator_mixed(benchmark::State &state) {
+  const int num_allocs = state.range(0);
+  const int max_size = state.range(1);
+  using namespace fastware::memory;
+
+  const auto sizes = mixed_sizes(num_allocs, max_size);
+
+  std::vector<int> order(num_allocs);
+  for (int i = 0; i < num_allocs; i++) {
+    order[i] = i;
+  }
+  std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+  const uint64_t capacity = static_cast<uint64_t>(num_allocs) * (max_size + 64);
+  tlsf_alloc_create_info_t tlsf_info{nullptr, capacity, alignment_t::b16};
+  allocator_t *tlsf = create(&tlsf_info);
+
+  budget_alloc_create_info_t create_info{nullptr, tlsf, "mixed",
+                                         capacity / 2, capacity};
+  allocator_t *alloc = create(&create_info);
+
+  std::vector<memblk> allocs(num_allocs);
+
+  for (auto _ : state) {
+    for (int i = 0; i < num_allocs; i++) {
+      allocs[i] = allocate(alloc, sizes[i]);
+    }
+    benchmark::ClobberMemory();
+
+    for (int i : order) {
+      deallocate(alloc, allocs[i]);
+    }
+    benchmark::ClobberMemory();
+  }
+
+  destroy(alloc);
+  destroy(tlsf);
+
+  state.counters["PerAlloc"] = benchmark::Counter(
+      num_allocs * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(memory_budget_allocator_mixed)
+    ->Args({100, 4096})
+    ->Args({1000, 4096})
+    ->Args({10000, 4096});
@@ -0,0 +1,49 @@
+#include <benchmark/benchmark.h>
+
+#include <fastware/memory.h>
+
+static void memory_concurrent_pool_allocator_contention(
+    benchmark::State &state) {
+  const int num_allocs = state.range(0);
+  const int alloc_size = state.range(1);
+  const int alignment = state.range(2);
+  using namespace fastware::memory;
+
+  static allocator_t *alloc = nullptr;
+
+  if (state.thread_index() == 0) {
+    pool_alloc_create_info_t create_info{
+        nullptr, align(alloc_size, static_cast<alignment_t::value>(alignment)),
+        static_cast<alignment_t::value>(alignment),
+        static_cast<uint64_t>(num_allocs) * state.threads(),
+        pool_flags_t::concurrent};
+    alloc = create(&create_info);
+  }
+
+  std::vector<memblk> allocs(num_allocs);
+
+  for (auto _ : state) {
+    for (int i = 0; i < num_allocs; i++) {
+      allocs[i] = allocate(alloc, alloc_size);
+    }
+    benchmark::ClobberMemory();
+
+    for (auto blk : allocs) {
+      deallocate(alloc, blk);
+    }
+    benchmark::ClobberMemory();
+  }
+
+  if (state.thread_index() == 0) {
+    destroy(alloc);
+  }
+
+  state.counters["PerAlloc"] = benchmark::Counter(
+      num_allocs * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(memory_concurrent_pool_allocator_contention)
+    ->Args({1000, 64, 64})
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
@@ -0,0 +1,63 @@
+#include <benchmark/benchmark.h>
+
+#include <fastware/memory.h>
+
+#include <barrier>
+
+// Every thread allocates its share of a frame, then the frame is reset once
+// all of them are done. Chunk size 0 is one fetch_add per allocation.
+static void memory_concurrent_stack_allocator_contention(
+    benchmark::State &state) {
+  const int num_allocs = state.range(0);
+  const int alloc_size = state.range(1);
+  const int chunk_size = state.range(2);
+  using namespace fastware::memory;
+
+  static allocator_t *alloc = nullptr;
+  static std::barrier<> *frame_end = nullptr;
+
+  if (state.thread_index() == 0) {
+    stack_alloc_create_info_t create_info{
+        nullptr,
+        static_cast<uint64_t>(num_allocs) * state.threads() *
+                align(alloc_size, alignment_t::b16) +
+            static_cast<uint64_t>(chunk_size) * state.threads(),
+        alignment_t::b16,
+        stack_flags_t::concurrent,
+        backing_flags_t::none,
+        static_cast<uint64_t>(chunk_size)};
+    alloc = create(&create_info);
+    frame_end = new std::barrier<>(state.threads());
+  }
+
+  for (auto _ : state) {
+    for (int i = 0; i < num_allocs; i++) {
+      auto blk = allocate(alloc, alloc_size);
+      benchmark::DoNotOptimize(blk);
+    }
+    benchmark::ClobberMemory();
+
+    state.PauseTiming();
+    frame_end->arrive_and_wait();
+    if (state.thread_index() == 0) {
+      deallocate_all(alloc);
+    }
+    frame_end->arrive_and_wait();
+    state.ResumeTiming();
+  }
+
+  if (state.thread_index() == 0) {
+    destroy(alloc);
+    delete frame_end;
+  }
+
+  state.counters["PerAlloc"] = benchmark::Counter(
+      num_allocs * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(memory_concurrent_stack_allocator_contention)
+    ->Args({1000, 64, 0})
+    ->Args({1000, 64, 16 * 1024})
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
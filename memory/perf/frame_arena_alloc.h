@@ -0,0 +1,71 @@
+#include <benchmark/benchmark.h>
+
+#include <fastware/memory.h>
+
+// Per frame scratch of num_allocs blocks, either a stack carved from the
+// root and destroyed every frame or a frame arena rotated every frame
+static void memory_frame_scratch_stack(benchmark::State &state) {
+  const int num_allocs = state.range(0);
+  const int alloc_size = state.range(1);
+  using namespace fastware::memory;
+
+  stack_alloc_create_info_t root_info{nullptr, 8 * Mb, alignment_t::b64};
+  allocator_t *root = create(&root_info);
+
+  for (auto _ : state) {
+    stack_alloc_create_info_t create_info{root, 2 * Mb, alignment_t::b64};
+    allocator_t *alloc = create(&create_info);
+
+    for (int i = 0; i < num_allocs; i++) {
+      auto blk = allocate(alloc, alloc_size);
+      benchmark::DoNotOptimize(blk);
+    }
+    benchmark::ClobberMemory();
+
+    destroy(alloc);
+  }
+
+  destroy(root);
+
+  state.counters["PerAlloc"] = benchmark::Counter(
+      num_allocs * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+static void memory_frame_scratch_arena(benchmark::State &state) {
+  const int num_allocs = state.range(0);
+  const int alloc_size = state.range(1);
+  using namespace fastware::memory;
+
+  stack_alloc_create_info_t root_info{nullptr, 8 * Mb, alignment_t::b64};
+  allocator_t *root = create(&root_info);
+
+  frame_arena_create_info_t create_info{root, 2 * Mb, alignment_t::b64, 2};
+  allocator_t *alloc = create(&create_info);
+
+  for (auto _ : state) {
+    begin_frame(alloc);
+
+    for (int i = 0; i < num_allocs; i++) {
+      auto blk = allocate(alloc, alloc_size);
+      benchmark::DoNotOptimize(blk);
+    }
+    benchmark::ClobberMemory();
+  }
+
+  destroy(alloc);
+  destroy(root);
+
+  state.counters["PerAlloc"] = benchmark::Counter(
+      num_allocs * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(memory_frame_scratch_stack)
+    ->Args({4, 256})
+    ->Args({100, 256})
+    ->Args({1000, 256});
+BENCHMARK(memory_frame_scratch_arena)
+    ->Args({4, 256})
+    ->Args({100, 256})
+    ->Args({1000, 256});
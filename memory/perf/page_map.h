@@ -0,0 +1,112 @@
+#include <benchmark/benchmark.h>
+
+#include <fastware/memory.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// Blocks of many pools handed back without knowing their pool, found in the
+// page map or by asking every pool whether it owns them
+static void memory_page_map_free(benchmark::State &state) {
+  const uint64_t pool_count = state.range(0);
+  const bool page_map = state.range(1);
+  constexpr uint64_t blocks_per_pool{256};
+  using namespace fastware::memory;
+
+  std::vector<allocator_t *> pools(pool_count);
+  for (allocator_t *&pool : pools) {
+    pool_alloc_create_info_t create_info{nullptr, 64, alignment_t::b64,
+                                         blocks_per_pool};
+    pool = create(&create_info);
+  }
+
+  std::mt19937 rng(42);
+  std::vector<memblk> blocks(pool_count * blocks_per_pool / 2);
+  for (memblk &blk : blocks) {
+    blk = allocate(pools[rng() % pool_count], 64);
+  }
+
+  for (auto _ : state) {
+    for (const memblk &blk : blocks) {
+      if (page_map) {
+        fastware::memory::free(blk);
+      } else {
+        for (allocator_t *pool : pools) {
+          if (owns(pool, blk)) {
+            deallocate(pool, blk);
+            break;
+          }
+        }
+      }
+    }
+    state.PauseTiming();
+    for (memblk &blk : blocks) {
+      blk = allocate(pools[rng() % pool_count], 64);
+    }
+    state.ResumeTiming();
+  }
+
+  for (allocator_t *pool : pools) {
+    destroy(pool);
+  }
+
+  state.counters["PerFree"] = benchmark::Counter(
+      blocks.size() * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(memory_page_map_free)
+    ->Args({4, 0})
+    ->Args({4, 1})
+    ->Args({64, 0})
+    ->Args({64, 1});
+
+// Pools of a Kb carved from one heap, every page is shared by several of
+// them and the heap
+static void memory_page_map_free_shared(benchmark::State &state) {
+  const uint64_t pool_count = state.range(0);
+  constexpr uint64_t blocks_per_pool{16};
+  using namespace fastware::memory;
+
+  tlsf_alloc_create_info_t heap_info{nullptr, pool_count * 2 * Kb + 64 * Kb,
+                                     alignment_t::b16};
+  allocator_t *heap = create(&heap_info);
+  std::vector<allocator_t *> pools(pool_count);
+  for (allocator_t *&pool : pools) {
+    pool_alloc_create_info_t create_info{heap, 64, alignment_t::b64,
+                                         blocks_per_pool};
+    pool = create(&create_info);
+  }
+
+  // as many from every pool, freed in a random order
+  std::mt19937 rng(42);
+  std::vector<memblk> blocks(pool_count * blocks_per_pool / 2);
+  for (uint64_t i = 0; i < blocks.size(); i++) {
+    blocks[i] = allocate(pools[i % pool_count], 64);
+  }
+  std::shuffle(blocks.begin(), blocks.end(), rng);
+
+  for (auto _ : state) {
+    for (const memblk &blk : blocks) {
+      fastware::memory::free(blk);
+    }
+    state.PauseTiming();
+    for (uint64_t i = 0; i < blocks.size(); i++) {
+      blocks[i] = allocate(pools[i % pool_count], 64);
+    }
+    std::shuffle(blocks.begin(), blocks.end(), rng);
+    state.ResumeTiming();
+  }
+
+  for (allocator_t *pool : pools) {
+    destroy(pool);
+  }
+  destroy(heap);
+
+  state.counters["PerFree"] = benchmark::Counter(
+      blocks.size() * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(memory_page_map_free_shared)->Arg(4)->Arg(64)->Arg(1024);
@@ -1,5 +1,20 @@
+#include "backing.h"
+#include "bitmap_pool_alloc.h"
+#include "budget_alloc.h"
+#include "concurrent_pool_alloc.h"
+#include "concurrent_stack_alloc.h"
+#include "frame_arena_alloc.h"
+#include "page_map.h"
 #include "pool_alloc.h"
+#include "scenarios.h"
+#include "segregator_alloc.h"
+#include "slab_alloc.h"
+#include "slot_map.h"
+#include "soa_vector.h"
 #include "stack_alloc.h"
+#include "std_allocator.h"
 #include "system_malloc.h"
+#include "thread_cache_alloc.h"
+#include "tlsf_alloc.h"
 
 BENCHMARK_MAIN();
\ No newline at end of file
@@ -1,11 +1,12 @@
 #include <benchmark/benchmark.h>
 
 #include <fastware/memory.h>
+#include <fastware/typed_allocator.h>
 
 static void memory_pool_allocator_alloc(benchmark::State &state) {
   const int num_allocs = state.range(0);
   const int alloc_size = state.range(1);
-  const int alignment = state.range(1);
+  const int alignment = state.range(2);
   using namespace fastware::memory;
 
   pool_alloc_create_info_t create_info{
@@ -43,6 +44,10 @@ BENCHMARK(memory_pool_allocator_alloc)
     ->Args({100, 55, 32})
     ->Args({1000, 55, 32})
     ->Args({10000, 55, 32});
+BENCHMARK(memory_pool_allocator_alloc)
+    ->Args({100, 256, 32})
+    ->Args({1000, 256, 32})
+    ->Args({10000, 256, 32});
 BENCHMARK(memory_pool_allocator_alloc)
     ->Args({100, 259, 32})
     ->Args({1000, 259, 32})
@@ -51,7 +56,7 @@ BENCHMARK(memory_pool_allocator_alloc)
 static void memory_pool_allocator_dealloc(benchmark::State &state) {
   const int num_allocs = state.range(0);
   const int alloc_size = state.range(1);
-  const int alignment = state.range(1);
+  const int alignment = state.range(2);
   using namespace fastware::memory;
 
   pool_alloc_create_info_t create_info{
@@ -92,6 +97,307 @@ BENCHMARK(memory_pool_allocator_dealloc)
     ->Args({1000, 55, 32})
     ->Args({10000, 55, 32});
 BENCHMARK(memory_pool_allocator_dealloc)
+    ->Args({100, 256, 32})
+    ->Args({1000, 256, 32})
+    ->Args({10000, 256, 32});
+BENCHMARK(memory_pool_allocator_dealloc)
+    ->Args({100, 259, 32})
+    ->Args({1000, 259, 32})
+    ->Args({10000, 259, 32});
+static void memory_pool_allocator_alloc_batch(benchmark::State &state) {
+  const int num_allocs = state.range(0);
+  const int alloc_size = state.range(1);
+  const int alignment = state.range(2);
+  constexpr int batch_size = 64;
+  using namespace fastware::memory;
+
+  pool_alloc_create_info_t create_info{
+      nullptr, align(alloc_size, static_cast<alignment_t::value>(alignment)),
+      static_cast<alignment_t::value>(alignment),
+      static_cast<uint64_t>(num_allocs)};
+  allocator_t *alloc = create(&create_info);
+
+  memblk blks[batch_size];
+
+  for (auto _ : state) {
+
+    for (int i = 0; i < num_allocs; i += batch_size) {
+      const int count = std::min(batch_size, num_allocs - i);
+      benchmark::DoNotOptimize(allocate_n(alloc, alloc_size, count, blks));
+      benchmark::DoNotOptimize(blks);
+    }
+    benchmark::ClobberMemory();
+
+    state.PauseTiming();
+    deallocate_all(alloc);
+    benchmark::ClobberMemory();
+    state.ResumeTiming();
+  }
+
+  destroy(alloc);
+
+  state.counters["PerAlloc"] = benchmark::Counter(
+      num_allocs * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(memory_pool_allocator_alloc_batch)
+    ->Args({100, 17, 32})
+    ->Args({1000, 17, 32})
+    ->Args({10000, 17, 32});
+BENCHMARK(memory_pool_allocator_alloc_batch)
+    ->Args({100, 55, 32})
+    ->Args({1000, 55, 32})
+    ->Args({10000, 55, 32});
+BENCHMARK(memory_pool_allocator_alloc_batch)
+    ->Args({100, 256, 32})
+    ->Args({1000, 256, 32})
+    ->Args({10000, 256, 32});
+BENCHMARK(memory_pool_allocator_alloc_batch)
+    ->Args({100, 259, 32})
+    ->Args({1000, 259, 32})
+    ->Args({10000, 259, 32});
+
+static void memory_pool_allocator_dealloc_batch(benchmark::State &state) {
+  const int num_allocs = state.range(0);
+  const int alloc_size = state.range(1);
+  const int alignment = state.range(2);
+  constexpr int batch_size = 64;
+  using namespace fastware::memory;
+
+  pool_alloc_create_info_t create_info{
+      nullptr, align(alloc_size, static_cast<alignment_t::value>(alignment)),
+      static_cast<alignment_t::value>(alignment),
+      static_cast<uint64_t>(num_allocs)};
+  allocator_t *alloc = create(&create_info);
+
+  std::vector<memblk> allocs(num_allocs);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    for (int i = 0; i < num_allocs; i++) {
+      allocs[i] = allocate(alloc, alloc_size);
+    }
+    benchmark::ClobberMemory();
+    state.ResumeTiming();
+
+    for (int i = 0; i < num_allocs; i += batch_size) {
+      deallocate_n(alloc, &allocs[i], std::min(batch_size, num_allocs - i));
+    }
+    benchmark::ClobberMemory();
+  }
+
+  destroy(alloc);
+
+  state.counters["PerAlloc"] = benchmark::Counter(
+      num_allocs * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(memory_pool_allocator_dealloc_batch)
+    ->Args({100, 17, 32})
+    ->Args({1000, 17, 32})
+    ->Args({10000, 17, 32});
+BENCHMARK(memory_pool_allocator_dealloc_batch)
+    ->Args({100, 55, 32})
+    ->Args({1000, 55, 32})
+    ->Args({10000, 55, 32});
+BENCHMARK(memory_pool_allocator_dealloc_batch)
+    ->Args({100, 256, 32})
+    ->Args({1000, 256, 32})
+    ->Args({10000, 256, 32});
+BENCHMARK(memory_pool_allocator_dealloc_batch)
+    ->Args({100, 259, 32})
+    ->Args({1000, 259, 32})
+    ->Args({10000, 259, 32});
+
+static void memory_typed_pool_allocator_alloc(benchmark::State &state) {
+  const int num_allocs = state.range(0);
+  const int alloc_size = state.range(1);
+  const int alignment = state.range(2);
+  using namespace fastware::memory;
+
+  pool_alloc_create_info_t create_info{
+      nullptr, align(alloc_size, static_cast<alignment_t::value>(alignment)),
+      static_cast<alignment_t::value>(alignment),
+      static_cast<uint64_t>(num_allocs)};
+  allocator_t *alloc = create(&create_info);
+  typed_allocator<pool_allocator_t> typed =
+      typed_allocator<pool_allocator_t>::from(alloc);
+
+  for (auto _ : state) {
+
+    for (int i = 0; i < num_allocs; i++) {
+      auto blk = typed.allocate(alloc_size);
+      benchmark::DoNotOptimize(blk);
+    }
+    benchmark::ClobberMemory();
+
+    state.PauseTiming();
+    typed.deallocate_all();
+    benchmark::ClobberMemory();
+    state.ResumeTiming();
+  }
+
+  destroy(alloc);
+
+  state.counters["PerAlloc"] = benchmark::Counter(
+      num_allocs * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(memory_typed_pool_allocator_alloc)
+    ->Args({100, 17, 32})
+    ->Args({1000, 17, 32})
+    ->Args({10000, 17, 32});
+BENCHMARK(memory_typed_pool_allocator_alloc)
+    ->Args({100, 55, 32})
+    ->Args({1000, 55, 32})
+    ->Args({10000, 55, 32});
+BENCHMARK(memory_typed_pool_allocator_alloc)
+    ->Args({100, 256, 32})
+    ->Args({1000, 256, 32})
+    ->Args({10000, 256, 32});
+BENCHMARK(memory_typed_pool_allocator_alloc)
+    ->Args({100, 259, 32})
+    ->Args({1000, 259, 32})
+    ->Args({10000, 259, 32});
+
+static void memory_typed_pool_allocator_dealloc(benchmark::State &state) {
+  const int num_allocs = state.range(0);
+  const int alloc_size = state.range(1);
+  const int alignment = state.range(2);
+  using namespace fastware::memory;
+
+  pool_alloc_create_info_t create_info{
+      nullptr, align(alloc_size, static_cast<alignment_t::value>(alignment)),
+      static_cast<alignment_t::value>(alignment),
+      static_cast<uint64_t>(num_allocs)};
+  allocator_t *alloc = create(&create_info);
+  typed_allocator<pool_allocator_t> typed =
+      typed_allocator<pool_allocator_t>::from(alloc);
+
+  std::vector<memblk> allocs(num_allocs);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    for (int i = 0; i < num_allocs; i++) {
+      allocs[i] = typed.allocate(alloc_size);
+    }
+    benchmark::ClobberMemory();
+    state.ResumeTiming();
+
+    for (auto blk : allocs) {
+      typed.deallocate(blk);
+    }
+    benchmark::ClobberMemory();
+  }
+
+  destroy(alloc);
+
+  state.counters["PerAlloc"] = benchmark::Counter(
+      num_allocs * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(memory_typed_pool_allocator_dealloc)
+    ->Args({100, 17, 32})
+    ->Args({1000, 17, 32})
+    ->Args({10000, 17, 32});
+BENCHMARK(memory_typed_pool_allocator_dealloc)
+    ->Args({100, 55, 32})
+    ->Args({1000, 55, 32})
+    ->Args({10000, 55, 32});
+BENCHMARK(memory_typed_pool_allocator_dealloc)
+    ->Args({100, 256, 32})
+    ->Args({1000, 256, 32})
+    ->Args({10000, 256, 32});
+BENCHMARK(memory_typed_pool_allocator_dealloc)
     ->Args({100, 259, 32})
     ->Args({1000, 259, 32})
-    ->Args({10000, 259, 32});
\ No newline at end of file
+    ->Args({10000, 259, 32});
+
+// Same object count with a block that is, is not and is rounded up to a power
+// of 2, the 72 byte row pays the reciprocal mapping instead of the waste
+static void memory_pool_allocator_block_size(benchmark::State &state) {
+  const int num_allocs = state.range(0);
+  const int alloc_size = state.range(1);
+  using namespace fastware::memory;
+
+  pool_alloc_create_info_t create_info{
+      nullptr, static_cast<uint64_t>(alloc_size), alignment_t::b8,
+      static_cast<uint64_t>(num_allocs)};
+  allocator_t *alloc = create(&create_info);
+
+  std::vector<memblk> allocs(num_allocs);
+
+  for (auto _ : state) {
+    for (int i = 0; i < num_allocs; i++) {
+      allocs[i] = allocate(alloc, alloc_size);
+    }
+    benchmark::ClobberMemory();
+
+    for (auto blk : allocs) {
+      deallocate(alloc, blk);
+    }
+    benchmark::ClobberMemory();
+  }
+
+  destroy(alloc);
+
+  state.counters["PerAlloc"] = benchmark::Counter(
+      num_allocs * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+  state.counters["Footprint"] =
+      benchmark::Counter(static_cast<double>(num_allocs) * alloc_size,
+                         benchmark::Counter::kDefaults,
+                         benchmark::Counter::kIs1024);
+}
+
+BENCHMARK(memory_pool_allocator_block_size)
+    ->Args({200000, 64})
+    ->Args({200000, 72})
+    ->Args({200000, 128});
+
+// Create and reset no longer link every control block. Reset stays flat as
+// the block count grows, create only pays for entering the pool in the page
+// map, one store per 2 Mb span and per page at the ends of the range.
+static void memory_pool_allocator_create(benchmark::State &state) {
+  const uint64_t block_count = state.range(0);
+  using namespace fastware::memory;
+
+  pool_alloc_create_info_t create_info{nullptr, 64, alignment_t::b64,
+                                       block_count};
+
+  for (auto _ : state) {
+    allocator_t *alloc = create(&create_info);
+    benchmark::DoNotOptimize(allocate(alloc, 64));
+    destroy(alloc);
+  }
+}
+
+BENCHMARK(memory_pool_allocator_create)
+    ->Arg(1 << 10)
+    ->Arg(1 << 16)
+    ->Arg(1 << 20);
+
+static void memory_pool_allocator_reset(benchmark::State &state) {
+  const uint64_t block_count = state.range(0);
+  using namespace fastware::memory;
+
+  pool_alloc_create_info_t create_info{nullptr, 64, alignment_t::b64,
+                                       block_count};
+  allocator_t *alloc = create(&create_info);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(allocate(alloc, 64));
+    deallocate_all(alloc);
+  }
+
+  destroy(alloc);
+}
+
+BENCHMARK(memory_pool_allocator_reset)
+    ->Arg(1 << 10)
+    ->Arg(1 << 16)
+    ->Arg(1 << 20);
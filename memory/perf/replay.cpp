@@ -0,0 +1,327 @@
+#include <benchmark/benchmark.h>
+
+#include <fastware/memory.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace fastware::memory;
+
+// A recorded trace flattened to allocations into numbered slots, so the
+// timed loop only indexes arrays. Every allocator of the trace is replayed
+// on the same target, deallocate_all and destroy free what their allocator
+// still holds, begin_frame what the arena allocated frame_count frames ago.
+// Failed allocations and frees of blocks allocated before the trace started
+// are dropped.
+struct replay_op_t {
+  bool allocate;
+  uint32_t slot;
+  uint64_t size;
+};
+
+struct replay_program_t {
+  std::vector<replay_op_t> ops;
+  uint32_t slot_count;
+  uint64_t allocation_count;
+  uint64_t total_bytes;
+  uint64_t max_size;
+  uint64_t peak_requested;
+};
+
+static bool load_program(const char *path, replay_program_t *program) {
+  FILE *file = fopen(path, "rb");
+  if (file == nullptr) {
+    return false;
+  }
+
+  struct live_t {
+    uint64_t alloc;
+    uint32_t slot;
+    uint64_t frame;
+  };
+  std::unordered_map<uint64_t, live_t> live;
+  std::unordered_map<uint64_t, std::vector<uint64_t>> owned;
+  // current frame of every frame arena
+  std::unordered_map<uint64_t, uint64_t> frames;
+  std::vector<uint32_t> free_slots;
+  std::vector<uint64_t> slot_sizes;
+  uint64_t requested = 0;
+
+  *program = {};
+
+  auto release = [&](uint64_t ptr) {
+    auto it = live.find(ptr);
+    if (it == live.end()) {
+      return;
+    }
+    const uint32_t slot = it->second.slot;
+    program->ops.push_back({false, slot, slot_sizes[slot]});
+    requested -= slot_sizes[slot];
+    free_slots.push_back(slot);
+    live.erase(it);
+  };
+
+  auto release_all = [&](uint64_t alloc) {
+    auto it = owned.find(alloc);
+    if (it == owned.end()) {
+      return;
+    }
+    // later blocks first, the way a stack unwinds
+    for (auto ptr = it->second.rbegin(); ptr != it->second.rend(); ++ptr) {
+      auto block = live.find(*ptr);
+      if (block != live.end() && block->second.alloc == alloc) {
+        release(*ptr);
+      }
+    }
+    owned.erase(it);
+  };
+
+  // blocks of the frame an arena is about to reuse, the others stay
+  auto release_frame = [&](uint64_t alloc, uint64_t frame_count) {
+    const uint64_t frame = ++frames[alloc];
+    if (frame < frame_count) {
+      return;
+    }
+    std::vector<uint64_t> &ptrs = owned[alloc];
+    uint64_t kept = 0;
+    for (uint64_t ptr : ptrs) {
+      auto block = live.find(ptr);
+      if (block == live.end() || block->second.alloc != alloc) {
+        continue;
+      }
+      if (block->second.frame == frame - frame_count) {
+        release(ptr);
+      } else {
+        ptrs[kept++] = ptr;
+      }
+    }
+    ptrs.resize(kept);
+  };
+
+  trace_event_t event;
+  while (fread(&event, sizeof(event), 1, file) == 1) {
+    switch (event.op) {
+    case trace_op_t::allocate: {
+      if (event.ptr == 0) {
+        break;
+      }
+      uint32_t slot = static_cast<uint32_t>(slot_sizes.size());
+      if (free_slots.empty()) {
+        slot_sizes.push_back(event.size);
+      } else {
+        slot = free_slots.back();
+        free_slots.pop_back();
+        slot_sizes[slot] = event.size;
+      }
+      live[event.ptr] = {event.alloc, slot, frames[event.alloc]};
+      owned[event.alloc].push_back(event.ptr);
+      program->ops.push_back({true, slot, event.size});
+      program->allocation_count++;
+      program->total_bytes += event.size;
+      program->max_size = std::max(program->max_size, event.size);
+      requested += event.size;
+      program->peak_requested = std::max(program->peak_requested, requested);
+      break;
+    }
+    case trace_op_t::deallocate: {
+      release(event.ptr);
+      break;
+    }
+    case trace_op_t::deallocate_all:
+    case trace_op_t::destroy: {
+      release_all(event.alloc);
+      break;
+    }
+    case trace_op_t::begin_frame: {
+      release_frame(event.alloc, event.size);
+      break;
+    }
+    default:
+      break;
+    }
+  }
+  fclose(file);
+
+  program->slot_count = static_cast<uint32_t>(slot_sizes.size());
+  return true;
+}
+
+static replay_program_t _program;
+
+struct replay_target_t {
+  enum value : int64_t { malloc = 0, tlsf, slab, stack };
+};
+
+static allocator_t *create_target(int64_t target) {
+  const uint64_t peak = std::max<uint64_t>(_program.peak_requested, 1);
+  switch (target) {
+  case replay_target_t::tlsf: {
+    tlsf_alloc_create_info_t create_info{nullptr, 4 * peak + 1 * Mb,
+                                         alignment_t::b16};
+    return create(&create_info);
+  }
+  case replay_target_t::slab: {
+    // whole pages, alignment_t::b4k is not a power of 2
+    slab_alloc_create_info_t create_info{
+        nullptr, 16, std::bit_ceil(std::max<uint64_t>(_program.max_size, 16)),
+        (2 * peak + 4 * Kb - 1) / (4 * Kb) * (4 * Kb)};
+    return create(&create_info);
+  }
+  case replay_target_t::stack: {
+    // nothing is reused, every allocation of the trace gets fresh space
+    stack_alloc_create_info_t create_info{
+        nullptr, _program.total_bytes + 16 * _program.allocation_count,
+        alignment_t::b16};
+    return create(&create_info);
+  }
+  default:
+    return nullptr;
+  }
+}
+
+static memblk replay_allocate(allocator_t *alloc, uint64_t size) {
+  if (alloc == nullptr) {
+    return {{malloc(size)}, size};
+  }
+  return allocate(alloc, size);
+}
+
+static void replay_deallocate(allocator_t *alloc, memblk blk) {
+  if (alloc == nullptr) {
+    free(blk.ptr);
+  } else if (blk.ptr) {
+    deallocate(alloc, blk);
+  }
+}
+
+static void replay_release(allocator_t *alloc, std::vector<memblk> &blocks) {
+  for (memblk &blk : blocks) {
+    if (blk.ptr) {
+      replay_deallocate(alloc, blk);
+      blk = {};
+    }
+  }
+  if (alloc) {
+    deallocate_all(alloc);
+  }
+}
+
+struct replay_usage_t {
+  uint64_t peak_held;
+  uint64_t footprint;
+  uint64_t failed;
+};
+
+// Untimed pass: peak bytes held in the blocks handed out and the footprint,
+// the 4 Kb pages that held a block at some point
+static replay_usage_t measure(allocator_t *alloc,
+                              std::vector<memblk> &blocks) {
+  replay_usage_t usage{};
+  uint64_t held = 0;
+  std::unordered_set<uint64_t> pages;
+
+  for (const replay_op_t &op : _program.ops) {
+    memblk &blk = blocks[op.slot];
+    if (op.allocate) {
+      blk = replay_allocate(alloc, op.size);
+      if (blk.ptr == nullptr) {
+        usage.failed++;
+        continue;
+      }
+      held += blk.size;
+      usage.peak_held = std::max(usage.peak_held, held);
+      for (uint64_t page = blk.addr >> 12;
+           page <= (blk.addr + blk.size - 1) >> 12; page++) {
+        pages.insert(page);
+      }
+    } else if (blk.ptr) {
+      held -= blk.size;
+      replay_deallocate(alloc, blk);
+      blk = {};
+    }
+  }
+  usage.footprint = pages.size() * 4 * Kb;
+
+  replay_release(alloc, blocks);
+  return usage;
+}
+
+static void memory_replay(benchmark::State &state) {
+  allocator_t *alloc = create_target(state.range(0));
+  std::vector<memblk> blocks(_program.slot_count);
+
+  const replay_usage_t usage = measure(alloc, blocks);
+
+  for (auto _ : state) {
+    for (const replay_op_t &op : _program.ops) {
+      memblk &blk = blocks[op.slot];
+      if (op.allocate) {
+        blk = replay_allocate(alloc, op.size);
+      } else {
+        replay_deallocate(alloc, blk);
+        blk = {};
+      }
+    }
+    benchmark::ClobberMemory();
+
+    state.PauseTiming();
+    replay_release(alloc, blocks);
+    state.ResumeTiming();
+  }
+
+  if (alloc) {
+    destroy(alloc);
+  }
+
+  state.counters["PerOp"] = benchmark::Counter(
+      _program.ops.size() * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+  state.counters["PeakRequested"] = _program.peak_requested;
+  state.counters["PeakHeld"] = usage.peak_held;
+  state.counters["Footprint"] = usage.footprint;
+  // share of the footprint beyond the peak of requested bytes
+  state.counters["Fragmentation"] =
+      usage.footprint
+          ? 1.0 - static_cast<double>(_program.peak_requested) /
+                      static_cast<double>(usage.footprint)
+          : 0.0;
+  state.counters["Failed"] = usage.failed;
+}
+
+// memory_replay <trace> [benchmark flags], traces are written by
+// trace_begin in FASTWARE_MEMORY_TRACE builds
+int main(int argc, char **argv) {
+  benchmark::Initialize(&argc, argv);
+
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s <trace> [--benchmark_...]\n", argv[0]);
+    return 1;
+  }
+
+  if (!load_program(argv[1], &_program)) {
+    fprintf(stderr, "cannot read trace %s\n", argv[1]);
+    return 1;
+  }
+
+  printf("%s: %zu ops, %lu allocations, peak %lu bytes requested\n", argv[1],
+         _program.ops.size(), _program.allocation_count,
+         _program.peak_requested);
+
+  benchmark::RegisterBenchmark("memory_replay/malloc", memory_replay)
+      ->Arg(replay_target_t::malloc);
+  benchmark::RegisterBenchmark("memory_replay/tlsf", memory_replay)
+      ->Arg(replay_target_t::tlsf);
+  benchmark::RegisterBenchmark("memory_replay/slab", memory_replay)
+      ->Arg(replay_target_t::slab);
+  benchmark::RegisterBenchmark("memory_replay/stack", memory_replay)
+      ->Arg(replay_target_t::stack);
+
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,297 @@
+#include <benchmark/benchmark.h>
+
+#include <fastware/memory.h>
+
+#include "workload.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <malloc.h>
+#include <x86intrin.h>
+
+// Allocation patterns run against every backing with 64 byte blocks. The
+// stack only frees its top block, other free orders leave the memory to the
+// deallocate_all ending every round. CyclesPerOp counts TSC ticks, RSS is
+// how much the resident set grew up to the allocation peak of a warm up
+// round (to the end of the run across threads).
+struct scenario_backing_t {
+  enum value : int64_t { stack = 0, pool, malloc, aligned_alloc };
+};
+
+constexpr uint64_t scenario_block_size{64};
+constexpr uint64_t scenario_block_count{10000};
+constexpr fastware::memory::alignment_t::value scenario_alignment{
+    fastware::memory::alignment_t::b32};
+
+static fastware::memory::allocator_t *
+scenario_create(int64_t backing, uint64_t block_count, uint64_t pool_flags) {
+  using namespace fastware::memory;
+  switch (backing) {
+  case scenario_backing_t::stack: {
+    stack_alloc_create_info_t create_info{
+        nullptr, block_count * align(scenario_block_size, scenario_alignment),
+        scenario_alignment};
+    return create(&create_info);
+  }
+  case scenario_backing_t::pool: {
+    pool_alloc_create_info_t create_info{nullptr, scenario_block_size,
+                                         scenario_alignment, block_count,
+                                         pool_flags};
+    return create(&create_info);
+  }
+  default:
+    return nullptr;
+  }
+}
+
+static void scenario_destroy(fastware::memory::allocator_t *alloc) {
+  if (alloc) {
+    fastware::memory::destroy(alloc);
+  }
+}
+
+static fastware::memory::memblk
+scenario_allocate(int64_t backing, fastware::memory::allocator_t *alloc) {
+  switch (backing) {
+  case scenario_backing_t::malloc:
+    return {{::malloc(scenario_block_size)}, scenario_block_size};
+  case scenario_backing_t::aligned_alloc:
+    return {{::aligned_alloc(scenario_alignment, scenario_block_size)},
+            scenario_block_size};
+  default:
+    return fastware::memory::allocate(alloc, scenario_block_size);
+  }
+}
+
+static void scenario_deallocate(int64_t backing,
+                                fastware::memory::allocator_t *alloc,
+                                fastware::memory::memblk blk) {
+  if (alloc) {
+    fastware::memory::deallocate(alloc, blk);
+  } else {
+    ::free(blk.ptr);
+  }
+  (void)backing;
+}
+
+static void scenario_end_round(int64_t backing,
+                               fastware::memory::allocator_t *alloc) {
+  if (backing == scenario_backing_t::stack) {
+    fastware::memory::deallocate_all(alloc);
+  }
+}
+
+// Baseline for scenario_rss, taken before the allocator is created once
+// malloc handed its free pages back
+static uint64_t scenario_rss_baseline() {
+  malloc_trim(0);
+  return resident_bytes();
+}
+
+static uint64_t scenario_rss(int64_t backing,
+                             fastware::memory::allocator_t *alloc,
+                             std::vector<fastware::memory::memblk> &blks,
+                             uint64_t before) {
+  for (auto &blk : blks) {
+    blk = scenario_allocate(backing, alloc);
+    memset(blk.ptr, 0, blk.size);
+  }
+  const uint64_t peak = resident_bytes();
+  for (auto blk : blks) {
+    scenario_deallocate(backing, alloc, blk);
+  }
+  scenario_end_round(backing, alloc);
+  return peak > before ? peak - before : 0;
+}
+
+static void scenario_counters(benchmark::State &state, uint64_t ops,
+                              uint64_t cycles, uint64_t rss) {
+  state.counters["PerOp"] = benchmark::Counter(
+      ops, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+  state.counters["CyclesPerOp"] = benchmark::Counter(
+      ops ? static_cast<double>(cycles) / ops : 0.0,
+      benchmark::Counter::kAvgThreads);
+  state.counters["RSS"] = benchmark::Counter(rss);
+}
+
+// Allocates every block then frees them in order, ops are both halves
+static void scenario_churn(benchmark::State &state,
+                           const std::vector<uint32_t> &order) {
+  const int64_t backing = state.range(0);
+  const uint64_t rss_before = scenario_rss_baseline();
+  fastware::memory::allocator_t *alloc =
+      scenario_create(backing, scenario_block_count, 0);
+  std::vector<fastware::memory::memblk> blks(scenario_block_count);
+
+  const uint64_t rss = scenario_rss(backing, alloc, blks, rss_before);
+  uint64_t cycles = 0;
+
+  for (auto _ : state) {
+    const uint64_t start = __rdtsc();
+    for (auto &blk : blks) {
+      blk = scenario_allocate(backing, alloc);
+    }
+    benchmark::ClobberMemory();
+
+    for (uint32_t i : order) {
+      scenario_deallocate(backing, alloc, blks[i]);
+    }
+    scenario_end_round(backing, alloc);
+    benchmark::ClobberMemory();
+    cycles += __rdtsc() - start;
+  }
+
+  scenario_destroy(alloc);
+  scenario_counters(state, 2 * scenario_block_count * state.iterations(),
+                    cycles, rss);
+}
+
+static std::vector<uint32_t> scenario_order(bool reverse, bool shuffle) {
+  std::vector<uint32_t> order(scenario_block_count);
+  std::iota(order.begin(), order.end(), 0);
+  if (reverse) {
+    std::reverse(order.begin(), order.end());
+  }
+  if (shuffle) {
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+  }
+  return order;
+}
+
+static void memory_scenario_lifo(benchmark::State &state) {
+  scenario_churn(state, scenario_order(true, false));
+}
+
+static void memory_scenario_fifo(benchmark::State &state) {
+  scenario_churn(state, scenario_order(false, false));
+}
+
+static void memory_scenario_random_free(benchmark::State &state) {
+  scenario_churn(state, scenario_order(false, true));
+}
+
+// Writes every block as it is handed out then reads them back in a random
+// order, so the placement of the blocks shows up in the cache misses
+static void memory_scenario_touch(benchmark::State &state) {
+  const int64_t backing = state.range(0);
+  const uint64_t rss_before = scenario_rss_baseline();
+  fastware::memory::allocator_t *alloc =
+      scenario_create(backing, scenario_block_count, 0);
+  std::vector<fastware::memory::memblk> blks(scenario_block_count);
+  const std::vector<uint32_t> order = scenario_order(false, true);
+
+  const uint64_t rss = scenario_rss(backing, alloc, blks, rss_before);
+  uint64_t cycles = 0;
+
+  for (auto _ : state) {
+    const uint64_t start = __rdtsc();
+    for (uint32_t i = 0; i < scenario_block_count; i++) {
+      blks[i] = scenario_allocate(backing, alloc);
+      memset(blks[i].ptr, static_cast<int>(i), blks[i].size);
+    }
+
+    uint64_t sum = 0;
+    for (uint32_t i : order) {
+      const uint64_t *words = static_cast<const uint64_t *>(blks[i].ptr);
+      for (uint64_t word = 0; word < scenario_block_size / 8; word++) {
+        sum += words[word];
+      }
+    }
+    benchmark::DoNotOptimize(sum);
+
+    for (auto blk : blks) {
+      scenario_deallocate(backing, alloc, blk);
+    }
+    scenario_end_round(backing, alloc);
+    benchmark::ClobberMemory();
+    cycles += __rdtsc() - start;
+  }
+
+  scenario_destroy(alloc);
+  scenario_counters(state, scenario_block_count * state.iterations(), cycles,
+                    rss);
+}
+
+// Blocks handed from the allocating thread to the freeing one through a
+// single producer single consumer ring
+struct scenario_ring_t {
+  static constexpr uint64_t capacity{1024};
+  alignas(64) std::atomic_uint64_t head;
+  alignas(64) std::atomic_uint64_t tail;
+  alignas(64) fastware::memory::memblk blks[capacity];
+};
+
+static scenario_ring_t _scenario_ring;
+
+// Thread 0 allocates, thread 1 frees. The stack cannot free from another
+// thread, the pool backing is a concurrent pool.
+static void memory_scenario_cross_thread_free(benchmark::State &state) {
+  const int64_t backing = state.range(0);
+  static fastware::memory::allocator_t *alloc = nullptr;
+  scenario_ring_t &ring = _scenario_ring;
+  static uint64_t rss_before = 0;
+
+  if (state.thread_index() == 0) {
+    rss_before = scenario_rss_baseline();
+    alloc = scenario_create(backing, 2 * scenario_ring_t::capacity,
+                            fastware::memory::pool_flags_t::concurrent);
+    ring.head.store(0, std::memory_order_relaxed);
+    ring.tail.store(0, std::memory_order_relaxed);
+  }
+
+  uint64_t cycles = 0;
+
+  for (auto _ : state) {
+    const uint64_t start = __rdtsc();
+    if (state.thread_index() == 0) {
+      for (uint64_t i = 0; i < scenario_block_count; i++) {
+        const fastware::memory::memblk blk = scenario_allocate(backing, alloc);
+        const uint64_t head = ring.head.load(std::memory_order_relaxed);
+        while (head - ring.tail.load(std::memory_order_acquire) ==
+               scenario_ring_t::capacity) {
+          std::this_thread::yield();
+        }
+        ring.blks[head % scenario_ring_t::capacity] = blk;
+        ring.head.store(head + 1, std::memory_order_release);
+      }
+    } else {
+      for (uint64_t i = 0; i < scenario_block_count; i++) {
+        const uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+        while (ring.head.load(std::memory_order_acquire) == tail) {
+          std::this_thread::yield();
+        }
+        scenario_deallocate(backing, alloc,
+                            ring.blks[tail % scenario_ring_t::capacity]);
+        ring.tail.store(tail + 1, std::memory_order_release);
+      }
+    }
+    cycles += __rdtsc() - start;
+  }
+
+  uint64_t rss = 0;
+  if (state.thread_index() == 0) {
+    const uint64_t rss_after = resident_bytes();
+    rss = rss_after > rss_before ? rss_after - rss_before : 0;
+    scenario_destroy(alloc);
+  }
+
+  scenario_counters(state, scenario_block_count * state.iterations(), cycles,
+                    rss);
+}
+
+BENCHMARK(memory_scenario_lifo)->DenseRange(0, 3)->ArgName("backing");
+BENCHMARK(memory_scenario_fifo)->DenseRange(0, 3)->ArgName("backing");
+BENCHMARK(memory_scenario_random_free)->DenseRange(0, 3)->ArgName("backing");
+BENCHMARK(memory_scenario_touch)->DenseRange(0, 3)->ArgName("backing");
+BENCHMARK(memory_scenario_cross_thread_free)
+    ->DenseRange(1, 3)
+    ->ArgName("backing")
+    ->Threads(2)
+    ->UseRealTime();
@@ -0,0 +1,117 @@
+#include <benchmark/benchmark.h>
+
+#include <fastware/memory.h>
+
+#include <algorithm>
+#include <random>
+
+#include "workload.h"
+
+// Same workload as memory_tlsf_allocator_mixed with the sizes up to 256
+// bytes routed to a slab in front of the tlsf heap
+static void memory_segregator_allocator_mixed(benchmark::State &state) {
+  const int num_allocs = state.range(0);
+  const int max_size = state.range(1);
+  using namespace fastware::memory;
+
+  const auto sizes = mixed_sizes(num_allocs, max_size);
+
+  std::vector<int> order(num_allocs);
+  for (int i = 0; i < num_allocs; i++) {
+    order[i] = i;
+  }
+  std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+  slab_alloc_create_info_t slab_info{
+      nullptr, 16, 256, static_cast<uint64_t>(num_allocs) * 256};
+  allocator_t *slab = create(&slab_info);
+
+  tlsf_alloc_create_info_t tlsf_info{
+      nullptr, static_cast<uint64_t>(num_allocs) * (max_size + 64),
+      alignment_t::b16};
+  allocator_t *tlsf = create(&tlsf_info);
+
+  segregator_alloc_create_info_t create_info{nullptr, 256, slab, tlsf};
+  allocator_t *alloc = create(&create_info);
+
+  std::vector<memblk> allocs(num_allocs);
+
+  for (auto _ : state) {
+    for (int i = 0; i < num_allocs; i++) {
+      allocs[i] = allocate(alloc, sizes[i]);
+    }
+    benchmark::ClobberMemory();
+
+    for (int i : order) {
+      deallocate(alloc, allocs[i]);
+    }
+    benchmark::ClobberMemory();
+  }
+
+  destroy(alloc);
+  destroy(tlsf);
+  destroy(slab);
+
+  state.counters["PerAlloc"] = benchmark::Counter(
+      num_allocs * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(memory_segregator_allocator_mixed)
+    ->Args({100, 4096})
+    ->Args({1000, 4096})
+    ->Args({10000, 4096});
+
+// A stack in front of the root for scratch that usually fits, checking
+// ownership of every block on free is the price of the fallback
+static void memory_fallback_allocator_scratch(benchmark::State &state) {
+  const int num_allocs = state.range(0);
+  const int max_size = state.range(1);
+  using namespace fastware::memory;
+
+  const auto sizes = mixed_sizes(num_allocs, max_size);
+
+  uint64_t total = 0;
+  for (auto size : sizes) {
+    total += align(size, alignment_t::b16);
+  }
+
+  // three quarters of the scratch fits on the stack
+  stack_alloc_create_info_t stack_info{nullptr, total * 3 / 4,
+                                       alignment_t::b16};
+  allocator_t *stack = create(&stack_info);
+
+  tlsf_alloc_create_info_t tlsf_info{nullptr, total + num_allocs * 64,
+                                     alignment_t::b16};
+  allocator_t *tlsf = create(&tlsf_info);
+
+  fallback_alloc_create_info_t create_info{nullptr, stack, tlsf};
+  allocator_t *alloc = create(&create_info);
+
+  std::vector<memblk> allocs(num_allocs);
+
+  for (auto _ : state) {
+    for (int i = 0; i < num_allocs; i++) {
+      allocs[i] = allocate(alloc, sizes[i]);
+    }
+    benchmark::ClobberMemory();
+
+    for (int i = num_allocs; i > 0; i--) {
+      deallocate(alloc, allocs[i - 1]);
+    }
+    benchmark::ClobberMemory();
+  }
+
+  destroy(alloc);
+  destroy(tlsf);
+  destroy(stack);
+
+  state.counters["PerAlloc"] = benchmark::Counter(
+      num_allocs * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(memory_fallback_allocator_scratch)
+    ->Args({100, 4096})
+    ->Args({1000, 4096})
+    ->Args({10000, 4096});
@@ -0,0 +1,54 @@
+#include <benchmark/benchmark.h>
+
+#include <fastware/memory.h>
+
+#include <algorithm>
+#include <bit>
+
+#include "workload.h"
+
+static void memory_slab_allocator_mixed(benchmark::State &state) {
+  const int num_allocs = state.range(0);
+  const int max_size = state.range(1);
+  using namespace fastware::memory;
+
+  const auto sizes = mixed_sizes(num_allocs, max_size);
+
+  // size every class for the busiest one in the workload
+  uint64_t class_capacity = 0;
+  std::vector<uint64_t> class_bytes(max_size + 1, 0);
+  for (auto size : sizes) {
+    const uint64_t class_size = std::max<uint64_t>(16, std::bit_ceil(size));
+    class_bytes[class_size] += class_size;
+    class_capacity = std::max(class_capacity, class_bytes[class_size]);
+  }
+
+  slab_alloc_create_info_t create_info{
+      nullptr, 16, static_cast<uint64_t>(max_size), class_capacity};
+  allocator_t *alloc = create(&create_info);
+
+  std::vector<memblk> allocs(num_allocs);
+
+  for (auto _ : state) {
+    for (int i = 0; i < num_allocs; i++) {
+      allocs[i] = allocate(alloc, sizes[i]);
+    }
+    benchmark::ClobberMemory();
+
+    for (auto blk : allocs) {
+      deallocate(alloc, blk);
+    }
+    benchmark::ClobberMemory();
+  }
+
+  destroy(alloc);
+
+  state.counters["PerAlloc"] = benchmark::Counter(
+      num_allocs * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(memory_slab_allocator_mixed)
+    ->Args({100, 4096})
+    ->Args({1000, 4096})
+    ->Args({10000, 4096});
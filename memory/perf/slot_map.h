@@ -0,0 +1,113 @@
+#include <benchmark/benchmark.h>
+
+#include <fastware/memory.h>
+#include <fastware/slot_map.h>
+
+#include <random>
+#include <vector>
+
+struct slot_map_object_t {
+  float position[3];
+  float velocity[3];
+  uint32_t flags;
+  uint32_t alive;
+};
+
+// Sum over the live objects once half of them were removed at random, from
+// the packed slot map or from a sparse array skipping dead entries the way
+// raw index stores do
+static void memory_slot_map_iterate(benchmark::State &state) {
+  const uint32_t num_objects = state.range(0);
+  const bool packed = state.range(1);
+  using namespace fastware::memory;
+
+  tlsf_alloc_create_info_t create_info{
+      nullptr, num_objects * (sizeof(slot_map_object_t) + 16) + 1 * Mb,
+      alignment_t::b16};
+  allocator_t *alloc = create(&create_info);
+
+  auto map = slot_map_t<slot_map_object_t>::create(alloc, num_objects);
+  std::vector<slot_map_object_t> sparse(num_objects);
+  std::vector<slot_handle_t> handles(num_objects);
+  for (uint32_t i = 0; i < num_objects; i++) {
+    sparse[i] = {{1.0f, 2.0f, 3.0f}, {0.5f, 0.5f, 0.5f}, i, 1};
+    handles[i] = map.insert(sparse[i]);
+  }
+
+  std::mt19937 rng(42);
+  for (uint32_t i = 0; i < num_objects / 2; i++) {
+    const uint32_t victim = rng() % num_objects;
+    map.erase(handles[victim]);
+    sparse[victim].alive = 0;
+  }
+
+  for (auto _ : state) {
+    float sum = 0.0f;
+    if (packed) {
+      for (const slot_map_object_t &object : map) {
+        sum += object.position[0] + object.velocity[0];
+      }
+    } else {
+      for (const slot_map_object_t &object : sparse) {
+        if (object.alive) {
+          sum += object.position[0] + object.velocity[0];
+        }
+      }
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+
+  map.destroy();
+  destroy(alloc);
+
+  state.counters["PerObject"] = benchmark::Counter(
+      num_objects * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(memory_slot_map_iterate)
+    ->Args({1000, 0})
+    ->Args({1000, 1})
+    ->Args({100000, 0})
+    ->Args({100000, 1});
+
+// Random insert, lookup and erase through handles
+static void memory_slot_map_churn(benchmark::State &state) {
+  const uint32_t num_objects = state.range(0);
+  using namespace fastware::memory;
+
+  tlsf_alloc_create_info_t create_info{
+      nullptr, num_objects * (sizeof(slot_map_object_t) + 16) + 1 * Mb,
+      alignment_t::b16};
+  allocator_t *alloc = create(&create_info);
+
+  auto map = slot_map_t<slot_map_object_t>::create(alloc, num_objects);
+  std::vector<slot_handle_t> handles(num_objects);
+  for (uint32_t i = 0; i < num_objects; i++) {
+    handles[i] = map.insert({});
+  }
+
+  std::mt19937 rng(42);
+  std::vector<uint32_t> victims(num_objects);
+  for (uint32_t &victim : victims) {
+    victim = rng() % num_objects;
+  }
+
+  for (auto _ : state) {
+    for (uint32_t victim : victims) {
+      slot_map_object_t *object = map.get(handles[victim]);
+      benchmark::DoNotOptimize(object);
+      map.erase(handles[victim]);
+      handles[victim] = map.insert({});
+    }
+  }
+
+  map.destroy();
+  destroy(alloc);
+
+  state.counters["PerOp"] = benchmark::Counter(
+      num_objects * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(memory_slot_map_churn)->Arg(1000)->Arg(100000);
@@ -0,0 +1,96 @@
+#include <benchmark/benchmark.h>
+
+#include <fastware/memory.h>
+#include <fastware/soa_vector.h>
+
+#include <array>
+#include <vector>
+
+struct soa_particle_t {
+  float position[4];
+  float velocity[4];
+  float color[4];
+  float age;
+  float size;
+};
+
+// Positions advanced by their velocities, from aligned columns that only
+// hold the two fields the kernel reads or from whole particle structs
+static void memory_soa_vector_integrate(benchmark::State &state) {
+  const uint32_t num_particles = state.range(0);
+  const bool columns = state.range(1);
+  using namespace fastware::memory;
+
+  stack_alloc_create_info_t create_info{nullptr, 64 * Mb, alignment_t::b64};
+  allocator_t *alloc = create(&create_info);
+
+  using position_t = std::array<float, 4>;
+  auto soa =
+      soa_vector_t<position_t, position_t, float>::create(alloc, num_particles);
+  std::vector<soa_particle_t> aos(num_particles);
+  for (uint32_t i = 0; i < num_particles; i++) {
+    soa.push_back({float(i), 0, 0, 1}, {1, 2, 3, 0}, 0.0f);
+    aos[i] = {{float(i), 0, 0, 1}, {1, 2, 3, 0}};
+  }
+
+  for (auto _ : state) {
+    if (columns) {
+      position_t *__restrict positions = soa.data<0>();
+      const position_t *__restrict velocities = soa.data<1>();
+      for (uint32_t i = 0; i < soa.count; i++) {
+        for (uint32_t j = 0; j < 4; j++) {
+          positions[i][j] += velocities[i][j] * 0.016f;
+        }
+      }
+      benchmark::DoNotOptimize(positions);
+    } else {
+      for (soa_particle_t &particle : aos) {
+        for (uint32_t j = 0; j < 4; j++) {
+          particle.position[j] += particle.velocity[j] * 0.016f;
+        }
+      }
+      benchmark::DoNotOptimize(aos.data());
+    }
+    benchmark::ClobberMemory();
+  }
+
+  soa.destroy();
+  destroy(alloc);
+
+  state.counters["PerParticle"] = benchmark::Counter(
+      num_particles * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(memory_soa_vector_integrate)
+    ->Args({10000, 0})
+    ->Args({10000, 1})
+    ->Args({1000000, 0})
+    ->Args({1000000, 1});
+
+// Filled one push_back at a time from empty, every doubling moves the
+// columns
+static void memory_soa_vector_push_back(benchmark::State &state) {
+  const uint32_t num_particles = state.range(0);
+  using namespace fastware::memory;
+
+  tlsf_alloc_create_info_t create_info{nullptr, 64 * Mb, alignment_t::b16};
+  allocator_t *alloc = create(&create_info);
+
+  for (auto _ : state) {
+    auto soa = soa_vector_t<float, float, uint32_t>::create(alloc, 0);
+    for (uint32_t i = 0; i < num_particles; i++) {
+      soa.push_back(float(i), 1.0f, i);
+    }
+    benchmark::DoNotOptimize(soa.data<2>());
+    soa.destroy();
+  }
+
+  destroy(alloc);
+
+  state.counters["PerPush"] = benchmark::Counter(
+      num_particles * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(memory_soa_vector_push_back)->Arg(1000)->Arg(1000000);
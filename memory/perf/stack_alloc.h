@@ -1,11 +1,14 @@
 #include <benchmark/benchmark.h>
 
 #include <fastware/memory.h>
+#include <fastware/typed_allocator.h>
+
+#include <cstring>
 
 static void memory_stack_allocator(benchmark::State &state) {
   const int num_allocs = state.range(0);
   const int alloc_size = state.range(1);
-  const int alignment = state.range(1);
+  const int alignment = state.range(2);
   using namespace fastware::memory;
 
   stack_alloc_create_info_t create_info{
@@ -47,4 +50,193 @@ BENCHMARK(memory_stack_allocator)
 BENCHMARK(memory_stack_allocator)
     ->Args({100, 259, 32})
     ->Args({1000, 259, 32})
-    ->Args({10000, 259, 32});
\ No newline at end of file
+    ->Args({10000, 259, 32});
+
+static void memory_stack_allocator_batch(benchmark::State &state) {
+  const int num_allocs = state.range(0);
+  const int alloc_size = state.range(1);
+  const int alignment = state.range(2);
+  constexpr int batch_size = 64;
+  using namespace fastware::memory;
+
+  stack_alloc_create_info_t create_info{
+      nullptr,
+      num_allocs *
+          align(alloc_size, static_cast<alignment_t::value>(alignment)),
+      static_cast<alignment_t::value>(alignment)};
+  allocator_t *alloc = create(&create_info);
+
+  memblk blks[batch_size];
+
+  for (auto _ : state) {
+
+    for (int i = 0; i < num_allocs; i += batch_size) {
+      const int count = std::min(batch_size, num_allocs - i);
+      benchmark::DoNotOptimize(allocate_n(alloc, alloc_size, count, blks));
+      benchmark::DoNotOptimize(blks);
+    }
+    benchmark::ClobberMemory();
+
+    state.PauseTiming();
+    deallocate_all(alloc);
+    benchmark::ClobberMemory();
+    state.ResumeTiming();
+  }
+
+  destroy(alloc);
+
+  state.counters["PerAlloc"] = benchmark::Counter(
+      num_allocs * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(memory_stack_allocator_batch)
+    ->Args({100, 17, 32})
+    ->Args({1000, 17, 32})
+    ->Args({10000, 17, 32});
+BENCHMARK(memory_stack_allocator_batch)
+    ->Args({100, 55, 32})
+    ->Args({1000, 55, 32})
+    ->Args({10000, 55, 32});
+BENCHMARK(memory_stack_allocator_batch)
+    ->Args({100, 259, 32})
+    ->Args({1000, 259, 32})
+    ->Args({10000, 259, 32});
+
+static void memory_typed_stack_allocator(benchmark::State &state) {
+  const int num_allocs = state.range(0);
+  const int alloc_size = state.range(1);
+  const int alignment = state.range(2);
+  using namespace fastware::memory;
+
+  stack_alloc_create_info_t create_info{
+      nullptr,
+      num_allocs *
+          align(alloc_size, static_cast<alignment_t::value>(alignment)),
+      static_cast<alignment_t::value>(alignment)};
+  allocator_t *alloc = create(&create_info);
+  typed_allocator<stack_allocator_t> typed =
+      typed_allocator<stack_allocator_t>::from(alloc);
+
+  for (auto _ : state) {
+
+    for (int i = 0; i < num_allocs; i++) {
+      auto blk = typed.allocate(alloc_size);
+      benchmark::DoNotOptimize(blk);
+    }
+    benchmark::ClobberMemory();
+
+    state.PauseTiming();
+    typed.deallocate_all();
+    benchmark::ClobberMemory();
+    state.ResumeTiming();
+  }
+
+  destroy(alloc);
+
+  state.counters["PerAlloc"] = benchmark::Counter(
+      num_allocs * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(memory_typed_stack_allocator)
+    ->Args({100, 17, 32})
+    ->Args({1000, 17, 32})
+    ->Args({10000, 17, 32});
+BENCHMARK(memory_typed_stack_allocator)
+    ->Args({100, 55, 32})
+    ->Args({1000, 55, 32})
+    ->Args({10000, 55, 32});
+BENCHMARK(memory_typed_stack_allocator)
+    ->Args({100, 259, 32})
+    ->Args({1000, 259, 32})
+    ->Args({10000, 259, 32});
+
+static void memory_virtual_stack_allocator(benchmark::State &state) {
+  const int num_allocs = state.range(0);
+  const int alloc_size = state.range(1);
+  const int alignment = state.range(2);
+  const bool decommit = state.range(3);
+  using namespace fastware::memory;
+
+  stack_alloc_create_info_t create_info{
+      nullptr,
+      num_allocs *
+          align(alloc_size, static_cast<alignment_t::value>(alignment)),
+      static_cast<alignment_t::value>(alignment),
+      stack_flags_t::virtual_memory |
+          (decommit ? stack_flags_t::decommit_on_reset : stack_flags_t::none)};
+  allocator_t *alloc = create(&create_info);
+
+  for (auto _ : state) {
+
+    for (int i = 0; i < num_allocs; i++) {
+      auto blk = allocate(alloc, alloc_size);
+      benchmark::DoNotOptimize(blk);
+    }
+    benchmark::ClobberMemory();
+
+    state.PauseTiming();
+    deallocate_all(alloc);
+    benchmark::ClobberMemory();
+    state.ResumeTiming();
+  }
+
+  destroy(alloc);
+
+  state.counters["PerAlloc"] = benchmark::Counter(
+      num_allocs * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(memory_virtual_stack_allocator)
+    ->Args({100, 17, 32, 0})
+    ->Args({1000, 17, 32, 0})
+    ->Args({10000, 17, 32, 0});
+BENCHMARK(memory_virtual_stack_allocator)
+    ->Args({100, 259, 32, 0})
+    ->Args({1000, 259, 32, 0})
+    ->Args({10000, 259, 32, 0});
+BENCHMARK(memory_virtual_stack_allocator)
+    ->Args({10000, 259, 32, 1});
+
+// A buffer grown by doubling from 64 bytes up to final_size on top of the
+// stack, in place with reallocate or by allocating, copying and freeing
+static void memory_stack_allocator_grow(benchmark::State &state) {
+  const uint64_t final_size = state.range(0);
+  const bool in_place = state.range(1);
+  using namespace fastware::memory;
+
+  stack_alloc_create_info_t create_info{nullptr, 4 * final_size,
+                                        alignment_t::b16};
+  allocator_t *alloc = create(&create_info);
+
+  uint64_t steps = 0;
+  for (auto _ : state) {
+    memblk blk = allocate(alloc, 64);
+    memset(blk.ptr, 1, blk.size);
+    for (uint64_t size = 128; size <= final_size; size *= 2, steps++) {
+      if (in_place) {
+        blk = reallocate(alloc, blk, size);
+      } else {
+        memblk grown = allocate(alloc, size);
+        memcpy(grown.ptr, blk.ptr, blk.size);
+        deallocate(alloc, blk);
+        blk = grown;
+      }
+      benchmark::DoNotOptimize(blk.ptr);
+    }
+    deallocate_all(alloc);
+  }
+
+  destroy(alloc);
+
+  state.counters["PerGrow"] = benchmark::Counter(
+      steps, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(memory_stack_allocator_grow)
+    ->Args({64 << 10, 0})
+    ->Args({64 << 10, 1})
+    ->Args({1 << 20, 0})
+    ->Args({1 << 20, 1});
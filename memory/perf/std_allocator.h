@@ -0,0 +1,110 @@
+#include <benchmark/benchmark.h>
+
+#include <fastware/memory.h>
+#include <fastware/std_allocator.h>
+
+#include <list>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+// Backing of the std::pmr containers: 0 the global heap, 1 a stack reset
+// every iteration, 2 pools (a slab of them for the containers that allocate
+// many sizes, a single one for node only containers)
+static fastware::memory::allocator_t *std_backing(int64_t backing,
+                                                 uint64_t node_size) {
+  using namespace fastware::memory;
+  switch (backing) {
+  case 1: {
+    stack_alloc_create_info_t create_info{nullptr, 64 * Mb, alignment_t::b16};
+    return create(&create_info);
+  }
+  case 2: {
+    if (node_size) {
+      pool_alloc_create_info_t create_info{nullptr, node_size,
+                                           alignment_t::b16, 1 << 20};
+      return create(&create_info);
+    }
+    slab_alloc_create_info_t create_info{nullptr, 16, 4 * Mb, 16 * Mb};
+    return create(&create_info);
+  }
+  default:
+    return nullptr;
+  }
+}
+
+template <typename workload_t>
+static void std_container(benchmark::State &state, uint64_t node_size,
+                          workload_t workload) {
+  using namespace fastware::memory;
+  const int64_t count = state.range(0);
+  allocator_t *alloc = std_backing(state.range(1), node_size);
+  fastware::memory::memory_resource resource{alloc};
+  std::pmr::memory_resource *upstream =
+      alloc ? static_cast<std::pmr::memory_resource *>(&resource)
+            : std::pmr::new_delete_resource();
+
+  for (auto _ : state) {
+    workload(upstream, count);
+
+    if (alloc && state.range(1) == 1) {
+      state.PauseTiming();
+      deallocate_all(alloc);
+      state.ResumeTiming();
+    }
+  }
+
+  if (alloc) {
+    destroy(alloc);
+  }
+
+  state.counters["PerElement"] = benchmark::Counter(
+      count * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+static void std_pmr_vector_push_back(benchmark::State &state) {
+  std_container(state, 0,
+                [](std::pmr::memory_resource *upstream, int64_t count) {
+                  std::pmr::vector<uint64_t> values{upstream};
+                  for (int64_t i = 0; i < count; i++) {
+                    values.push_back(i);
+                  }
+                  benchmark::DoNotOptimize(values.data());
+                });
+}
+
+static void std_pmr_unordered_map_churn(benchmark::State &state) {
+  std_container(state, 0,
+                [](std::pmr::memory_resource *upstream, int64_t count) {
+                  std::pmr::unordered_map<uint64_t, uint64_t> values{upstream};
+                  for (int64_t i = 0; i < count; i++) {
+                    values[i * 7] = i;
+                  }
+                  for (int64_t i = 0; i < count; i += 2) {
+                    values.erase(i * 7);
+                  }
+                  benchmark::DoNotOptimize(values.size());
+                });
+}
+
+static void std_pmr_list_push_pop(benchmark::State &state) {
+  // node of a list of uint64_t, two links and the value
+  std_container(state, 32,
+                [](std::pmr::memory_resource *upstream, int64_t count) {
+                  std::pmr::list<uint64_t> values{upstream};
+                  for (int64_t i = 0; i < count; i++) {
+                    values.push_back(i);
+                  }
+                  for (int64_t i = 0; i < count; i += 2) {
+                    values.pop_front();
+                  }
+                  benchmark::DoNotOptimize(values.size());
+                });
+}
+
+BENCHMARK(std_pmr_vector_push_back)
+    ->ArgsProduct({{1000, 100000}, {0, 1, 2}});
+BENCHMARK(std_pmr_unordered_map_churn)
+    ->ArgsProduct({{1000, 100000}, {0, 1, 2}});
+BENCHMARK(std_pmr_list_push_pop)->ArgsProduct({{1000, 100000}, {0, 1, 2}});
@@ -1,5 +1,7 @@
 #include <benchmark/benchmark.h>
 
+#include "workload.h"
+
 static void system_malloc(benchmark::State &state) {
   const int num_allocs = state.range(0);
   const int alloc_size = state.range(1);
@@ -33,7 +35,7 @@ BENCHMARK(system_malloc)
 static void system_aligned_alloc(benchmark::State &state) {
   const int num_allocs = state.range(0);
   const int alloc_size = state.range(1);
-  const int alignment = state.range(1);
+  const int alignment = state.range(2);
   std::vector<void *> allocs(num_allocs);
   for (auto _ : state) {
 
@@ -90,4 +92,57 @@ static void system_free(benchmark::State &state) {
 
 BENCHMARK(system_free)->Args({100, 17})->Args({1000, 17})->Args({10000, 17});
 BENCHMARK(system_free)->Args({100, 55})->Args({1000, 55})->Args({10000, 55});
-BENCHMARK(system_free)->Args({100, 259})->Args({1000, 259})->Args({10000, 259});
\ No newline at end of file
+BENCHMARK(system_free)->Args({100, 259})->Args({1000, 259})->Args({10000, 259});
+
+static void system_malloc_contention(benchmark::State &state) {
+  const int num_allocs = state.range(0);
+  const int alloc_size = state.range(1);
+  std::vector<void *> allocs(num_allocs);
+  for (auto _ : state) {
+    for (int i = 0; i < num_allocs; i++) {
+      allocs[i] = malloc(alloc_size);
+    }
+    benchmark::ClobberMemory();
+
+    for (auto ptr : allocs) {
+      free(ptr);
+    }
+    benchmark::ClobberMemory();
+  }
+  state.counters["PerAlloc"] = benchmark::Counter(
+      num_allocs * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(system_malloc_contention)
+    ->Args({1000, 64})
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+
+static void system_malloc_mixed(benchmark::State &state) {
+  const int num_allocs = state.range(0);
+  const int max_size = state.range(1);
+
+  const auto sizes = mixed_sizes(num_allocs, max_size);
+
+  std::vector<void *> allocs(num_allocs);
+  for (auto _ : state) {
+    for (int i = 0; i < num_allocs; i++) {
+      allocs[i] = malloc(sizes[i]);
+    }
+    benchmark::ClobberMemory();
+
+    for (auto ptr : allocs) {
+      free(ptr);
+    }
+    benchmark::ClobberMemory();
+  }
+  state.counters["PerAlloc"] = benchmark::Counter(
+      num_allocs * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(system_malloc_mixed)
+    ->Args({100, 4096})
+    ->Args({1000, 4096})
+    ->Args({10000, 4096});
\ No newline at end of file
@@ -0,0 +1,221 @@
+#include <benchmark/benchmark.h>
+
+#include <fastware/memory.h>
+
+#include <atomic>
+#include <thread>
+
+namespace {
+// Single producer, single consumer ring handing blocks from the thread that
+// allocates them to the thread that frees them
+struct handoff_ring_t {
+  static constexpr uint64_t capacity{1024};
+  alignas(64) std::atomic_uint64_t write{0};
+  alignas(64) std::atomic_uint64_t read{0};
+  alignas(64) void *slots[capacity];
+
+  void push(void *ptr) {
+    const uint64_t w = write.load(std::memory_order_relaxed);
+    while (w - read.load(std::memory_order_acquire) == capacity) {
+      std::this_thread::yield();
+    }
+    slots[w % capacity] = ptr;
+    write.store(w + 1, std::memory_order_release);
+  }
+
+  void *pop() {
+    const uint64_t r = read.load(std::memory_order_relaxed);
+    while (write.load(std::memory_order_acquire) == r) {
+      std::this_thread::yield();
+    }
+    void *ptr = slots[r % capacity];
+    read.store(r + 1, std::memory_order_release);
+    return ptr;
+  }
+};
+
+handoff_ring_t handoff_rings[8];
+
+// Even threads allocate, odd threads free what their partner allocated
+template <typename Alloc, typename Dealloc>
+void producer_consumer(benchmark::State &state, int num_allocs, Alloc alloc_fn,
+                       Dealloc dealloc_fn) {
+  handoff_ring_t &ring = handoff_rings[state.thread_index() / 2];
+  const bool producer = (state.thread_index() & 1) == 0;
+
+  for (auto _ : state) {
+    if (producer) {
+      for (int i = 0; i < num_allocs; i++) {
+        void *ptr = alloc_fn();
+        benchmark::DoNotOptimize(ptr);
+        ring.push(ptr);
+      }
+    } else {
+      for (int i = 0; i < num_allocs; i++) {
+        dealloc_fn(ring.pop());
+      }
+    }
+  }
+
+  state.counters["PerAlloc"] = benchmark::Counter(
+      num_allocs * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+} // namespace
+
+static void memory_thread_cache_allocator_contention(benchmark::State &state) {
+  const int num_allocs = state.range(0);
+  const int alloc_size = state.range(1);
+  const int alignment = state.range(2);
+  using namespace fastware::memory;
+
+  static allocator_t *pool = nullptr;
+  static allocator_t *alloc = nullptr;
+
+  if (state.thread_index() == 0) {
+    pool_alloc_create_info_t pool_info{
+        nullptr, align(alloc_size, static_cast<alignment_t::value>(alignment)),
+        static_cast<alignment_t::value>(alignment),
+        static_cast<uint64_t>(num_allocs) * state.threads() * 2,
+        pool_flags_t::concurrent};
+    pool = create(&pool_info);
+    thread_cache_create_info_t cache_info{nullptr, pool, 64};
+    alloc = create(&cache_info);
+  }
+
+  std::vector<memblk> allocs(num_allocs);
+
+  for (auto _ : state) {
+    for (int i = 0; i < num_allocs; i++) {
+      allocs[i] = allocate(alloc, alloc_size);
+    }
+    benchmark::ClobberMemory();
+
+    for (auto blk : allocs) {
+      deallocate(alloc, blk);
+    }
+    benchmark::ClobberMemory();
+  }
+
+  if (state.thread_index() == 0) {
+    destroy(alloc);
+    destroy(pool);
+  }
+
+  state.counters["PerAlloc"] = benchmark::Counter(
+      num_allocs * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(memory_thread_cache_allocator_contention)
+    ->Args({1000, 64, 64})
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+
+static void memory_thread_cache_allocator_producer_consumer(
+    benchmark::State &state) {
+  const int num_allocs = state.range(0);
+  const int alloc_size = state.range(1);
+  const int alignment = state.range(2);
+  using namespace fastware::memory;
+
+  static allocator_t *pool = nullptr;
+  static allocator_t *alloc = nullptr;
+
+  if (state.thread_index() == 0) {
+    // ring and magazines can hold blocks besides the ones in flight
+    pool_alloc_create_info_t pool_info{
+        nullptr, align(alloc_size, static_cast<alignment_t::value>(alignment)),
+        static_cast<alignment_t::value>(alignment),
+        (handoff_ring_t::capacity + 128) * state.threads(),
+        pool_flags_t::concurrent};
+    pool = create(&pool_info);
+    thread_cache_create_info_t cache_info{nullptr, pool, 64};
+    alloc = create(&cache_info);
+  }
+
+  producer_consumer(
+      state, num_allocs,
+      [&] {
+        memblk blk = allocate(alloc, alloc_size);
+        while (blk.ptr == nullptr) {
+          std::this_thread::yield();
+          blk = allocate(alloc, alloc_size);
+        }
+        return blk.ptr;
+      },
+      [&](void *ptr) { deallocate(alloc, {ptr, prefered_size(alloc, 1)}); });
+
+  if (state.thread_index() == 0) {
+    destroy(alloc);
+    destroy(pool);
+  }
+}
+
+BENCHMARK(memory_thread_cache_allocator_producer_consumer)
+    ->Args({1000, 64, 64})
+    ->Threads(2)
+    ->Threads(4)
+    ->Threads(8)
+    ->Threads(16)
+    ->UseRealTime();
+
+static void memory_concurrent_pool_allocator_producer_consumer(
+    benchmark::State &state) {
+  const int num_allocs = state.range(0);
+  const int alloc_size = state.range(1);
+  const int alignment = state.range(2);
+  using namespace fastware::memory;
+
+  static allocator_t *alloc = nullptr;
+
+  if (state.thread_index() == 0) {
+    pool_alloc_create_info_t pool_info{
+        nullptr, align(alloc_size, static_cast<alignment_t::value>(alignment)),
+        static_cast<alignment_t::value>(alignment),
+        (handoff_ring_t::capacity + 128) * state.threads(),
+        pool_flags_t::concurrent};
+    alloc = create(&pool_info);
+  }
+
+  producer_consumer(
+      state, num_allocs,
+      [&] {
+        memblk blk = allocate(alloc, alloc_size);
+        while (blk.ptr == nullptr) {
+          std::this_thread::yield();
+          blk = allocate(alloc, alloc_size);
+        }
+        return blk.ptr;
+      },
+      [&](void *ptr) { deallocate(alloc, {ptr, prefered_size(alloc, 1)}); });
+
+  if (state.thread_index() == 0) {
+    destroy(alloc);
+  }
+}
+
+BENCHMARK(memory_concurrent_pool_allocator_producer_consumer)
+    ->Args({1000, 64, 64})
+    ->Threads(2)
+    ->Threads(4)
+    ->Threads(8)
+    ->Threads(16)
+    ->UseRealTime();
+
+static void system_malloc_producer_consumer(benchmark::State &state) {
+  const int num_allocs = state.range(0);
+  const int alloc_size = state.range(1);
+
+  producer_consumer(
+      state, num_allocs, [&] { return malloc(alloc_size); },
+      [](void *ptr) { free(ptr); });
+}
+
+BENCHMARK(system_malloc_producer_consumer)
+    ->Args({1000, 64})
+    ->Threads(2)
+    ->Threads(4)
+    ->Threads(8)
+    ->Threads(16)
+    ->UseRealTime();
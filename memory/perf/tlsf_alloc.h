@@ -0,0 +1,53 @@
+#include <benchmark/benchmark.h>
+
+#include <fastware/memory.h>
+
+#include <algorithm>
+#include <random>
+
+#include "workload.h"
+
+static void memory_tlsf_allocator_mixed(benchmark::State &state) {
+  const int num_allocs = state.range(0);
+  const int max_size = state.range(1);
+  using namespace fastware::memory;
+
+  const auto sizes = mixed_sizes(num_allocs, max_size);
+
+  // free in random order so coalescing has work to do
+  std::vector<int> order(num_allocs);
+  for (int i = 0; i < num_allocs; i++) {
+    order[i] = i;
+  }
+  std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+  tlsf_alloc_create_info_t create_info{
+      nullptr, static_cast<uint64_t>(num_allocs) * (max_size + 64),
+      alignment_t::b16};
+  allocator_t *alloc = create(&create_info);
+
+  std::vector<memblk> allocs(num_allocs);
+
+  for (auto _ : state) {
+    for (int i = 0; i < num_allocs; i++) {
+      allocs[i] = allocate(alloc, sizes[i]);
+    }
+    benchmark::ClobberMemory();
+
+    for (int i : order) {
+      deallocate(alloc, allocs[i]);
+    }
+    benchmark::ClobberMemory();
+  }
+
+  destroy(alloc);
+
+  state.counters["PerAlloc"] = benchmark::Counter(
+      num_allocs * state.iterations(),
+      benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(memory_tlsf_allocator_mixed)
+    ->Args({100, 4096})
+    ->Args({1000, 4096})
+    ->Args({10000, 4096});
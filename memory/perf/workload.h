@@ -0,0 +1,39 @@
+#ifndef MEMORY_PERF_WORKLOAD_H
+#define MEMORY_PERF_WORKLOAD_H
+
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <unistd.h>
+
+// Small object sizes skewed like a real heap: a power of 2 class is picked
+// uniformly, then a size within it, so small sizes dominate by count
+inline std::vector<uint64_t> mixed_sizes(uint64_t count, uint64_t max_size,
+                                         uint32_t seed = 42) {
+  std::mt19937 rng(seed);
+  const uint32_t classes = 64 - __builtin_clzl(max_size);
+  std::vector<uint64_t> sizes(count);
+  for (auto &size : sizes) {
+    const uint64_t high = 1ul << (rng() % classes);
+    size = (high >> 1) + rng() % ((high >> 1) + 1);
+    size = size == 0 ? 1 : size;
+  }
+  return sizes;
+}
+
+// Resident set of the process in bytes, from /proc/self/statm
+inline uint64_t resident_bytes() {
+  uint64_t size = 0;
+  uint64_t resident = 0;
+  if (FILE *file = fopen("/proc/self/statm", "r")) {
+    if (fscanf(file, "%lu %lu", &size, &resident) != 2) {
+      resident = 0;
+    }
+    fclose(file);
+  }
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+#endif // MEMORY_PERF_WORKLOAD_H
@@ -1,31 +1,79 @@
 #include <fastware/memory.h>
+#include <fastware/typed_allocator.h>
 
+#include <algorithm>
+#include <atomic>
 #include <bit>
+#include <chrono>
 #include <cassert>
 #include <cmath>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <memory>
+#include <mutex>
+
+#include <sys/mman.h>
 
 namespace fastware {
 namespace memory {
 
-struct allocator_t {};
-
-enum class alloc_type_e : uint64_t { none = 0, stack, pool };
-
-struct stack_allocator_t : allocator_t {
+// Lives at the start of its own reservation, [mem_space_start, commit_end)
+// is readable and writable, the rest up to mem_space_end is PROT_NONE
+struct virtual_stack_allocator_t : allocator_t {
   alloc_type_e type;
   address block_start;
   address mem_space_start;
   address mem_space_end;
+  address commit_end;
   alignment_t::value alignment;
+  uint64_t size;
+  uint64_t flags;
+};
+
+constexpr uint64_t virtual_commit_granularity{64 * Kb};
+
+// The frames are plain stacks inside the arena, only current hands out
+// memory. Rotating stores the next frame in current and resets its top.
+struct frame_arena_allocator_t : allocator_t {
+  alloc_type_e type;
+  stack_allocator_t *current;
+  allocator_t *parent;
+  uint64_t size;
+  uint64_t backing;
+  uint64_t frame_count;
+  stack_allocator_t frames[max_arena_frames];
+};
+
+// Chunk a thread slot bumps in, [start, end) is still free
+struct concurrent_stack_chunk_t {
+  address start;
+  address end;
+  int8_t __padding[48];
+};
+
+// block_start is the address of the shared top, it may overshoot
+// mem_space_end when the stack runs out. Chunks are only there with a
+// chunk_size, one per thread slot.
+struct concurrent_stack_allocator_t : allocator_t {
+  alloc_type_e type;
+  address mem_space_start;
+  address mem_space_end;
   allocator_t *parent;
   uint64_t size;
+  alignment_t::value alignment;
+  uint64_t chunk_size;
+  uint64_t backing;
+  std::atomic_uint64_t block_start;
+  int8_t __padding[56];
+  concurrent_stack_chunk_t chunks[];
 };
 
-struct pool_allocator_t : allocator_t {
+// Free list head packs {tag:32, block index + 1:32}, zero index means empty.
+// The tag is bumped on every successful exchange so a stale head can never
+// win the CAS again (ABA).
+struct concurrent_pool_allocator_t : allocator_t {
   alloc_type_e type;
   address mem_space_start;
   address mem_space_end;
@@ -34,10 +82,533 @@ struct pool_allocator_t : allocator_t {
   uint64_t block_count;
   uint64_t aligned_block_size;
   alignment_t::value alignment;
-  uint64_t bit_shift;
-  address *block_start;
-  address control_blocks[];
+  uint64_t block_shift;
+  uint64_t block_reciprocal;
+  uint64_t backing;
+  int8_t __padding[48];
+  std::atomic_uint64_t head;
+  // Blocks from untouched on were not handed out since the last reset and
+  // are not on the list, it may overshoot block_count once they are gone
+  std::atomic_uint64_t untouched;
+  int8_t __padding2[48];
+  std::atomic_uint32_t control_blocks[];
+};
+
+constexpr uint64_t max_cache_threads{64};
+
+struct magazine_t {
+  uint64_t count;
+  address blocks[];
+};
+
+// One magazine per thread slot, each starting on its own cache line
+struct thread_cache_allocator_t : allocator_t {
+  alloc_type_e type;
+  allocator_t *parent;
+  uint64_t size;
+  concurrent_pool_allocator_t *pool;
+  uint64_t block_size;
+  uint64_t magazine_size;
+  uint64_t magazine_stride;
+  address magazines;
+};
+
+struct slab_allocator_t : allocator_t {
+  alloc_type_e type;
+  allocator_t *parent;
+  uint64_t size;
+  uint64_t min_shift;
+  uint64_t class_count;
+  allocator_t *pools[];
+};
+
+constexpr uint64_t tlsf_sl_log2{4};
+constexpr uint64_t tlsf_sl_count{1 << tlsf_sl_log2};
+constexpr uint64_t tlsf_fl_count{64};
+
+// Size includes the header and is a multiple of the alignment, leaving the
+// low bits for flags. Free list links live in the payload of free blocks.
+struct tlsf_block_t {
+  tlsf_block_t *prev_phys;
+  uint64_t size;
+  tlsf_block_t *next_free;
+  tlsf_block_t *prev_free;
+};
+
+struct tlsf_allocator_t : allocator_t {
+  alloc_type_e type;
+  address mem_space_start;
+  address mem_space_end;
+  allocator_t *parent;
+  uint64_t size;
+  alignment_t::value alignment;
+  uint64_t header_size;
+  uint64_t min_block_size;
+  uint64_t fl_bitmap;
+  uint32_t sl_bitmap[tlsf_fl_count];
+  tlsf_block_t *free_lists[tlsf_fl_count][tlsf_sl_count];
+};
+
+struct fallback_allocator_t : allocator_t {
+  alloc_type_e type;
+  allocator_t *parent;
+  uint64_t size;
+  allocator_t *primary;
+  allocator_t *secondary;
+};
+
+struct segregator_allocator_t : allocator_t {
+  alloc_type_e type;
+  allocator_t *parent;
+  uint64_t size;
+  uint64_t threshold;
+  allocator_t *small;
+  allocator_t *large;
+};
+
+constexpr uint64_t affix_canary{0xfa57fa57deadc0deul};
+
+// A block of inner is [prefix, block, suffix]. The size is the last word of
+// the prefix and the front canary the word before it, the back canary is the
+// whole suffix and may be unaligned.
+struct affix_allocator_t : allocator_t {
+  alloc_type_e type;
+  allocator_t *parent;
+  uint64_t size;
+  allocator_t *inner;
+  uint64_t flags;
+  uint64_t prefix_size;
+  uint64_t suffix_size;
+};
+
+// Budgets are linked in creation order so they can be reported without
+// stats. charged_bytes goes up by the size asked for before inner is called
+// so concurrent allocations cannot slip past the hard limit together.
+struct budget_allocator_t : allocator_t {
+  alloc_type_e type;
+  allocator_t *parent;
+  uint64_t size;
+  allocator_t *inner;
+  const char *tag;
+  uint64_t soft_limit;
+  uint64_t hard_limit;
+  budget_callback_t callback;
+  void *user_data;
+  budget_allocator_t *prev;
+  budget_allocator_t *next;
+  std::atomic_uint64_t charged_bytes;
+  std::atomic_uint64_t peak_bytes;
+  std::atomic_uint64_t refused_count;
+};
+
+namespace {
+#ifdef FASTWARE_MEMORY_STATS
+const char *internal_kind(alloc_type_e type) {
+  switch (type) {
+  case alloc_type_e::stack:
+    return "stack";
+  case alloc_type_e::virtual_stack:
+    return "virtual_stack";
+  case alloc_type_e::concurrent_stack:
+    return "concurrent_stack";
+  case alloc_type_e::frame_arena:
+    return "frame_arena";
+  case alloc_type_e::pool:
+    return "pool";
+  case alloc_type_e::concurrent_pool:
+    return "concurrent_pool";
+  case alloc_type_e::bitmap_pool:
+    return "bitmap_pool";
+  case alloc_type_e::thread_cache:
+    return "thread_cache";
+  case alloc_type_e::slab:
+    return "slab";
+  case alloc_type_e::tlsf:
+    return "tlsf";
+  case alloc_type_e::fallback:
+    return "fallback";
+  case alloc_type_e::segregator:
+    return "segregator";
+  case alloc_type_e::affix:
+    return "affix";
+  case alloc_type_e::budget:
+    return "budget";
+  default:
+    return "unknown";
+  }
+}
+
+// Side table keyed by allocator address so the allocator layouts stay the
+// same whether stats are compiled in or not. Records never move while their
+// allocator lives, an open addressing index over them finds the record of
+// an allocator. Destroying an allocator shifts the entries probed past it
+// back instead of leaving a tombstone, probes stay as short as the table is
+// full. Only the lock holder changes the table, lookups do not lock.
+struct stats_record_t {
+  std::atomic<allocator_t *> alloc;
+  allocator_t *parent;
+  uint64_t capacity;
+  uint64_t block_count;
+  std::atomic_uint64_t bytes_in_use;
+  std::atomic_uint64_t peak_bytes;
+  std::atomic_uint64_t alloc_count;
+  std::atomic_uint64_t free_count;
+  std::atomic_uint64_t failed_count;
+  std::atomic_uint64_t live_count;
+};
+
+constexpr uint64_t stats_record_count{512};
+// at most half full
+constexpr uint64_t stats_index_bits{10};
+constexpr uint64_t stats_index_size{1 << stats_index_bits};
+constexpr uint64_t stats_index_mask{stats_index_size - 1};
+
+static struct stats_table_t {
+  std::atomic_flag lock;
+  // record + 1 of every index entry, 0 for empty ones
+  std::atomic_uint32_t index[stats_index_size];
+  // records below used_count that are not on the free list are live
+  uint32_t used_count;
+  uint32_t free_count;
+  uint32_t free_records[stats_record_count];
+  stats_record_t records[stats_record_count];
+} _stats_table;
+
+inline uint64_t stats_hash(const allocator_t *alloc) {
+  return (reinterpret_cast<uintptr_t>(alloc) * 0x9E3779B97F4A7C15ul) >>
+         (64 - stats_index_bits);
+}
+
+// Index entry of alloc, stats_index_size when it has none. Exact with the
+// lock held, without it an entry being shifted back can be missed.
+inline uint64_t stats_probe(const allocator_t *alloc) {
+  for (uint64_t i = stats_hash(alloc);; i = (i + 1) & stats_index_mask) {
+    const uint32_t entry =
+        _stats_table.index[i].load(std::memory_order_acquire);
+    if (entry == 0) {
+      return stats_index_size;
+    }
+    if (_stats_table.records[entry - 1].alloc.load(
+            std::memory_order_relaxed) == alloc) {
+      return i;
+    }
+  }
+}
+
+void stats_lock() {
+  while (_stats_table.lock.test_and_set(std::memory_order_acquire))
+    ;
+}
+
+void stats_unlock() { _stats_table.lock.clear(std::memory_order_release); }
+
+// With the lock held
+inline stats_record_t *stats_locked_find(const allocator_t *alloc) {
+  const uint64_t i = stats_probe(alloc);
+  if (i == stats_index_size) {
+    return nullptr;
+  }
+  return &_stats_table.records[_stats_table.index[i].load(
+                                   std::memory_order_relaxed) -
+                               1];
+}
+
+// A miss is looked up again under the lock, it may have raced a destroy
+// shifting the entry back
+inline stats_record_t *stats_find(const allocator_t *alloc) {
+  const uint64_t i = stats_probe(alloc);
+  if (__builtin_expect(i != stats_index_size, true)) {
+    const uint32_t entry =
+        _stats_table.index[i].load(std::memory_order_acquire);
+    stats_record_t *record = &_stats_table.records[entry - 1];
+    if (record->alloc.load(std::memory_order_relaxed) == alloc) {
+      return record;
+    }
+  }
+  stats_lock();
+  stats_record_t *record = stats_locked_find(alloc);
+  stats_unlock();
+  return record;
+}
+
+void stats_register(allocator_t *alloc, allocator_t *parent, uint64_t capacity,
+                    uint64_t block_count) {
+  if (alloc == nullptr) {
+    return;
+  }
+  stats_lock();
+  // past stats_record_count live allocators the new ones go without stats,
+  // like in builds without them
+  if (_stats_table.free_count == 0 &&
+      _stats_table.used_count == stats_record_count) {
+    stats_unlock();
+    return;
+  }
+  const uint32_t slot =
+      _stats_table.free_count > 0
+          ? _stats_table.free_records[--_stats_table.free_count]
+          : _stats_table.used_count++;
+  stats_record_t *record = &_stats_table.records[slot];
+  record->parent = parent;
+  record->capacity = capacity;
+  record->block_count = block_count;
+  record->bytes_in_use.store(0, std::memory_order_relaxed);
+  record->peak_bytes.store(0, std::memory_order_relaxed);
+  record->alloc_count.store(0, std::memory_order_relaxed);
+  record->free_count.store(0, std::memory_order_relaxed);
+  record->failed_count.store(0, std::memory_order_relaxed);
+  record->live_count.store(0, std::memory_order_relaxed);
+  record->alloc.store(alloc, std::memory_order_relaxed);
+
+  uint64_t i = stats_hash(alloc);
+  while (_stats_table.index[i].load(std::memory_order_relaxed) != 0) {
+    i = (i + 1) & stats_index_mask;
+  }
+  _stats_table.index[i].store(slot + 1, std::memory_order_release);
+  stats_unlock();
+}
+
+void stats_unregister(allocator_t *alloc) {
+  stats_lock();
+  uint64_t hole = stats_probe(alloc);
+  if (hole == stats_index_size) {
+    stats_unlock();
+    return;
+  }
+  const uint32_t slot =
+      _stats_table.index[hole].load(std::memory_order_relaxed) - 1;
+
+  // Backward shift: every entry past the hole that may sit there takes its
+  // place and leaves a hole of its own. The hole is only emptied at the
+  // end, a lookup racing the shift misses at worst and retries locked.
+  for (uint64_t i = (hole + 1) & stats_index_mask;;
+       i = (i + 1) & stats_index_mask) {
+    const uint32_t entry =
+        _stats_table.index[i].load(std::memory_order_relaxed);
+    if (entry == 0) {
+      break;
+    }
+    const uint64_t home = stats_hash(
+        _stats_table.records[entry - 1].alloc.load(std::memory_order_relaxed));
+    // probed from home to i, the hole is on the way unless home is past it
+    if (((i - home) & stats_index_mask) >= ((i - hole) & stats_index_mask)) {
+      _stats_table.index[hole].store(entry, std::memory_order_release);
+      hole = i;
+    }
+  }
+  _stats_table.index[hole].store(0, std::memory_order_release);
+
+  _stats_table.records[slot].alloc.store(nullptr, std::memory_order_relaxed);
+  _stats_table.free_records[_stats_table.free_count++] = slot;
+  stats_unlock();
+}
+
+void stats_reparent(allocator_t *alloc, allocator_t *parent) {
+  stats_lock();
+  stats_record_t *record = stats_locked_find(alloc);
+  if (record) {
+    record->parent = parent;
+  }
+  stats_unlock();
+}
+
+void stats_add_bytes(stats_record_t *record, uint64_t size) {
+  const uint64_t in_use =
+      record->bytes_in_use.fetch_add(size, std::memory_order_relaxed) + size;
+  uint64_t peak = record->peak_bytes.load(std::memory_order_relaxed);
+  while (peak < in_use && !record->peak_bytes.compare_exchange_weak(
+                              peak, in_use, std::memory_order_relaxed))
+    ;
+}
+
+void stats_on_alloc(allocator_t *alloc, uint64_t count, uint64_t size) {
+  stats_record_t *record = stats_find(alloc);
+  if (record == nullptr) {
+    return;
+  }
+  if (count == 0) {
+    record->failed_count.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  record->alloc_count.fetch_add(count, std::memory_order_relaxed);
+  record->live_count.fetch_add(count, std::memory_order_relaxed);
+  stats_add_bytes(record, size);
+}
+
+// A live block grew by size bytes
+void stats_on_expand(allocator_t *alloc, uint64_t size) {
+  stats_record_t *record = stats_find(alloc);
+  if (record == nullptr) {
+    return;
+  }
+  stats_add_bytes(record, size);
+}
+
+void stats_on_dealloc(allocator_t *alloc, uint64_t count, uint64_t size) {
+  stats_record_t *record = stats_find(alloc);
+  if (record == nullptr) {
+    return;
+  }
+  record->free_count.fetch_add(count, std::memory_order_relaxed);
+  record->live_count.fetch_sub(count, std::memory_order_relaxed);
+  record->bytes_in_use.fetch_sub(size, std::memory_order_relaxed);
+}
+
+// Blocks of one batch can differ in size when a fallback filled it from both
+void stats_on_alloc_n(allocator_t *alloc, const memblk *blks, uint64_t count) {
+  uint64_t size = 0;
+  for (uint64_t i = 0; i < count; i++) {
+    size += blks[i].size;
+  }
+  stats_on_alloc(alloc, count, size);
+}
+
+void stats_on_dealloc_n(allocator_t *alloc, const memblk *blks,
+                        uint64_t count) {
+  uint64_t size = 0;
+  for (uint64_t i = 0; i < count; i++) {
+    size += blks[i].size;
+  }
+  stats_on_dealloc(alloc, count, size);
+}
+
+void stats_on_reset(allocator_t *alloc) {
+  stats_record_t *record = stats_find(alloc);
+  if (record == nullptr) {
+    return;
+  }
+  record->live_count.store(0, std::memory_order_relaxed);
+  record->bytes_in_use.store(0, std::memory_order_relaxed);
+}
+
+allocator_stats_t stats_snapshot(const stats_record_t *record) {
+  return {internal_kind(*reinterpret_cast<alloc_type_e *>(
+              record->alloc.load(std::memory_order_relaxed))),
+          record->capacity,
+          record->bytes_in_use.load(std::memory_order_relaxed),
+          record->peak_bytes.load(std::memory_order_relaxed),
+          record->alloc_count.load(std::memory_order_relaxed),
+          record->free_count.load(std::memory_order_relaxed),
+          record->failed_count.load(std::memory_order_relaxed),
+          record->live_count.load(std::memory_order_relaxed),
+          record->block_count};
+}
+
+void stats_walk(allocator_t *parent, uint32_t depth, stats_visitor_t visitor,
+                void *user_data) {
+  for (uint64_t i = 0; i < _stats_table.used_count; i++) {
+    stats_record_t *record = &_stats_table.records[i];
+    allocator_t *alloc = record->alloc.load(std::memory_order_relaxed);
+    if (record->parent != parent || alloc == nullptr) {
+      continue;
+    }
+    const allocator_stats_t stats = stats_snapshot(record);
+    visitor(alloc, &stats, depth, user_data);
+    stats_walk(alloc, depth + 1, visitor, user_data);
+  }
+}
+#else
+inline void stats_register(allocator_t *, allocator_t *, uint64_t, uint64_t) {}
+inline void stats_unregister(allocator_t *) {}
+inline void stats_reparent(allocator_t *, allocator_t *) {}
+inline void stats_on_alloc(allocator_t *, uint64_t, uint64_t) {}
+inline void stats_on_expand(allocator_t *, uint64_t) {}
+inline void stats_on_dealloc(allocator_t *, uint64_t, uint64_t) {}
+inline void stats_on_alloc_n(allocator_t *, const memblk *, uint64_t) {}
+inline void stats_on_dealloc_n(allocator_t *, const memblk *, uint64_t) {}
+inline void stats_on_reset(allocator_t *) {}
+#endif
+
+#ifdef FASTWARE_MEMORY_TRACE
+constexpr uint64_t trace_buffer_events{4096};
+
+// Events are recorded into one buffer while the other, once full, is
+// written out without holding the lock
+static struct trace_buffer_t {
+  std::atomic_flag lock;
+  // taken under the lock when a full buffer is swapped out and held until it
+  // is written, so writes land in order and a buffer is never refilled while
+  // it is being written
+  std::mutex write_mutex;
+  FILE *file;
+  std::chrono::steady_clock::time_point start;
+  uint64_t current;
+  uint64_t count;
+  trace_event_t events[2][trace_buffer_events];
+} _trace_buffer;
+
+// Public calls made while another one is running on the same thread come
+// from the allocators themselves (parents, pools of a slab or a cache)
+thread_local uint32_t _trace_depth{0};
+
+struct trace_scope_t {
+  trace_scope_t() { _trace_depth++; }
+  ~trace_scope_t() { _trace_depth--; }
+};
+
+void trace_lock() {
+  while (_trace_buffer.lock.test_and_set(std::memory_order_acquire))
+    ;
+}
+
+void trace_unlock() { _trace_buffer.lock.clear(std::memory_order_release); }
+
+// With the lock and the write mutex held
+void trace_flush() {
+  fwrite(_trace_buffer.events[_trace_buffer.current], sizeof(trace_event_t),
+         _trace_buffer.count, _trace_buffer.file);
+  _trace_buffer.count = 0;
+}
+
+void trace_record(trace_op_t::value op, const void *alloc, uint64_t ptr,
+                  uint64_t size) {
+  if (_trace_depth != 1) {
+    return;
+  }
+
+  trace_lock();
+  if (_trace_buffer.file) {
+    // stamped under the lock so the file stays in time order
+    const auto elapsed =
+        std::chrono::steady_clock::now() - _trace_buffer.start;
+    trace_event_t &event =
+        _trace_buffer.events[_trace_buffer.current][_trace_buffer.count++];
+    event.timestamp = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    event.op = op;
+    event.alloc = reinterpret_cast<uint64_t>(alloc);
+    event.ptr = ptr;
+    event.size = size;
+    if (_trace_buffer.count == trace_buffer_events) {
+      // only waits under the lock when the last write is still running
+      _trace_buffer.write_mutex.lock();
+      const trace_event_t *full = _trace_buffer.events[_trace_buffer.current];
+      FILE *file = _trace_buffer.file;
+      _trace_buffer.current ^= 1;
+      _trace_buffer.count = 0;
+      trace_unlock();
+
+      fwrite(full, sizeof(trace_event_t), trace_buffer_events, file);
+      _trace_buffer.write_mutex.unlock();
+      return;
+    }
+  }
+  trace_unlock();
+}
+
+void trace_on_create(allocator_t *alloc, allocator_t *parent) {
+  trace_record(trace_op_t::create, alloc, reinterpret_cast<uint64_t>(parent),
+               static_cast<uint64_t>(*reinterpret_cast<alloc_type_e *>(alloc)));
+}
+#else
+struct trace_scope_t {
+  trace_scope_t() {}
 };
+inline void trace_record(trace_op_t::value, const void *, uint64_t,
+                         uint64_t) {}
+inline void trace_on_create(allocator_t *, allocator_t *) {}
+#endif
+} // namespace
 
 namespace {
 void internal_print_state(pool_allocator_t *alloc) {
@@ -49,14 +620,41 @@ void internal_print_state(pool_allocator_t *alloc) {
          "block_count = %lu\n"
          "aligned_block_size = %lu\n"
          "alignment = %lu\n"
-         "bit_shift = %lu\n"
+         "block_shift = %lu\n"
+         "block_reciprocal = %lu\n"
          "block_start = %p\n"
+         "untouched = %p\n"
+         "control_blocks = %p\n"
+         "}\n",
+         alloc, alloc->mem_space_start.raw, alloc->mem_space_end.raw,
+         alloc->parent, alloc->size, alloc->block_count,
+         alloc->aligned_block_size, alloc->alignment, alloc->block_shift,
+         alloc->block_reciprocal, alloc->block_start, alloc->untouched,
+         alloc->control_blocks);
+}
+
+void internal_print_state(concurrent_pool_allocator_t *alloc) {
+  const uint64_t head = alloc->head.load(std::memory_order_relaxed);
+  printf("concurrent_pool_allocator_t (%p) {\n"
+         "mem_space_start = %p\n"
+         "mem_space_end = %p\n"
+         "parent = %p\n"
+         "size = %lu\n"
+         "block_count = %lu\n"
+         "aligned_block_size = %lu\n"
+         "alignment = %lu\n"
+         "block_shift = %lu\n"
+         "block_reciprocal = %lu\n"
+         "head = {tag = %lu, index = %lu}\n"
+         "untouched = %lu\n"
          "control_blocks = %p\n"
          "}\n",
          alloc, alloc->mem_space_start.raw, alloc->mem_space_end.raw,
          alloc->parent, alloc->size, alloc->block_count,
-         alloc->aligned_block_size, alloc->alignment, alloc->bit_shift,
-         alloc->block_start, alloc->control_blocks);
+         alloc->aligned_block_size, alloc->alignment, alloc->block_shift,
+         alloc->block_reciprocal, head >> 32, head & 0xFFFFFFFF,
+         alloc->untouched.load(std::memory_order_relaxed),
+         alloc->control_blocks);
 }
 } // namespace
 
@@ -74,8 +672,95 @@ struct aligned_storage_create_info_t {
   uint64_t allocator_size;
   uint64_t mem_space_size;
   alignment_t::value alignment;
+  uint64_t backing;
 };
 
+constexpr uint64_t page_size{4 * Kb};
+constexpr uint64_t huge_page_size{2 * Mb};
+
+constexpr uint64_t round_up(uint64_t size, uint64_t granularity) {
+  return (size + granularity - 1) & ~(granularity - 1);
+}
+
+memblk map_backing_storage(uint64_t size, uint64_t backing) {
+
+  const int populate = backing & backing_flags_t::populate ? MAP_POPULATE : 0;
+
+  if (backing & backing_flags_t::huge_pages) {
+    const uint64_t mapped_size = round_up(size, huge_page_size);
+    void *ptr = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | populate, -1,
+                     0);
+    if (ptr != MAP_FAILED) {
+      return {ptr, mapped_size};
+    }
+    // no huge pages reserved, try for transparent ones instead
+  }
+
+  if (backing & (backing_flags_t::huge_pages |
+                 backing_flags_t::transparent_huge_pages)) {
+    // over map so the range can be trimmed to a huge page boundary
+    const uint64_t mapped_size = round_up(size, huge_page_size);
+    const uint64_t reserve_size = mapped_size + huge_page_size;
+    void *ptr = mmap(nullptr, reserve_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+      return {nullptr, 0};
+    }
+    const address reserve_start{.raw = ptr};
+    const address start{.idx = round_up(reserve_start.idx, huge_page_size)};
+    const uint64_t head = start - reserve_start;
+    if (head) {
+      munmap(reserve_start, head);
+    }
+    if (reserve_size - head - mapped_size) {
+      munmap(start + mapped_size, reserve_size - head - mapped_size);
+    }
+    madvise(start, mapped_size, MADV_HUGEPAGE);
+    if (populate) {
+      // after the advice so the faults can be served with huge pages
+      for (uint64_t offset = 0; offset < mapped_size; offset += page_size) {
+        static_cast<volatile char *>(start.raw)[offset] = 0;
+      }
+    }
+    return {start, mapped_size};
+  }
+
+  const uint64_t mapped_size = round_up(size, page_size);
+  void *ptr = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | populate, -1, 0);
+  if (ptr == MAP_FAILED) {
+    return {nullptr, 0};
+  }
+  return {ptr, mapped_size};
+}
+
+void release_backing_storage(void *ptr, uint64_t size, uint64_t backing) {
+  if (backing != backing_flags_t::none) {
+    munmap(ptr, size);
+  } else {
+    std::free(ptr);
+  }
+}
+
+// Pages that can be dropped one by one, hugetlb mappings only take whole
+// huge pages
+constexpr uint64_t trim_granularity(uint64_t backing) {
+  return backing & backing_flags_t::huge_pages ? huge_page_size : page_size;
+}
+
+// Drops the pages that lie entirely inside [start, end), they stay mapped
+// and fault back in zeroed. Returns how many bytes were dropped.
+uint64_t release_pages(address start, address end, uint64_t granularity) {
+  const address first{.idx = round_up(start.idx, granularity)};
+  const address last{.idx = end.idx & ~(granularity - 1)};
+  if (last.idx <= first.idx ||
+      madvise(first, last - first, MADV_DONTNEED) != 0) {
+    return 0;
+  }
+  return last - first;
+}
+
 aligned_storage_t create_aligned_storage(aligned_storage_create_info_t *info) {
 
   const uint64_t aligned_alloc_size =
@@ -89,36 +774,58 @@ aligned_storage_t create_aligned_storage(aligned_storage_create_info_t *info) {
   if (info->parent) {
     temp_blk = allocate(info->parent, total_aligned_size +
                                           alignment_t::mask(info->alignment));
+  } else if (info->backing != backing_flags_t::none) {
+    temp_blk = map_backing_storage(total_aligned_size, info->backing);
   } else {
     temp_blk = {aligned_alloc(info->alignment, total_aligned_size),
                 total_aligned_size};
   }
+  if (temp_blk.ptr == nullptr) {
+    // out of memory, or over the budget of the parent
+    return {};
+  }
 
   address base_address{.raw = temp_blk.ptr};
   address usable_address = base_address + aligned_alloc_size;
 
+  // parents may align less than asked, the mask added above covers it
   uint64_t max_usable_size = temp_blk.size - aligned_alloc_size;
-  uint64_t usable_size = aligned_mem_space_size;
-
-  std::align(info->alignment, max_usable_size, usable_address.raw, usable_size);
-  assert(usable_size >= aligned_mem_space_size &&
-         "Not enough memory left after alignment");
+  const void *aligned = std::align(info->alignment, aligned_mem_space_size,
+                                   usable_address.raw, max_usable_size);
+  assert(aligned && "Not enough memory left after alignment");
   assert(is_aligned(usable_address, info->alignment) &&
          "Memory does not appear to be aligned");
+  (void)aligned;
 
-  return {base_address, temp_blk.size, usable_address, usable_size};
+  return {base_address, temp_blk.size, usable_address, aligned_mem_space_size};
 }
 
 memblk internal_alloc(stack_allocator_t *alloc, uint64_t size) {
+  return typed_allocator<stack_allocator_t>::allocate(alloc, size);
+}
+
+memblk internal_alloc(virtual_stack_allocator_t *alloc, uint64_t size) {
 
   uint64_t aligned_size = align(size, alloc->alignment);
 
   auto current_head = alloc->block_start;
   auto next_head = current_head + aligned_size;
 
-  if (__builtin_expect(next_head > alloc->mem_space_end, false)) {
-    // out of memory
-    return {nullptr, 0};
+  if (__builtin_expect(next_head > alloc->commit_end, false)) {
+    if (next_head > alloc->mem_space_end) {
+      // out of reserved address space
+      return {nullptr, 0};
+    }
+    address commit_end{
+        .idx = align(next_head.idx, static_cast<alignment_t::value>(
+                                        virtual_commit_granularity))};
+    commit_end = commit_end > alloc->mem_space_end ? alloc->mem_space_end
+                                                   : commit_end;
+    if (mprotect(alloc->commit_end, commit_end - alloc->commit_end,
+                 PROT_READ | PROT_WRITE) != 0) {
+      return {nullptr, 0};
+    }
+    alloc->commit_end = commit_end;
   }
 
   alloc->block_start = next_head;
@@ -127,41 +834,73 @@ memblk internal_alloc(stack_allocator_t *alloc, uint64_t size) {
 }
 
 memblk internal_alloc(pool_allocator_t *alloc, uint64_t size) {
-
 #ifdef FASTWARE_VERBOSE
   printf("internal_alloc(pool_allocator_t*) - before\n");
   internal_print_state(alloc);
 #endif
+  const memblk blk = typed_allocator<pool_allocator_t>::allocate(alloc, size);
+#ifdef FASTWARE_VERBOSE
+  printf("internal_alloc(pool_allocator_t*) - after\n");
+  internal_print_state(alloc);
+#endif
+  return blk;
+}
+
+constexpr uint64_t tagged_head(uint64_t head, uint64_t node) {
+  return (((head >> 32) + 1) << 32) | node;
+}
+
+memblk internal_alloc(concurrent_pool_allocator_t *alloc, uint64_t size) {
+
   const uint64_t aligned_size = align(size, alloc->alignment);
   assert(alloc->aligned_block_size == aligned_size && "Invalid block size");
 
-  if (__builtin_expect(alloc->block_start == nullptr, false)) {
-    // out of memory
-    return {nullptr, 0};
-  }
-
-  address *next_block = static_cast<address *>(alloc->block_start->raw);
-  const uint64_t address_diff = address{.raw = alloc->block_start} -
-                                address{.raw = alloc->control_blocks};
-  const uint64_t address_shift = address_diff << alloc->bit_shift;
-  const address offset_address = alloc->mem_space_start + address_shift;
+  uint64_t head = alloc->head.load(std::memory_order_acquire);
+  uint64_t node = 0;
+  do {
+    node = head & 0xFFFFFFFF;
+    if (node == 0) {
+      // nothing on the list, take the next untouched block
+      if (alloc->untouched.load(std::memory_order_relaxed) >=
+          alloc->block_count) {
+        // out of memory
+        return {nullptr, 0};
+      }
+      node = alloc->untouched.fetch_add(1, std::memory_order_relaxed) + 1;
+      if (__builtin_expect(node > alloc->block_count, false)) {
+        return {nullptr, 0};
+      }
+      break;
+    }
+    // The node may be handed out concurrently, in that case the value read
+    // here is garbage but the tag makes the exchange below fail
+    const uint64_t next =
+        alloc->control_blocks[node - 1].load(std::memory_order_relaxed);
+    if (alloc->head.compare_exchange_weak(head, tagged_head(head, next),
+                                          std::memory_order_acquire,
+                                          std::memory_order_acquire)) {
+      break;
+    }
+  } while (true);
 
-  alloc->block_start = next_block;
+  const address offset_address =
+      alloc->mem_space_start +
+      block_offset(node - 1, alloc->block_shift, alloc->block_reciprocal,
+                   alloc->aligned_block_size);
 
 #ifdef FASTWARE_VERBOSE
-  printf("address_diff = %lu, address_shift = %lu, mem_space_start = %p, "
-         "offset_address = %p, range = %lu, control_blocks = %p, block_start = "
-         "%p, next_block = %p\n",
-         address_diff, address_shift, alloc->mem_space_start.raw,
-         offset_address.raw, offset_address - alloc->mem_space_start,
-         alloc->control_blocks, alloc->block_start, next_block);
-  printf("internal_alloc(pool_allocator_t*) - after\n");
-  internal_print_state(alloc);
+  printf("internal_alloc(concurrent_pool_allocator_t*) - node = %lu, "
+         "offset_address = %p\n",
+         node - 1, offset_address.raw);
 #endif
   return {offset_address.raw, aligned_size};
 }
 
 void internal_dealloc(stack_allocator_t *alloc, memblk blk) {
+  typed_allocator<stack_allocator_t>::deallocate(alloc, blk);
+}
+
+void internal_dealloc(virtual_stack_allocator_t *alloc, memblk blk) {
 
   auto adjusted_head = alloc->block_start - blk.size;
   if (adjusted_head == blk.ptr) {
@@ -172,26 +911,54 @@ void internal_dealloc(stack_allocator_t *alloc, memblk blk) {
 }
 
 void internal_dealloc(pool_allocator_t *alloc, memblk blk) {
-  assert(alloc->aligned_block_size == blk.size && "Not a correct block size");
 #ifdef FASTWARE_VERBOSE
   printf("internal_dealloc(pool_allocator_t*) - before\n");
   internal_print_state(alloc);
 #endif
-  const address block{.raw = blk.ptr};
-  const uint64_t mem_blk_diff = block - alloc->mem_space_start;
-  const address control_block_addr = address{.raw = alloc->control_blocks} +
-                                     (mem_blk_diff >> alloc->bit_shift);
-  address *control_block = static_cast<address *>(control_block_addr.raw);
-  control_block->raw = alloc->block_start;
-  alloc->block_start = control_block;
+  typed_allocator<pool_allocator_t>::deallocate(alloc, blk);
 #ifdef FASTWARE_VERBOSE
   printf("internal_dealloc(pool_allocator_t*) - after\n");
   internal_print_state(alloc);
 #endif
 }
 
+void internal_dealloc(concurrent_pool_allocator_t *alloc, memblk blk) {
+  assert(alloc->aligned_block_size == blk.size && "Not a correct block size");
+
+  const address block{.raw = blk.ptr};
+  const uint64_t idx = block_index(block - alloc->mem_space_start,
+                                   alloc->block_shift, alloc->block_reciprocal);
+
+#ifdef FASTWARE_VERBOSE
+  printf("internal_dealloc(concurrent_pool_allocator_t*) - node = %lu, "
+         "block = %p\n",
+         idx, blk.ptr);
+#endif
+  uint64_t head = alloc->head.load(std::memory_order_relaxed);
+  do {
+    alloc->control_blocks[idx].store(static_cast<uint32_t>(head),
+                                     std::memory_order_relaxed);
+  } while (!alloc->head.compare_exchange_weak(head, tagged_head(head, idx + 1),
+                                              std::memory_order_release,
+                                              std::memory_order_relaxed));
+}
+
 void internal_dealloc_all(stack_allocator_t *alloc) {
+  typed_allocator<stack_allocator_t>::deallocate_all(alloc);
+}
+
+void internal_dealloc_all(virtual_stack_allocator_t *alloc) {
   alloc->block_start = alloc->mem_space_start;
+  if (alloc->flags & stack_flags_t::decommit_on_reset) {
+    // pages stay mapped and fault back in zeroed, the first one holds us
+    const address first_page{
+        .idx = align(alloc->mem_space_start.idx,
+                     static_cast<alignment_t::value>(
+                         virtual_commit_granularity))};
+    if (alloc->commit_end > first_page) {
+      madvise(first_page, alloc->commit_end - first_page, MADV_DONTNEED);
+    }
+  }
 }
 
 void internal_dealloc_all(pool_allocator_t *alloc) {
@@ -199,161 +966,2894 @@ void internal_dealloc_all(pool_allocator_t *alloc) {
   printf("internal_dealloc_all(pool_allocator_t*)\n");
   internal_print_state(alloc);
 #endif
-  alloc->block_start = &alloc->control_blocks[0];
-  for (uint64_t i = 0; i < alloc->block_count - 1; i++) {
-    alloc->control_blocks[i].raw = &alloc->control_blocks[i + 1];
-  }
-  alloc->control_blocks[alloc->block_count - 1].raw = nullptr;
+  typed_allocator<pool_allocator_t>::deallocate_all(alloc);
 }
 
-uint64_t internal_pref_size(stack_allocator_t *alloc, uint64_t size) {
-  return align(size, alloc->alignment);
+// Pops up to count blocks with a single exchange. Links are walked before
+// the CAS; if any of them changed the tag did too, so the range check only
+// has to keep a stale walk inside the control blocks.
+inline void chain_store(address *out, address block, uint64_t) {
+  *out = block;
 }
 
-uint64_t internal_pref_size(pool_allocator_t *alloc, uint64_t size) {
-  return size > alloc->aligned_block_size ? 0 : alloc->aligned_block_size;
+inline void chain_store(memblk *out, address block, uint64_t size) {
+  *out = {block.raw, size};
 }
 
-bool internal_owns(stack_allocator_t *alloc, memblk blk) {
-  return blk.ptr >= alloc->mem_space_start & blk.ptr < alloc->mem_space_end;
-}
+inline address chain_load(const address &block) { return block; }
 
-bool internal_owns(pool_allocator_t *alloc, memblk blk) {
-  return blk.ptr >= alloc->mem_space_start & blk.ptr < alloc->mem_space_end;
-}
+inline address chain_load(const memblk &block) { return {.raw = block.ptr}; }
 
-bool constexpr pow_of_2(uint64_t size) { return __builtin_popcount(size) == 1; }
+// Claims up to count untouched blocks with a single add
+template <typename block_t>
+uint64_t internal_alloc_untouched(concurrent_pool_allocator_t *alloc,
+                                  uint64_t count, block_t *out) {
+  if (alloc->untouched.load(std::memory_order_relaxed) >= alloc->block_count) {
+    return 0;
+  }
+  const uint64_t first =
+      alloc->untouched.fetch_add(count, std::memory_order_relaxed);
+  if (first >= alloc->block_count) {
+    return 0;
+  }
+  const uint64_t left = alloc->block_count - first;
+  const uint64_t taken = count < left ? count : left;
+  for (uint64_t i = 0; i < taken; i++) {
+    chain_store(&out[i],
+                alloc->mem_space_start +
+                    block_offset(first + i, alloc->block_shift,
+                                 alloc->block_reciprocal,
+                                 alloc->aligned_block_size),
+                alloc->aligned_block_size);
+  }
+  return taken;
+}
 
-} // namespace
+template <typename block_t>
+uint64_t internal_alloc_chain(concurrent_pool_allocator_t *alloc,
+                              uint64_t count, block_t *out) {
+  uint64_t head = alloc->head.load(std::memory_order_acquire);
+  uint64_t taken = 0;
+  uint64_t next = 0;
+  do {
+    uint64_t node = head & 0xFFFFFFFF;
+    if (node == 0) {
+      return internal_alloc_untouched(alloc, count, out);
+    }
+    taken = 0;
+    while (node != 0 & node <= alloc->block_count & taken < count) {
+      chain_store(&out[taken++],
+                  alloc->mem_space_start +
+                      block_offset(node - 1, alloc->block_shift,
+                                   alloc->block_reciprocal,
+                                   alloc->aligned_block_size),
+                  alloc->aligned_block_size);
+      node = alloc->control_blocks[node - 1].load(std::memory_order_relaxed);
+    }
+    next = node;
+    if (taken == 0) {
+      return 0;
+    }
+  } while (!alloc->head.compare_exchange_weak(head, tagged_head(head, next),
+                                              std::memory_order_acquire,
+                                              std::memory_order_acquire));
+  return taken;
+}
+
+// Links the blocks privately and publishes them with a single exchange
+template <typename block_t>
+void internal_dealloc_chain(concurrent_pool_allocator_t *alloc,
+                            const block_t *blocks, uint64_t count) {
+  if (count == 0) {
+    return;
+  }
+  uint64_t first = 0;
+  uint64_t last = 0;
+  for (uint64_t i = 0; i < count; i++) {
+    const uint64_t idx =
+        block_index(chain_load(blocks[i]) - alloc->mem_space_start,
+                    alloc->block_shift, alloc->block_reciprocal);
+    if (i == 0) {
+      first = idx;
+    } else {
+      alloc->control_blocks[last].store(static_cast<uint32_t>(idx + 1),
+                                        std::memory_order_relaxed);
+    }
+    last = idx;
+  }
+  uint64_t head = alloc->head.load(std::memory_order_relaxed);
+  do {
+    alloc->control_blocks[last].store(static_cast<uint32_t>(head),
+                                      std::memory_order_relaxed);
+  } while (!alloc->head.compare_exchange_weak(
+      head, tagged_head(head, first + 1), std::memory_order_release,
+      std::memory_order_relaxed));
+}
+
+// Not thread safe, must not race with allocate/deallocate
+void internal_dealloc_all(concurrent_pool_allocator_t *alloc) {
+#ifdef FASTWARE_VERBOSE
+  printf("internal_dealloc_all(concurrent_pool_allocator_t*)\n");
+  internal_print_state(alloc);
+#endif
+  alloc->untouched.store(0, std::memory_order_relaxed);
+  const uint64_t head = alloc->head.load(std::memory_order_relaxed);
+  alloc->head.store(tagged_head(head, 0), std::memory_order_release);
+}
+
+uint64_t internal_pref_size(stack_allocator_t *alloc, uint64_t size) {
+  return typed_allocator<stack_allocator_t>::prefered_size(alloc, size);
+}
+
+uint64_t internal_pref_size(virtual_stack_allocator_t *alloc, uint64_t size) {
+  return align(size, alloc->alignment);
+}
+
+uint64_t internal_pref_size(pool_allocator_t *alloc, uint64_t size) {
+  return typed_allocator<pool_allocator_t>::prefered_size(alloc, size);
+}
+
+uint64_t internal_pref_size(concurrent_pool_allocator_t *alloc,
+                            uint64_t size) {
+  return size > alloc->aligned_block_size ? 0 : alloc->aligned_block_size;
+}
+
+bool internal_owns(stack_allocator_t *alloc, memblk blk) {
+  return typed_allocator<stack_allocator_t>::owns(alloc, blk);
+}
+
+bool internal_expand(stack_allocator_t *alloc, memblk *blk, uint64_t delta) {
+  return typed_allocator<stack_allocator_t>::expand(alloc, blk, delta);
+}
+
+bool internal_owns(virtual_stack_allocator_t *alloc, memblk blk) {
+  return blk.ptr >= alloc->mem_space_start & blk.ptr < alloc->mem_space_end;
+}
+
+// The top is the end of blk so the next bump lands right after it, commit
+// included
+bool internal_expand(virtual_stack_allocator_t *alloc, memblk *blk,
+                     uint64_t delta) {
+  const address end = address{.raw = blk->ptr} + blk->size;
+  if (end.raw != alloc->block_start.raw) {
+    return false;
+  }
+  const memblk grown = internal_alloc(alloc, delta);
+  if (grown.ptr == nullptr) {
+    return false;
+  }
+  blk->size += grown.size;
+  return true;
+}
+
+bool internal_owns(pool_allocator_t *alloc, memblk blk) {
+  return typed_allocator<pool_allocator_t>::owns(alloc, blk);
+}
+
+bool internal_expand(pool_allocator_t *alloc, memblk *blk, uint64_t delta) {
+  return typed_allocator<pool_allocator_t>::expand(alloc, blk, delta);
+}
+
+bool internal_owns(concurrent_pool_allocator_t *alloc, memblk blk) {
+  return blk.ptr >= alloc->mem_space_start & blk.ptr < alloc->mem_space_end;
+}
+
+bool internal_expand(concurrent_pool_allocator_t *alloc, memblk *blk,
+                     uint64_t delta) {
+  if (blk->size + delta > alloc->aligned_block_size) {
+    return false;
+  }
+  blk->size = alloc->aligned_block_size;
+  return true;
+}
+
+uint64_t internal_alloc_n(stack_allocator_t *alloc, uint64_t size,
+                          uint64_t count, memblk *out) {
+  return typed_allocator<stack_allocator_t>::allocate_n(alloc, size, count,
+                                                        out);
+}
+
+uint64_t internal_alloc_n(virtual_stack_allocator_t *alloc, uint64_t size,
+                          uint64_t count, memblk *out) {
+  // one bump (and at most one commit) when the whole batch fits
+  const uint64_t aligned_size = align(size, alloc->alignment);
+  const memblk blk = internal_alloc(alloc, aligned_size * count);
+  if (blk.ptr == nullptr) {
+    uint64_t taken = 0;
+    while (taken < count &&
+           (out[taken] = internal_alloc(alloc, size)).ptr != nullptr) {
+      taken++;
+    }
+    return taken;
+  }
+  const address head{.raw = blk.ptr};
+  for (uint64_t i = 0; i < count; i++) {
+    out[i] = {(head + i * aligned_size).raw, aligned_size};
+  }
+  return count;
+}
+
+uint64_t internal_alloc_n(pool_allocator_t *alloc, uint64_t size,
+                          uint64_t count, memblk *out) {
+  return typed_allocator<pool_allocator_t>::allocate_n(alloc, size, count,
+                                                       out);
+}
+
+uint64_t internal_alloc_n(concurrent_pool_allocator_t *alloc, uint64_t size,
+                          uint64_t count, memblk *out) {
+  assert(alloc->aligned_block_size == align(size, alloc->alignment) &&
+         "Invalid block size");
+  (void)size;
+  return count ? internal_alloc_chain(alloc, count, out) : 0;
+}
+
+void internal_dealloc_n(stack_allocator_t *alloc, const memblk *blks,
+                        uint64_t count) {
+  typed_allocator<stack_allocator_t>::deallocate_n(alloc, blks, count);
+}
+
+void internal_dealloc_n(virtual_stack_allocator_t *alloc, const memblk *blks,
+                        uint64_t count) {
+  for (uint64_t i = count; i > 0; i--) {
+    internal_dealloc(alloc, blks[i - 1]);
+  }
+}
+
+void internal_dealloc_n(pool_allocator_t *alloc, const memblk *blks,
+                        uint64_t count) {
+  typed_allocator<pool_allocator_t>::deallocate_n(alloc, blks, count);
+}
+
+void internal_dealloc_n(concurrent_pool_allocator_t *alloc, const memblk *blks,
+                        uint64_t count) {
+  internal_dealloc_chain(alloc, blks, count);
+}
+
+memblk internal_alloc(bitmap_pool_allocator_t *alloc, uint64_t size) {
+  return typed_allocator<bitmap_pool_allocator_t>::allocate(alloc, size);
+}
+
+uint64_t internal_alloc_n(bitmap_pool_allocator_t *alloc, uint64_t size,
+                          uint64_t count, memblk *out) {
+  return typed_allocator<bitmap_pool_allocator_t>::allocate_n(alloc, size,
+                                                              count, out);
+}
+
+void internal_dealloc(bitmap_pool_allocator_t *alloc, memblk blk) {
+  typed_allocator<bitmap_pool_allocator_t>::deallocate(alloc, blk);
+}
+
+void internal_dealloc_n(bitmap_pool_allocator_t *alloc, const memblk *blks,
+                        uint64_t count) {
+  typed_allocator<bitmap_pool_allocator_t>::deallocate_n(alloc, blks, count);
+}
+
+void internal_dealloc_all(bitmap_pool_allocator_t *alloc) {
+  typed_allocator<bitmap_pool_allocator_t>::deallocate_all(alloc);
+}
+
+uint64_t internal_pref_size(bitmap_pool_allocator_t *alloc, uint64_t size) {
+  return typed_allocator<bitmap_pool_allocator_t>::prefered_size(alloc, size);
+}
+
+bool internal_owns(bitmap_pool_allocator_t *alloc, memblk blk) {
+  return typed_allocator<bitmap_pool_allocator_t>::owns(alloc, blk);
+}
+
+bool internal_expand(bitmap_pool_allocator_t *alloc, memblk *blk,
+                     uint64_t delta) {
+  return typed_allocator<bitmap_pool_allocator_t>::expand(alloc, blk, delta);
+}
+
+memblk internal_alloc(frame_arena_allocator_t *alloc, uint64_t size) {
+  return typed_allocator<stack_allocator_t>::allocate(alloc->current, size);
+}
+
+uint64_t internal_alloc_n(frame_arena_allocator_t *alloc, uint64_t size,
+                          uint64_t count, memblk *out) {
+  return typed_allocator<stack_allocator_t>::allocate_n(alloc->current, size,
+                                                        count, out);
+}
+
+void internal_dealloc(frame_arena_allocator_t *alloc, memblk blk) {
+  // blocks of older frames go away with their frame, one at the very end of
+  // the previous frame would otherwise look like the top of an empty one
+  if (typed_allocator<stack_allocator_t>::owns(alloc->current, blk)) {
+    typed_allocator<stack_allocator_t>::deallocate(alloc->current, blk);
+  }
+}
+
+void internal_dealloc_n(frame_arena_allocator_t *alloc, const memblk *blks,
+                        uint64_t count) {
+  for (uint64_t i = count; i > 0; i--) {
+    internal_dealloc(alloc, blks[i - 1]);
+  }
+}
+
+void internal_dealloc_all(frame_arena_allocator_t *alloc) {
+  for (uint64_t i = 0; i < alloc->frame_count; i++) {
+    typed_allocator<stack_allocator_t>::deallocate_all(&alloc->frames[i]);
+  }
+}
+
+uint64_t internal_pref_size(frame_arena_allocator_t *alloc, uint64_t size) {
+  return typed_allocator<stack_allocator_t>::prefered_size(alloc->current,
+                                                           size);
+}
+
+bool internal_owns(frame_arena_allocator_t *alloc, memblk blk) {
+  return blk.ptr >= alloc->frames[0].mem_space_start.raw &
+         blk.ptr < alloc->frames[alloc->frame_count - 1].mem_space_end.raw;
+}
+
+bool internal_expand(frame_arena_allocator_t *alloc, memblk *blk,
+                     uint64_t delta) {
+  return typed_allocator<stack_allocator_t>::expand(alloc->current, blk,
+                                                    delta);
+}
+
+// Thread slots index the magazines of every thread cache. A slot is released
+// when its thread exits and the magazines it left behind are inherited by
+// the next thread that claims it, so no blocks are stranded.
+constexpr uint64_t no_thread_slot{~0ul};
+
+std::atomic_uint64_t thread_slot_bits{0};
+
+thread_local uint64_t thread_slot_id{no_thread_slot};
+
+struct thread_slot_release_t {
+  ~thread_slot_release_t() {
+    if (thread_slot_id != no_thread_slot) {
+      thread_slot_bits.fetch_and(~(1ul << thread_slot_id),
+                                 std::memory_order_release);
+      thread_slot_id = no_thread_slot;
+    }
+  }
+};
+
+uint64_t acquire_thread_slot() {
+  uint64_t bits = thread_slot_bits.load(std::memory_order_relaxed);
+  uint64_t slot = 0;
+  do {
+    if (__builtin_expect(bits == ~0ul, false)) {
+      // more threads than magazines, caller goes to the pool directly
+      return no_thread_slot;
+    }
+    slot = __builtin_ctzl(~bits);
+  } while (!thread_slot_bits.compare_exchange_weak(
+      bits, bits | (1ul << slot), std::memory_order_acquire,
+      std::memory_order_relaxed));
+
+  static thread_local thread_slot_release_t release;
+  (void)release;
+  thread_slot_id = slot;
+  return slot;
+}
+
+inline uint64_t current_thread_slot() {
+  if (__builtin_expect(thread_slot_id != no_thread_slot, true)) {
+    return thread_slot_id;
+  }
+  return acquire_thread_slot();
+}
+
+memblk concurrent_stack_bump(concurrent_stack_allocator_t *alloc,
+                             uint64_t aligned_size) {
+  const uint64_t head =
+      alloc->block_start.fetch_add(aligned_size, std::memory_order_relaxed);
+  if (__builtin_expect(head + aligned_size > alloc->mem_space_end.idx,
+                       false)) {
+    // out of memory, the top stays past the end until the next reset
+    return {nullptr, 0};
+  }
+  return {reinterpret_cast<void *>(head), aligned_size};
+}
+
+// A new chunk for the slot, the last one may be shorter than chunk_size but
+// has to hold at least aligned_size
+bool concurrent_stack_reserve(concurrent_stack_allocator_t *alloc,
+                              concurrent_stack_chunk_t *chunk,
+                              uint64_t aligned_size) {
+  uint64_t head = alloc->block_start.load(std::memory_order_relaxed);
+  uint64_t reserved = 0;
+  do {
+    const uint64_t left =
+        head < alloc->mem_space_end.idx ? alloc->mem_space_end.idx - head : 0;
+    if (left < aligned_size) {
+      return false;
+    }
+    reserved = left < alloc->chunk_size ? left : alloc->chunk_size;
+  } while (!alloc->block_start.compare_exchange_weak(
+      head, head + reserved, std::memory_order_relaxed,
+      std::memory_order_relaxed));
+
+  chunk->start.idx = head;
+  chunk->end.idx = head + reserved;
+  return true;
+}
+
+memblk internal_alloc(concurrent_stack_allocator_t *alloc, uint64_t size) {
+  const uint64_t aligned_size = align(size, alloc->alignment);
+
+  const uint64_t slot =
+      alloc->chunk_size && aligned_size <= alloc->chunk_size
+          ? current_thread_slot()
+          : no_thread_slot;
+  if (slot == no_thread_slot) {
+    return concurrent_stack_bump(alloc, aligned_size);
+  }
+
+  concurrent_stack_chunk_t *chunk = &alloc->chunks[slot];
+  if (chunk->end - chunk->start < aligned_size &&
+      !concurrent_stack_reserve(alloc, chunk, aligned_size)) {
+    return {nullptr, 0};
+  }
+
+  const address head = chunk->start;
+  chunk->start = head + aligned_size;
+  return {head, aligned_size};
+}
+
+void internal_dealloc(concurrent_stack_allocator_t *alloc, memblk blk) {
+  const uint64_t slot =
+      alloc->chunk_size ? current_thread_slot() : no_thread_slot;
+  if (slot != no_thread_slot) {
+    concurrent_stack_chunk_t *chunk = &alloc->chunks[slot];
+    if (chunk->start - blk.size == blk.ptr) {
+      // last allocation of this thread's chunk
+      chunk->start = chunk->start - blk.size;
+      return;
+    }
+  }
+
+  // pops the shared top when nobody allocated since, else it stays until
+  // the reset
+  uint64_t head = blk.addr + blk.size;
+  alloc->block_start.compare_exchange_strong(head, blk.addr,
+                                             std::memory_order_relaxed);
+}
+
+void internal_dealloc_all(concurrent_stack_allocator_t *alloc) {
+  alloc->block_start.store(alloc->mem_space_start.idx,
+                           std::memory_order_relaxed);
+  if (alloc->chunk_size) {
+    for (uint64_t slot = 0; slot < max_cache_threads; slot++) {
+      alloc->chunks[slot] = {};
+    }
+  }
+}
+
+uint64_t internal_pref_size(concurrent_stack_allocator_t *alloc,
+                            uint64_t size) {
+  return align(size, alloc->alignment);
+}
+
+bool internal_owns(concurrent_stack_allocator_t *alloc, memblk blk) {
+  return blk.ptr >= alloc->mem_space_start & blk.ptr < alloc->mem_space_end;
+}
+
+bool internal_expand(concurrent_stack_allocator_t *alloc, memblk *blk,
+                     uint64_t delta) {
+  const uint64_t aligned_delta = align(delta, alloc->alignment);
+  const address end = address{.raw = blk->ptr} + blk->size;
+
+  const uint64_t slot =
+      alloc->chunk_size ? current_thread_slot() : no_thread_slot;
+  if (slot != no_thread_slot) {
+    concurrent_stack_chunk_t *chunk = &alloc->chunks[slot];
+    if (chunk->start.raw == end.raw) {
+      // top of this thread's chunk, it can only grow inside of it
+      if (aligned_delta > chunk->end - chunk->start) {
+        return false;
+      }
+      chunk->start = end + aligned_delta;
+      blk->size += aligned_delta;
+      return true;
+    }
+  }
+
+  // the shared top, as long as nobody allocated since
+  if (end.idx + aligned_delta > alloc->mem_space_end.idx) {
+    return false;
+  }
+  uint64_t head = end.idx;
+  if (!alloc->block_start.compare_exchange_strong(
+          head, end.idx + aligned_delta, std::memory_order_relaxed)) {
+    return false;
+  }
+  blk->size += aligned_delta;
+  return true;
+}
+
+uint64_t internal_alloc_n(concurrent_stack_allocator_t *alloc, uint64_t size,
+                          uint64_t count, memblk *out) {
+  // a single bump for the batch, one by one when it does not fit
+  const uint64_t aligned_size = align(size, alloc->alignment);
+  const memblk blk = internal_alloc(alloc, aligned_size * count);
+  if (blk.ptr == nullptr) {
+    uint64_t taken = 0;
+    while (taken < count &&
+           (out[taken] = internal_alloc(alloc, size)).ptr != nullptr) {
+      taken++;
+    }
+    return taken;
+  }
+  const address head{.raw = blk.ptr};
+  for (uint64_t i = 0; i < count; i++) {
+    out[i] = {(head + i * aligned_size).raw, aligned_size};
+  }
+  return count;
+}
+
+void internal_dealloc_n(concurrent_stack_allocator_t *alloc,
+                        const memblk *blks, uint64_t count) {
+  for (uint64_t i = count; i > 0; i--) {
+    internal_dealloc(alloc, blks[i - 1]);
+  }
+}
+
+magazine_t *internal_magazine(thread_cache_allocator_t *alloc, uint64_t slot) {
+  return static_cast<magazine_t *>(
+      (alloc->magazines + slot * alloc->magazine_stride).raw);
+}
+
+uint64_t internal_refill(thread_cache_allocator_t *alloc, magazine_t *mag,
+                         uint64_t count) {
+  mag->count = internal_alloc_chain(alloc->pool, count, mag->blocks);
+  stats_on_alloc(alloc->pool, mag->count, mag->count * alloc->block_size);
+  return mag->count;
+}
+
+void internal_flush(thread_cache_allocator_t *alloc, magazine_t *mag,
+                    uint64_t count) {
+  const address *blocks = &mag->blocks[mag->count - count];
+  internal_dealloc_chain(alloc->pool, blocks, count);
+  stats_on_dealloc(alloc->pool, count, count * alloc->block_size);
+  mag->count -= count;
+}
+
+memblk internal_alloc(thread_cache_allocator_t *alloc, uint64_t size) {
+  assert(size <= alloc->block_size && "Invalid block size");
+
+  const uint64_t slot = current_thread_slot();
+  if (__builtin_expect(slot == no_thread_slot, false)) {
+    return allocate(alloc->pool, alloc->block_size);
+  }
+
+  magazine_t *mag = internal_magazine(alloc, slot);
+  if (__builtin_expect(mag->count == 0, false)) {
+    if (internal_refill(alloc, mag, (alloc->magazine_size + 1) / 2) == 0) {
+      // out of memory
+      return {nullptr, 0};
+    }
+  }
+  return {mag->blocks[--mag->count].raw, alloc->block_size};
+}
+
+void internal_dealloc(thread_cache_allocator_t *alloc, memblk blk) {
+  assert(alloc->block_size == blk.size && "Not a correct block size");
+
+  const uint64_t slot = current_thread_slot();
+  if (__builtin_expect(slot == no_thread_slot, false)) {
+    deallocate(alloc->pool, blk);
+    return;
+  }
+
+  magazine_t *mag = internal_magazine(alloc, slot);
+  if (__builtin_expect(mag->count == alloc->magazine_size, false)) {
+    internal_flush(alloc, mag, (alloc->magazine_size + 1) / 2);
+  }
+  mag->blocks[mag->count++].raw = blk.ptr;
+}
+
+// Not thread safe, every magazine is dropped and the pool reset
+void internal_dealloc_all(thread_cache_allocator_t *alloc) {
+  for (uint64_t slot = 0; slot < max_cache_threads; slot++) {
+    internal_magazine(alloc, slot)->count = 0;
+  }
+  deallocate_all(alloc->pool);
+}
+
+uint64_t internal_pref_size(thread_cache_allocator_t *alloc, uint64_t size) {
+  return size > alloc->block_size ? 0 : alloc->block_size;
+}
+
+bool internal_owns(thread_cache_allocator_t *alloc, memblk blk) {
+  return owns(alloc->pool, blk);
+}
+
+bool internal_expand(thread_cache_allocator_t *alloc, memblk *blk,
+                     uint64_t delta) {
+  if (blk->size + delta > alloc->block_size) {
+    return false;
+  }
+  blk->size = alloc->block_size;
+  return true;
+}
+
+uint64_t internal_alloc_n(thread_cache_allocator_t *alloc, uint64_t size,
+                          uint64_t count, memblk *out) {
+  uint64_t taken = 0;
+  while (taken < count &&
+         (out[taken] = internal_alloc(alloc, size)).ptr != nullptr) {
+    taken++;
+  }
+  return taken;
+}
+
+void internal_dealloc_n(thread_cache_allocator_t *alloc, const memblk *blks,
+                        uint64_t count) {
+  for (uint64_t i = 0; i < count; i++) {
+    internal_dealloc(alloc, blks[i]);
+  }
+}
+
+// Size class without branching: the bit width of size - 1, clamped from
+// below by the smallest class. Sizes above the largest class land past
+// class_count.
+inline uint64_t internal_size_class(slab_allocator_t *alloc, uint64_t size) {
+  const uint64_t min_mask = (1ul << alloc->min_shift) - 1;
+  return (64 - __builtin_clzl((size - 1) | min_mask)) - alloc->min_shift;
+}
+
+memblk internal_alloc(slab_allocator_t *alloc, uint64_t size) {
+  const uint64_t size_class = internal_size_class(alloc, size);
+  if (__builtin_expect(size_class >= alloc->class_count, false)) {
+    // no class is big enough
+    return {nullptr, 0};
+  }
+  const uint64_t class_size = 1ul << (size_class + alloc->min_shift);
+  return allocate(alloc->pools[size_class], class_size);
+}
+
+void internal_dealloc(slab_allocator_t *alloc, memblk blk) {
+  const uint64_t size_class = internal_size_class(alloc, blk.size);
+  assert(size_class < alloc->class_count && "Not a correct block size");
+  deallocate(alloc->pools[size_class], blk);
+}
+
+void internal_dealloc_all(slab_allocator_t *alloc) {
+  for (uint64_t i = 0; i < alloc->class_count; i++) {
+    deallocate_all(alloc->pools[i]);
+  }
+}
+
+uint64_t internal_pref_size(slab_allocator_t *alloc, uint64_t size) {
+  const uint64_t size_class = internal_size_class(alloc, size);
+  return size_class >= alloc->class_count
+             ? 0
+             : 1ul << (size_class + alloc->min_shift);
+}
+
+bool internal_owns(slab_allocator_t *alloc, memblk blk) {
+  const uint64_t size_class = internal_size_class(alloc, blk.size);
+  return size_class < alloc->class_count &&
+         owns(alloc->pools[size_class], blk);
+}
+
+// Within the size class only, moving to a bigger class is a new block
+bool internal_expand(slab_allocator_t *alloc, memblk *blk, uint64_t delta) {
+  const uint64_t size_class = internal_size_class(alloc, blk->size);
+  assert(size_class < alloc->class_count && "Not a correct block size");
+  const uint64_t class_size = 1ul << (size_class + alloc->min_shift);
+  if (blk->size + delta > class_size) {
+    return false;
+  }
+  blk->size = class_size;
+  return true;
+}
+
+uint64_t internal_alloc_n(slab_allocator_t *alloc, uint64_t size,
+                          uint64_t count, memblk *out) {
+  const uint64_t size_class = internal_size_class(alloc, size);
+  if (__builtin_expect(size_class >= alloc->class_count, false)) {
+    // no class is big enough
+    return 0;
+  }
+  const uint64_t class_size = 1ul << (size_class + alloc->min_shift);
+  return allocate_n(alloc->pools[size_class], class_size, count, out);
+}
+
+void internal_dealloc_n(slab_allocator_t *alloc, const memblk *blks,
+                        uint64_t count) {
+  for (uint64_t i = 0; i < count; i++) {
+    internal_dealloc(alloc, blks[i]);
+  }
+}
+
+constexpr uint64_t tlsf_free_bit{1};
+constexpr uint64_t tlsf_prev_free_bit{2};
+constexpr uint64_t tlsf_flag_mask{tlsf_free_bit | tlsf_prev_free_bit};
+
+inline uint64_t tlsf_size(const tlsf_block_t *block) {
+  return block->size & ~tlsf_flag_mask;
+}
+
+inline tlsf_block_t *tlsf_offset(tlsf_block_t *block, uint64_t offset) {
+  return static_cast<tlsf_block_t *>((address{.raw = block} + offset).raw);
+}
+
+inline void tlsf_mapping(uint64_t size, uint64_t *fl, uint64_t *sl) {
+  *fl = 63 - __builtin_clzl(size);
+  *sl = (size >> (*fl - tlsf_sl_log2)) ^ tlsf_sl_count;
+}
+
+void tlsf_insert(tlsf_allocator_t *alloc, tlsf_block_t *block) {
+  uint64_t fl = 0, sl = 0;
+  tlsf_mapping(tlsf_size(block), &fl, &sl);
+  tlsf_block_t *head = alloc->free_lists[fl][sl];
+  block->next_free = head;
+  block->prev_free = nullptr;
+  if (head) {
+    head->prev_free = block;
+  }
+  alloc->free_lists[fl][sl] = block;
+  alloc->fl_bitmap |= 1ul << fl;
+  alloc->sl_bitmap[fl] |= 1u << sl;
+}
+
+void tlsf_remove(tlsf_allocator_t *alloc, tlsf_block_t *block) {
+  uint64_t fl = 0, sl = 0;
+  tlsf_mapping(tlsf_size(block), &fl, &sl);
+  tlsf_block_t *prev = block->prev_free;
+  tlsf_block_t *next = block->next_free;
+  if (next) {
+    next->prev_free = prev;
+  }
+  if (prev) {
+    prev->next_free = next;
+    return;
+  }
+  alloc->free_lists[fl][sl] = next;
+  if (next == nullptr) {
+    alloc->sl_bitmap[fl] &= ~(1u << sl);
+    if (alloc->sl_bitmap[fl] == 0) {
+      alloc->fl_bitmap &= ~(1ul << fl);
+    }
+  }
+}
+
+// One free block spanning the whole space followed by a used zero sized
+// sentinel that stops coalescing at the end
+void tlsf_reset(tlsf_allocator_t *alloc) {
+  alloc->fl_bitmap = 0;
+  memset(alloc->sl_bitmap, 0, sizeof(alloc->sl_bitmap));
+  memset(alloc->free_lists, 0, sizeof(alloc->free_lists));
+
+  tlsf_block_t *first = static_cast<tlsf_block_t *>(alloc->mem_space_start.raw);
+  const uint64_t first_size =
+      (alloc->mem_space_end - alloc->mem_space_start) - alloc->header_size;
+  first->prev_phys = nullptr;
+  first->size = first_size | tlsf_free_bit;
+
+  tlsf_block_t *sentinel = tlsf_offset(first, first_size);
+  sentinel->prev_phys = first;
+  sentinel->size = tlsf_prev_free_bit;
+
+  tlsf_insert(alloc, first);
+}
+
+memblk internal_alloc(tlsf_allocator_t *alloc, uint64_t size) {
+  uint64_t block_size = alloc->header_size + align(size, alloc->alignment);
+  block_size =
+      block_size < alloc->min_block_size ? alloc->min_block_size : block_size;
+
+  // Round up to the next second level list so that any block found fits
+  uint64_t fl = 0, sl = 0;
+  const uint64_t round =
+      (1ul << (63 - __builtin_clzl(block_size) - tlsf_sl_log2)) - 1;
+  tlsf_mapping(block_size + round, &fl, &sl);
+
+  uint64_t sl_map = alloc->sl_bitmap[fl] & (~0u << sl);
+  if (sl_map == 0) {
+    const uint64_t fl_map =
+        fl + 1 < tlsf_fl_count ? alloc->fl_bitmap & (~0ul << (fl + 1)) : 0;
+    if (__builtin_expect(fl_map == 0, false)) {
+      // out of memory
+      return {nullptr, 0};
+    }
+    fl = __builtin_ctzl(fl_map);
+    sl_map = alloc->sl_bitmap[fl];
+  }
+  sl = __builtin_ctz(sl_map);
+
+  tlsf_block_t *block = alloc->free_lists[fl][sl];
+  tlsf_remove(alloc, block);
+
+  const uint64_t free_size = tlsf_size(block);
+  tlsf_block_t *next = tlsf_offset(block, free_size);
+  if (free_size - block_size >= alloc->min_block_size) {
+    tlsf_block_t *rest = tlsf_offset(block, block_size);
+    rest->prev_phys = block;
+    rest->size = (free_size - block_size) | tlsf_free_bit;
+    next->prev_phys = rest;
+    tlsf_insert(alloc, rest);
+  } else {
+    block_size = free_size;
+    next->size &= ~tlsf_prev_free_bit;
+  }
+  // blocks next to a free one never stay free, so prev is in use
+  block->size = block_size;
+
+  return {(address{.raw = block} + alloc->header_size).raw,
+          block_size - alloc->header_size};
+}
+
+void internal_dealloc(tlsf_allocator_t *alloc, memblk blk) {
+  tlsf_block_t *block = static_cast<tlsf_block_t *>(
+      (address{.raw = blk.ptr} - alloc->header_size).raw);
+  assert((block->size & tlsf_free_bit) == 0 && "Block is already free");
+
+  uint64_t block_size = tlsf_size(block);
+  tlsf_block_t *next = tlsf_offset(block, block_size);
+
+  if (block->size & tlsf_prev_free_bit) {
+    tlsf_block_t *prev = block->prev_phys;
+    tlsf_remove(alloc, prev);
+    block_size += tlsf_size(prev);
+    block = prev;
+  }
+  if (next->size & tlsf_free_bit) {
+    tlsf_remove(alloc, next);
+    block_size += tlsf_size(next);
+    next = tlsf_offset(block, block_size);
+  }
+
+  block->size = block_size | tlsf_free_bit;
+  next->prev_phys = block;
+  next->size |= tlsf_prev_free_bit;
+  tlsf_insert(alloc, block);
+}
+
+void internal_dealloc_all(tlsf_allocator_t *alloc) { tlsf_reset(alloc); }
+
+uint64_t internal_pref_size(tlsf_allocator_t *alloc, uint64_t size) {
+  const uint64_t aligned_size = align(size, alloc->alignment);
+  const uint64_t min_size = alloc->min_block_size - alloc->header_size;
+  return aligned_size < min_size ? min_size : aligned_size;
+}
+
+bool internal_owns(tlsf_allocator_t *alloc, memblk blk) {
+  return blk.ptr >= alloc->mem_space_start & blk.ptr < alloc->mem_space_end;
+}
+
+// Takes what it needs from the next physical block when that one is free,
+// splitting off the rest like allocate does
+bool internal_expand(tlsf_allocator_t *alloc, memblk *blk, uint64_t delta) {
+  tlsf_block_t *block = static_cast<tlsf_block_t *>(
+      (address{.raw = blk->ptr} - alloc->header_size).raw);
+  uint64_t block_size = tlsf_size(block);
+  const uint64_t needed =
+      alloc->header_size + align(blk->size + delta, alloc->alignment);
+  if (needed <= block_size) {
+    blk->size = block_size - alloc->header_size;
+    return true;
+  }
+
+  tlsf_block_t *next = tlsf_offset(block, block_size);
+  if ((next->size & tlsf_free_bit) == 0 ||
+      block_size + tlsf_size(next) < needed) {
+    return false;
+  }
+  tlsf_remove(alloc, next);
+
+  const uint64_t merged_size = block_size + tlsf_size(next);
+  tlsf_block_t *after = tlsf_offset(block, merged_size);
+  if (merged_size - needed >= alloc->min_block_size) {
+    tlsf_block_t *rest = tlsf_offset(block, needed);
+    rest->prev_phys = block;
+    rest->size = (merged_size - needed) | tlsf_free_bit;
+    after->prev_phys = rest;
+    tlsf_insert(alloc, rest);
+    block_size = needed;
+  } else {
+    block_size = merged_size;
+    after->prev_phys = block;
+    after->size &= ~tlsf_prev_free_bit;
+  }
+  // the block in front keeps its state
+  block->size = block_size | (block->size & tlsf_prev_free_bit);
+
+  blk->size = block_size - alloc->header_size;
+  return true;
+}
+
+uint64_t internal_alloc_n(tlsf_allocator_t *alloc, uint64_t size,
+                          uint64_t count, memblk *out) {
+  uint64_t taken = 0;
+  while (taken < count &&
+         (out[taken] = internal_alloc(alloc, size)).ptr != nullptr) {
+    taken++;
+  }
+  return taken;
+}
+
+void internal_dealloc_n(tlsf_allocator_t *alloc, const memblk *blks,
+                        uint64_t count) {
+  for (uint64_t i = 0; i < count; i++) {
+    internal_dealloc(alloc, blks[i]);
+  }
+}
+
+memblk internal_alloc(fallback_allocator_t *alloc, uint64_t size) {
+  const memblk blk = allocate(alloc->primary, size);
+  return blk.ptr ? blk : allocate(alloc->secondary, size);
+}
+
+void internal_dealloc(fallback_allocator_t *alloc, memblk blk) {
+  deallocate(owns(alloc->primary, blk) ? alloc->primary : alloc->secondary,
+             blk);
+}
+
+void internal_dealloc_all(fallback_allocator_t *alloc) {
+  deallocate_all(alloc->primary);
+  deallocate_all(alloc->secondary);
+}
+
+uint64_t internal_pref_size(fallback_allocator_t *alloc, uint64_t size) {
+  const uint64_t pref_size = prefered_size(alloc->primary, size);
+  return pref_size ? pref_size : prefered_size(alloc->secondary, size);
+}
+
+bool internal_owns(fallback_allocator_t *alloc, memblk blk) {
+  return owns(alloc->primary, blk) || owns(alloc->secondary, blk);
+}
+
+bool internal_expand(fallback_allocator_t *alloc, memblk *blk,
+                     uint64_t delta) {
+  return expand(owns(alloc->primary, *blk) ? alloc->primary
+                                           : alloc->secondary,
+                blk, delta);
+}
+
+uint64_t internal_alloc_n(fallback_allocator_t *alloc, uint64_t size,
+                          uint64_t count, memblk *out) {
+  const uint64_t taken = allocate_n(alloc->primary, size, count, out);
+  if (taken == count) {
+    return taken;
+  }
+  return taken +
+         allocate_n(alloc->secondary, size, count - taken, out + taken);
+}
+
+void internal_dealloc_n(fallback_allocator_t *alloc, const memblk *blks,
+                        uint64_t count) {
+  for (uint64_t i = count; i > 0; i--) {
+    internal_dealloc(alloc, blks[i - 1]);
+  }
+}
+
+inline allocator_t *internal_route(segregator_allocator_t *alloc,
+                                   uint64_t size) {
+  return size <= alloc->threshold ? alloc->small : alloc->large;
+}
+
+memblk internal_alloc(segregator_allocator_t *alloc, uint64_t size) {
+  return allocate(internal_route(alloc, size), size);
+}
+
+// small may hand out blocks bigger than the threshold, so the size of a
+// block does not tell where it came from
+void internal_dealloc(segregator_allocator_t *alloc, memblk blk) {
+  deallocate(owns(alloc->small, blk) ? alloc->small : alloc->large, blk);
+}
+
+void internal_dealloc_all(segregator_allocator_t *alloc) {
+  deallocate_all(alloc->small);
+  deallocate_all(alloc->large);
+}
+
+uint64_t internal_pref_size(segregator_allocator_t *alloc, uint64_t size) {
+  return prefered_size(internal_route(alloc, size), size);
+}
+
+bool internal_owns(segregator_allocator_t *alloc, memblk blk) {
+  return owns(alloc->small, blk) || owns(alloc->large, blk);
+}
+
+bool internal_expand(segregator_allocator_t *alloc, memblk *blk,
+                     uint64_t delta) {
+  return expand(owns(alloc->small, *blk) ? alloc->small : alloc->large, blk,
+                delta);
+}
+
+uint64_t internal_alloc_n(segregator_allocator_t *alloc, uint64_t size,
+                          uint64_t count, memblk *out) {
+  return allocate_n(internal_route(alloc, size), size, count, out);
+}
+
+void internal_dealloc_n(segregator_allocator_t *alloc, const memblk *blks,
+                        uint64_t count) {
+  for (uint64_t i = count; i > 0; i--) {
+    internal_dealloc(alloc, blks[i - 1]);
+  }
+}
+
+inline uint64_t *internal_affix_word(const void *ptr, uint64_t index) {
+  return static_cast<uint64_t *>(
+      (address{.raw = const_cast<void *>(ptr)} - (index + 1) * 8).raw);
+}
+
+void internal_affix_store(affix_allocator_t *alloc, memblk blk) {
+  uint64_t word = 0;
+  if (alloc->flags & affix_flags_t::size) {
+    *internal_affix_word(blk.ptr, word++) = blk.size;
+  }
+  if (alloc->flags & affix_flags_t::canary) {
+    *internal_affix_word(blk.ptr, word) = affix_canary;
+    memcpy((address{.raw = blk.ptr} + blk.size).raw, &affix_canary,
+           sizeof(affix_canary));
+  }
+}
+
+memblk internal_alloc(affix_allocator_t *alloc, uint64_t size) {
+  const memblk inner = allocate(
+      alloc->inner, alloc->prefix_size + size + alloc->suffix_size);
+  if (__builtin_expect(inner.ptr == nullptr, false)) {
+    // out of memory
+    return {nullptr, 0};
+  }
+
+  const memblk blk{(address{.raw = inner.ptr} + alloc->prefix_size).raw,
+                   inner.size - alloc->prefix_size - alloc->suffix_size};
+  internal_affix_store(alloc, blk);
+  return blk;
+}
+
+void internal_dealloc(affix_allocator_t *alloc, memblk blk) {
+  uint64_t word = 0;
+  if (alloc->flags & affix_flags_t::size) {
+    const uint64_t size = *internal_affix_word(blk.ptr, word++);
+    assert((blk.size == 0 || blk.size == size) && "Not a correct block size");
+    blk.size = size;
+  }
+  if (alloc->flags & affix_flags_t::canary) {
+    uint64_t back_canary = 0;
+    memcpy(&back_canary, (address{.raw = blk.ptr} + blk.size).raw,
+           sizeof(back_canary));
+    assert(*internal_affix_word(blk.ptr, word) == affix_canary &&
+           "Memory in front of the block was overwritten");
+    assert(back_canary == affix_canary &&
+           "Memory past the end of the block was overwritten");
+    (void)back_canary;
+  }
+  deallocate(alloc->inner,
+             {(address{.raw = blk.ptr} - alloc->prefix_size).raw,
+              alloc->prefix_size + blk.size + alloc->suffix_size});
+}
+
+void internal_dealloc_all(affix_allocator_t *alloc) {
+  deallocate_all(alloc->inner);
+}
+
+uint64_t internal_pref_size(affix_allocator_t *alloc, uint64_t size) {
+  const uint64_t pref_size = prefered_size(
+      alloc->inner, alloc->prefix_size + size + alloc->suffix_size);
+  return pref_size ? pref_size - alloc->prefix_size - alloc->suffix_size : 0;
+}
+
+bool internal_owns(affix_allocator_t *alloc, memblk blk) {
+  return owns(alloc->inner,
+              {(address{.raw = blk.ptr} - alloc->prefix_size).raw,
+               alloc->prefix_size + blk.size + alloc->suffix_size});
+}
+
+// The suffix moves to the new end of the block
+bool internal_expand(affix_allocator_t *alloc, memblk *blk, uint64_t delta) {
+  memblk inner{(address{.raw = blk->ptr} - alloc->prefix_size).raw,
+               alloc->prefix_size + blk->size + alloc->suffix_size};
+  if (!expand(alloc->inner, &inner, delta)) {
+    return false;
+  }
+  blk->size = inner.size - alloc->prefix_size - alloc->suffix_size;
+  internal_affix_store(alloc, *blk);
+  return true;
+}
+
+uint64_t internal_alloc_n(affix_allocator_t *alloc, uint64_t size,
+                          uint64_t count, memblk *out) {
+  uint64_t taken = 0;
+  while (taken < count &&
+         (out[taken] = internal_alloc(alloc, size)).ptr != nullptr) {
+    taken++;
+  }
+  return taken;
+}
+
+void internal_dealloc_n(affix_allocator_t *alloc, const memblk *blks,
+                        uint64_t count) {
+  for (uint64_t i = count; i > 0; i--) {
+    internal_dealloc(alloc, blks[i - 1]);
+  }
+}
+
+// Budgets alive, oldest first
+static struct budget_list_t {
+  std::atomic_flag lock;
+  budget_allocator_t *head;
+  budget_allocator_t *tail;
+} _budget_list;
+
+void budget_lock() {
+  while (_budget_list.lock.test_and_set(std::memory_order_acquire))
+    ;
+}
+
+void budget_unlock() { _budget_list.lock.clear(std::memory_order_release); }
+
+void internal_link_budget(budget_allocator_t *alloc) {
+  budget_lock();
+  alloc->prev = _budget_list.tail;
+  alloc->next = nullptr;
+  if (_budget_list.tail) {
+    _budget_list.tail->next = alloc;
+  } else {
+    _budget_list.head = alloc;
+  }
+  _budget_list.tail = alloc;
+  budget_unlock();
+}
+
+void internal_unlink_budget(budget_allocator_t *alloc) {
+  budget_lock();
+  if (alloc->prev) {
+    alloc->prev->next = alloc->next;
+  } else {
+    _budget_list.head = alloc->next;
+  }
+  if (alloc->next) {
+    alloc->next->prev = alloc->prev;
+  } else {
+    _budget_list.tail = alloc->prev;
+  }
+  budget_unlock();
+}
+
+budget_report_t internal_report(const budget_allocator_t *alloc) {
+  return {alloc->tag,
+          alloc->charged_bytes.load(std::memory_order_relaxed),
+          alloc->peak_bytes.load(std::memory_order_relaxed),
+          alloc->soft_limit,
+          alloc->hard_limit,
+          alloc->refused_count.load(std::memory_order_relaxed)};
+}
+
+void internal_notify(budget_allocator_t *alloc, budget_event_t::value event) {
+  if (alloc->callback) {
+    const budget_report_t report = internal_report(alloc);
+    alloc->callback(alloc, event, &report, alloc->user_data);
+  }
+}
+
+// Charges size bytes up front, false and nothing charged when that goes
+// over the hard limit. Callers charge what inner is going to hand out, not
+// what was asked, pools, slabs and stacks round up.
+bool internal_charge(budget_allocator_t *alloc, uint64_t size) {
+  const uint64_t before =
+      alloc->charged_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (alloc->hard_limit && before + size > alloc->hard_limit) {
+    alloc->charged_bytes.fetch_sub(size, std::memory_order_relaxed);
+    alloc->refused_count.fetch_add(1, std::memory_order_relaxed);
+    internal_notify(alloc, budget_event_t::hard_limit);
+    return false;
+  }
+  return true;
+}
+
+// Replaces an up front charge by the size inner actually handed out, 0 when
+// it handed out nothing
+void internal_settle(budget_allocator_t *alloc, uint64_t charged,
+                     uint64_t size) {
+  const uint64_t after =
+      alloc->charged_bytes.fetch_add(size - charged,
+                                     std::memory_order_relaxed) +
+      size - charged;
+  const uint64_t before = after - size;
+
+  uint64_t peak = alloc->peak_bytes.load(std::memory_order_relaxed);
+  while (after > peak && !alloc->peak_bytes.compare_exchange_weak(
+                             peak, after, std::memory_order_relaxed)) {
+  }
+
+  if (alloc->soft_limit && before < alloc->soft_limit &&
+      after >= alloc->soft_limit) {
+    internal_notify(alloc, budget_event_t::soft_limit);
+  }
+}
+
+memblk internal_alloc(budget_allocator_t *alloc, uint64_t size) {
+  const uint64_t charged = prefered_size(alloc->inner, size);
+  if (!internal_charge(alloc, charged)) {
+    return {nullptr, 0};
+  }
+  const memblk blk = allocate(alloc->inner, size);
+  internal_settle(alloc, charged, blk.size);
+  return blk;
+}
+
+void internal_dealloc(budget_allocator_t *alloc, memblk blk) {
+  deallocate(alloc->inner, blk);
+  alloc->charged_bytes.fetch_sub(blk.size, std::memory_order_relaxed);
+}
+
+void internal_dealloc_all(budget_allocator_t *alloc) {
+  deallocate_all(alloc->inner);
+  alloc->charged_bytes.store(0, std::memory_order_relaxed);
+}
+
+uint64_t internal_pref_size(budget_allocator_t *alloc, uint64_t size) {
+  return prefered_size(alloc->inner, size);
+}
+
+bool internal_owns(budget_allocator_t *alloc, memblk blk) {
+  return owns(alloc->inner, blk);
+}
+
+bool internal_expand(budget_allocator_t *alloc, memblk *blk, uint64_t delta) {
+  const uint64_t size = blk->size;
+  const uint64_t charged =
+      std::max(prefered_size(alloc->inner, size + delta) - size, delta);
+  if (!internal_charge(alloc, charged)) {
+    return false;
+  }
+  const bool expanded = expand(alloc->inner, blk, delta);
+  internal_settle(alloc, charged, expanded ? blk->size - size : 0);
+  return expanded;
+}
+
+uint64_t internal_alloc_n(budget_allocator_t *alloc, uint64_t size,
+                          uint64_t count, memblk *out) {
+  uint64_t taken = 0;
+  while (taken < count &&
+         (out[taken] = internal_alloc(alloc, size)).ptr != nullptr) {
+    taken++;
+  }
+  return taken;
+}
+
+void internal_dealloc_n(budget_allocator_t *alloc, const memblk *blks,
+                        uint64_t count) {
+  for (uint64_t i = count; i > 0; i--) {
+    internal_dealloc(alloc, blks[i - 1]);
+  }
+}
+
+// Owner of every page some allocator hands blocks out from, a radix table of
+// four 9 bit levels over 48 bit addresses laid out like the hardware page
+// tables. An entry above the pages can hold the owner of its whole span, so
+// entering a range stores once per span it covers and page by page only at
+// its ends. A page that a range covers only part of (one pool ends and the
+// next one starts in it) is marked shared and points at the short list of
+// ranges handing out from it. Entries only change under the lock, lookups
+// never take it. Tables and lists that are no longer used are kept for the
+// next split.
+constexpr uint64_t page_map_bits{9};
+constexpr uint64_t page_map_fanout{1ul << page_map_bits};
+constexpr uint64_t page_map_top_level{3};
+constexpr uint64_t page_shift{12};
+// page entries, several ranges hand out from the page
+constexpr uintptr_t page_map_shared{1};
+// entries above the pages, the owner of the whole span
+constexpr uintptr_t page_map_span{2};
+constexpr uint64_t page_map_tables_per_chunk{64};
+constexpr uint64_t page_owners_capacity{9};
+constexpr uint64_t page_owners_per_chunk{64};
+
+struct page_map_table_t {
+  std::atomic_uintptr_t entries[page_map_fanout];
+};
+
+// The ranges a shared page hands out from, smallest first so the first one
+// holding an address owns it. The sequence is odd while the lock holder
+// rewrites the list, a lookup that sees it change reads the page again.
+// More ranges than fit are searched in the list of ranges under the lock.
+struct page_owners_t {
+  std::atomic_uint64_t sequence;
+  std::atomic_uint64_t page;
+  // page_owners_capacity + 1 when they do not fit
+  std::atomic_uint64_t count;
+  struct {
+    std::atomic_uintptr_t owner;
+    std::atomic_uintptr_t start;
+    std::atomic_uintptr_t end;
+  } ranges[page_owners_capacity];
+};
+
+// owner hands out blocks from [start, end). Slabs and thread caches hand
+// out from the storage of their pools, they enter the same range after them.
+struct page_range_t {
+  allocator_t *owner;
+  address start;
+  address end;
+};
+
+static struct page_map_t {
+  page_map_table_t root;
+  std::atomic_flag lock;
+  // in the order they were entered
+  page_range_t *ranges;
+  uint64_t range_count;
+  uint64_t range_capacity;
+  page_map_table_t **spares;
+  uint64_t spare_count;
+  uint64_t spare_capacity;
+  page_map_table_t *chunk_next;
+  page_map_table_t *chunk_end;
+  page_owners_t **owners_spares;
+  uint64_t owners_spare_count;
+  uint64_t owners_spare_capacity;
+  page_owners_t *owners_next;
+  page_owners_t *owners_end;
+} _page_map;
+
+void page_map_lock() {
+  while (_page_map.lock.test_and_set(std::memory_order_acquire))
+    ;
+}
+
+void page_map_unlock() { _page_map.lock.clear(std::memory_order_release); }
+
+void *page_map_reserve(uint64_t size) {
+  void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  assert(ptr != MAP_FAILED && "Out of memory for the page map");
+  return ptr;
+}
+
+// Room for one more item in a list of the page map, capacity doubles
+void *page_map_grow(void *items, uint64_t count, uint64_t *capacity,
+                    uint64_t item_size) {
+  if (count < *capacity) {
+    return items;
+  }
+  const uint64_t new_capacity =
+      *capacity ? 2 * *capacity : page_size / item_size;
+  void *new_items = page_map_reserve(new_capacity * item_size);
+  if (items) {
+    memcpy(new_items, items, count * item_size);
+    munmap(items, *capacity * item_size);
+  }
+  *capacity = new_capacity;
+  return new_items;
+}
+
+page_map_table_t *page_map_table() {
+  if (_page_map.spare_count) {
+    return _page_map.spares[--_page_map.spare_count];
+  }
+  if (_page_map.chunk_next == _page_map.chunk_end) {
+    _page_map.chunk_next = static_cast<page_map_table_t *>(page_map_reserve(
+        page_map_tables_per_chunk * sizeof(page_map_table_t)));
+    _page_map.chunk_end = _page_map.chunk_next + page_map_tables_per_chunk;
+  }
+  return _page_map.chunk_next++;
+}
+
+page_owners_t *page_map_owners() {
+  if (_page_map.owners_spare_count) {
+    return _page_map.owners_spares[--_page_map.owners_spare_count];
+  }
+  if (_page_map.owners_next == _page_map.owners_end) {
+    _page_map.owners_next = static_cast<page_owners_t *>(
+        page_map_reserve(page_owners_per_chunk * sizeof(page_owners_t)));
+    _page_map.owners_end = _page_map.owners_next + page_owners_per_chunk;
+  }
+  return _page_map.owners_next++;
+}
+
+// The list of a page entry that is replaced becomes a spare. Its sequence
+// keeps counting, a lookup still reading it sees it change once reused.
+void page_map_release(uintptr_t value) {
+  if (!(value & page_map_shared)) {
+    return;
+  }
+  _page_map.owners_spares = static_cast<page_owners_t **>(page_map_grow(
+      _page_map.owners_spares, _page_map.owners_spare_count,
+      &_page_map.owners_spare_capacity, sizeof(page_owners_t *)));
+  _page_map.owners_spares[_page_map.owners_spare_count++] =
+      reinterpret_cast<page_owners_t *>(value & ~page_map_shared);
+}
+
+// table and the tables below it become spares
+void page_map_drop(page_map_table_t *table, uint64_t level) {
+  for (std::atomic_uintptr_t &entry : table->entries) {
+    const uintptr_t value = entry.load(std::memory_order_relaxed);
+    if (level == 0) {
+      page_map_release(value);
+    } else if (value && !(value & page_map_span)) {
+      page_map_drop(reinterpret_cast<page_map_table_t *>(value), level - 1);
+    }
+  }
+  _page_map.spares = static_cast<page_map_table_t **>(
+      page_map_grow(_page_map.spares, _page_map.spare_count,
+                    &_page_map.spare_capacity, sizeof(page_map_table_t *)));
+  _page_map.spares[_page_map.spare_count++] = table;
+}
+
+// The table below entry, split from the owner of the span when there is
+// none. level is the one of the table.
+page_map_table_t *page_map_split(std::atomic_uintptr_t *entry,
+                                 uint64_t level) {
+  const uintptr_t value = entry->load(std::memory_order_relaxed);
+  if (value && !(value & page_map_span)) {
+    return reinterpret_cast<page_map_table_t *>(value);
+  }
+  page_map_table_t *table = page_map_table();
+  const uintptr_t fill = level > 0 ? value : value & ~page_map_span;
+  for (std::atomic_uintptr_t &child : table->entries) {
+    child.store(fill, std::memory_order_relaxed);
+  }
+  entry->store(reinterpret_cast<uintptr_t>(table), std::memory_order_release);
+  return table;
+}
+
+// Pages [first, last) of the span of table, which starts at page base, go
+// to owner. Lock held.
+void page_map_assign(page_map_table_t *table, uint64_t level, uint64_t base,
+                     uint64_t first, uint64_t last, uintptr_t owner) {
+  const uint64_t shift = level * page_map_bits;
+  for (uint64_t page = first; page < last;) {
+    const uint64_t index = (page - base) >> shift;
+    const uint64_t span_start = base + (index << shift);
+    const uint64_t span_end = span_start + (1ul << shift);
+    std::atomic_uintptr_t *entry = &table->entries[index];
+    if (level == 0) {
+      const uintptr_t value = entry->load(std::memory_order_relaxed);
+      entry->store(owner, std::memory_order_release);
+      page_map_release(value);
+    } else if (page == span_start && span_end <= last) {
+      const uintptr_t value = entry->load(std::memory_order_relaxed);
+      entry->store(owner ? owner | page_map_span : 0,
+                   std::memory_order_release);
+      if (value && !(value & page_map_span)) {
+        page_map_drop(reinterpret_cast<page_map_table_t *>(value), level - 1);
+      }
+    } else {
+      page_map_assign(page_map_split(entry, level - 1), level - 1, span_start,
+                      page, span_end < last ? span_end : last, owner);
+    }
+    page = span_end;
+  }
+}
+
+void page_map_store(uint64_t first, uint64_t last, uintptr_t owner) {
+  assert(last <= 1ul << (page_map_top_level + 1) * page_map_bits &&
+         "Address beyond 48 bits");
+  page_map_assign(&_page_map.root, page_map_top_level, 0, first, last, owner);
+}
+
+// The smallest range holding [start, end), the last entered one of equal
+// ranges. Lock held.
+const page_range_t *page_map_innermost(address start, address end) {
+  const page_range_t *innermost = nullptr;
+  for (uint64_t i = 0; i < _page_map.range_count; i++) {
+    const page_range_t *range = &_page_map.ranges[i];
+    if (range->start.idx <= start.idx && end.idx <= range->end.idx &&
+        (innermost == nullptr ||
+         range->end - range->start <= innermost->end - innermost->start)) {
+      innermost = range;
+    }
+  }
+  return innermost;
+}
+
+// Entry of a page, split down to it. Lock held.
+std::atomic_uintptr_t *page_map_leaf(uint64_t page) {
+  page_map_table_t *table = &_page_map.root;
+  for (uint64_t level = page_map_top_level; level > 0; level--) {
+    const uint64_t index =
+        (page >> level * page_map_bits) & (page_map_fanout - 1);
+    table = page_map_split(&table->entries[index], level - 1);
+  }
+  return &table->entries[page & (page_map_fanout - 1)];
+}
+
+// Sets the entry of a page from the ranges alone, the list of the ranges
+// handing out from it when one of them only covers part of it. Lock held.
+void page_map_resolve(uint64_t page) {
+  const address start{.idx = page << page_shift};
+  const address end = start + page_size;
+
+  // the innermost range covering the whole page hides the ones around it,
+  // the last entered of equal ranges hides the others
+  const page_range_t *found[page_owners_capacity + 1];
+  uint64_t count = 0;
+  const page_range_t *cover = page_map_innermost(start, end);
+  if (cover) {
+    found[count++] = cover;
+  }
+  bool shared = false;
+  for (uint64_t i = 0; i < _page_map.range_count; i++) {
+    const page_range_t *range = &_page_map.ranges[i];
+    if (range->end.idx <= start.idx || end.idx <= range->start.idx ||
+        (range->start.idx <= start.idx && end.idx <= range->end.idx)) {
+      continue;
+    }
+    shared = true;
+    uint64_t slot = 0;
+    while (slot < count && (found[slot]->start.idx != range->start.idx ||
+                            found[slot]->end.idx != range->end.idx)) {
+      slot++;
+    }
+    if (slot < page_owners_capacity + 1) {
+      found[slot] = range;
+      count = slot < count ? count : slot + 1;
+    }
+  }
+
+  std::atomic_uintptr_t *leaf = page_map_leaf(page);
+  const uintptr_t value = leaf->load(std::memory_order_relaxed);
+  if (!shared) {
+    leaf->store(cover ? reinterpret_cast<uintptr_t>(cover->owner) : 0,
+                std::memory_order_release);
+    page_map_release(value);
+    return;
+  }
+
+  // smallest first, of equal ones the last entered
+  std::sort(found, found + count,
+            [](const page_range_t *lhs, const page_range_t *rhs) {
+              const uint64_t lhs_size = lhs->end - lhs->start;
+              const uint64_t rhs_size = rhs->end - rhs->start;
+              return lhs_size != rhs_size ? lhs_size < rhs_size : lhs > rhs;
+            });
+
+  page_owners_t *owners =
+      value & page_map_shared
+          ? reinterpret_cast<page_owners_t *>(value & ~page_map_shared)
+          : page_map_owners();
+  const uint64_t sequence = owners->sequence.load(std::memory_order_relaxed);
+  owners->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  owners->page.store(page, std::memory_order_relaxed);
+  owners->count.store(count, std::memory_order_relaxed);
+  for (uint64_t i = 0; i < count && i < page_owners_capacity; i++) {
+    owners->ranges[i].owner.store(reinterpret_cast<uintptr_t>(found[i]->owner),
+                                  std::memory_order_relaxed);
+    owners->ranges[i].start.store(found[i]->start.idx,
+                                  std::memory_order_relaxed);
+    owners->ranges[i].end.store(found[i]->end.idx, std::memory_order_relaxed);
+  }
+  owners->sequence.store(sequence + 2, std::memory_order_release);
+  if (!(value & page_map_shared)) {
+    leaf->store(reinterpret_cast<uintptr_t>(owners) | page_map_shared,
+                std::memory_order_release);
+    page_map_release(value);
+  }
+}
+
+// Pages strictly inside [start, end) go to owner, the two at its ends are
+// resolved from the ranges. Lock held.
+void page_map_update(address start, address end, allocator_t *owner) {
+  const uint64_t first = start.idx >> page_shift;
+  const uint64_t last = (end.idx - 1) >> page_shift;
+  if (first + 1 < last) {
+    page_map_store(first + 1, last, reinterpret_cast<uintptr_t>(owner));
+  }
+  page_map_resolve(first);
+  page_map_resolve(last);
+}
+
+// Lock held
+void page_map_append(allocator_t *owner, address start, address end) {
+  _page_map.ranges = static_cast<page_range_t *>(
+      page_map_grow(_page_map.ranges, _page_map.range_count,
+                    &_page_map.range_capacity, sizeof(page_range_t)));
+  _page_map.ranges[_page_map.range_count++] = {owner, start, end};
+  page_map_update(start, end, owner);
+}
+
+// Ranges are entered at create, before any block is handed out
+void page_map_insert(allocator_t *owner, address start, address end) {
+  if (start.idx == end.idx) {
+    return;
+  }
+  page_map_lock();
+  page_map_append(owner, start, end);
+  page_map_unlock();
+}
+
+// owner also hands out from every range of from
+void page_map_claim(allocator_t *owner, allocator_t *from) {
+  page_map_lock();
+  const uint64_t range_count = _page_map.range_count;
+  for (uint64_t i = 0; i < range_count; i++) {
+    const page_range_t range = _page_map.ranges[i];
+    if (range.owner == from) {
+      page_map_append(owner, range.start, range.end);
+    }
+  }
+  page_map_unlock();
+}
+
+// The pages of owner go back to the range they were carved from. Ranges
+// carved from owner must have been erased already.
+void page_map_erase(allocator_t *owner) {
+  page_map_lock();
+  uint64_t i = 0;
+  while (i < _page_map.range_count) {
+    const page_range_t range = _page_map.ranges[i];
+    if (range.owner != owner) {
+      i++;
+      continue;
+    }
+    memmove(&_page_map.ranges[i], &_page_map.ranges[i + 1],
+            (--_page_map.range_count - i) * sizeof(page_range_t));
+    const page_range_t *outer = page_map_innermost(range.start, range.end);
+    page_map_update(range.start, range.end, outer ? outer->owner : nullptr);
+  }
+  page_map_unlock();
+}
+
+uint64_t internal_trim(stack_allocator_t *alloc) {
+  return release_pages(alloc->block_start, alloc->mem_space_end,
+                       trim_granularity(alloc->backing));
+}
+
+// The pages stay committed, they are only emptied
+uint64_t internal_trim(virtual_stack_allocator_t *alloc) {
+  return release_pages(alloc->block_start, alloc->commit_end, page_size);
+}
+
+// Bottom up merge sort of the free list by address, no scratch needed
+address *internal_sort_free_list(address *head) {
+  for (uint64_t run = 1;; run <<= 1) {
+    address sorted{.raw = nullptr};
+    address *tail = &sorted;
+    address *list = head;
+    uint64_t merges = 0;
+    while (list) {
+      merges++;
+      address *lhs = list;
+      address *rhs = list;
+      uint64_t lhs_count = 0;
+      while (rhs && lhs_count < run) {
+        rhs = static_cast<address *>(rhs->raw);
+        lhs_count++;
+      }
+      uint64_t rhs_count = run;
+      while (lhs_count || (rhs_count && rhs)) {
+        address *pick = nullptr;
+        if (lhs_count == 0 || (rhs_count && rhs && rhs < lhs)) {
+          pick = rhs;
+          rhs = static_cast<address *>(rhs->raw);
+          rhs_count--;
+        } else {
+          pick = lhs;
+          lhs = static_cast<address *>(lhs->raw);
+          lhs_count--;
+        }
+        tail->raw = pick;
+        tail = pick;
+      }
+      list = rhs;
+    }
+    tail->raw = nullptr;
+    head = static_cast<address *>(sorted.raw);
+    if (merges <= 1) {
+      return head;
+    }
+  }
+}
+
+// The free list is sorted so runs of free blocks are found in one walk,
+// which also hands blocks out in address order afterwards. A run that ends
+// at the untouched blocks leaves the list and becomes untouched again. The
+// links live in the control blocks, so the free blocks themselves can go.
+uint64_t internal_trim(pool_allocator_t *alloc) {
+  using typed = typed_allocator<pool_allocator_t>;
+  const uint64_t granularity = trim_granularity(alloc->backing);
+  const auto release_run = [alloc, granularity](address *first,
+                                                address *last) {
+    const address start =
+        alloc->mem_space_start + typed::block_offset(alloc, first);
+    const address end = alloc->mem_space_start +
+                        typed::block_offset(alloc, last) +
+                        alloc->aligned_block_size;
+    return release_pages(start, end, granularity);
+  };
+
+  alloc->block_start = internal_sort_free_list(alloc->block_start);
+
+  uint64_t released = 0;
+  address *before_run = nullptr;
+  address *run_start = alloc->block_start;
+  address *prev = nullptr;
+  for (address *node = alloc->block_start; node;
+       node = static_cast<address *>(node->raw)) {
+    if (prev && node != prev + 1) {
+      released += release_run(run_start, prev);
+      before_run = prev;
+      run_start = node;
+    }
+    prev = node;
+  }
+  if (prev && prev + 1 == alloc->untouched) {
+    alloc->untouched = run_start;
+    if (before_run) {
+      before_run->raw = nullptr;
+    } else {
+      alloc->block_start = nullptr;
+    }
+  } else if (prev) {
+    released += release_run(run_start, prev);
+  }
+
+  return released +
+         release_pages(alloc->mem_space_start +
+                           typed::block_offset(alloc, alloc->untouched),
+                       alloc->mem_space_end, granularity);
+}
+
+// Only the untouched blocks, the list is shared with other threads
+uint64_t internal_trim(concurrent_pool_allocator_t *alloc) {
+  const uint64_t untouched = alloc->untouched.load(std::memory_order_relaxed);
+  if (untouched >= alloc->block_count) {
+    return 0;
+  }
+  return release_pages(alloc->mem_space_start +
+                           block_offset(untouched, alloc->block_shift,
+                                        alloc->block_reciprocal,
+                                        alloc->aligned_block_size),
+                       alloc->mem_space_end, trim_granularity(alloc->backing));
+}
+
+// Index of the first live (set) or free (clear) block from index on,
+// word_count * 64 when there is none
+uint64_t internal_next_block(const bitmap_pool_allocator_t *alloc,
+                             uint64_t index, bool live) {
+  uint64_t word = index >> 6;
+  if (word >= alloc->word_count) {
+    return alloc->word_count << 6;
+  }
+  const uint64_t flip = live ? 0 : ~0ul;
+  uint64_t bits = (alloc->live_bits[word] ^ flip) & (~0ul << (index & 63));
+  while (bits == 0) {
+    if (++word == alloc->word_count) {
+      return word << 6;
+    }
+    bits = alloc->live_bits[word] ^ flip;
+  }
+  return (word << 6) + __builtin_ctzl(bits);
+}
+
+uint64_t internal_trim(bitmap_pool_allocator_t *alloc) {
+  const uint64_t granularity = trim_granularity(alloc->backing);
+  const auto block_address = [alloc](uint64_t index) {
+    return index >= alloc->block_count
+               ? alloc->mem_space_end
+               : alloc->mem_space_start +
+                     block_offset(index, alloc->block_shift,
+                                  alloc->block_reciprocal,
+                                  alloc->aligned_block_size);
+  };
+
+  uint64_t released = 0;
+  uint64_t index = internal_next_block(alloc, 0, false);
+  while (index < alloc->block_count) {
+    const uint64_t live = internal_next_block(alloc, index, true);
+    released +=
+        release_pages(block_address(index), block_address(live), granularity);
+    index = internal_next_block(alloc, live, false);
+  }
+  return released;
+}
+
+uint64_t internal_trim(slab_allocator_t *alloc) {
+  uint64_t released = 0;
+  for (uint64_t i = 0; i < alloc->class_count; i++) {
+    released += trim(alloc->pools[i]);
+  }
+  return released;
+}
+
+bool constexpr pow_of_2(uint64_t size) { return __builtin_popcount(size) == 1; }
+
+allocator_t *create_concurrent_pool(pool_alloc_create_info_t *info,
+                                    uint64_t aligned_block_size) {
+
+  assert(info->block_count < 0xFFFFFFFF &&
+         "Concurrent pool block count must fit in 32 bits");
+
+  const uint64_t alloc_space_size = aligned_block_size * info->block_count;
+  const uint64_t control_block_size =
+      sizeof(std::atomic_uint32_t) * info->block_count;
+  const uint64_t allocator_size =
+      sizeof(concurrent_pool_allocator_t) + control_block_size;
+
+  aligned_storage_create_info_t storage_info{
+      info->parent, allocator_size, alloc_space_size, info->block_alignment,
+      info->backing};
+
+  aligned_storage_t storage = create_aligned_storage(&storage_info);
+  if (storage.base_address.raw == nullptr) {
+    return nullptr;
+  }
+
+  concurrent_pool_allocator_t *alloc =
+      static_cast<concurrent_pool_allocator_t *>(storage.base_address.raw);
+
+  alloc->type = alloc_type_e::concurrent_pool;
+  alloc->mem_space_start = storage.usable_address;
+  alloc->mem_space_end = storage.usable_address + storage.usable_size;
+  alloc->parent = info->parent;
+  alloc->size = storage.size;
+  alloc->block_count = info->block_count;
+  alloc->aligned_block_size = aligned_block_size;
+  alloc->alignment = info->block_alignment;
+  alloc->block_shift = __builtin_ctzl(aligned_block_size);
+  alloc->block_reciprocal = block_reciprocal(aligned_block_size);
+  alloc->backing = info->parent ? backing_flags_t::none : info->backing;
+  alloc->head.store(0, std::memory_order_relaxed);
+
+  internal_dealloc_all(alloc);
+
+#ifdef FASTWARE_VERBOSE
+  internal_print_state(alloc);
+#endif
+  stats_register(alloc, info->parent, alloc_space_size, info->block_count);
+  page_map_insert(alloc, alloc->mem_space_start, alloc->mem_space_end);
+  trace_on_create(alloc, info->parent);
+  return alloc;
+}
+
+allocator_t *create_bitmap_pool(pool_alloc_create_info_t *info,
+                                uint64_t aligned_block_size) {
+
+  assert(!(info->flags & pool_flags_t::concurrent) &&
+         "Bitmap pools are single threaded");
+
+  const uint64_t alloc_space_size = aligned_block_size * info->block_count;
+  const uint64_t word_count = (info->block_count + 63) / 64;
+  const uint64_t allocator_size =
+      sizeof(bitmap_pool_allocator_t) + sizeof(uint64_t) * word_count;
+
+  aligned_storage_create_info_t storage_info{
+      info->parent, allocator_size, alloc_space_size, info->block_alignment,
+      info->backing};
+
+  aligned_storage_t storage = create_aligned_storage(&storage_info);
+  if (storage.base_address.raw == nullptr) {
+    return nullptr;
+  }
+
+  bitmap_pool_allocator_t *alloc =
+      static_cast<bitmap_pool_allocator_t *>(storage.base_address.raw);
+
+  alloc->type = alloc_type_e::bitmap_pool;
+  alloc->mem_space_start = storage.usable_address;
+  alloc->mem_space_end = storage.usable_address + storage.usable_size;
+  alloc->parent = info->parent;
+  alloc->size = storage.size;
+  alloc->block_count = info->block_count;
+  alloc->aligned_block_size = aligned_block_size;
+  alloc->alignment = info->block_alignment;
+  alloc->block_shift = __builtin_ctzl(aligned_block_size);
+  alloc->block_reciprocal = block_reciprocal(aligned_block_size);
+  alloc->backing = info->parent ? backing_flags_t::none : info->backing;
+  alloc->word_count = word_count;
+
+  internal_dealloc_all(alloc);
+
+  stats_register(alloc, info->parent, alloc_space_size, info->block_count);
+  page_map_insert(alloc, alloc->mem_space_start, alloc->mem_space_end);
+  trace_on_create(alloc, info->parent);
+  return alloc;
+}
+
+allocator_t *create_virtual_stack(stack_alloc_create_info_t *info) {
+
+  assert(info->parent == nullptr &&
+         "Virtual memory stack reserves its own address space");
+
+  const uint64_t header_size =
+      align(sizeof(virtual_stack_allocator_t), info->alignment);
+  const uint64_t reserve_size =
+      align(header_size + info->size,
+            static_cast<alignment_t::value>(virtual_commit_granularity));
+
+  void *base = mmap(nullptr, reserve_size, PROT_NONE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (base == MAP_FAILED) {
+    return nullptr;
+  }
+
+  // the header and the first allocations share the first commit
+  const address base_address{.raw = base};
+  const address commit_end = base_address + virtual_commit_granularity;
+  if (mprotect(base, virtual_commit_granularity, PROT_READ | PROT_WRITE) !=
+      0) {
+    munmap(base, reserve_size);
+    return nullptr;
+  }
+
+  virtual_stack_allocator_t *alloc =
+      static_cast<virtual_stack_allocator_t *>(base);
+  alloc->type = alloc_type_e::virtual_stack;
+  alloc->block_start = base_address + header_size;
+  alloc->mem_space_start = base_address + header_size;
+  alloc->mem_space_end = base_address + reserve_size;
+  alloc->commit_end = commit_end;
+  alloc->alignment = info->alignment;
+  alloc->size = reserve_size;
+  alloc->flags = info->flags;
+
+  stats_register(alloc, nullptr, alloc->mem_space_end - alloc->mem_space_start,
+                 0);
+  page_map_insert(alloc, alloc->mem_space_start, alloc->mem_space_end);
+  trace_on_create(alloc, nullptr);
+  return alloc;
+}
+
+allocator_t *create_concurrent_stack(stack_alloc_create_info_t *info) {
+
+  assert(!(info->flags & stack_flags_t::virtual_memory) &&
+         "Concurrent stack cannot use virtual memory");
+
+  const uint64_t allocator_size =
+      sizeof(concurrent_stack_allocator_t) +
+      (info->chunk_size ? sizeof(concurrent_stack_chunk_t) * max_cache_threads
+                        : 0);
+
+  aligned_storage_create_info_t storage_info{
+      info->parent, allocator_size, info->size, info->alignment,
+      info->backing};
+
+  aligned_storage_t storage = create_aligned_storage(&storage_info);
+  if (storage.base_address.raw == nullptr) {
+    return nullptr;
+  }
+
+  concurrent_stack_allocator_t *alloc =
+      static_cast<concurrent_stack_allocator_t *>(storage.base_address.raw);
+  alloc->type = alloc_type_e::concurrent_stack;
+  alloc->mem_space_start = storage.usable_address;
+  alloc->mem_space_end = storage.usable_address + storage.usable_size;
+  alloc->parent = info->parent;
+  alloc->size = storage.size;
+  alloc->alignment = info->alignment;
+  alloc->chunk_size =
+      info->chunk_size ? align(info->chunk_size, info->alignment) : 0;
+  alloc->backing = info->parent ? backing_flags_t::none : info->backing;
+
+  internal_dealloc_all(alloc);
+
+  stats_register(alloc, info->parent, storage.usable_size, 0);
+  page_map_insert(alloc, alloc->mem_space_start, alloc->mem_space_end);
+  trace_on_create(alloc, info->parent);
+  return alloc;
+}
+
+} // namespace
 
 allocator_t *create(stack_alloc_create_info_t *info) {
+  trace_scope_t scope;
+
+  if (info->flags & stack_flags_t::concurrent) {
+    return create_concurrent_stack(info);
+  }
+
+  if (info->flags & stack_flags_t::virtual_memory) {
+    return create_virtual_stack(info);
+  }
+
+  aligned_storage_create_info_t aligned_info{
+      info->parent, sizeof(stack_allocator_t), info->size, info->alignment,
+      info->backing};
+
+  aligned_storage_t storage = create_aligned_storage(&aligned_info);
+  if (storage.base_address.raw == nullptr) {
+    return nullptr;
+  }
+
+  stack_allocator_t *alloc =
+      static_cast<stack_allocator_t *>(storage.base_address.raw);
+  alloc->type = alloc_type_e::stack;
+  alloc->block_start = storage.usable_address;
+  alloc->mem_space_start = storage.usable_address;
+  alloc->mem_space_end = storage.usable_address + storage.usable_size;
+  alloc->alignment = info->alignment;
+  alloc->parent = info->parent;
+  alloc->size = storage.size;
+  alloc->backing = info->parent ? backing_flags_t::none : info->backing;
+
+  stats_register(alloc, info->parent, storage.usable_size, 0);
+  page_map_insert(alloc, alloc->mem_space_start, alloc->mem_space_end);
+  trace_on_create(alloc, info->parent);
+  return alloc;
+}
+
+allocator_t *create(pool_alloc_create_info_t *info) {
+  trace_scope_t scope;
+
+  const uint64_t aligned_block_size =
+      align(info->block_size, info->block_alignment);
+
+  if (info->flags & pool_flags_t::bitmap) {
+    return create_bitmap_pool(info, aligned_block_size);
+  }
+
+  if (info->flags & pool_flags_t::concurrent) {
+    return create_concurrent_pool(info, aligned_block_size);
+  }
+
+  const uint64_t alloc_space_size = aligned_block_size * info->block_count;
+  const uint64_t control_block_size = sizeof(address) * info->block_count;
+  const uint64_t allocator_size = sizeof(pool_allocator_t) + control_block_size;
+
+  aligned_storage_create_info_t storage_info{
+      info->parent, allocator_size, alloc_space_size, info->block_alignment,
+      info->backing};
+
+  aligned_storage_t storage = create_aligned_storage(&storage_info);
+  if (storage.base_address.raw == nullptr) {
+    return nullptr;
+  }
+
+  pool_allocator_t *alloc =
+      static_cast<pool_allocator_t *>(storage.base_address.raw);
+
+  alloc->type = alloc_type_e::pool;
+  alloc->mem_space_start = storage.usable_address;
+  alloc->mem_space_end = storage.usable_address + storage.usable_size;
+  alloc->parent = info->parent;
+  alloc->size = storage.size;
+  alloc->block_count = info->block_count;
+  alloc->aligned_block_size = aligned_block_size;
+  alloc->alignment = info->block_alignment;
+  alloc->block_shift = __builtin_ctzl(aligned_block_size);
+  alloc->block_reciprocal = block_reciprocal(aligned_block_size);
+  alloc->backing = info->parent ? backing_flags_t::none : info->backing;
+  // the control blocks are linked as blocks are freed
+  alloc->block_start = nullptr;
+  alloc->untouched = &alloc->control_blocks[0];
+
+#ifdef FASTWARE_VERBOSE
+  internal_print_state(alloc);
+#endif
+
+  stats_register(alloc, info->parent, alloc_space_size, info->block_count);
+  page_map_insert(alloc, alloc->mem_space_start, alloc->mem_space_end);
+  trace_on_create(alloc, info->parent);
+  return alloc;
+}
+
+allocator_t *create(thread_cache_create_info_t *info) {
+  trace_scope_t scope;
+
+  assert(info->pool && "Thread cache needs a pool to cache");
+  assert(*reinterpret_cast<alloc_type_e *>(info->pool) ==
+             alloc_type_e::concurrent_pool &&
+         "Thread caches refill and flush from any thread, the pool must be "
+         "concurrent");
+  assert(info->magazine_size > 0 && "Magazine cannot be empty");
 
-  aligned_storage_create_info_t aligned_info{
-      info->parent, sizeof(stack_allocator_t), info->size, info->alignment};
+  const uint64_t magazine_stride =
+      align(sizeof(magazine_t) + sizeof(address) * info->magazine_size,
+            alignment_t::b64);
 
-  aligned_storage_t storage = create_aligned_storage(&aligned_info);
+  aligned_storage_create_info_t storage_info{
+      info->parent, sizeof(thread_cache_allocator_t),
+      magazine_stride * max_cache_threads, alignment_t::b64};
 
-  stack_allocator_t *alloc =
-      static_cast<stack_allocator_t *>(storage.base_address.raw);
-  alloc->type = alloc_type_e::stack;
-  alloc->block_start = storage.usable_address;
+  aligned_storage_t storage = create_aligned_storage(&storage_info);
+  if (storage.base_address.raw == nullptr) {
+    return nullptr;
+  }
+
+  thread_cache_allocator_t *alloc =
+      static_cast<thread_cache_allocator_t *>(storage.base_address.raw);
+
+  alloc->type = alloc_type_e::thread_cache;
+  alloc->parent = info->parent;
+  alloc->size = storage.size;
+  alloc->pool = static_cast<concurrent_pool_allocator_t *>(info->pool);
+  alloc->block_size = prefered_size(info->pool, 1);
+  alloc->magazine_size = info->magazine_size;
+  alloc->magazine_stride = magazine_stride;
+  alloc->magazines = storage.usable_address;
+
+  for (uint64_t slot = 0; slot < max_cache_threads; slot++) {
+    internal_magazine(alloc, slot)->count = 0;
+  }
+
+  stats_register(alloc, info->parent, 0, 0);
+  // blocks of the pool are freed through the cache
+  page_map_claim(alloc, info->pool);
+  trace_on_create(alloc, info->parent);
+  return alloc;
+}
+
+allocator_t *create(slab_alloc_create_info_t *info) {
+  trace_scope_t scope;
+
+  assert(pow_of_2(info->min_block_size) && pow_of_2(info->max_block_size) &&
+         "Size classes can only be powers of 2");
+  assert(info->min_block_size >= sizeof(address) &&
+         info->min_block_size <= info->max_block_size &&
+         "Invalid size class range");
+  assert(info->class_capacity >= info->max_block_size &&
+         "Every class needs room for at least one block");
+
+  const uint64_t min_shift = __builtin_ctzl(info->min_block_size);
+  const uint64_t class_count =
+      __builtin_ctzl(info->max_block_size) - min_shift + 1;
+
+  const uint64_t allocator_size =
+      sizeof(slab_allocator_t) + sizeof(allocator_t *) * class_count;
+
+  aligned_storage_create_info_t storage_info{info->parent, allocator_size, 0,
+                                             alignment_t::b64};
+
+  aligned_storage_t storage = create_aligned_storage(&storage_info);
+  if (storage.base_address.raw == nullptr) {
+    return nullptr;
+  }
+
+  slab_allocator_t *alloc =
+      static_cast<slab_allocator_t *>(storage.base_address.raw);
+
+  alloc->type = alloc_type_e::slab;
+  alloc->parent = info->parent;
+  alloc->size = storage.size;
+  alloc->min_shift = min_shift;
+  alloc->class_count = class_count;
+
+  stats_register(alloc, info->parent, 0, 0);
+  trace_on_create(alloc, info->parent);
+
+  for (uint64_t i = 0; i < class_count; i++) {
+    const uint64_t block_size = 1ul << (i + min_shift);
+    pool_alloc_create_info_t pool_info{
+        info->parent, block_size,
+        alignment_t::select(block_size < alignment_t::b64 ? block_size
+                                                          : alignment_t::b64),
+        info->class_capacity / block_size, info->pool_flags};
+    alloc->pools[i] = create(&pool_info);
+    if (alloc->pools[i] == nullptr) {
+      // the slab goes with the pools made so far
+      alloc->class_count = i;
+      destroy(alloc);
+      return nullptr;
+    }
+    // storage comes from our parent but the pools belong to the slab
+    stats_reparent(alloc->pools[i], alloc);
+    page_map_claim(alloc, alloc->pools[i]);
+  }
+
+  return alloc;
+}
+
+allocator_t *create(tlsf_alloc_create_info_t *info) {
+  trace_scope_t scope;
+
+  const alignment_t::value alignment =
+      info->alignment < alignment_t::b16 ? alignment_t::b16 : info->alignment;
+  const uint64_t header_size = align(2 * sizeof(uint64_t), alignment);
+  const uint64_t min_block_size = header_size + alignment;
+
+  assert(info->size >= min_block_size && "TLSF space too small");
+
+  // room for the end sentinel
+  aligned_storage_create_info_t storage_info{
+      info->parent, sizeof(tlsf_allocator_t), info->size + header_size,
+      alignment};
+
+  aligned_storage_t storage = create_aligned_storage(&storage_info);
+  if (storage.base_address.raw == nullptr) {
+    return nullptr;
+  }
+
+  tlsf_allocator_t *alloc =
+      static_cast<tlsf_allocator_t *>(storage.base_address.raw);
+
+  alloc->type = alloc_type_e::tlsf;
   alloc->mem_space_start = storage.usable_address;
   alloc->mem_space_end = storage.usable_address + storage.usable_size;
-  alloc->alignment = info->alignment;
   alloc->parent = info->parent;
   alloc->size = storage.size;
+  alloc->alignment = alignment;
+  alloc->header_size = header_size;
+  alloc->min_block_size = min_block_size;
+
+  tlsf_reset(alloc);
 
+  stats_register(alloc, info->parent, info->size, 0);
+  page_map_insert(alloc, alloc->mem_space_start, alloc->mem_space_end);
+  trace_on_create(alloc, info->parent);
   return alloc;
 }
 
-allocator_t *create(pool_alloc_create_info_t *info) {
+allocator_t *create(frame_arena_create_info_t *info) {
+  trace_scope_t scope;
 
-  const uint64_t aligned_block_size =
-      align(info->block_size, info->block_alignment);
+  assert(info->frame_count >= 2 && info->frame_count <= max_arena_frames &&
+         "Frame arena needs 2 or 3 frames");
 
-  assert(pow_of_2(aligned_block_size) && "Block size can only be a power of 2");
+  const uint64_t frame_size = align(info->frame_size, info->alignment);
 
-  const uint64_t alloc_space_size = aligned_block_size * info->block_count;
-  const uint64_t control_block_size = sizeof(address) * info->block_count;
-  const uint64_t allocator_size = sizeof(pool_allocator_t) + control_block_size;
+  aligned_storage_create_info_t storage_info{
+      info->parent, sizeof(frame_arena_allocator_t),
+      frame_size * info->frame_count, info->alignment, info->backing};
+
+  aligned_storage_t storage = create_aligned_storage(&storage_info);
+  if (storage.base_address.raw == nullptr) {
+    return nullptr;
+  }
+
+  frame_arena_allocator_t *alloc =
+      static_cast<frame_arena_allocator_t *>(storage.base_address.raw);
+  alloc->type = alloc_type_e::frame_arena;
+  alloc->parent = info->parent;
+  alloc->size = storage.size;
+  alloc->backing = info->parent ? backing_flags_t::none : info->backing;
+  alloc->frame_count = info->frame_count;
+
+  for (uint64_t i = 0; i < info->frame_count; i++) {
+    stack_allocator_t *frame = &alloc->frames[i];
+    frame->type = alloc_type_e::stack;
+    frame->mem_space_start = storage.usable_address + i * frame_size;
+    frame->mem_space_end = frame->mem_space_start + frame_size;
+    frame->block_start = frame->mem_space_start;
+    frame->alignment = info->alignment;
+    // owned by the arena, never destroyed on their own
+    frame->parent = nullptr;
+    frame->size = 0;
+    frame->backing = backing_flags_t::none;
+  }
+  alloc->current = &alloc->frames[0];
+
+  stats_register(alloc, info->parent, frame_size * info->frame_count, 0);
+  page_map_insert(alloc, storage.usable_address,
+                  storage.usable_address + frame_size * info->frame_count);
+  trace_on_create(alloc, info->parent);
+  return alloc;
+}
+
+allocator_t *create(fallback_alloc_create_info_t *info) {
+  trace_scope_t scope;
+
+  assert(info->primary && info->secondary &&
+         "Fallback needs a primary and a secondary allocator");
 
   aligned_storage_create_info_t storage_info{
-      info->parent, allocator_size, alloc_space_size, info->block_alignment};
+      info->parent, sizeof(fallback_allocator_t), 0, alignment_t::b64};
 
   aligned_storage_t storage = create_aligned_storage(&storage_info);
+  if (storage.base_address.raw == nullptr) {
+    return nullptr;
+  }
 
-  pool_allocator_t *alloc =
-      static_cast<pool_allocator_t *>(storage.base_address.raw);
+  fallback_allocator_t *alloc =
+      static_cast<fallback_allocator_t *>(storage.base_address.raw);
+
+  alloc->type = alloc_type_e::fallback;
+  alloc->parent = info->parent;
+  alloc->size = storage.size;
+  alloc->primary = info->primary;
+  alloc->secondary = info->secondary;
+
+  stats_register(alloc, info->parent, 0, 0);
+  trace_on_create(alloc, info->parent);
+  return alloc;
+}
 
-  const uint64_t bit_shift =
-      __builtin_ctzl(aligned_block_size) - __builtin_ctzl(sizeof(address));
+allocator_t *create(segregator_alloc_create_info_t *info) {
+  trace_scope_t scope;
 
-  alloc->type = alloc_type_e::pool;
-  alloc->mem_space_start = storage.usable_address;
-  alloc->mem_space_end = storage.usable_address + storage.usable_size;
+  assert(info->small && info->large &&
+         "Segregator needs a small and a large allocator");
+
+  aligned_storage_create_info_t storage_info{
+      info->parent, sizeof(segregator_allocator_t), 0, alignment_t::b64};
+
+  aligned_storage_t storage = create_aligned_storage(&storage_info);
+  if (storage.base_address.raw == nullptr) {
+    return nullptr;
+  }
+
+  segregator_allocator_t *alloc =
+      static_cast<segregator_allocator_t *>(storage.base_address.raw);
+
+  alloc->type = alloc_type_e::segregator;
   alloc->parent = info->parent;
   alloc->size = storage.size;
-  alloc->block_count = info->block_count;
-  alloc->aligned_block_size = aligned_block_size;
-  alloc->alignment = info->block_alignment;
-  alloc->bit_shift = bit_shift;
-  alloc->block_start = &alloc->control_blocks[0];
+  alloc->threshold = info->threshold;
+  alloc->small = info->small;
+  alloc->large = info->large;
 
-#ifdef FASTWARE_VERBOSE
-  internal_print_state(alloc);
-#endif
-  for (uint64_t i = 0; i < info->block_count - 1; i++) {
-    alloc->control_blocks[i].raw = &alloc->control_blocks[i + 1];
-#ifdef FASTWARE_VERBOSE
-    printf("i = %lu, size = %lu, control_blocks[i] = %p, control_blocks[i + 1] "
-           "= %p\n",
-           i, alloc->block_count, &alloc->control_blocks[i],
-           &alloc->control_blocks[i + 1]);
-#endif
+  stats_register(alloc, info->parent, 0, 0);
+  trace_on_create(alloc, info->parent);
+  return alloc;
+}
+
+allocator_t *create(affix_alloc_create_info_t *info) {
+  trace_scope_t scope;
+
+  assert(info->inner && "Affix needs an allocator to wrap");
+
+  const uint64_t prefix_words =
+      ((info->flags & affix_flags_t::size) ? 1 : 0) +
+      ((info->flags & affix_flags_t::canary) ? 1 : 0);
+
+  aligned_storage_create_info_t storage_info{
+      info->parent, sizeof(affix_allocator_t), 0, alignment_t::b64};
+
+  aligned_storage_t storage = create_aligned_storage(&storage_info);
+  if (storage.base_address.raw == nullptr) {
+    return nullptr;
+  }
+
+  affix_allocator_t *alloc =
+      static_cast<affix_allocator_t *>(storage.base_address.raw);
+
+  alloc->type = alloc_type_e::affix;
+  alloc->parent = info->parent;
+  alloc->size = storage.size;
+  alloc->inner = info->inner;
+  alloc->flags = info->flags;
+  alloc->prefix_size =
+      prefix_words ? align(prefix_words * sizeof(uint64_t), info->alignment)
+                   : 0;
+  alloc->suffix_size =
+      (info->flags & affix_flags_t::canary) ? sizeof(affix_canary) : 0;
+
+  stats_register(alloc, info->parent, 0, 0);
+  trace_on_create(alloc, info->parent);
+  return alloc;
+}
+
+allocator_t *create(budget_alloc_create_info_t *info) {
+  trace_scope_t scope;
+
+  assert(info->inner && "Budget needs an allocator to charge");
+  assert((info->soft_limit == 0 || info->hard_limit == 0 ||
+          info->soft_limit <= info->hard_limit) &&
+         "Soft limit above the hard limit");
+
+  aligned_storage_create_info_t storage_info{
+      info->parent, sizeof(budget_allocator_t), 0, alignment_t::b64};
+
+  aligned_storage_t storage = create_aligned_storage(&storage_info);
+  if (storage.base_address.raw == nullptr) {
+    return nullptr;
+  }
+
+  budget_allocator_t *alloc =
+      static_cast<budget_allocator_t *>(storage.base_address.raw);
+
+  alloc->type = alloc_type_e::budget;
+  alloc->parent = info->parent;
+  alloc->size = storage.size;
+  alloc->inner = info->inner;
+  alloc->tag = info->tag ? info->tag : "untagged";
+  alloc->soft_limit = info->soft_limit;
+  alloc->hard_limit = info->hard_limit;
+  alloc->callback = info->callback;
+  alloc->user_data = info->user_data;
+  alloc->charged_bytes.store(0, std::memory_order_relaxed);
+  alloc->peak_bytes.store(0, std::memory_order_relaxed);
+  alloc->refused_count.store(0, std::memory_order_relaxed);
+  internal_link_budget(alloc);
+
+  stats_register(alloc, info->parent, 0, 0);
+  trace_on_create(alloc, info->parent);
+  return alloc;
+}
+
+void destroy(allocator_t *alloc) {
+  trace_scope_t scope;
+  trace_record(trace_op_t::destroy, alloc, 0, 0);
+
+  stats_unregister(alloc);
+  page_map_erase(alloc);
+
+  alloc_type_e *type = reinterpret_cast<alloc_type_e *>(alloc);
+
+  allocator_t *parent = nullptr;
+  uint64_t size = 0;
+  uint64_t backing = backing_flags_t::none;
+
+  switch (*type) {
+  case alloc_type_e::stack: {
+    stack_allocator_t *stack_alloc = static_cast<stack_allocator_t *>(alloc);
+    parent = stack_alloc->parent;
+    size = stack_alloc->size;
+    backing = stack_alloc->backing;
+    break;
+  }
+  case alloc_type_e::virtual_stack: {
+    virtual_stack_allocator_t *stack_alloc =
+        static_cast<virtual_stack_allocator_t *>(alloc);
+    // the allocator lives inside its own reservation
+    munmap(stack_alloc, stack_alloc->size);
+    return;
+  }
+  case alloc_type_e::concurrent_stack: {
+    concurrent_stack_allocator_t *stack_alloc =
+        static_cast<concurrent_stack_allocator_t *>(alloc);
+    parent = stack_alloc->parent;
+    size = stack_alloc->size;
+    backing = stack_alloc->backing;
+    break;
+  }
+  case alloc_type_e::frame_arena: {
+    frame_arena_allocator_t *arena_alloc =
+        static_cast<frame_arena_allocator_t *>(alloc);
+    parent = arena_alloc->parent;
+    size = arena_alloc->size;
+    backing = arena_alloc->backing;
+    break;
+  }
+  case alloc_type_e::pool: {
+    pool_allocator_t *pool_alloc = static_cast<pool_allocator_t *>(alloc);
+    parent = pool_alloc->parent;
+    size = pool_alloc->size;
+    backing = pool_alloc->backing;
+    break;
+  }
+  case alloc_type_e::concurrent_pool: {
+    concurrent_pool_allocator_t *pool_alloc =
+        static_cast<concurrent_pool_allocator_t *>(alloc);
+    parent = pool_alloc->parent;
+    size = pool_alloc->size;
+    backing = pool_alloc->backing;
+    break;
+  }
+  case alloc_type_e::bitmap_pool: {
+    bitmap_pool_allocator_t *pool_alloc =
+        static_cast<bitmap_pool_allocator_t *>(alloc);
+    parent = pool_alloc->parent;
+    size = pool_alloc->size;
+    backing = pool_alloc->backing;
+    break;
+  }
+  case alloc_type_e::thread_cache: {
+    thread_cache_allocator_t *cache_alloc =
+        static_cast<thread_cache_allocator_t *>(alloc);
+    // hand every cached block back before the magazines go away
+    for (uint64_t slot = 0; slot < max_cache_threads; slot++) {
+      magazine_t *mag = internal_magazine(cache_alloc, slot);
+      internal_flush(cache_alloc, mag, mag->count);
+    }
+    parent = cache_alloc->parent;
+    size = cache_alloc->size;
+    break;
+  }
+  case alloc_type_e::slab: {
+    slab_allocator_t *slab_alloc = static_cast<slab_allocator_t *>(alloc);
+    // pools were carved after the slab itself, release them in reverse
+    for (uint64_t i = slab_alloc->class_count; i > 0; i--) {
+      destroy(slab_alloc->pools[i - 1]);
+    }
+    parent = slab_alloc->parent;
+    size = slab_alloc->size;
+    break;
+  }
+  case alloc_type_e::tlsf: {
+    tlsf_allocator_t *tlsf_alloc = static_cast<tlsf_allocator_t *>(alloc);
+    parent = tlsf_alloc->parent;
+    size = tlsf_alloc->size;
+    break;
+  }
+  case alloc_type_e::fallback: {
+    fallback_allocator_t *fallback_alloc =
+        static_cast<fallback_allocator_t *>(alloc);
+    parent = fallback_alloc->parent;
+    size = fallback_alloc->size;
+    break;
+  }
+  case alloc_type_e::segregator: {
+    segregator_allocator_t *segregator_alloc =
+        static_cast<segregator_allocator_t *>(alloc);
+    parent = segregator_alloc->parent;
+    size = segregator_alloc->size;
+    break;
+  }
+  case alloc_type_e::affix: {
+    affix_allocator_t *affix_alloc = static_cast<affix_allocator_t *>(alloc);
+    parent = affix_alloc->parent;
+    size = affix_alloc->size;
+    break;
+  }
+  case alloc_type_e::budget: {
+    budget_allocator_t *budget_alloc = static_cast<budget_allocator_t *>(alloc);
+    internal_unlink_budget(budget_alloc);
+    parent = budget_alloc->parent;
+    size = budget_alloc->size;
+    break;
+  }
+
+  default:
+    return;
+  }
+
+  if (parent) {
+    deallocate(parent, {alloc, size});
+  } else {
+    release_backing_storage(alloc, size, backing);
+  }
+}
+
+memblk allocate(allocator_t *alloc, uint64_t size) {
+  trace_scope_t scope;
+
+  memblk blk{nullptr, 0};
+  alloc_type_e *type = reinterpret_cast<alloc_type_e *>(alloc);
+  switch (*type) {
+  case alloc_type_e::stack: {
+    blk = internal_alloc(static_cast<stack_allocator_t *>(alloc), size);
+    break;
+  }
+  case alloc_type_e::virtual_stack: {
+    blk = internal_alloc(static_cast<virtual_stack_allocator_t *>(alloc),
+                         size);
+    break;
+  }
+  case alloc_type_e::concurrent_stack: {
+    blk = internal_alloc(static_cast<concurrent_stack_allocator_t *>(alloc),
+                         size);
+    break;
+  }
+  case alloc_type_e::frame_arena: {
+    blk = internal_alloc(static_cast<frame_arena_allocator_t *>(alloc),
+                         size);
+    break;
+  }
+  case alloc_type_e::pool: {
+    blk = internal_alloc(static_cast<pool_allocator_t *>(alloc), size);
+    break;
+  }
+  case alloc_type_e::concurrent_pool: {
+    blk = internal_alloc(static_cast<concurrent_pool_allocator_t *>(alloc),
+                         size);
+    break;
+  }
+  case alloc_type_e::bitmap_pool: {
+    blk = internal_alloc(static_cast<bitmap_pool_allocator_t *>(alloc), size);
+    break;
+  }
+  case alloc_type_e::thread_cache: {
+    blk = internal_alloc(static_cast<thread_cache_allocator_t *>(alloc), size);
+    break;
+  }
+  case alloc_type_e::slab: {
+    blk = internal_alloc(static_cast<slab_allocator_t *>(alloc), size);
+    break;
+  }
+  case alloc_type_e::tlsf: {
+    blk = internal_alloc(static_cast<tlsf_allocator_t *>(alloc), size);
+    break;
+  }
+  case alloc_type_e::fallback: {
+    blk = internal_alloc(static_cast<fallback_allocator_t *>(alloc), size);
+    break;
+  }
+  case alloc_type_e::segregator: {
+    blk = internal_alloc(static_cast<segregator_allocator_t *>(alloc), size);
+    break;
+  }
+  case alloc_type_e::affix: {
+    blk = internal_alloc(static_cast<affix_allocator_t *>(alloc), size);
+    break;
+  }
+  case alloc_type_e::budget: {
+    blk = internal_alloc(static_cast<budget_allocator_t *>(alloc), size);
+    break;
+  }
+  default: {
+    assert(false && "Unknown allocator used");
+  }
+  }
+
+  stats_on_alloc(alloc, blk.ptr ? 1 : 0, blk.size);
+  trace_record(trace_op_t::allocate, alloc, blk.addr, size);
+  return blk;
+}
+
+uint64_t allocate_n(allocator_t *alloc, uint64_t size, uint64_t count,
+                    memblk *out) {
+  trace_scope_t scope;
+
+  uint64_t taken = 0;
+  alloc_type_e *type = reinterpret_cast<alloc_type_e *>(alloc);
+  switch (*type) {
+  case alloc_type_e::stack: {
+    taken = internal_alloc_n(static_cast<stack_allocator_t *>(alloc), size,
+                             count, out);
+    break;
+  }
+  case alloc_type_e::virtual_stack: {
+    taken = internal_alloc_n(static_cast<virtual_stack_allocator_t *>(alloc),
+                             size, count, out);
+    break;
+  }
+  case alloc_type_e::concurrent_stack: {
+    taken = internal_alloc_n(static_cast<concurrent_stack_allocator_t *>(alloc),
+                             size, count, out);
+    break;
+  }
+  case alloc_type_e::frame_arena: {
+    taken = internal_alloc_n(static_cast<frame_arena_allocator_t *>(alloc),
+                             size, count, out);
+    break;
+  }
+  case alloc_type_e::pool: {
+    taken = internal_alloc_n(static_cast<pool_allocator_t *>(alloc), size,
+                             count, out);
+    break;
+  }
+  case alloc_type_e::concurrent_pool: {
+    taken = internal_alloc_n(static_cast<concurrent_pool_allocator_t *>(alloc),
+                             size, count, out);
+    break;
+  }
+  case alloc_type_e::bitmap_pool: {
+    taken = internal_alloc_n(static_cast<bitmap_pool_allocator_t *>(alloc),
+                             size, count, out);
+    break;
+  }
+  case alloc_type_e::thread_cache: {
+    taken = internal_alloc_n(static_cast<thread_cache_allocator_t *>(alloc),
+                             size, count, out);
+    break;
+  }
+  case alloc_type_e::slab: {
+    taken = internal_alloc_n(static_cast<slab_allocator_t *>(alloc), size,
+                             count, out);
+    break;
+  }
+  case alloc_type_e::tlsf: {
+    taken = internal_alloc_n(static_cast<tlsf_allocator_t *>(alloc), size,
+                             count, out);
+    break;
+  }
+  case alloc_type_e::fallback: {
+    taken = internal_alloc_n(static_cast<fallback_allocator_t *>(alloc), size,
+                             count, out);
+    break;
+  }
+  case alloc_type_e::segregator: {
+    taken = internal_alloc_n(static_cast<segregator_allocator_t *>(alloc), size,
+                             count, out);
+    break;
+  }
+  case alloc_type_e::affix: {
+    taken = internal_alloc_n(static_cast<affix_allocator_t *>(alloc), size,
+                             count, out);
+    break;
+  }
+  case alloc_type_e::budget: {
+    taken = internal_alloc_n(static_cast<budget_allocator_t *>(alloc), size,
+                             count, out);
+    break;
+  }
+  default: {
+    assert(false && "Unknown allocator used");
+  }
   }
-  alloc->control_blocks[info->block_count - 1].raw = nullptr;
 
-  return alloc;
+  if (taken) {
+    stats_on_alloc_n(alloc, out, taken);
+  }
+  for (uint64_t i = 0; i < taken; i++) {
+    trace_record(trace_op_t::allocate, alloc, out[i].addr, size);
+  }
+  if (taken < count) {
+    stats_on_alloc(alloc, 0, 0);
+    trace_record(trace_op_t::allocate, alloc, 0, size);
+  }
+  return taken;
 }
 
-void destroy(allocator_t *alloc) {
+void deallocate(allocator_t *alloc, memblk blk) {
+  trace_scope_t scope;
+  trace_record(trace_op_t::deallocate, alloc, blk.addr, blk.size);
+  stats_on_dealloc(alloc, 1, blk.size);
 
   alloc_type_e *type = reinterpret_cast<alloc_type_e *>(alloc);
-
-  allocator_t *parent = nullptr;
-  uint64_t size = 0;
-
   switch (*type) {
   case alloc_type_e::stack: {
-    stack_allocator_t *stack_alloc = static_cast<stack_allocator_t *>(alloc);
-    parent = stack_alloc->parent;
-    size = stack_alloc->size;
+    internal_dealloc(static_cast<stack_allocator_t *>(alloc), blk);
+    break;
+  }
+  case alloc_type_e::virtual_stack: {
+    internal_dealloc(static_cast<virtual_stack_allocator_t *>(alloc), blk);
+    break;
+  }
+  case alloc_type_e::concurrent_stack: {
+    internal_dealloc(static_cast<concurrent_stack_allocator_t *>(alloc), blk);
+    break;
+  }
+  case alloc_type_e::frame_arena: {
+    internal_dealloc(static_cast<frame_arena_allocator_t *>(alloc), blk);
     break;
   }
   case alloc_type_e::pool: {
-    pool_allocator_t *pool_alloc = static_cast<pool_allocator_t *>(alloc);
-    parent = pool_alloc->parent;
-    size = pool_alloc->size;
+    internal_dealloc(static_cast<pool_allocator_t *>(alloc), blk);
     break;
   }
-
-  default:
-    return;
+  case alloc_type_e::concurrent_pool: {
+    internal_dealloc(static_cast<concurrent_pool_allocator_t *>(alloc), blk);
+    break;
+  }
+  case alloc_type_e::bitmap_pool: {
+    internal_dealloc(static_cast<bitmap_pool_allocator_t *>(alloc), blk);
+    break;
+  }
+  case alloc_type_e::thread_cache: {
+    internal_dealloc(static_cast<thread_cache_allocator_t *>(alloc), blk);
+    break;
+  }
+  case alloc_type_e::slab: {
+    internal_dealloc(static_cast<slab_allocator_t *>(alloc), blk);
+    break;
+  }
+  case alloc_type_e::tlsf: {
+    internal_dealloc(static_cast<tlsf_allocator_t *>(alloc), blk);
+    break;
+  }
+  case alloc_type_e::fallback: {
+    internal_dealloc(static_cast<fallback_allocator_t *>(alloc), blk);
+    break;
+  }
+  case alloc_type_e::segregator: {
+    internal_dealloc(static_cast<segregator_allocator_t *>(alloc), blk);
+    break;
+  }
+  case alloc_type_e::affix: {
+    internal_dealloc(static_cast<affix_allocator_t *>(alloc), blk);
+    break;
+  }
+  case alloc_type_e::budget: {
+    internal_dealloc(static_cast<budget_allocator_t *>(alloc), blk);
+    break;
+  }
+  default: {
+    assert(false && "Unknown allocator used");
   }
-
-  if (parent) {
-    deallocate(parent, {alloc, size});
-  } else {
-    free(alloc);
   }
 }
 
-memblk allocate(allocator_t *alloc, uint64_t size) {
+void deallocate_n(allocator_t *alloc, const memblk *blks, uint64_t count) {
+  trace_scope_t scope;
+  for (uint64_t i = 0; i < count; i++) {
+    trace_record(trace_op_t::deallocate, alloc, blks[i].addr, blks[i].size);
+  }
+  stats_on_dealloc_n(alloc, blks, count);
 
   alloc_type_e *type = reinterpret_cast<alloc_type_e *>(alloc);
   switch (*type) {
   case alloc_type_e::stack: {
-    return internal_alloc(static_cast<stack_allocator_t *>(alloc), size);
+    internal_dealloc_n(static_cast<stack_allocator_t *>(alloc), blks, count);
+    break;
+  }
+  case alloc_type_e::virtual_stack: {
+    internal_dealloc_n(static_cast<virtual_stack_allocator_t *>(alloc), blks,
+                       count);
+    break;
+  }
+  case alloc_type_e::concurrent_stack: {
+    internal_dealloc_n(static_cast<concurrent_stack_allocator_t *>(alloc), blks,
+                       count);
+    break;
+  }
+  case alloc_type_e::frame_arena: {
+    internal_dealloc_n(static_cast<frame_arena_allocator_t *>(alloc), blks,
+                       count);
+    break;
   }
   case alloc_type_e::pool: {
-    return internal_alloc(static_cast<pool_allocator_t *>(alloc), size);
+    internal_dealloc_n(static_cast<pool_allocator_t *>(alloc), blks, count);
+    break;
+  }
+  case alloc_type_e::concurrent_pool: {
+    internal_dealloc_n(static_cast<concurrent_pool_allocator_t *>(alloc), blks,
+                       count);
+    break;
+  }
+  case alloc_type_e::bitmap_pool: {
+    internal_dealloc_n(static_cast<bitmap_pool_allocator_t *>(alloc), blks,
+                       count);
+    break;
+  }
+  case alloc_type_e::thread_cache: {
+    internal_dealloc_n(static_cast<thread_cache_allocator_t *>(alloc), blks,
+                       count);
+    break;
+  }
+  case alloc_type_e::slab: {
+    internal_dealloc_n(static_cast<slab_allocator_t *>(alloc), blks, count);
+    break;
+  }
+  case alloc_type_e::tlsf: {
+    internal_dealloc_n(static_cast<tlsf_allocator_t *>(alloc), blks, count);
+    break;
+  }
+  case alloc_type_e::fallback: {
+    internal_dealloc_n(static_cast<fallback_allocator_t *>(alloc), blks, count);
+    break;
+  }
+  case alloc_type_e::segregator: {
+    internal_dealloc_n(static_cast<segregator_allocator_t *>(alloc), blks,
+                       count);
+    break;
+  }
+  case alloc_type_e::affix: {
+    internal_dealloc_n(static_cast<affix_allocator_t *>(alloc), blks, count);
+    break;
+  }
+  case alloc_type_e::budget: {
+    internal_dealloc_n(static_cast<budget_allocator_t *>(alloc), blks, count);
+    break;
   }
   default: {
     assert(false && "Unknown allocator used");
-    return {nullptr, 0};
   }
   }
 }
 
-void deallocate(allocator_t *alloc, memblk blk) {
+void deallocate_all(allocator_t *alloc) {
+  trace_scope_t scope;
+  trace_record(trace_op_t::deallocate_all, alloc, 0, 0);
+  stats_on_reset(alloc);
+
   alloc_type_e *type = reinterpret_cast<alloc_type_e *>(alloc);
   switch (*type) {
   case alloc_type_e::stack: {
-    internal_dealloc(static_cast<stack_allocator_t *>(alloc), blk);
+    internal_dealloc_all(static_cast<stack_allocator_t *>(alloc));
+    break;
+  }
+  case alloc_type_e::virtual_stack: {
+    internal_dealloc_all(static_cast<virtual_stack_allocator_t *>(alloc));
+    break;
+  }
+  case alloc_type_e::concurrent_stack: {
+    internal_dealloc_all(static_cast<concurrent_stack_allocator_t *>(alloc));
+    break;
+  }
+  case alloc_type_e::frame_arena: {
+    internal_dealloc_all(static_cast<frame_arena_allocator_t *>(alloc));
     break;
   }
   case alloc_type_e::pool: {
-    internal_dealloc(static_cast<pool_allocator_t *>(alloc), blk);
+    internal_dealloc_all(static_cast<pool_allocator_t *>(alloc));
+    break;
+  }
+  case alloc_type_e::concurrent_pool: {
+    internal_dealloc_all(static_cast<concurrent_pool_allocator_t *>(alloc));
+    break;
+  }
+  case alloc_type_e::bitmap_pool: {
+    internal_dealloc_all(static_cast<bitmap_pool_allocator_t *>(alloc));
+    break;
+  }
+  case alloc_type_e::thread_cache: {
+    internal_dealloc_all(static_cast<thread_cache_allocator_t *>(alloc));
+    break;
+  }
+  case alloc_type_e::slab: {
+    internal_dealloc_all(static_cast<slab_allocator_t *>(alloc));
+    break;
+  }
+  case alloc_type_e::tlsf: {
+    internal_dealloc_all(static_cast<tlsf_allocator_t *>(alloc));
+    break;
+  }
+  case alloc_type_e::fallback: {
+    internal_dealloc_all(static_cast<fallback_allocator_t *>(alloc));
+    break;
+  }
+  case alloc_type_e::segregator: {
+    internal_dealloc_all(static_cast<segregator_allocator_t *>(alloc));
+    break;
+  }
+  case alloc_type_e::affix: {
+    internal_dealloc_all(static_cast<affix_allocator_t *>(alloc));
+    break;
+  }
+  case alloc_type_e::budget: {
+    internal_dealloc_all(static_cast<budget_allocator_t *>(alloc));
     break;
   }
   default: {
@@ -362,21 +3862,143 @@ void deallocate(allocator_t *alloc, memblk blk) {
   }
 }
 
-void deallocate_all(allocator_t *alloc) {
+bool expand(allocator_t *alloc, memblk *blk, uint64_t delta) {
+  trace_scope_t scope;
+
+  const memblk old = *blk;
+  bool expanded = false;
   alloc_type_e *type = reinterpret_cast<alloc_type_e *>(alloc);
   switch (*type) {
   case alloc_type_e::stack: {
-    internal_dealloc_all(static_cast<stack_allocator_t *>(alloc));
+    expanded =
+        internal_expand(static_cast<stack_allocator_t *>(alloc), blk, delta);
+    break;
+  }
+  case alloc_type_e::virtual_stack: {
+    expanded = internal_expand(
+        static_cast<virtual_stack_allocator_t *>(alloc), blk, delta);
+    break;
+  }
+  case alloc_type_e::concurrent_stack: {
+    expanded = internal_expand(
+        static_cast<concurrent_stack_allocator_t *>(alloc), blk, delta);
+    break;
+  }
+  case alloc_type_e::frame_arena: {
+    expanded = internal_expand(
+        static_cast<frame_arena_allocator_t *>(alloc), blk, delta);
     break;
   }
   case alloc_type_e::pool: {
-    internal_dealloc_all(static_cast<pool_allocator_t *>(alloc));
+    expanded =
+        internal_expand(static_cast<pool_allocator_t *>(alloc), blk, delta);
+    break;
+  }
+  case alloc_type_e::concurrent_pool: {
+    expanded = internal_expand(
+        static_cast<concurrent_pool_allocator_t *>(alloc), blk, delta);
+    break;
+  }
+  case alloc_type_e::bitmap_pool: {
+    expanded = internal_expand(
+        static_cast<bitmap_pool_allocator_t *>(alloc), blk, delta);
+    break;
+  }
+  case alloc_type_e::thread_cache: {
+    expanded = internal_expand(
+        static_cast<thread_cache_allocator_t *>(alloc), blk, delta);
+    break;
+  }
+  case alloc_type_e::slab: {
+    expanded =
+        internal_expand(static_cast<slab_allocator_t *>(alloc), blk, delta);
+    break;
+  }
+  case alloc_type_e::tlsf: {
+    expanded =
+        internal_expand(static_cast<tlsf_allocator_t *>(alloc), blk, delta);
+    break;
+  }
+  case alloc_type_e::fallback: {
+    expanded =
+        internal_expand(static_cast<fallback_allocator_t *>(alloc), blk, delta);
+    break;
+  }
+  case alloc_type_e::segregator: {
+    expanded = internal_expand(
+        static_cast<segregator_allocator_t *>(alloc), blk, delta);
+    break;
+  }
+  case alloc_type_e::affix: {
+    expanded =
+        internal_expand(static_cast<affix_allocator_t *>(alloc), blk, delta);
+    break;
+  }
+  case alloc_type_e::budget: {
+    expanded =
+        internal_expand(static_cast<budget_allocator_t *>(alloc), blk, delta);
     break;
   }
   default: {
     assert(false && "Unknown allocator used");
   }
   }
+
+  if (expanded) {
+    stats_on_expand(alloc, blk->size - old.size);
+    // replayed as the old block going away and the grown one coming back
+    trace_record(trace_op_t::deallocate, alloc, old.addr, old.size);
+    trace_record(trace_op_t::allocate, alloc, blk->addr, old.size + delta);
+  }
+  return expanded;
+}
+
+// Made of the public calls only, they keep the stats and the trace
+memblk reallocate(allocator_t *alloc, memblk blk, uint64_t new_size) {
+  if (blk.ptr == nullptr) {
+    return allocate(alloc, new_size);
+  }
+  if (new_size <= blk.size || expand(alloc, &blk, new_size - blk.size)) {
+    return blk;
+  }
+
+  const memblk moved = allocate(alloc, new_size);
+  if (moved.ptr == nullptr) {
+    return moved;
+  }
+  memcpy(moved.ptr, blk.ptr, blk.size);
+  deallocate(alloc, blk);
+  return moved;
+}
+
+uint64_t trim(allocator_t *alloc) {
+  trace_scope_t scope;
+
+  alloc_type_e *type = reinterpret_cast<alloc_type_e *>(alloc);
+  switch (*type) {
+  case alloc_type_e::stack: {
+    return internal_trim(static_cast<stack_allocator_t *>(alloc));
+  }
+  case alloc_type_e::virtual_stack: {
+    return internal_trim(static_cast<virtual_stack_allocator_t *>(alloc));
+  }
+  case alloc_type_e::pool: {
+    return internal_trim(static_cast<pool_allocator_t *>(alloc));
+  }
+  case alloc_type_e::concurrent_pool: {
+    return internal_trim(static_cast<concurrent_pool_allocator_t *>(alloc));
+  }
+  case alloc_type_e::bitmap_pool: {
+    return internal_trim(static_cast<bitmap_pool_allocator_t *>(alloc));
+  }
+  case alloc_type_e::slab: {
+    return internal_trim(static_cast<slab_allocator_t *>(alloc));
+  }
+  default: {
+    // the rest keep their pages
+    return 0;
+  }
+  }
 }
 
 uint64_t prefered_size(allocator_t *alloc, uint64_t size) {
@@ -385,9 +4007,52 @@ uint64_t prefered_size(allocator_t *alloc, uint64_t size) {
   case alloc_type_e::stack: {
     return internal_pref_size(static_cast<stack_allocator_t *>(alloc), size);
   }
+  case alloc_type_e::virtual_stack: {
+    return internal_pref_size(static_cast<virtual_stack_allocator_t *>(alloc),
+                              size);
+  }
+  case alloc_type_e::concurrent_stack: {
+    return internal_pref_size(
+        static_cast<concurrent_stack_allocator_t *>(alloc), size);
+  }
+  case alloc_type_e::frame_arena: {
+    return internal_pref_size(
+        static_cast<frame_arena_allocator_t *>(alloc), size);
+  }
   case alloc_type_e::pool: {
     return internal_pref_size(static_cast<pool_allocator_t *>(alloc), size);
   }
+  case alloc_type_e::concurrent_pool: {
+    return internal_pref_size(
+        static_cast<concurrent_pool_allocator_t *>(alloc), size);
+  }
+  case alloc_type_e::bitmap_pool: {
+    return internal_pref_size(static_cast<bitmap_pool_allocator_t *>(alloc),
+                              size);
+  }
+  case alloc_type_e::thread_cache: {
+    return internal_pref_size(static_cast<thread_cache_allocator_t *>(alloc),
+                              size);
+  }
+  case alloc_type_e::slab: {
+    return internal_pref_size(static_cast<slab_allocator_t *>(alloc), size);
+  }
+  case alloc_type_e::tlsf: {
+    return internal_pref_size(static_cast<tlsf_allocator_t *>(alloc), size);
+  }
+  case alloc_type_e::fallback: {
+    return internal_pref_size(static_cast<fallback_allocator_t *>(alloc), size);
+  }
+  case alloc_type_e::segregator: {
+    return internal_pref_size(static_cast<segregator_allocator_t *>(alloc),
+                              size);
+  }
+  case alloc_type_e::affix: {
+    return internal_pref_size(static_cast<affix_allocator_t *>(alloc), size);
+  }
+  case alloc_type_e::budget: {
+    return internal_pref_size(static_cast<budget_allocator_t *>(alloc), size);
+  }
   default: {
     assert(false && "Unknown allocator used");
     return 0;
@@ -395,15 +4060,94 @@ uint64_t prefered_size(allocator_t *alloc, uint64_t size) {
   }
 }
 
+uint64_t allocated_size(allocator_t *alloc, const void *ptr, uint64_t size) {
+  alloc_type_e *type = reinterpret_cast<alloc_type_e *>(alloc);
+  switch (*type) {
+  case alloc_type_e::fallback: {
+    fallback_allocator_t *fallback_alloc =
+        static_cast<fallback_allocator_t *>(alloc);
+    const uint64_t pref_size = prefered_size(fallback_alloc->primary, size);
+    if (pref_size &&
+        owns(fallback_alloc->primary, {{const_cast<void *>(ptr)}, pref_size})) {
+      return allocated_size(fallback_alloc->primary, ptr, size);
+    }
+    return allocated_size(fallback_alloc->secondary, ptr, size);
+  }
+  case alloc_type_e::segregator: {
+    segregator_allocator_t *segregator_alloc =
+        static_cast<segregator_allocator_t *>(alloc);
+    return allocated_size(internal_route(segregator_alloc, size), ptr, size);
+  }
+  case alloc_type_e::affix: {
+    affix_allocator_t *affix_alloc = static_cast<affix_allocator_t *>(alloc);
+    const uint64_t affixes =
+        affix_alloc->prefix_size + affix_alloc->suffix_size;
+    const uint64_t inner_size = allocated_size(
+        affix_alloc->inner,
+        (address{.raw = const_cast<void *>(ptr)} - affix_alloc->prefix_size)
+            .raw,
+        size + affixes);
+    return inner_size ? inner_size - affixes : 0;
+  }
+  case alloc_type_e::budget: {
+    return allocated_size(static_cast<budget_allocator_t *>(alloc)->inner, ptr,
+                          size);
+  }
+  default: {
+    // the others hand out the same size for a request every time
+    return prefered_size(alloc, size);
+  }
+  }
+}
+
 bool owns(allocator_t *alloc, memblk blk) {
   alloc_type_e *type = reinterpret_cast<alloc_type_e *>(alloc);
   switch (*type) {
   case alloc_type_e::stack: {
     return internal_owns(static_cast<stack_allocator_t *>(alloc), blk);
   }
+  case alloc_type_e::virtual_stack: {
+    return internal_owns(static_cast<virtual_stack_allocator_t *>(alloc), blk);
+  }
+  case alloc_type_e::concurrent_stack: {
+    return internal_owns(static_cast<concurrent_stack_allocator_t *>(alloc),
+                         blk);
+  }
+  case alloc_type_e::frame_arena: {
+    return internal_owns(static_cast<frame_arena_allocator_t *>(alloc),
+                         blk);
+  }
   case alloc_type_e::pool: {
     return internal_owns(static_cast<pool_allocator_t *>(alloc), blk);
   }
+  case alloc_type_e::concurrent_pool: {
+    return internal_owns(static_cast<concurrent_pool_allocator_t *>(alloc),
+                         blk);
+  }
+  case alloc_type_e::bitmap_pool: {
+    return internal_owns(static_cast<bitmap_pool_allocator_t *>(alloc), blk);
+  }
+  case alloc_type_e::thread_cache: {
+    return internal_owns(static_cast<thread_cache_allocator_t *>(alloc), blk);
+  }
+  case alloc_type_e::slab: {
+    return internal_owns(static_cast<slab_allocator_t *>(alloc), blk);
+  }
+  case alloc_type_e::tlsf: {
+    return internal_owns(static_cast<tlsf_allocator_t *>(alloc), blk);
+  }
+  case alloc_type_e::fallback: {
+    return internal_owns(static_cast<fallback_allocator_t *>(alloc), blk);
+  }
+  case alloc_type_e::segregator: {
+    return internal_owns(static_cast<segregator_allocator_t *>(alloc), blk);
+  }
+  case alloc_type_e::affix: {
+    return internal_owns(static_cast<affix_allocator_t *>(alloc), blk);
+  }
+  case alloc_type_e::budget: {
+    return internal_owns(static_cast<budget_allocator_t *>(alloc), blk);
+  }
   default: {
     assert(false && "Unknown allocator used");
     return false;
@@ -411,5 +4155,203 @@ bool owns(allocator_t *alloc, memblk blk) {
   }
 }
 
+// Owner of ptr in the list of a shared page, false when the list changed
+// while it was read
+bool page_owners_find(const page_owners_t *owners, uint64_t page,
+                      address blk, allocator_t **owner) {
+  const uint64_t sequence = owners->sequence.load(std::memory_order_acquire);
+  if ((sequence & 1) || owners->page.load(std::memory_order_relaxed) != page) {
+    return false;
+  }
+  const uint64_t count = owners->count.load(std::memory_order_relaxed);
+  *owner = nullptr;
+  for (uint64_t i = 0; i < count && i < page_owners_capacity; i++) {
+    if (owners->ranges[i].start.load(std::memory_order_relaxed) <= blk.idx &&
+        blk.idx < owners->ranges[i].end.load(std::memory_order_relaxed)) {
+      *owner = reinterpret_cast<allocator_t *>(
+          owners->ranges[i].owner.load(std::memory_order_relaxed));
+      break;
+    }
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (owners->sequence.load(std::memory_order_relaxed) != sequence) {
+    return false;
+  }
+  if (__builtin_expect(count > page_owners_capacity, false)) {
+    page_map_lock();
+    const page_range_t *range = page_map_innermost(blk, blk + 1);
+    *owner = range ? range->owner : nullptr;
+    page_map_unlock();
+  }
+  return true;
+}
+
+allocator_t *owner_of(const void *ptr) {
+  const uint64_t page = reinterpret_cast<uintptr_t>(ptr) >> page_shift;
+  if (page >> (page_map_top_level + 1) * page_map_bits) {
+    return nullptr;
+  }
+  const address blk{.raw = const_cast<void *>(ptr)};
+  for (;;) {
+    const page_map_table_t *table = &_page_map.root;
+    for (uint64_t level = page_map_top_level; level > 0; level--) {
+      const uint64_t index =
+          (page >> level * page_map_bits) & (page_map_fanout - 1);
+      const uintptr_t entry =
+          table->entries[index].load(std::memory_order_acquire);
+      if (entry & page_map_span) {
+        return reinterpret_cast<allocator_t *>(entry & ~page_map_span);
+      }
+      if (entry == 0) {
+        return nullptr;
+      }
+      table = reinterpret_cast<const page_map_table_t *>(entry);
+    }
+    const uintptr_t entry = table->entries[page & (page_map_fanout - 1)].load(
+        std::memory_order_acquire);
+    if (__builtin_expect(!(entry & page_map_shared), true)) {
+      return reinterpret_cast<allocator_t *>(entry);
+    }
+    allocator_t *owner;
+    if (page_owners_find(
+            reinterpret_cast<const page_owners_t *>(entry & ~page_map_shared),
+            page, blk, &owner)) {
+      return owner;
+    }
+  }
+}
+
+void free(memblk blk) {
+  allocator_t *owner = owner_of(blk.ptr);
+  assert(owner && "Block of no allocator");
+  deallocate(owner, blk);
+}
+
+void begin_frame(allocator_t *alloc) {
+  trace_scope_t scope;
+
+  assert(*reinterpret_cast<alloc_type_e *>(alloc) ==
+             alloc_type_e::frame_arena &&
+         "Not a frame arena");
+
+  frame_arena_allocator_t *arena_alloc =
+      static_cast<frame_arena_allocator_t *>(alloc);
+  const uint64_t next =
+      (arena_alloc->current - arena_alloc->frames + 1) %
+      arena_alloc->frame_count;
+  stack_allocator_t *frame = &arena_alloc->frames[next];
+
+  trace_record(trace_op_t::begin_frame, alloc, 0, arena_alloc->frame_count);
+  // only the bytes are known, the count of live blocks is not
+  stats_on_dealloc(alloc, 0, frame->block_start - frame->mem_space_start);
+
+  frame->block_start = frame->mem_space_start;
+  arena_alloc->current = frame;
+}
+
+uint64_t affix_size(allocator_t *alloc, const void *ptr) {
+  assert(*reinterpret_cast<alloc_type_e *>(alloc) == alloc_type_e::affix &&
+         "Not an affix allocator");
+  assert((static_cast<affix_allocator_t *>(alloc)->flags &
+          affix_flags_t::size) &&
+         "Sizes are not kept");
+  (void)alloc;
+  return *internal_affix_word(ptr, 0);
+}
+
+budget_report_t query_budget(allocator_t *alloc) {
+  assert(*reinterpret_cast<alloc_type_e *>(alloc) == alloc_type_e::budget &&
+         "Not a budget");
+  return internal_report(static_cast<budget_allocator_t *>(alloc));
+}
+
+void walk_budgets(budget_visitor_t visitor, void *user_data) {
+  budget_lock();
+  for (budget_allocator_t *budget = _budget_list.head; budget;
+       budget = budget->next) {
+    const budget_report_t report = internal_report(budget);
+    visitor(budget, &report, user_data);
+  }
+  budget_unlock();
+}
+
+void for_each_live(allocator_t *alloc, live_visitor_t visitor,
+                   void *user_data) {
+  typed_allocator<bitmap_pool_allocator_t>::from(alloc).for_each_live(
+      [visitor, user_data](memblk blk) { visitor(blk, user_data); });
+}
+
+allocator_stats_t query_stats(allocator_t *alloc) {
+#ifdef FASTWARE_MEMORY_STATS
+  stats_lock();
+  const stats_record_t *record = stats_locked_find(alloc);
+  const allocator_stats_t stats =
+      record ? stats_snapshot(record) : allocator_stats_t{};
+  stats_unlock();
+  return stats;
+#else
+  (void)alloc;
+  return {};
+#endif
+}
+
+void walk_allocators(allocator_t *root, stats_visitor_t visitor,
+                     void *user_data) {
+#ifdef FASTWARE_MEMORY_STATS
+  stats_lock();
+  if (root == nullptr) {
+    stats_walk(nullptr, 0, visitor, user_data);
+  } else if (const stats_record_t *record = stats_locked_find(root)) {
+    const allocator_stats_t stats = stats_snapshot(record);
+    visitor(root, &stats, 0, user_data);
+    stats_walk(root, 1, visitor, user_data);
+  }
+  stats_unlock();
+#else
+  (void)root;
+  (void)visitor;
+  (void)user_data;
+#endif
+}
+
+bool trace_begin(const char *path) {
+#ifdef FASTWARE_MEMORY_TRACE
+  FILE *file = fopen(path, "wb");
+  if (file == nullptr) {
+    return false;
+  }
+
+  trace_lock();
+  _trace_buffer.write_mutex.lock();
+  if (_trace_buffer.file) {
+    trace_flush();
+    fclose(_trace_buffer.file);
+  }
+  _trace_buffer.write_mutex.unlock();
+  _trace_buffer.file = file;
+  _trace_buffer.start = std::chrono::steady_clock::now();
+  _trace_buffer.count = 0;
+  trace_unlock();
+  return true;
+#else
+  (void)path;
+  return false;
+#endif
+}
+
+void trace_end() {
+#ifdef FASTWARE_MEMORY_TRACE
+  trace_lock();
+  _trace_buffer.write_mutex.lock();
+  if (_trace_buffer.file) {
+    trace_flush();
+    fclose(_trace_buffer.file);
+    _trace_buffer.file = nullptr;
+  }
+  _trace_buffer.write_mutex.unlock();
+  trace_unlock();
+#endif
+}
+
 } // namespace memory
 } // namespace fastware
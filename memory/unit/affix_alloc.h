@@ -0,0 +1,110 @@
+#include <fastware/memory.h>
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+using namespace fastware::memory;
+
+TEST(memory, affix_allocator_create) {
+
+  stack_alloc_create_info_t stack_info{nullptr, 4 * Kb, alignment_t::b16};
+  allocator_t *stack = fastware::memory::create(&stack_info);
+
+  affix_alloc_create_info_t create_info{nullptr, stack,
+                                        affix_flags_t::size, alignment_t::b16};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  ASSERT_NE(alloc, nullptr);
+  // a 16 byte prefix rounds 17 + 16 up to 48
+  ASSERT_EQ(prefered_size(alloc, 17), 32);
+
+  destroy(alloc);
+  destroy(stack);
+}
+
+TEST(memory, affix_allocator_size_prefix) {
+
+  stack_alloc_create_info_t stack_info{nullptr, 4 * Kb, alignment_t::b16};
+  allocator_t *stack = fastware::memory::create(&stack_info);
+
+  affix_alloc_create_info_t create_info{nullptr, stack,
+                                        affix_flags_t::size, alignment_t::b16};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blk = allocate(alloc, 40);
+  ASSERT_NE(blk.ptr, nullptr);
+  ASSERT_TRUE(is_aligned(blk.ptr, alignment_t::b16));
+  ASSERT_EQ(blk.size, 48);
+  ASSERT_EQ(affix_size(alloc, blk.ptr), 48);
+  ASSERT_TRUE(owns(alloc, blk));
+
+  memblk blk2 = allocate(alloc, 8);
+  ASSERT_EQ(affix_size(alloc, blk2.ptr), 16);
+
+  // the size is read back from the prefix
+  deallocate(alloc, {blk2.ptr, 0});
+  deallocate(alloc, {blk.ptr, 0});
+
+  // the stack unwound to its start
+  ASSERT_EQ(allocate(stack, 4 * Kb).size, 4 * Kb);
+
+  destroy(alloc);
+  destroy(stack);
+}
+
+TEST(memory, affix_allocator_canary) {
+
+  tlsf_alloc_create_info_t tlsf_info{nullptr, 4 * Kb, alignment_t::b16};
+  allocator_t *tlsf = fastware::memory::create(&tlsf_info);
+
+  affix_alloc_create_info_t create_info{
+      nullptr, tlsf, affix_flags_t::size | affix_flags_t::canary,
+      alignment_t::b16};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blks[16];
+  for (memblk &blk : blks) {
+    blk = allocate(alloc, 24);
+    ASSERT_NE(blk.ptr, nullptr);
+    ASSERT_TRUE(is_aligned(blk.ptr, alignment_t::b16));
+    ASSERT_GE(blk.size, 24);
+    // the whole block is usable, the guards sit outside of it
+    memset(blk.ptr, 0xff, blk.size);
+  }
+
+  for (const memblk &blk : blks) {
+    ASSERT_EQ(affix_size(alloc, blk.ptr), blk.size);
+    deallocate(alloc, blk);
+  }
+
+  // everything coalesced back into a single free block
+  ASSERT_NE(allocate(tlsf, 3 * Kb).ptr, nullptr);
+
+  destroy(alloc);
+  destroy(tlsf);
+}
+
+TEST(memory, affix_allocator_out_of_memory) {
+
+  pool_alloc_create_info_t pool_info{nullptr, 128, alignment_t::b64, 2};
+  allocator_t *pool = fastware::memory::create(&pool_info);
+
+  affix_alloc_create_info_t create_info{nullptr, pool, affix_flags_t::canary,
+                                        alignment_t::b64};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  // a 64 byte prefix and an 8 byte suffix out of every 128 byte block
+  ASSERT_EQ(prefered_size(alloc, 8), 56);
+  ASSERT_EQ(prefered_size(alloc, 57), 0);
+
+  memblk blks[3];
+  ASSERT_EQ(allocate_n(alloc, 8, 3, blks), 2);
+  ASSERT_EQ(blks[0].size, 56);
+  ASSERT_TRUE(is_aligned(blks[0].ptr, alignment_t::b64));
+
+  deallocate_n(alloc, blks, 2);
+  ASSERT_EQ(allocate_n(pool, 128, 2, blks), 2);
+
+  destroy(alloc);
+  destroy(pool);
+}
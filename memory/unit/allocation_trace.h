@@ -0,0 +1,250 @@
+#include <fastware/memory.h>
+#include <fastware/typed_allocator.h>
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace fastware::memory;
+
+static std::vector<trace_event_t> read_trace(const char *path) {
+  std::vector<trace_event_t> events;
+  FILE *file = fopen(path, "rb");
+  if (file == nullptr) {
+    return events;
+  }
+  trace_event_t event;
+  while (fread(&event, sizeof(event), 1, file) == 1) {
+    events.push_back(event);
+  }
+  fclose(file);
+  return events;
+}
+
+TEST(memory, allocation_trace_records_calls) {
+
+  if (!trace_enabled) {
+    GTEST_SKIP() << "built without FASTWARE_MEMORY_TRACE";
+  }
+
+  const char *path = "allocation_trace_records_calls.trace";
+  ASSERT_TRUE(trace_begin(path));
+
+  stack_alloc_create_info_t create_info{nullptr, 1 * Kb, alignment_t::b16};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk first = allocate(alloc, 100);
+  memblk failed = allocate(alloc, 2 * Kb);
+  memblk batch[2];
+  ASSERT_EQ(allocate_n(alloc, 32, 2, batch), 2);
+  deallocate_n(alloc, batch, 2);
+  deallocate(alloc, first);
+  deallocate_all(alloc);
+  destroy(alloc);
+
+  trace_end();
+
+  std::vector<trace_event_t> events = read_trace(path);
+  remove(path);
+
+  ASSERT_EQ(events.size(), 10);
+
+  const uint64_t id = reinterpret_cast<uint64_t>(alloc);
+  for (const trace_event_t &event : events) {
+    ASSERT_EQ(event.alloc, id);
+  }
+  for (uint64_t i = 1; i < events.size(); i++) {
+    ASSERT_GE(events[i].timestamp, events[i - 1].timestamp);
+  }
+
+  ASSERT_EQ(events[0].op, trace_op_t::create);
+  ASSERT_EQ(events[0].ptr, 0);
+  ASSERT_EQ(events[0].size, static_cast<uint64_t>(alloc_type_e::stack));
+
+  ASSERT_EQ(events[1].op, trace_op_t::allocate);
+  ASSERT_EQ(events[1].ptr, first.addr);
+  ASSERT_EQ(events[1].size, 100);
+
+  ASSERT_EQ(events[2].op, trace_op_t::allocate);
+  ASSERT_EQ(events[2].ptr, failed.addr);
+  ASSERT_EQ(events[2].size, 2 * Kb);
+
+  ASSERT_EQ(events[3].op, trace_op_t::allocate);
+  ASSERT_EQ(events[3].ptr, batch[0].addr);
+  ASSERT_EQ(events[4].op, trace_op_t::allocate);
+  ASSERT_EQ(events[4].ptr, batch[1].addr);
+
+  ASSERT_EQ(events[5].op, trace_op_t::deallocate);
+  ASSERT_EQ(events[5].ptr, batch[0].addr);
+  ASSERT_EQ(events[6].op, trace_op_t::deallocate);
+  ASSERT_EQ(events[6].ptr, batch[1].addr);
+
+  ASSERT_EQ(events[7].op, trace_op_t::deallocate);
+  ASSERT_EQ(events[7].ptr, first.addr);
+  ASSERT_EQ(events[7].size, first.size);
+
+  ASSERT_EQ(events[8].op, trace_op_t::deallocate_all);
+  ASSERT_EQ(events[9].op, trace_op_t::destroy);
+}
+
+TEST(memory, allocation_trace_skips_nested_calls) {
+
+  if (!trace_enabled) {
+    GTEST_SKIP() << "built without FASTWARE_MEMORY_TRACE";
+  }
+
+  const char *path = "allocation_trace_skips_nested_calls.trace";
+  ASSERT_TRUE(trace_begin(path));
+
+  // the slab creates its pools from the parent and frees into them, only the
+  // calls made here must show up
+  stack_alloc_create_info_t parent_info{nullptr, 1 * Mb, alignment_t::b64};
+  allocator_t *parent = fastware::memory::create(&parent_info);
+  slab_alloc_create_info_t create_info{parent, 16, 64, 4 * Kb};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blk = allocate(alloc, 40);
+  deallocate(alloc, blk);
+  destroy(alloc);
+  destroy(parent);
+
+  trace_end();
+
+  std::vector<trace_event_t> events = read_trace(path);
+  remove(path);
+
+  ASSERT_EQ(events.size(), 6);
+
+  ASSERT_EQ(events[0].op, trace_op_t::create);
+  ASSERT_EQ(events[0].alloc, reinterpret_cast<uint64_t>(parent));
+
+  ASSERT_EQ(events[1].op, trace_op_t::create);
+  ASSERT_EQ(events[1].alloc, reinterpret_cast<uint64_t>(alloc));
+  ASSERT_EQ(events[1].ptr, reinterpret_cast<uint64_t>(parent));
+  ASSERT_EQ(events[1].size, static_cast<uint64_t>(alloc_type_e::slab));
+
+  ASSERT_EQ(events[2].op, trace_op_t::allocate);
+  ASSERT_EQ(events[2].alloc, reinterpret_cast<uint64_t>(alloc));
+  ASSERT_EQ(events[3].op, trace_op_t::deallocate);
+  ASSERT_EQ(events[3].alloc, reinterpret_cast<uint64_t>(alloc));
+
+  ASSERT_EQ(events[4].op, trace_op_t::destroy);
+  ASSERT_EQ(events[4].alloc, reinterpret_cast<uint64_t>(alloc));
+  ASSERT_EQ(events[5].op, trace_op_t::destroy);
+  ASSERT_EQ(events[5].alloc, reinterpret_cast<uint64_t>(parent));
+}
+
+TEST(memory, allocation_trace_begin_frame) {
+
+  if (!trace_enabled) {
+    GTEST_SKIP() << "built without FASTWARE_MEMORY_TRACE";
+  }
+
+  const char *path = "allocation_trace_begin_frame.trace";
+  ASSERT_TRUE(trace_begin(path));
+
+  frame_arena_create_info_t create_info{nullptr, 1 * Kb, alignment_t::b16, 3};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  allocate(alloc, 64);
+  begin_frame(alloc);
+  destroy(alloc);
+
+  trace_end();
+
+  std::vector<trace_event_t> events = read_trace(path);
+  remove(path);
+
+  ASSERT_EQ(events.size(), 4);
+  ASSERT_EQ(events[0].size, static_cast<uint64_t>(alloc_type_e::frame_arena));
+  ASSERT_EQ(events[2].op, trace_op_t::begin_frame);
+  ASSERT_EQ(events[2].alloc, reinterpret_cast<uint64_t>(alloc));
+  ASSERT_EQ(events[2].size, 3);
+}
+
+TEST(memory, allocation_trace_reallocate) {
+
+  if (!trace_enabled) {
+    GTEST_SKIP() << "built without FASTWARE_MEMORY_TRACE";
+  }
+
+  const char *path = "allocation_trace_reallocate.trace";
+  ASSERT_TRUE(trace_begin(path));
+
+  stack_alloc_create_info_t create_info{nullptr, 1 * Kb, alignment_t::b16};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blk = allocate(alloc, 64);
+  memblk grown = reallocate(alloc, blk, 128);
+  memblk top = allocate(alloc, 16);
+  memblk moved = reallocate(alloc, grown, 256);
+  destroy(alloc);
+
+  trace_end();
+
+  std::vector<trace_event_t> events = read_trace(path);
+  remove(path);
+
+  ASSERT_EQ(events.size(), 8);
+
+  // in place, the block goes away and comes back bigger
+  ASSERT_EQ(events[2].op, trace_op_t::deallocate);
+  ASSERT_EQ(events[2].ptr, blk.addr);
+  ASSERT_EQ(events[2].size, 64);
+  ASSERT_EQ(events[3].op, trace_op_t::allocate);
+  ASSERT_EQ(events[3].ptr, blk.addr);
+  ASSERT_EQ(events[3].size, 128);
+
+  ASSERT_EQ(events[4].op, trace_op_t::allocate);
+  ASSERT_EQ(events[4].ptr, top.addr);
+
+  // moved, both blocks are live while the contents are copied
+  ASSERT_EQ(events[5].op, trace_op_t::allocate);
+  ASSERT_EQ(events[5].ptr, moved.addr);
+  ASSERT_EQ(events[5].size, 256);
+  ASSERT_EQ(events[6].op, trace_op_t::deallocate);
+  ASSERT_EQ(events[6].ptr, grown.addr);
+  ASSERT_EQ(events[6].size, 128);
+
+  ASSERT_EQ(events[7].op, trace_op_t::destroy);
+}
+
+TEST(memory, allocation_trace_threads_past_the_buffer) {
+
+  if (!trace_enabled) {
+    GTEST_SKIP() << "built without FASTWARE_MEMORY_TRACE";
+  }
+
+  // several times the 4096 events written at once
+  constexpr int thread_count = 4;
+  constexpr int pairs = 5000;
+
+  const char *path = "allocation_trace_threads_past_the_buffer.trace";
+  ASSERT_TRUE(trace_begin(path));
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_count; t++) {
+    threads.emplace_back([] {
+      stack_alloc_create_info_t create_info{nullptr, 1 * Kb, alignment_t::b16};
+      allocator_t *alloc = fastware::memory::create(&create_info);
+      for (int i = 0; i < pairs; i++) {
+        deallocate(alloc, allocate(alloc, 64));
+      }
+      destroy(alloc);
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  trace_end();
+
+  std::vector<trace_event_t> events = read_trace(path);
+  remove(path);
+
+  ASSERT_EQ(events.size(), thread_count * (2 * pairs + 2));
+  for (uint64_t i = 1; i < events.size(); i++) {
+    ASSERT_GE(events[i].timestamp, events[i - 1].timestamp);
+  }
+}
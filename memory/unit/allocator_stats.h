@@ -0,0 +1,426 @@
+#include <fastware/memory.h>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+using namespace fastware::memory;
+
+TEST(memory, allocator_stats_stack_counters) {
+
+  if (!stats_enabled) {
+    GTEST_SKIP() << "built without FASTWARE_MEMORY_STATS";
+  }
+
+  stack_alloc_create_info_t create_info{nullptr, 1 * Kb, alignment_t::b16};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  allocator_stats_t stats = query_stats(alloc);
+  ASSERT_STREQ(stats.kind, "stack");
+  ASSERT_GE(stats.capacity, 1 * Kb);
+  ASSERT_EQ(stats.bytes_in_use, 0);
+
+  memblk first = allocate(alloc, 100);
+  memblk second = allocate(alloc, 200);
+  memblk failed = allocate(alloc, 2 * Kb);
+  ASSERT_EQ(failed.ptr, nullptr);
+
+  stats = query_stats(alloc);
+  ASSERT_EQ(stats.bytes_in_use, first.size + second.size);
+  ASSERT_EQ(stats.peak_bytes, first.size + second.size);
+  ASSERT_EQ(stats.alloc_count, 2);
+  ASSERT_EQ(stats.failed_count, 1);
+  ASSERT_EQ(stats.live_count, 2);
+
+  deallocate(alloc, second);
+
+  stats = query_stats(alloc);
+  ASSERT_EQ(stats.bytes_in_use, first.size);
+  ASSERT_EQ(stats.peak_bytes, first.size + second.size);
+  ASSERT_EQ(stats.free_count, 1);
+  ASSERT_EQ(stats.live_count, 1);
+
+  deallocate_all(alloc);
+
+  stats = query_stats(alloc);
+  ASSERT_EQ(stats.bytes_in_use, 0);
+  ASSERT_EQ(stats.live_count, 0);
+  ASSERT_EQ(stats.peak_bytes, first.size + second.size);
+
+  destroy(alloc);
+}
+
+TEST(memory, allocator_stats_pool_occupancy) {
+
+  if (!stats_enabled) {
+    GTEST_SKIP() << "built without FASTWARE_MEMORY_STATS";
+  }
+
+  for (uint64_t flags : {pool_flags_t::none, pool_flags_t::concurrent}) {
+    pool_alloc_create_info_t create_info{nullptr, 64, alignment_t::b64, 8,
+                                         flags};
+
+    allocator_t *alloc = fastware::memory::create(&create_info);
+
+    memblk blocks[9];
+    for (memblk &blk : blocks) {
+      blk = allocate(alloc, 64);
+    }
+
+    allocator_stats_t stats = query_stats(alloc);
+    ASSERT_EQ(stats.block_count, 8);
+    ASSERT_EQ(stats.live_count, 8);
+    ASSERT_EQ(stats.bytes_in_use, 8 * 64);
+    ASSERT_EQ(stats.failed_count, 1);
+
+    for (uint64_t i = 0; i < 4; i++) {
+      deallocate(alloc, blocks[i]);
+    }
+
+    stats = query_stats(alloc);
+    ASSERT_EQ(stats.live_count, 4);
+    ASSERT_EQ(stats.peak_bytes, 8 * 64);
+
+    destroy(alloc);
+  }
+}
+
+TEST(memory, allocator_stats_thread_cache_pool_occupancy) {
+
+  if (!stats_enabled) {
+    GTEST_SKIP() << "built without FASTWARE_MEMORY_STATS";
+  }
+
+  pool_alloc_create_info_t pool_info{nullptr, 64, alignment_t::b64, 64,
+                                     pool_flags_t::concurrent};
+  allocator_t *pool = fastware::memory::create(&pool_info);
+
+  thread_cache_create_info_t create_info{nullptr, pool, 8};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blk = allocate(alloc, 64);
+
+  // the pool sees the blocks parked in the magazine as in use
+  ASSERT_EQ(query_stats(alloc).live_count, 1);
+  ASSERT_EQ(query_stats(pool).live_count, 4);
+
+  deallocate(alloc, blk);
+  ASSERT_EQ(query_stats(alloc).live_count, 0);
+
+  destroy(alloc);
+  ASSERT_EQ(query_stats(pool).live_count, 0);
+  ASSERT_EQ(query_stats(pool).alloc_count, 4);
+
+  destroy(pool);
+}
+
+TEST(memory, allocator_stats_walk_tree) {
+
+  if (!stats_enabled) {
+    GTEST_SKIP() << "built without FASTWARE_MEMORY_STATS";
+  }
+
+  stack_alloc_create_info_t root_info{nullptr, 1 * Mb, alignment_t::b64};
+  allocator_t *root = fastware::memory::create(&root_info);
+
+  stack_alloc_create_info_t scratch_info{root, 4 * Kb, alignment_t::b16};
+  allocator_t *scratch = fastware::memory::create(&scratch_info);
+
+  slab_alloc_create_info_t slab_info{root, 16, 64, 1 * Kb};
+  allocator_t *slab = fastware::memory::create(&slab_info);
+
+  struct visit_t {
+    allocator_t *alloc;
+    uint32_t depth;
+  };
+  struct visits_t {
+    visit_t entries[16];
+    uint32_t count;
+  } visits{};
+
+  walk_allocators(
+      root,
+      [](allocator_t *alloc, const allocator_stats_t *, uint32_t depth,
+         void *user_data) {
+        visits_t *visits = static_cast<visits_t *>(user_data);
+        visits->entries[visits->count++] = {alloc, depth};
+      },
+      &visits);
+
+  // root, the scratch stack, the slab and its 3 pools
+  ASSERT_EQ(visits.count, 6);
+  ASSERT_EQ(visits.entries[0].alloc, root);
+  ASSERT_EQ(visits.entries[0].depth, 0);
+
+  uint32_t children = 0;
+  uint32_t grand_children = 0;
+  for (uint32_t i = 1; i < visits.count; i++) {
+    children += visits.entries[i].depth == 1;
+    grand_children += visits.entries[i].depth == 2;
+    if (visits.entries[i].alloc == scratch || visits.entries[i].alloc == slab) {
+      ASSERT_EQ(visits.entries[i].depth, 1);
+    }
+  }
+  ASSERT_EQ(children, 2);
+  ASSERT_EQ(grand_children, 3);
+
+  // the storage of every child was carved from root
+  ASSERT_EQ(query_stats(root).live_count, 5);
+
+  destroy(slab);
+  destroy(scratch);
+  destroy(root);
+
+  visits.count = 0;
+  walk_allocators(
+      root,
+      [](allocator_t *, const allocator_stats_t *, uint32_t, void *user_data) {
+        static_cast<visits_t *>(user_data)->count++;
+      },
+      &visits);
+  ASSERT_EQ(visits.count, 0);
+}
+
+TEST(memory, allocator_stats_batches) {
+
+  if (!stats_enabled) {
+    GTEST_SKIP() << "built without FASTWARE_MEMORY_STATS";
+  }
+
+  pool_alloc_create_info_t create_info{nullptr, 64, alignment_t::b64, 8};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blks[10];
+  ASSERT_EQ(allocate_n(alloc, 64, 10, blks), 8);
+
+  allocator_stats_t stats = query_stats(alloc);
+  ASSERT_EQ(stats.alloc_count, 8);
+  ASSERT_EQ(stats.live_count, 8);
+  ASSERT_EQ(stats.bytes_in_use, 8 * 64);
+  ASSERT_EQ(stats.failed_count, 1);
+
+  deallocate_n(alloc, blks, 8);
+
+  stats = query_stats(alloc);
+  ASSERT_EQ(stats.free_count, 8);
+  ASSERT_EQ(stats.live_count, 0);
+  ASSERT_EQ(stats.bytes_in_use, 0);
+
+  destroy(alloc);
+}
+
+TEST(memory, allocator_stats_mixed_batch) {
+
+  if (!stats_enabled) {
+    GTEST_SKIP() << "built without FASTWARE_MEMORY_STATS";
+  }
+
+  pool_alloc_create_info_t pool_info{nullptr, 32, alignment_t::b16, 2};
+  allocator_t *pool = fastware::memory::create(&pool_info);
+
+  stack_alloc_create_info_t stack_info{nullptr, 1 * Kb, alignment_t::b64};
+  allocator_t *stack = fastware::memory::create(&stack_info);
+
+  fallback_alloc_create_info_t create_info{nullptr, pool, stack};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  // two 32 byte blocks of the pool, two aligned up to 64 by the stack
+  memblk blks[4];
+  ASSERT_EQ(allocate_n(alloc, 32, 4, blks), 4);
+  ASSERT_EQ(blks[0].size, 32);
+  ASSERT_EQ(blks[3].size, 64);
+
+  allocator_stats_t stats = query_stats(alloc);
+  ASSERT_EQ(stats.live_count, 4);
+  ASSERT_EQ(stats.bytes_in_use, 2 * 32 + 2 * 64);
+
+  deallocate_n(alloc, blks, 4);
+
+  stats = query_stats(alloc);
+  ASSERT_EQ(stats.live_count, 0);
+  ASSERT_EQ(stats.bytes_in_use, 0);
+
+  destroy(alloc);
+  destroy(stack);
+  destroy(pool);
+}
+
+TEST(memory, allocator_stats_frame_arena_rotation) {
+
+  if (!stats_enabled) {
+    GTEST_SKIP() << "built without FASTWARE_MEMORY_STATS";
+  }
+
+  frame_arena_create_info_t create_info{nullptr, 1 * Kb, alignment_t::b16, 2};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  allocator_stats_t stats = query_stats(alloc);
+  ASSERT_STREQ(stats.kind, "frame_arena");
+  ASSERT_EQ(stats.capacity, 2 * Kb);
+
+  allocate(alloc, 100);
+  begin_frame(alloc);
+  allocate(alloc, 200);
+
+  stats = query_stats(alloc);
+  ASSERT_EQ(stats.bytes_in_use, 112 + 208);
+
+  // the first frame is reused, its bytes are gone
+  begin_frame(alloc);
+  stats = query_stats(alloc);
+  ASSERT_EQ(stats.bytes_in_use, 208);
+  ASSERT_EQ(stats.peak_bytes, 112 + 208);
+
+  destroy(alloc);
+}
+
+TEST(memory, allocator_stats_fallback_counts_both_levels) {
+
+  if (!stats_enabled) {
+    GTEST_SKIP() << "built without FASTWARE_MEMORY_STATS";
+  }
+
+  stack_alloc_create_info_t stack_info{nullptr, 64, alignment_t::b16};
+  allocator_t *stack = fastware::memory::create(&stack_info);
+
+  tlsf_alloc_create_info_t tlsf_info{nullptr, 4 * Kb, alignment_t::b16};
+  allocator_t *tlsf = fastware::memory::create(&tlsf_info);
+
+  fallback_alloc_create_info_t create_info{nullptr, stack, tlsf};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  allocator_stats_t stats = query_stats(alloc);
+  ASSERT_STREQ(stats.kind, "fallback");
+  ASSERT_EQ(stats.capacity, 0);
+
+  memblk blk = allocate(alloc, 64);
+  memblk blk2 = allocate(alloc, 64);
+
+  stats = query_stats(alloc);
+  ASSERT_EQ(stats.alloc_count, 2);
+  ASSERT_EQ(stats.bytes_in_use, 128);
+
+  // the stack ran out once, the composite itself did not
+  ASSERT_EQ(query_stats(stack).failed_count, 1);
+  ASSERT_EQ(query_stats(tlsf).live_count, 1);
+
+  deallocate(alloc, blk2);
+  deallocate(alloc, blk);
+
+  ASSERT_EQ(query_stats(alloc).live_count, 0);
+  ASSERT_EQ(query_stats(stack).live_count, 0);
+  ASSERT_EQ(query_stats(tlsf).live_count, 0);
+
+  destroy(alloc);
+  destroy(tlsf);
+  destroy(stack);
+}
+
+TEST(memory, allocator_stats_expand_in_place) {
+
+  if (!stats_enabled) {
+    GTEST_SKIP() << "built without FASTWARE_MEMORY_STATS";
+  }
+
+  stack_alloc_create_info_t create_info{nullptr, 1 * Kb, alignment_t::b16};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blk = allocate(alloc, 64);
+  ASSERT_TRUE(expand(alloc, &blk, 64));
+
+  // same block, more bytes
+  allocator_stats_t stats = query_stats(alloc);
+  ASSERT_EQ(stats.alloc_count, 1);
+  ASSERT_EQ(stats.live_count, 1);
+  ASSERT_EQ(stats.bytes_in_use, 128);
+  ASSERT_EQ(stats.peak_bytes, 128);
+
+  deallocate(alloc, blk);
+  stats = query_stats(alloc);
+  ASSERT_EQ(stats.live_count, 0);
+  ASSERT_EQ(stats.bytes_in_use, 0);
+
+  destroy(alloc);
+}
+
+TEST(memory, allocator_stats_table_reuses_destroyed_entries) {
+
+  if (!stats_enabled) {
+    GTEST_SKIP() << "built without FASTWARE_MEMORY_STATS";
+  }
+
+  tlsf_alloc_create_info_t tlsf_info{nullptr, 4 * Mb, alignment_t::b16};
+  allocator_t *tlsf = fastware::memory::create(&tlsf_info);
+
+  // many more creates than the table has entries, like a scratch stack
+  // per shader program
+  std::vector<allocator_t *> live;
+  std::mt19937 rng(42);
+  for (uint64_t i = 0; i < 4000; i++) {
+    stack_alloc_create_info_t stack_info{tlsf, 256, alignment_t::b16};
+    allocator_t *stack = fastware::memory::create(&stack_info);
+    ASSERT_NE(stack, nullptr);
+    live.push_back(stack);
+    // destroyed in a random order so entries get shifted back
+    if (live.size() > 200) {
+      std::swap(live[rng() % live.size()], live.back());
+      destroy(live.back());
+      live.pop_back();
+    }
+  }
+
+  for (uint64_t i = 0; i < live.size(); i++) {
+    memblk blk = allocate(live[i], 16 * (i % 8 + 1));
+    allocator_stats_t stats = query_stats(live[i]);
+    ASSERT_STREQ(stats.kind, "stack");
+    ASSERT_EQ(stats.bytes_in_use, blk.size);
+    ASSERT_EQ(stats.alloc_count, 1);
+  }
+
+  for (allocator_t *stack : live) {
+    destroy(stack);
+  }
+  ASSERT_EQ(query_stats(tlsf).live_count, 0);
+  destroy(tlsf);
+}
+
+TEST(memory, allocator_stats_table_full) {
+
+  if (!stats_enabled) {
+    GTEST_SKIP() << "built without FASTWARE_MEMORY_STATS";
+  }
+
+  tlsf_alloc_create_info_t tlsf_info{nullptr, 4 * Mb, alignment_t::b16};
+  allocator_t *tlsf = fastware::memory::create(&tlsf_info);
+
+  // more live allocators than the table holds, the last ones go untracked
+  std::vector<allocator_t *> stacks;
+  for (uint64_t i = 0; i < 600; i++) {
+    stack_alloc_create_info_t stack_info{tlsf, 256, alignment_t::b16};
+    allocator_t *stack = fastware::memory::create(&stack_info);
+    ASSERT_NE(stack, nullptr);
+    ASSERT_NE(allocate(stack, 16).ptr, nullptr);
+    stacks.push_back(stack);
+  }
+  ASSERT_STREQ(query_stats(stacks.front()).kind, "stack");
+  ASSERT_EQ(query_stats(stacks.front()).alloc_count, 1);
+  ASSERT_EQ(query_stats(stacks.back()).kind, nullptr);
+  ASSERT_EQ(query_stats(stacks.back()).alloc_count, 0);
+
+  // room again once some are gone
+  for (uint64_t i = 0; i < 200; i++) {
+    destroy(stacks[i]);
+  }
+  stack_alloc_create_info_t stack_info{tlsf, 256, alignment_t::b16};
+  allocator_t *tracked = fastware::memory::create(&stack_info);
+  ASSERT_STREQ(query_stats(tracked).kind, "stack");
+
+  destroy(tracked);
+  for (uint64_t i = 200; i < stacks.size(); i++) {
+    destroy(stacks[i]);
+  }
+  ASSERT_EQ(query_stats(tlsf).live_count, 0);
+  destroy(tlsf);
+}
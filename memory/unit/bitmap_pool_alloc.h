@@ -0,0 +1,168 @@
+#include <fastware/memory.h>
+#include <fastware/typed_allocator.h>
+#include <gtest/gtest.h>
+
+using namespace fastware::memory;
+
+TEST(memory, bitmap_pool_allocator_create) {
+
+  pool_alloc_create_info_t create_info{nullptr, 64, alignment_t::b64, 100,
+                                       pool_flags_t::bitmap};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  ASSERT_NE(alloc, nullptr);
+  ASSERT_EQ(prefered_size(alloc, 1), 64);
+  ASSERT_EQ(prefered_size(alloc, 65), 0);
+
+  destroy(alloc);
+}
+
+TEST(memory, bitmap_pool_allocator_first_fit) {
+
+  constexpr uint64_t block_count = 130;
+  pool_alloc_create_info_t create_info{nullptr, 72, alignment_t::b8,
+                                       block_count, pool_flags_t::bitmap};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blks[block_count];
+  for (uint64_t i = 0; i < block_count; i++) {
+    blks[i] = allocate(alloc, 72);
+    ASSERT_NE(blks[i].ptr, nullptr);
+    ASSERT_EQ(blks[i].size, 72);
+    ASSERT_TRUE(owns(alloc, blks[i]));
+    // handed out in address order
+    ASSERT_EQ(address{.raw = blks[i].ptr} - address{.raw = blks[0].ptr},
+              i * 72);
+  }
+  // the bits past block_count in the last word are never handed out
+  ASSERT_EQ(allocate(alloc, 72).ptr, nullptr);
+
+  // the lowest free block comes back first, whatever the free order
+  deallocate(alloc, blks[100]);
+  deallocate(alloc, blks[3]);
+  deallocate(alloc, blks[70]);
+  ASSERT_EQ(allocate(alloc, 72).ptr, blks[3].ptr);
+  ASSERT_EQ(allocate(alloc, 72).ptr, blks[70].ptr);
+  ASSERT_EQ(allocate(alloc, 72).ptr, blks[100].ptr);
+  ASSERT_EQ(allocate(alloc, 72).ptr, nullptr);
+
+  deallocate_all(alloc);
+  ASSERT_EQ(allocate(alloc, 72).ptr, blks[0].ptr);
+
+  destroy(alloc);
+}
+
+TEST(memory, bitmap_pool_allocator_allocate_n) {
+
+  constexpr uint64_t block_count = 200;
+  pool_alloc_create_info_t create_info{nullptr, 32, alignment_t::b32,
+                                       block_count, pool_flags_t::bitmap};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk first[150];
+  memblk second[100];
+  ASSERT_EQ(allocate_n(alloc, 32, 150, first), 150);
+  ASSERT_EQ(allocate_n(alloc, 32, 100, second), 50);
+  ASSERT_EQ(allocate(alloc, 32).ptr, nullptr);
+  ASSERT_EQ(second[0].ptr, (address{.raw = first[0].ptr} + 150 * 32).raw);
+
+  deallocate_n(alloc, first + 10, 5);
+  memblk again[8];
+  ASSERT_EQ(allocate_n(alloc, 32, 8, again), 5);
+  for (uint64_t i = 0; i < 5; i++) {
+    ASSERT_EQ(again[i].ptr, first[10 + i].ptr);
+  }
+
+  destroy(alloc);
+}
+
+TEST(memory, bitmap_pool_allocator_for_each_live) {
+
+  constexpr uint64_t block_count = 300;
+  pool_alloc_create_info_t create_info{nullptr, 16, alignment_t::b16,
+                                       block_count, pool_flags_t::bitmap};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blks[block_count];
+  ASSERT_EQ(allocate_n(alloc, 16, block_count, blks), block_count);
+  for (uint64_t i = 0; i < block_count; i++) {
+    *static_cast<uint64_t *>(blks[i].ptr) = i;
+    if (i % 3) {
+      deallocate(alloc, blks[i]);
+    }
+  }
+
+  // type-erased visitor
+  struct visit_t {
+    uint64_t count;
+    uint64_t last;
+  } visit{0, 0};
+  for_each_live(
+      alloc,
+      [](memblk blk, void *user_data) {
+        visit_t *visit = static_cast<visit_t *>(user_data);
+        const uint64_t value = *static_cast<uint64_t *>(blk.ptr);
+        EXPECT_EQ(value % 3, 0);
+        EXPECT_TRUE(visit->count == 0 || value > visit->last);
+        visit->last = value;
+        visit->count++;
+      },
+      &visit);
+  ASSERT_EQ(visit.count, block_count / 3);
+
+  // inlined visitor, freeing the visited block is allowed
+  typed_allocator<bitmap_pool_allocator_t> typed =
+      typed_allocator<bitmap_pool_allocator_t>::from(alloc);
+  uint64_t visited = 0;
+  typed.for_each_live([&](memblk blk) {
+    visited++;
+    if (*static_cast<uint64_t *>(blk.ptr) % 2) {
+      typed.deallocate(blk);
+    }
+  });
+  ASSERT_EQ(visited, block_count / 3);
+
+  visited = 0;
+  typed.for_each_live([&](memblk) { visited++; });
+  ASSERT_EQ(visited, block_count / 6);
+
+  destroy(alloc);
+}
+
+TEST(memory, bitmap_pool_allocator_trim) {
+
+  constexpr uint64_t block_count = 1024;
+  pool_alloc_create_info_t create_info{nullptr, 64, alignment_t::b64,
+                                       block_count, pool_flags_t::bitmap};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  static memblk blks[block_count];
+  for (memblk &blk : blks) {
+    blk = allocate(alloc, 64);
+    *static_cast<uint64_t *>(blk.ptr) = 0xABAB;
+  }
+  ASSERT_EQ(trim(alloc), 0);
+
+  // a run across words, one at the end and a single block
+  for (uint64_t i = 60; i < 200; i++) {
+    deallocate(alloc, blks[i]);
+  }
+  for (uint64_t i = 800; i < block_count; i++) {
+    deallocate(alloc, blks[i]);
+  }
+  deallocate(alloc, blks[500]);
+
+  ASSERT_GE(trim(alloc), 8 * Kb);
+  ASSERT_EQ(*static_cast<uint64_t *>(blks[128].ptr), 0);
+  ASSERT_EQ(*static_cast<uint64_t *>(blks[900].ptr), 0);
+  ASSERT_EQ(*static_cast<uint64_t *>(blks[500].ptr), 0xABAB);
+  ASSERT_EQ(*static_cast<uint64_t *>(blks[59].ptr), 0xABAB);
+  ASSERT_EQ(*static_cast<uint64_t *>(blks[200].ptr), 0xABAB);
+
+  destroy(alloc);
+}
@@ -0,0 +1,186 @@
+#include <fastware/memory.h>
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace fastware::memory;
+
+struct budget_events_t {
+  uint64_t soft_count;
+  uint64_t hard_count;
+  uint64_t charged_bytes;
+};
+
+static void count_budget_events(allocator_t *, budget_event_t::value event,
+                                const budget_report_t *report,
+                                void *user_data) {
+  budget_events_t *events = static_cast<budget_events_t *>(user_data);
+  if (event == budget_event_t::soft_limit) {
+    events->soft_count++;
+  } else {
+    events->hard_count++;
+  }
+  events->charged_bytes = report->charged_bytes;
+}
+
+TEST(memory, budget_allocator_limits) {
+
+  stack_alloc_create_info_t stack_info{nullptr, 16 * Kb, alignment_t::b16};
+  allocator_t *stack = fastware::memory::create(&stack_info);
+
+  budget_events_t events{};
+  budget_alloc_create_info_t create_info{
+      nullptr, stack, "scratch", 1 * Kb, 4 * Kb, count_budget_events, &events};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+  ASSERT_NE(alloc, nullptr);
+
+  // charged the size handed out
+  memblk a = allocate(alloc, 500);
+  ASSERT_EQ(a.size, 512);
+  ASSERT_EQ(query_budget(alloc).charged_bytes, 512);
+  ASSERT_EQ(events.soft_count, 0);
+
+  // over the soft limit once
+  memblk b = allocate(alloc, 1 * Kb);
+  ASSERT_NE(b.ptr, nullptr);
+  memblk c = allocate(alloc, 16);
+  ASSERT_EQ(events.soft_count, 1);
+  ASSERT_EQ(events.charged_bytes, 512 + 1 * Kb);
+
+  // refused past the hard limit, there is room left on the stack
+  ASSERT_EQ(allocate(alloc, 3 * Kb).ptr, nullptr);
+  ASSERT_EQ(events.hard_count, 1);
+  ASSERT_FALSE(expand(alloc, &c, 3 * Kb));
+  ASSERT_EQ(events.hard_count, 2);
+  ASSERT_TRUE(expand(alloc, &c, 16));
+
+  budget_report_t report = query_budget(alloc);
+  ASSERT_STREQ(report.tag, "scratch");
+  ASSERT_EQ(report.charged_bytes, 512 + 1 * Kb + 32);
+  ASSERT_EQ(report.refused_count, 2);
+
+  deallocate(alloc, c);
+  deallocate(alloc, b);
+  report = query_budget(alloc);
+  ASSERT_EQ(report.charged_bytes, 512);
+  ASSERT_EQ(report.peak_bytes, 512 + 1 * Kb + 32);
+
+  // below the soft limit again, crossing it is reported again
+  ASSERT_NE(allocate(alloc, 1 * Kb).ptr, nullptr);
+  ASSERT_EQ(events.soft_count, 2);
+
+  deallocate_all(alloc);
+  ASSERT_EQ(query_budget(alloc).charged_bytes, 0);
+  ASSERT_EQ(allocate(stack, 16 * Kb).size, 16 * Kb);
+
+  destroy(alloc);
+  destroy(stack);
+}
+
+TEST(memory, budget_allocator_hard_limit_on_rounded_size) {
+
+  pool_alloc_create_info_t pool_info{nullptr, 64, alignment_t::b64, 8};
+  allocator_t *pool = fastware::memory::create(&pool_info);
+
+  budget_events_t events{};
+  budget_alloc_create_info_t create_info{
+      nullptr, pool, "blocks", 0, 100, count_budget_events, &events};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  // 16 bytes asked, a whole block handed out and charged
+  memblk blk = allocate(alloc, 16);
+  ASSERT_EQ(blk.size, 64);
+  ASSERT_EQ(query_budget(alloc).charged_bytes, 64);
+
+  // a second block would take the budget past 100 bytes
+  ASSERT_EQ(allocate(alloc, 16).ptr, nullptr);
+  ASSERT_EQ(events.hard_count, 1);
+  ASSERT_EQ(query_budget(alloc).charged_bytes, 64);
+  ASSERT_EQ(query_budget(alloc).peak_bytes, 64);
+
+  deallocate(alloc, blk);
+  destroy(alloc);
+  destroy(pool);
+}
+
+TEST(memory, budget_allocator_charges_children) {
+
+  tlsf_alloc_create_info_t tlsf_info{nullptr, 1 * Mb, alignment_t::b16};
+  allocator_t *tlsf = fastware::memory::create(&tlsf_info);
+
+  budget_alloc_create_info_t create_info{nullptr, tlsf, "renderer", 0,
+                                         64 * Kb};
+  allocator_t *budget = fastware::memory::create(&create_info);
+
+  pool_alloc_create_info_t pool_info{budget, 64, alignment_t::b64, 256};
+  allocator_t *pool = fastware::memory::create(&pool_info);
+  ASSERT_NE(pool, nullptr);
+  // the blocks and the control blocks
+  ASSERT_GE(query_budget(budget).charged_bytes, 256 * 64 + 256 * 8);
+
+  // a child that does not fit is not created
+  stack_alloc_create_info_t stack_info{budget, 64 * Kb, alignment_t::b16};
+  ASSERT_EQ(fastware::memory::create(&stack_info), nullptr);
+  ASSERT_EQ(query_budget(budget).refused_count, 1);
+
+  slab_alloc_create_info_t slab_info{budget, 16, 4 * Kb, 16 * Kb};
+  ASSERT_EQ(fastware::memory::create(&slab_info), nullptr);
+  const uint64_t pool_charge = query_budget(budget).charged_bytes;
+  ASSERT_LT(pool_charge, 32 * Kb);
+
+  stack_info.size = 16 * Kb;
+  allocator_t *stack = fastware::memory::create(&stack_info);
+  ASSERT_NE(stack, nullptr);
+  ASSERT_GT(query_budget(budget).charged_bytes, pool_charge + 16 * Kb);
+
+  destroy(stack);
+  ASSERT_EQ(query_budget(budget).charged_bytes, pool_charge);
+  destroy(pool);
+  ASSERT_EQ(query_budget(budget).charged_bytes, 0);
+
+  destroy(budget);
+  destroy(tlsf);
+}
+
+TEST(memory, budget_allocator_walk) {
+
+  tlsf_alloc_create_info_t tlsf_info{nullptr, 64 * Kb, alignment_t::b16};
+  allocator_t *tlsf = fastware::memory::create(&tlsf_info);
+
+  budget_alloc_create_info_t text_info{nullptr, tlsf, "text"};
+  allocator_t *text = fastware::memory::create(&text_info);
+  budget_alloc_create_info_t logger_info{nullptr, tlsf, "logger"};
+  allocator_t *logger = fastware::memory::create(&logger_info);
+  // nested, charged to both
+  budget_alloc_create_info_t glyph_info{nullptr, text, "glyphs"};
+  allocator_t *glyphs = fastware::memory::create(&glyph_info);
+
+  memblk blk = allocate(glyphs, 1 * Kb);
+  ASSERT_EQ(query_budget(text).charged_bytes, blk.size);
+  ASSERT_EQ(query_budget(glyphs).charged_bytes, blk.size);
+
+  std::vector<std::string> tags;
+  const auto collect = [](allocator_t *, const budget_report_t *report,
+                          void *user_data) {
+    static_cast<std::vector<std::string> *>(user_data)->push_back(
+        report->tag);
+  };
+  walk_budgets(collect, &tags);
+  ASSERT_EQ(tags, (std::vector<std::string>{"text", "logger", "glyphs"}));
+
+  destroy(logger);
+  tags.clear();
+  walk_budgets(collect, &tags);
+  ASSERT_EQ(tags, (std::vector<std::string>{"text", "glyphs"}));
+
+  deallocate(glyphs, blk);
+  destroy(glyphs);
+  destroy(text);
+  tags.clear();
+  walk_budgets(collect, &tags);
+  ASSERT_TRUE(tags.empty());
+
+  destroy(tlsf);
+}
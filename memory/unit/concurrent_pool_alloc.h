@@ -0,0 +1,225 @@
+#include <fastware/memory.h>
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+using namespace fastware::memory;
+
+TEST(memory, concurrent_pool_allocator_create) {
+
+  pool_alloc_create_info_t create_info{nullptr, 32, alignment_t::b32, 32,
+                                       pool_flags_t::concurrent};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  ASSERT_NE(alloc, nullptr);
+
+  destroy(alloc);
+}
+
+TEST(memory, concurrent_pool_allocator_aligned_alloc_all_dealloc_all) {
+
+  pool_alloc_create_info_t create_info{nullptr, 32, alignment_t::b32, 32,
+                                       pool_flags_t::concurrent};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  ASSERT_NE(alloc, nullptr);
+
+  for (int i = 0, s = 1024 / 32; i < s; i++) {
+    memblk blk = allocate(alloc, 17);
+
+    ASSERT_EQ(blk.size, 32);
+    ASSERT_TRUE(is_aligned(blk.ptr, alignment_t::b32));
+    ASSERT_TRUE(owns(alloc, blk));
+  }
+
+  memblk empty_blk1 = allocate(alloc, 17);
+  ASSERT_EQ(empty_blk1.size, 0);
+  ASSERT_EQ(empty_blk1.ptr, nullptr);
+
+  deallocate_all(alloc);
+
+  for (int i = 0, s = 1024 / 32; i < s; i++) {
+    memblk blk = allocate(alloc, 17);
+
+    ASSERT_EQ(blk.size, 32);
+    ASSERT_TRUE(is_aligned(blk.ptr, alignment_t::b32));
+  }
+
+  memblk empty_blk2 = allocate(alloc, 17);
+  ASSERT_EQ(empty_blk2.size, 0);
+  ASSERT_EQ(empty_blk2.ptr, nullptr);
+
+  destroy(alloc);
+}
+
+TEST(memory, concurrent_pool_allocator_aligned_alloc_dealloc) {
+
+  pool_alloc_create_info_t create_info{nullptr, 32, alignment_t::b32, 32,
+                                       pool_flags_t::concurrent};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  ASSERT_NE(alloc, nullptr);
+
+  memblk blk = allocate(alloc, 17);
+  memblk blk2 = allocate(alloc, 17);
+  ASSERT_NE(blk.ptr, blk2.ptr);
+
+  deallocate(alloc, blk);
+
+  memblk blk3 = allocate(alloc, 17);
+  ASSERT_EQ(blk3.size, 32);
+  ASSERT_EQ(blk3.ptr, blk.ptr);
+
+  destroy(alloc);
+}
+
+TEST(memory, concurrent_pool_allocator_threaded_alloc_dealloc) {
+
+  constexpr int thread_count = 8;
+  constexpr int blocks_per_thread = 256;
+  constexpr int rounds = 64;
+
+  pool_alloc_create_info_t create_info{
+      nullptr, 64, alignment_t::b64, thread_count * blocks_per_thread,
+      pool_flags_t::concurrent};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  ASSERT_NE(alloc, nullptr);
+
+  std::vector<std::thread> threads;
+  std::vector<int> failures(thread_count, 0);
+
+  for (int t = 0; t < thread_count; t++) {
+    threads.emplace_back([alloc, t, &failures] {
+      memblk blks[blocks_per_thread];
+      for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < blocks_per_thread; i++) {
+          blks[i] = allocate(alloc, 64);
+          if (blks[i].ptr == nullptr) {
+            failures[t]++;
+            continue;
+          }
+          // every block is exclusively ours until we hand it back
+          *static_cast<int *>(blks[i].ptr) = t;
+        }
+        for (int i = 0; i < blocks_per_thread; i++) {
+          if (blks[i].ptr == nullptr) {
+            continue;
+          }
+          if (*static_cast<int *>(blks[i].ptr) != t) {
+            failures[t]++;
+          }
+          deallocate(alloc, blks[i]);
+        }
+      }
+    });
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  for (int t = 0; t < thread_count; t++) {
+    ASSERT_EQ(failures[t], 0);
+  }
+
+  // everything went back to the free list
+  for (int i = 0; i < thread_count * blocks_per_thread; i++) {
+    ASSERT_NE(allocate(alloc, 64).ptr, nullptr);
+  }
+  ASSERT_EQ(allocate(alloc, 64).ptr, nullptr);
+
+  destroy(alloc);
+}
+
+TEST(memory, concurrent_pool_allocator_allocate_n) {
+
+  pool_alloc_create_info_t create_info{nullptr, 64, alignment_t::b64, 16,
+                                       pool_flags_t::concurrent};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk first[10];
+  memblk second[10];
+  ASSERT_EQ(allocate_n(alloc, 64, 10, first), 10);
+  ASSERT_EQ(allocate_n(alloc, 64, 10, second), 6);
+  ASSERT_EQ(allocate_n(alloc, 64, 10, second + 6), 0);
+
+  deallocate_n(alloc, first, 10);
+  memblk again[10];
+  ASSERT_EQ(allocate_n(alloc, 64, 10, again), 10);
+  for (uint64_t i = 0; i < 10; i++) {
+    ASSERT_EQ(again[i].ptr, first[i].ptr);
+    ASSERT_EQ(again[i].size, 64);
+  }
+
+  destroy(alloc);
+}
+
+TEST(memory, concurrent_pool_allocator_non_power_of_2) {
+
+  constexpr uint64_t block_count = 1000;
+  pool_alloc_create_info_t create_info{nullptr, 96, alignment_t::b32,
+                                       block_count, pool_flags_t::concurrent};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  static memblk blks[block_count];
+  ASSERT_EQ(allocate_n(alloc, 96, block_count, blks), block_count);
+  for (uint64_t i = 0; i < block_count; i++) {
+    ASSERT_EQ(blks[i].size, 96);
+    ASSERT_TRUE(is_aligned(blks[i].ptr, alignment_t::b32));
+  }
+  ASSERT_EQ(allocate(alloc, 96).ptr, nullptr);
+
+  for (uint64_t i = 0; i < block_count; i += 3) {
+    deallocate(alloc, blks[i]);
+  }
+  for (uint64_t i = 0; i < block_count; i += 3) {
+    memblk blk = allocate(alloc, 96);
+    ASSERT_EQ((address{.raw = blk.ptr} - address{.raw = blks[0].ptr}) % 96, 0);
+    ASSERT_TRUE(owns(alloc, blk));
+  }
+  ASSERT_EQ(allocate(alloc, 96).ptr, nullptr);
+
+  destroy(alloc);
+}
+
+TEST(memory, concurrent_pool_allocator_lazy_reset_trim) {
+
+  constexpr uint64_t block_count = 1024;
+  pool_alloc_create_info_t create_info{nullptr, 64, alignment_t::b64,
+                                       block_count, pool_flags_t::concurrent};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk first = allocate(alloc, 64);
+  memblk blks[8];
+  ASSERT_EQ(allocate_n(alloc, 64, 8, blks), 8);
+  for (uint64_t i = 0; i < 8; i++) {
+    ASSERT_EQ(address{.raw = blks[i].ptr} - address{.raw = first.ptr},
+              (i + 1) * 64);
+  }
+  // the list before the untouched blocks
+  deallocate(alloc, blks[3]);
+  ASSERT_EQ(allocate(alloc, 64).ptr, blks[3].ptr);
+
+  // all but the pages the 9 blocks sit on
+  ASSERT_GE(trim(alloc), block_count * 64 - 8 * Kb);
+
+  deallocate_all(alloc);
+  ASSERT_EQ(allocate(alloc, 64).ptr, first.ptr);
+  for (uint64_t i = 1; i < block_count; i++) {
+    ASSERT_NE(allocate(alloc, 64).ptr, nullptr);
+  }
+  ASSERT_EQ(allocate(alloc, 64).ptr, nullptr);
+  ASSERT_EQ(allocate_n(alloc, 64, 8, blks), 0);
+  ASSERT_EQ(trim(alloc), 0);
+
+  destroy(alloc);
+}
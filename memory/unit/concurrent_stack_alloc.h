@@ -0,0 +1,204 @@
+#include <fastware/memory.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+using namespace fastware::memory;
+
+TEST(memory, concurrent_stack_allocator_create) {
+
+  for (uint64_t chunk_size : {0ul, 256ul}) {
+    stack_alloc_create_info_t create_info{nullptr,
+                                          1 * Kb,
+                                          alignment_t::b16,
+                                          stack_flags_t::concurrent,
+                                          backing_flags_t::none,
+                                          chunk_size};
+
+    allocator_t *alloc = fastware::memory::create(&create_info);
+
+    ASSERT_NE(alloc, nullptr);
+
+    destroy(alloc);
+  }
+}
+
+TEST(memory, concurrent_stack_allocator_aligned_alloc_all_dealloc_all) {
+
+  for (uint64_t chunk_size : {0ul, 256ul}) {
+    stack_alloc_create_info_t create_info{nullptr,
+                                          1 * Kb,
+                                          alignment_t::b32,
+                                          stack_flags_t::concurrent,
+                                          backing_flags_t::none,
+                                          chunk_size};
+
+    allocator_t *alloc = fastware::memory::create(&create_info);
+
+    ASSERT_NE(alloc, nullptr);
+
+    for (int round = 0; round < 2; round++) {
+      // the last chunk is shorter when the stack is almost full
+      for (int i = 0, s = 1024 / 32; i < s; i++) {
+        memblk blk = allocate(alloc, 17);
+
+        ASSERT_EQ(blk.size, 32);
+        ASSERT_TRUE(is_aligned(blk.ptr, alignment_t::b32));
+        ASSERT_TRUE(owns(alloc, blk));
+      }
+
+      memblk empty_blk = allocate(alloc, 17);
+      ASSERT_EQ(empty_blk.size, 0);
+      ASSERT_EQ(empty_blk.ptr, nullptr);
+
+      deallocate_all(alloc);
+    }
+
+    destroy(alloc);
+  }
+}
+
+TEST(memory, concurrent_stack_allocator_dealloc_top) {
+
+  for (uint64_t chunk_size : {0ul, 256ul}) {
+    stack_alloc_create_info_t create_info{nullptr,
+                                          1 * Kb,
+                                          alignment_t::b16,
+                                          stack_flags_t::concurrent,
+                                          backing_flags_t::none,
+                                          chunk_size};
+
+    allocator_t *alloc = fastware::memory::create(&create_info);
+
+    memblk first = allocate(alloc, 64);
+    memblk second = allocate(alloc, 64);
+    ASSERT_EQ(static_cast<char *>(second.ptr),
+              static_cast<char *>(first.ptr) + 64);
+
+    // only the top goes back
+    deallocate(alloc, first);
+    memblk third = allocate(alloc, 64);
+    ASSERT_EQ(static_cast<char *>(third.ptr),
+              static_cast<char *>(second.ptr) + 64);
+
+    deallocate(alloc, third);
+    memblk fourth = allocate(alloc, 64);
+    ASSERT_EQ(fourth.ptr, third.ptr);
+
+    destroy(alloc);
+  }
+}
+
+TEST(memory, concurrent_stack_allocator_large_request_with_chunks) {
+
+  stack_alloc_create_info_t create_info{nullptr,
+                                        4 * Kb,
+                                        alignment_t::b16,
+                                        stack_flags_t::concurrent,
+                                        backing_flags_t::none,
+                                        256};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk small = allocate(alloc, 16);
+  memblk large = allocate(alloc, 1 * Kb);
+  ASSERT_NE(large.ptr, nullptr);
+  ASSERT_EQ(large.size, 1 * Kb);
+
+  // the large block is carved from the shared top, past the thread's chunk
+  ASSERT_GE(static_cast<char *>(large.ptr),
+            static_cast<char *>(small.ptr) + 256);
+
+  memblk next_small = allocate(alloc, 16);
+  ASSERT_EQ(static_cast<char *>(next_small.ptr),
+            static_cast<char *>(small.ptr) + 16);
+
+  destroy(alloc);
+}
+
+TEST(memory, concurrent_stack_allocator_threaded_alloc) {
+
+  constexpr int thread_count = 8;
+  constexpr int blocks_per_thread = 512;
+
+  for (uint64_t chunk_size : {0ul, 1024ul}) {
+    stack_alloc_create_info_t create_info{nullptr,
+                                          thread_count * blocks_per_thread * 64,
+                                          alignment_t::b16,
+                                          stack_flags_t::concurrent,
+                                          backing_flags_t::none,
+                                          chunk_size};
+
+    allocator_t *alloc = fastware::memory::create(&create_info);
+
+    ASSERT_NE(alloc, nullptr);
+
+    std::vector<std::thread> threads;
+    std::vector<std::vector<memblk>> blks(thread_count);
+
+    for (int t = 0; t < thread_count; t++) {
+      threads.emplace_back([alloc, t, &blks] {
+        // variable amounts of output per thread, 16 to 64 bytes
+        for (int i = 0; i < blocks_per_thread; i++) {
+          memblk blk = allocate(alloc, 16 + 16 * ((i + t) % 4));
+          if (blk.ptr) {
+            memset(blk.ptr, t, blk.size);
+          }
+          blks[t].push_back(blk);
+        }
+      });
+    }
+
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    std::vector<memblk> all;
+    for (int t = 0; t < thread_count; t++) {
+      for (memblk blk : blks[t]) {
+        ASSERT_NE(blk.ptr, nullptr);
+        ASSERT_TRUE(owns(alloc, blk));
+        for (uint64_t i = 0; i < blk.size; i++) {
+          ASSERT_EQ(static_cast<char *>(blk.ptr)[i], t);
+        }
+        all.push_back(blk);
+      }
+    }
+
+    std::sort(all.begin(), all.end(),
+              [](memblk lhs, memblk rhs) { return lhs.addr < rhs.addr; });
+    for (uint64_t i = 1; i < all.size(); i++) {
+      ASSERT_LE(all[i - 1].addr + all[i - 1].size, all[i].addr);
+    }
+
+    deallocate_all(alloc);
+    memblk first = allocate(alloc, 16);
+    ASSERT_EQ(first.addr, all[0].addr);
+
+    destroy(alloc);
+  }
+}
+
+TEST(memory, concurrent_stack_allocator_allocate_n) {
+
+  stack_alloc_create_info_t create_info{nullptr, 1 * Kb, alignment_t::b16,
+                                        stack_flags_t::concurrent};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blks[8];
+  ASSERT_EQ(allocate_n(alloc, 40, 8, blks), 8);
+  for (int i = 1; i < 8; i++) {
+    ASSERT_EQ(blks[i].size, 48);
+    ASSERT_EQ(blks[i].addr, blks[i - 1].addr + 48);
+  }
+
+  // the whole batch is on top, it pops back in one go
+  deallocate_n(alloc, blks, 8);
+  memblk blk = allocate(alloc, 16);
+  ASSERT_EQ(blk.ptr, blks[0].ptr);
+
+  destroy(alloc);
+}
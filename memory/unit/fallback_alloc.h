@@ -0,0 +1,118 @@
+#include <fastware/memory.h>
+#include <gtest/gtest.h>
+
+using namespace fastware::memory;
+
+TEST(memory, fallback_allocator_create) {
+
+  stack_alloc_create_info_t stack_info{nullptr, 64, alignment_t::b16};
+  allocator_t *stack = fastware::memory::create(&stack_info);
+
+  tlsf_alloc_create_info_t tlsf_info{nullptr, 4 * Kb, alignment_t::b16};
+  allocator_t *tlsf = fastware::memory::create(&tlsf_info);
+
+  fallback_alloc_create_info_t create_info{nullptr, stack, tlsf};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  ASSERT_NE(alloc, nullptr);
+  ASSERT_EQ(prefered_size(alloc, 17), 32);
+
+  destroy(alloc);
+  destroy(tlsf);
+  destroy(stack);
+}
+
+TEST(memory, fallback_allocator_falls_through) {
+
+  stack_alloc_create_info_t stack_info{nullptr, 64, alignment_t::b16};
+  allocator_t *stack = fastware::memory::create(&stack_info);
+
+  tlsf_alloc_create_info_t tlsf_info{nullptr, 4 * Kb, alignment_t::b16};
+  allocator_t *tlsf = fastware::memory::create(&tlsf_info);
+
+  fallback_alloc_create_info_t create_info{nullptr, stack, tlsf};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blk = allocate(alloc, 48);
+  ASSERT_NE(blk.ptr, nullptr);
+  ASSERT_TRUE(owns(stack, blk));
+
+  // only 16 bytes left on the stack
+  memblk blk2 = allocate(alloc, 32);
+  ASSERT_NE(blk2.ptr, nullptr);
+  ASSERT_FALSE(owns(stack, blk2));
+  ASSERT_TRUE(owns(tlsf, blk2));
+
+  ASSERT_TRUE(owns(alloc, blk));
+  ASSERT_TRUE(owns(alloc, blk2));
+
+  // each block goes back to the allocator it came from
+  deallocate(alloc, blk2);
+  deallocate(alloc, blk);
+
+  memblk blk3 = allocate(alloc, 48);
+  ASSERT_EQ(blk3.ptr, blk.ptr);
+
+  deallocate(alloc, blk3);
+
+  destroy(alloc);
+  destroy(tlsf);
+  destroy(stack);
+}
+
+TEST(memory, fallback_allocator_alloc_n_spills) {
+
+  pool_alloc_create_info_t pool_info{nullptr, 32, alignment_t::b32, 4};
+  allocator_t *pool = fastware::memory::create(&pool_info);
+
+  stack_alloc_create_info_t stack_info{nullptr, 256, alignment_t::b32};
+  allocator_t *stack = fastware::memory::create(&stack_info);
+
+  fallback_alloc_create_info_t create_info{nullptr, pool, stack};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blks[6];
+  ASSERT_EQ(allocate_n(alloc, 32, 6, blks), 6);
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(owns(pool, blks[i]));
+  }
+  for (int i = 4; i < 6; i++) {
+    ASSERT_TRUE(owns(stack, blks[i]));
+  }
+
+  deallocate_n(alloc, blks, 6);
+
+  // the stack unwound and the pool has every block back
+  ASSERT_EQ(allocate_n(pool, 32, 4, blks), 4);
+  ASSERT_EQ(allocate(stack, 256).size, 256);
+
+  destroy(alloc);
+  destroy(stack);
+  destroy(pool);
+}
+
+TEST(memory, fallback_allocator_dealloc_all) {
+
+  stack_alloc_create_info_t stack_info{nullptr, 64, alignment_t::b16};
+  allocator_t *stack = fastware::memory::create(&stack_info);
+
+  stack_alloc_create_info_t stack_info2{nullptr, 64, alignment_t::b16};
+  allocator_t *stack2 = fastware::memory::create(&stack_info2);
+
+  fallback_alloc_create_info_t create_info{nullptr, stack, stack2};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  for (int i = 0; i < 8; i++) {
+    ASSERT_NE(allocate(alloc, 16).ptr, nullptr);
+  }
+  ASSERT_EQ(allocate(alloc, 16).ptr, nullptr);
+
+  deallocate_all(alloc);
+
+  ASSERT_EQ(allocate(stack, 64).size, 64);
+  ASSERT_EQ(allocate(stack2, 64).size, 64);
+
+  destroy(alloc);
+  destroy(stack2);
+  destroy(stack);
+}
@@ -0,0 +1,130 @@
+#include <fastware/memory.h>
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+using namespace fastware::memory;
+
+TEST(memory, frame_arena_allocator_create) {
+
+  for (uint64_t frame_count : {2ul, 3ul}) {
+    frame_arena_create_info_t create_info{nullptr, 1 * Kb, alignment_t::b16,
+                                          frame_count};
+
+    allocator_t *alloc = fastware::memory::create(&create_info);
+
+    ASSERT_NE(alloc, nullptr);
+
+    destroy(alloc);
+  }
+}
+
+TEST(memory, frame_arena_allocator_frame_lifetime) {
+
+  for (uint64_t frame_count : {2ul, 3ul}) {
+    frame_arena_create_info_t create_info{nullptr, 1 * Kb, alignment_t::b16,
+                                          frame_count};
+
+    allocator_t *alloc = fastware::memory::create(&create_info);
+
+    memblk frames[4];
+    for (uint64_t frame = 0; frame < 4; frame++) {
+      if (frame) {
+        begin_frame(alloc);
+      }
+      frames[frame] = allocate(alloc, 100);
+      ASSERT_NE(frames[frame].ptr, nullptr);
+      ASSERT_TRUE(is_aligned(frames[frame].ptr, alignment_t::b16));
+      ASSERT_TRUE(owns(alloc, frames[frame]));
+      memset(frames[frame].ptr, static_cast<int>(frame), frames[frame].size);
+
+      // every frame still in flight kept its data
+      for (uint64_t older = frame + 1 > frame_count ? frame + 1 - frame_count
+                                                    : 0;
+           older < frame; older++) {
+        ASSERT_NE(frames[older].ptr, frames[frame].ptr);
+        for (uint64_t i = 0; i < frames[older].size; i++) {
+          ASSERT_EQ(static_cast<char *>(frames[older].ptr)[i],
+                    static_cast<char>(older));
+        }
+      }
+    }
+
+    // frame_count frames later the same stack is handed out again
+    ASSERT_EQ(frames[frame_count].ptr, frames[0].ptr);
+
+    destroy(alloc);
+  }
+}
+
+TEST(memory, frame_arena_allocator_frame_full) {
+
+  frame_arena_create_info_t create_info{nullptr, 1 * Kb, alignment_t::b32, 2};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  for (int i = 0, s = 1024 / 32; i < s; i++) {
+    memblk blk = allocate(alloc, 17);
+    ASSERT_EQ(blk.size, 32);
+  }
+  ASSERT_EQ(allocate(alloc, 17).ptr, nullptr);
+
+  // the next frame has its own space, the one after that is reset
+  begin_frame(alloc);
+  ASSERT_NE(allocate(alloc, 1 * Kb).ptr, nullptr);
+  begin_frame(alloc);
+  ASSERT_NE(allocate(alloc, 1 * Kb).ptr, nullptr);
+
+  destroy(alloc);
+}
+
+TEST(memory, frame_arena_allocator_dealloc_current_frame_only) {
+
+  frame_arena_create_info_t create_info{nullptr, 256, alignment_t::b16, 2};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  // fills the first frame to its very end
+  memblk old_blk = allocate(alloc, 256);
+  begin_frame(alloc);
+
+  // the old block ends where the empty current frame starts, freeing it
+  // must not move the current top back into the old frame
+  deallocate(alloc, old_blk);
+  memblk blk = allocate(alloc, 16);
+  ASSERT_EQ(static_cast<char *>(blk.ptr),
+            static_cast<char *>(old_blk.ptr) + 256);
+
+  deallocate(alloc, blk);
+  ASSERT_EQ(allocate(alloc, 16).ptr, blk.ptr);
+
+  memblk blks[4];
+  ASSERT_EQ(allocate_n(alloc, 16, 4, blks), 4);
+  deallocate_n(alloc, blks, 4);
+  ASSERT_EQ(allocate(alloc, 16).ptr, blks[0].ptr);
+
+  destroy(alloc);
+}
+
+TEST(memory, frame_arena_allocator_from_parent) {
+
+  stack_alloc_create_info_t parent_info{nullptr, 64 * Kb, alignment_t::b64};
+  allocator_t *parent = fastware::memory::create(&parent_info);
+
+  frame_arena_create_info_t create_info{parent, 4 * Kb, alignment_t::b64, 3};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blk = allocate(alloc, 64);
+  ASSERT_TRUE(owns(parent, blk));
+
+  deallocate_all(alloc);
+  ASSERT_EQ(allocate(alloc, 64).ptr, blk.ptr);
+
+  destroy(alloc);
+
+  // the arena went back to the parent
+  memblk whole = allocate(parent, 64 * Kb);
+  ASSERT_NE(whole.ptr, nullptr);
+
+  destroy(parent);
+}
@@ -0,0 +1,153 @@
+#include <fastware/memory.h>
+#include <gtest/gtest.h>
+
+using namespace fastware::memory;
+
+TEST(memory, page_map_finds_innermost_owner) {
+
+  tlsf_alloc_create_info_t tlsf_info{nullptr, 1 * Mb, alignment_t::b16};
+  allocator_t *tlsf = fastware::memory::create(&tlsf_info);
+
+  // small enough to share pages with each other and the heap
+  pool_alloc_create_info_t pool_info{tlsf, 32, alignment_t::b16, 16};
+  allocator_t *pool = fastware::memory::create(&pool_info);
+  memblk heap_blk = allocate(tlsf, 100);
+  allocator_t *other_pool = fastware::memory::create(&pool_info);
+
+  // whole pages of its own
+  stack_alloc_create_info_t stack_info{tlsf, 64 * Kb, alignment_t::b16};
+  allocator_t *stack = fastware::memory::create(&stack_info);
+
+  memblk pool_blk = allocate(pool, 32);
+  memblk other_blk = allocate(other_pool, 32);
+  memblk stack_blk = allocate(stack, 32 * Kb);
+  ASSERT_EQ(owner_of(pool_blk.ptr), pool);
+  ASSERT_EQ(owner_of(other_blk.ptr), other_pool);
+  ASSERT_EQ(owner_of(heap_blk.ptr), tlsf);
+  ASSERT_EQ(owner_of(stack_blk.ptr), stack);
+  ASSERT_EQ(owner_of(static_cast<char *>(stack_blk.ptr) + 16 * Kb), stack);
+
+  int on_the_stack = 0;
+  ASSERT_EQ(owner_of(&on_the_stack), nullptr);
+
+  // the block goes back to its pool and comes out first again
+  fastware::memory::free(pool_blk);
+  ASSERT_EQ(allocate(pool, 32).ptr, pool_blk.ptr);
+
+  // the pages go back to the heap with the allocators
+  destroy(stack);
+  ASSERT_EQ(owner_of(static_cast<char *>(stack_blk.ptr) + 16 * Kb), tlsf);
+  destroy(pool);
+  ASSERT_EQ(owner_of(pool_blk.ptr), tlsf);
+  ASSERT_EQ(owner_of(other_blk.ptr), other_pool);
+
+  fastware::memory::free(heap_blk);
+  destroy(other_pool);
+  destroy(tlsf);
+  ASSERT_EQ(owner_of(heap_blk.ptr), nullptr);
+}
+
+TEST(memory, page_map_slab_and_thread_cache_take_over_pools) {
+
+  slab_alloc_create_info_t slab_info{nullptr, 16, 256, 16 * Kb};
+  allocator_t *slab = fastware::memory::create(&slab_info);
+
+  memblk small = allocate(slab, 16);
+  memblk large = allocate(slab, 200);
+  ASSERT_EQ(owner_of(small.ptr), slab);
+  ASSERT_EQ(owner_of(large.ptr), slab);
+  fastware::memory::free(large);
+  ASSERT_EQ(allocate(slab, 256).ptr, large.ptr);
+  destroy(slab);
+
+  pool_alloc_create_info_t pool_info{nullptr, 64, alignment_t::b64, 1024,
+                                     pool_flags_t::concurrent};
+  allocator_t *pool = fastware::memory::create(&pool_info);
+  thread_cache_create_info_t cache_info{nullptr, pool, 16};
+  allocator_t *cache = fastware::memory::create(&cache_info);
+
+  memblk blk = allocate(cache, 64);
+  ASSERT_EQ(owner_of(blk.ptr), cache);
+  // into the magazine of this thread, next out of it
+  fastware::memory::free(blk);
+  ASSERT_EQ(allocate(cache, 64).ptr, blk.ptr);
+
+  destroy(cache);
+  ASSERT_EQ(owner_of(blk.ptr), pool);
+
+  destroy(pool);
+}
+
+TEST(memory, page_map_frees_through_composites) {
+
+  stack_alloc_create_info_t root_info{nullptr, Gb, alignment_t::b64,
+                                      stack_flags_t::virtual_memory};
+  allocator_t *root = fastware::memory::create(&root_info);
+
+  stack_alloc_create_info_t stack_info{root, 1 * Kb, alignment_t::b16};
+  allocator_t *stack = fastware::memory::create(&stack_info);
+  tlsf_alloc_create_info_t tlsf_info{root, 64 * Kb, alignment_t::b16};
+  allocator_t *tlsf = fastware::memory::create(&tlsf_info);
+
+  fallback_alloc_create_info_t create_info{root, stack, tlsf};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk first = allocate(alloc, 1 * Kb);
+  memblk second = allocate(alloc, 1 * Kb);
+  ASSERT_EQ(owner_of(first.ptr), stack);
+  ASSERT_EQ(owner_of(second.ptr), tlsf);
+
+  // far into the reservation of the root
+  memblk big = allocate(root, 256 * Mb);
+  ASSERT_EQ(owner_of(static_cast<char *>(big.ptr) + 200 * Mb), root);
+
+  fastware::memory::free(first);
+  fastware::memory::free(second);
+  ASSERT_EQ(allocate(stack, 1 * Kb).ptr, first.ptr);
+  ASSERT_EQ(allocate(tlsf, 60 * Kb).size, 60 * Kb);
+
+  destroy(alloc);
+  destroy(tlsf);
+  destroy(stack);
+  destroy(root);
+}
+
+TEST(memory, page_map_many_owners_on_a_page) {
+
+  tlsf_alloc_create_info_t tlsf_info{nullptr, 64 * Kb, alignment_t::b16};
+  allocator_t *tlsf = fastware::memory::create(&tlsf_info);
+
+  // a few blocks each, more pools on a page than its list holds
+  constexpr uint64_t pool_count{48};
+  allocator_t *pools[pool_count];
+  memblk blks[pool_count];
+  for (uint64_t i = 0; i < pool_count; i++) {
+    pool_alloc_create_info_t pool_info{tlsf, 16, alignment_t::b16, 2};
+    pools[i] = fastware::memory::create(&pool_info);
+    ASSERT_NE(pools[i], nullptr);
+    blks[i] = allocate(pools[i], 16);
+  }
+  memblk heap_blk = allocate(tlsf, 16);
+
+  for (uint64_t i = 0; i < pool_count; i++) {
+    ASSERT_EQ(owner_of(blks[i].ptr), pools[i]);
+  }
+  ASSERT_EQ(owner_of(heap_blk.ptr), tlsf);
+
+  // every other one gone, their pages go back to the heap
+  for (uint64_t i = 0; i < pool_count; i += 2) {
+    destroy(pools[i]);
+  }
+  for (uint64_t i = 0; i < pool_count; i++) {
+    ASSERT_EQ(owner_of(blks[i].ptr), i % 2 ? pools[i] : tlsf);
+  }
+
+  for (uint64_t i = 1; i < pool_count; i += 2) {
+    fastware::memory::free(blks[i]);
+    ASSERT_EQ(allocate(pools[i], 16).ptr, blks[i].ptr);
+    destroy(pools[i]);
+    ASSERT_EQ(owner_of(blks[i].ptr), tlsf);
+  }
+  fastware::memory::free(heap_blk);
+  destroy(tlsf);
+}
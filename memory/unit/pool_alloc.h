@@ -1,6 +1,9 @@
 #include <fastware/memory.h>
+#include <fastware/typed_allocator.h>
 #include <gtest/gtest.h>
 
+#include <cstring>
+
 using namespace fastware::memory;
 
 TEST(memory, pool_allocator_create) {
@@ -123,3 +126,217 @@ TEST(memory, pool_allocator_aligned_alloc_dealloc) {
 
   destroy(alloc);
 }
+
+TEST(memory, pool_allocator_backing) {
+
+  const uint64_t flag_sets[]{pool_flags_t::none, pool_flags_t::concurrent};
+
+  for (uint64_t flags : flag_sets) {
+    pool_alloc_create_info_t create_info{
+        nullptr, 64, alignment_t::b64, 1024, flags,
+        backing_flags_t::transparent_huge_pages | backing_flags_t::populate};
+
+    allocator_t *alloc = fastware::memory::create(&create_info);
+
+    ASSERT_NE(alloc, nullptr);
+
+    for (int i = 0; i < 1024; i++) {
+      memblk blk = allocate(alloc, 64);
+      ASSERT_NE(blk.ptr, nullptr);
+      ASSERT_TRUE(is_aligned(blk.ptr, alignment_t::b64));
+    }
+
+    destroy(alloc);
+  }
+}
+
+TEST(memory, pool_allocator_allocate_n) {
+
+  pool_alloc_create_info_t create_info{nullptr, 64, alignment_t::b64, 16};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk first[10];
+  memblk second[10];
+  ASSERT_EQ(allocate_n(alloc, 64, 10, first), 10);
+  ASSERT_EQ(allocate_n(alloc, 64, 10, second), 6);
+  ASSERT_EQ(allocate(alloc, 64).ptr, nullptr);
+
+  for (uint64_t i = 0; i < 10; i++) {
+    ASSERT_EQ(first[i].size, 64);
+    ASSERT_TRUE(owns(alloc, first[i]));
+    for (uint64_t j = 0; j < 6; j++) {
+      ASSERT_NE(first[i].ptr, second[j].ptr);
+    }
+  }
+
+  // spliced back as one chain, handed out again in the same order
+  deallocate_n(alloc, first, 10);
+  memblk again[10];
+  ASSERT_EQ(allocate_n(alloc, 64, 10, again), 10);
+  for (uint64_t i = 0; i < 10; i++) {
+    ASSERT_EQ(again[i].ptr, first[i].ptr);
+  }
+
+  deallocate_n(alloc, second, 6);
+  deallocate_n(alloc, again, 10);
+  memblk all[20];
+  ASSERT_EQ(allocate_n(alloc, 64, 20, all), 16);
+
+  destroy(alloc);
+}
+
+TEST(memory, pool_allocator_block_index_reciprocal) {
+
+  for (uint64_t block_size = 8; block_size <= 4 * Kb; block_size += 8) {
+    const uint64_t shift = __builtin_ctzl(block_size);
+    const uint64_t reciprocal = block_reciprocal(block_size);
+    ASSERT_EQ(reciprocal == 0, (block_size & (block_size - 1)) == 0);
+
+    for (uint64_t index : {0ul, 1ul, 2ul, 1000ul, 199999ul, 1ul << 20,
+                           (1ul << 32) - 1}) {
+      const uint64_t offset =
+          block_offset(index, shift, reciprocal, block_size);
+      ASSERT_EQ(offset, index * block_size);
+      ASSERT_EQ(block_index(offset, shift, reciprocal), index);
+    }
+  }
+}
+
+TEST(memory, pool_allocator_non_power_of_2) {
+
+  constexpr uint64_t block_count = 1000;
+  pool_alloc_create_info_t create_info{nullptr, 72, alignment_t::b8,
+                                       block_count};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  ASSERT_EQ(prefered_size(alloc, 1), 72);
+
+  static memblk blks[block_count];
+  for (memblk &blk : blks) {
+    blk = allocate(alloc, 72);
+    ASSERT_NE(blk.ptr, nullptr);
+    ASSERT_EQ(blk.size, 72);
+    ASSERT_TRUE(is_aligned(blk.ptr, alignment_t::b8));
+    ASSERT_TRUE(owns(alloc, blk));
+  }
+  ASSERT_EQ(allocate(alloc, 72).ptr, nullptr);
+
+  // blocks are packed back to back, 72 bytes apart
+  for (uint64_t i = 1; i < block_count; i++) {
+    ASSERT_EQ(address{.raw = blks[i].ptr} - address{.raw = blks[i - 1].ptr},
+              72);
+  }
+
+  // every block maps back to its own control block
+  for (uint64_t i = 0; i < block_count; i += 2) {
+    deallocate(alloc, blks[i]);
+  }
+  for (uint64_t i = block_count; i > 0; i -= 2) {
+    ASSERT_EQ(allocate(alloc, 72).ptr, blks[i - 2].ptr);
+  }
+  ASSERT_EQ(allocate(alloc, 72).ptr, nullptr);
+
+  deallocate_n(alloc, blks, block_count);
+  memblk again[block_count];
+  ASSERT_EQ(allocate_n(alloc, 72, block_count, again), block_count);
+  for (uint64_t i = 0; i < block_count; i++) {
+    ASSERT_EQ(again[i].ptr, blks[i].ptr);
+  }
+
+  destroy(alloc);
+}
+
+TEST(memory, pool_allocator_lazy_reset) {
+
+  pool_alloc_create_info_t create_info{nullptr, 64, alignment_t::b64, 8};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  // untouched blocks come in address order
+  memblk a = allocate(alloc, 64);
+  memblk b = allocate(alloc, 64);
+  memblk c = allocate(alloc, 64);
+  ASSERT_EQ(address{.raw = b.ptr} - address{.raw = a.ptr}, 64);
+  ASSERT_EQ(address{.raw = c.ptr} - address{.raw = b.ptr}, 64);
+
+  // freed blocks before untouched ones
+  deallocate(alloc, b);
+  ASSERT_EQ(allocate(alloc, 64).ptr, b.ptr);
+  ASSERT_EQ(address{.raw = allocate(alloc, 64).ptr} - address{.raw = c.ptr},
+            64);
+
+  deallocate(alloc, a);
+  memblk blks[8];
+  ASSERT_EQ(allocate_n(alloc, 64, 8, blks), 5);
+  ASSERT_EQ(blks[0].ptr, a.ptr);
+  ASSERT_EQ(allocate(alloc, 64).ptr, nullptr);
+
+  // every block is handed out once more after a reset
+  deallocate_all(alloc);
+  ASSERT_EQ(allocate(alloc, 64).ptr, a.ptr);
+  ASSERT_EQ(allocate_n(alloc, 64, 8, blks), 7);
+  for (uint64_t i = 0; i < 7; i++) {
+    ASSERT_EQ(address{.raw = blks[i].ptr} - address{.raw = a.ptr},
+              (i + 1) * 64);
+  }
+  ASSERT_EQ(allocate(alloc, 64).ptr, nullptr);
+
+  destroy(alloc);
+}
+
+TEST(memory, pool_allocator_trim) {
+
+  constexpr uint64_t block_count = 1024;
+  pool_alloc_create_info_t create_info{nullptr, 64, alignment_t::b64,
+                                       block_count};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  static memblk blks[block_count];
+  for (memblk &blk : blks) {
+    blk = allocate(alloc, 64);
+    memset(blk.ptr, 0xAB, 64);
+  }
+  ASSERT_EQ(trim(alloc), 0);
+
+  // the middle 8 Kb hold whole free pages, the first page still a live block
+  for (uint64_t i = 0; i < 10; i++) {
+    deallocate(alloc, blks[i]);
+  }
+  for (uint64_t i = 191; i >= 64; i--) {
+    deallocate(alloc, blks[i]);
+  }
+  ASSERT_GE(trim(alloc), 4 * Kb);
+  ASSERT_EQ(static_cast<unsigned char *>(blks[128].ptr)[0], 0);
+  ASSERT_EQ(static_cast<unsigned char *>(blks[0].ptr)[0], 0xAB);
+  ASSERT_EQ(static_cast<unsigned char *>(blks[63].ptr)[63], 0xAB);
+  ASSERT_EQ(static_cast<unsigned char *>(blks[192].ptr)[0], 0xAB);
+
+  // the list was sorted by address
+  ASSERT_EQ(allocate(alloc, 64).ptr, blks[0].ptr);
+  ASSERT_EQ(allocate(alloc, 64).ptr, blks[1].ptr);
+
+  // free blocks at the end become untouched again
+  for (uint64_t i = 512; i < block_count; i++) {
+    deallocate(alloc, blks[i]);
+  }
+  ASSERT_GE(trim(alloc), 28 * Kb);
+  for (uint64_t i = 2; i < 10; i++) {
+    ASSERT_EQ(allocate(alloc, 64).ptr, blks[i].ptr);
+  }
+  for (uint64_t i = 64; i < 192; i++) {
+    ASSERT_EQ(allocate(alloc, 64).ptr, blks[i].ptr);
+  }
+  for (uint64_t i = 512; i < block_count; i++) {
+    ASSERT_EQ(allocate(alloc, 64).ptr, blks[i].ptr);
+  }
+  ASSERT_EQ(allocate(alloc, 64).ptr, nullptr);
+
+  // nearly everything after a reset
+  deallocate_all(alloc);
+  ASSERT_GE(trim(alloc), block_count * 64 - 4 * Kb);
+
+  destroy(alloc);
+}
@@ -0,0 +1,219 @@
+#include <fastware/memory.h>
+#include <fastware/typed_allocator.h>
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+using namespace fastware::memory;
+
+TEST(memory, reallocate_stack_top_in_place) {
+
+  stack_alloc_create_info_t create_info{nullptr, 1 * Kb, alignment_t::b16};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blk = allocate(alloc, 100);
+  ASSERT_EQ(blk.size, 112);
+
+  ASSERT_TRUE(expand(alloc, &blk, 10));
+  ASSERT_EQ(blk.size, 128);
+
+  memblk grown = reallocate(alloc, blk, 500);
+  ASSERT_EQ(grown.ptr, blk.ptr);
+  ASSERT_EQ(grown.size, 512);
+
+  // never past the end of the stack
+  ASSERT_FALSE(expand(alloc, &grown, 1 * Kb));
+  ASSERT_EQ(grown.size, 512);
+
+  // shrinking keeps the block as it is
+  ASSERT_EQ(reallocate(alloc, grown, 16).size, 512);
+
+  deallocate(alloc, grown);
+  ASSERT_EQ(allocate(alloc, 1 * Kb).ptr, blk.ptr);
+
+  destroy(alloc);
+}
+
+TEST(memory, reallocate_stack_moves_below_top) {
+
+  stack_alloc_create_info_t create_info{nullptr, 1 * Kb, alignment_t::b16};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blk = allocate(alloc, 64);
+  memset(blk.ptr, 0x5A, blk.size);
+  memblk top = allocate(alloc, 64);
+
+  ASSERT_FALSE(expand(alloc, &blk, 16));
+  ASSERT_EQ(blk.size, 64);
+
+  memblk moved = reallocate(alloc, blk, 128);
+  ASSERT_NE(moved.ptr, blk.ptr);
+  ASSERT_GT(moved.ptr, top.ptr);
+  ASSERT_EQ(moved.size, 128);
+  for (int i = 0; i < 64; i++) {
+    ASSERT_EQ(static_cast<unsigned char *>(moved.ptr)[i], 0x5A);
+  }
+
+  // out of memory leaves the block where it was
+  ASSERT_EQ(reallocate(alloc, moved, 2 * Kb).ptr, nullptr);
+  ASSERT_TRUE(expand(alloc, &moved, 16));
+
+  destroy(alloc);
+}
+
+TEST(memory, reallocate_typed_stack) {
+
+  stack_alloc_create_info_t create_info{nullptr, 1 * Kb, alignment_t::b16};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+  auto stack = typed_allocator<stack_allocator_t>::from(alloc);
+
+  memblk blk = stack.allocate(32);
+  ASSERT_TRUE(stack.expand(&blk, 32));
+  ASSERT_EQ(blk.size, 64);
+
+  memblk blk2 = stack.allocate(32);
+  ASSERT_FALSE(stack.expand(&blk, 32));
+  ASSERT_TRUE(stack.expand(&blk2, 32));
+
+  destroy(alloc);
+}
+
+TEST(memory, reallocate_virtual_stack_commits) {
+
+  stack_alloc_create_info_t create_info{nullptr, Gb, alignment_t::b64,
+                                        stack_flags_t::virtual_memory};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blk = allocate(alloc, 17);
+  // well past the first commit
+  ASSERT_TRUE(expand(alloc, &blk, 3 * Mb));
+  ASSERT_EQ(blk.size, 64 + 3 * Mb);
+  memset(blk.ptr, 0xCD, blk.size);
+
+  destroy(alloc);
+}
+
+TEST(memory, reallocate_concurrent_stack_chunk_top) {
+
+  stack_alloc_create_info_t create_info{nullptr,
+                                        4 * Kb,
+                                        alignment_t::b16,
+                                        stack_flags_t::concurrent,
+                                        backing_flags_t::none,
+                                        256};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blk = allocate(alloc, 16);
+  ASSERT_TRUE(expand(alloc, &blk, 64));
+  ASSERT_EQ(blk.size, 80);
+
+  // not beyond the thread's chunk
+  ASSERT_FALSE(expand(alloc, &blk, 256));
+
+  memblk next = allocate(alloc, 16);
+  ASSERT_EQ(static_cast<char *>(next.ptr), static_cast<char *>(blk.ptr) + 80);
+
+  // the large block sits on the shared top
+  memblk large = allocate(alloc, 1 * Kb);
+  ASSERT_TRUE(expand(alloc, &large, 1 * Kb));
+  ASSERT_EQ(large.size, 2 * Kb);
+
+  destroy(alloc);
+}
+
+TEST(memory, reallocate_pool_within_block) {
+
+  pool_alloc_create_info_t create_info{nullptr, 48, alignment_t::b16, 4};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blk = allocate(alloc, 48);
+  // a block handed out with less than its block size grows up to it
+  memblk small{blk.ptr, 20};
+  ASSERT_TRUE(expand(alloc, &small, 28));
+  ASSERT_EQ(small.size, 48);
+  ASSERT_FALSE(expand(alloc, &small, 1));
+
+  ASSERT_EQ(reallocate(alloc, {blk.ptr, 40}, 48).ptr, blk.ptr);
+
+  deallocate(alloc, blk);
+  destroy(alloc);
+}
+
+TEST(memory, reallocate_slab_within_class) {
+
+  slab_alloc_create_info_t create_info{nullptr, 16, 256, 4 * Kb};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blk = allocate(alloc, 100);
+  memset(blk.ptr, 0x11, 100);
+  ASSERT_EQ(blk.size, 128);
+  ASSERT_FALSE(expand(alloc, &blk, 1));
+
+  // a bigger class is a new block
+  memblk moved = reallocate(alloc, blk, 200);
+  ASSERT_NE(moved.ptr, blk.ptr);
+  ASSERT_EQ(moved.size, 256);
+  ASSERT_EQ(static_cast<unsigned char *>(moved.ptr)[99], 0x11);
+
+  ASSERT_EQ(allocate(alloc, 128).ptr, blk.ptr);
+
+  destroy(alloc);
+}
+
+TEST(memory, reallocate_tlsf_into_free_neighbour) {
+
+  tlsf_alloc_create_info_t create_info{nullptr, 4 * Kb, alignment_t::b16};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blk = allocate(alloc, 64);
+  memblk next = allocate(alloc, 256);
+  memblk fence = allocate(alloc, 64);
+
+  ASSERT_FALSE(expand(alloc, &blk, 64));
+
+  deallocate(alloc, next);
+  ASSERT_TRUE(expand(alloc, &blk, 64));
+  ASSERT_EQ(blk.size, 128);
+
+  // the rest of the neighbour is still free
+  memblk rest = allocate(alloc, 128);
+  ASSERT_GT(rest.ptr, blk.ptr);
+  ASSERT_LT(rest.ptr, fence.ptr);
+
+  // and the whole neighbour when the rest would be too small to keep
+  deallocate(alloc, rest);
+  ASSERT_TRUE(expand(alloc, &blk, 208));
+  ASSERT_EQ(blk.size, 64 + 256 + 16);
+
+  deallocate(alloc, fence);
+  deallocate(alloc, blk);
+
+  // everything coalesced back
+  ASSERT_NE(allocate(alloc, 3 * Kb).ptr, nullptr);
+
+  destroy(alloc);
+}
+
+TEST(memory, reallocate_affix_moves_suffix) {
+
+  stack_alloc_create_info_t stack_info{nullptr, 1 * Kb, alignment_t::b16};
+  allocator_t *stack = fastware::memory::create(&stack_info);
+
+  affix_alloc_create_info_t create_info{
+      nullptr, stack, affix_flags_t::size | affix_flags_t::canary,
+      alignment_t::b16};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blk = allocate(alloc, 24);
+  ASSERT_TRUE(expand(alloc, &blk, 64));
+  ASSERT_GE(blk.size, 24 + 64);
+  ASSERT_EQ(affix_size(alloc, blk.ptr), blk.size);
+  memset(blk.ptr, 0xff, blk.size);
+
+  // the canaries are where the grown block expects them
+  deallocate(alloc, {blk.ptr, 0});
+  ASSERT_EQ(allocate(stack, 1 * Kb).size, 1 * Kb);
+
+  destroy(alloc);
+  destroy(stack);
+}
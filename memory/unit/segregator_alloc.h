@@ -0,0 +1,113 @@
+#include <fastware/memory.h>
+#include <gtest/gtest.h>
+
+using namespace fastware::memory;
+
+TEST(memory, segregator_allocator_create) {
+
+  slab_alloc_create_info_t slab_info{nullptr, 16, 128, 4 * Kb};
+  allocator_t *slab = fastware::memory::create(&slab_info);
+
+  tlsf_alloc_create_info_t tlsf_info{nullptr, 64 * Kb, alignment_t::b16};
+  allocator_t *tlsf = fastware::memory::create(&tlsf_info);
+
+  segregator_alloc_create_info_t create_info{nullptr, 128, slab, tlsf};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  ASSERT_NE(alloc, nullptr);
+  ASSERT_EQ(prefered_size(alloc, 100), 128);
+  ASSERT_EQ(prefered_size(alloc, 200), prefered_size(tlsf, 200));
+
+  destroy(alloc);
+  destroy(tlsf);
+  destroy(slab);
+}
+
+TEST(memory, segregator_allocator_routes_by_size) {
+
+  slab_alloc_create_info_t slab_info{nullptr, 16, 128, 4 * Kb};
+  allocator_t *slab = fastware::memory::create(&slab_info);
+
+  tlsf_alloc_create_info_t tlsf_info{nullptr, 64 * Kb, alignment_t::b16};
+  allocator_t *tlsf = fastware::memory::create(&tlsf_info);
+
+  segregator_alloc_create_info_t create_info{nullptr, 128, slab, tlsf};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk small = allocate(alloc, 128);
+  ASSERT_EQ(small.size, 128);
+  ASSERT_TRUE(owns(slab, small));
+
+  memblk large = allocate(alloc, 129);
+  ASSERT_NE(large.ptr, nullptr);
+  ASSERT_TRUE(owns(tlsf, large));
+  ASSERT_FALSE(owns(slab, large));
+
+  ASSERT_TRUE(owns(alloc, small));
+  ASSERT_TRUE(owns(alloc, large));
+
+  deallocate(alloc, large);
+  deallocate(alloc, small);
+
+  ASSERT_EQ(allocate(alloc, 128).ptr, small.ptr);
+  ASSERT_EQ(allocate(alloc, 129).ptr, large.ptr);
+
+  destroy(alloc);
+  destroy(tlsf);
+  destroy(slab);
+}
+
+TEST(memory, segregator_allocator_small_block_over_threshold) {
+
+  slab_alloc_create_info_t slab_info{nullptr, 16, 128, 4 * Kb};
+  allocator_t *slab = fastware::memory::create(&slab_info);
+
+  tlsf_alloc_create_info_t tlsf_info{nullptr, 64 * Kb, alignment_t::b16};
+  allocator_t *tlsf = fastware::memory::create(&tlsf_info);
+
+  segregator_alloc_create_info_t create_info{nullptr, 100, slab, tlsf};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  // rounded up past the threshold by the slab, still freed to the slab
+  memblk blk = allocate(alloc, 100);
+  ASSERT_EQ(blk.size, 128);
+  ASSERT_TRUE(owns(slab, blk));
+
+  deallocate(alloc, blk);
+  ASSERT_EQ(allocate(slab, 128).ptr, blk.ptr);
+
+  destroy(alloc);
+  destroy(tlsf);
+  destroy(slab);
+}
+
+TEST(memory, segregator_allocator_alloc_n) {
+
+  pool_alloc_create_info_t pool_info{nullptr, 32, alignment_t::b32, 8};
+  allocator_t *pool = fastware::memory::create(&pool_info);
+
+  stack_alloc_create_info_t stack_info{nullptr, 4 * Kb, alignment_t::b16};
+  allocator_t *stack = fastware::memory::create(&stack_info);
+
+  segregator_alloc_create_info_t create_info{nullptr, 32, pool, stack};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk small[8];
+  ASSERT_EQ(allocate_n(alloc, 32, 10, small), 8);
+
+  memblk large[4];
+  ASSERT_EQ(allocate_n(alloc, 64, 4, large), 4);
+  for (const memblk &blk : large) {
+    ASSERT_TRUE(owns(stack, blk));
+  }
+
+  deallocate_n(alloc, large, 4);
+  deallocate_n(alloc, small, 8);
+
+  ASSERT_EQ(allocate(stack, 4 * Kb).size, 4 * Kb);
+  ASSERT_EQ(allocate_n(pool, 32, 8, small), 8);
+
+  destroy(alloc);
+  destroy(stack);
+  destroy(pool);
+}
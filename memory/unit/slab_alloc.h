@@ -0,0 +1,112 @@
+#include <fastware/memory.h>
+#include <gtest/gtest.h>
+
+using namespace fastware::memory;
+
+TEST(memory, slab_allocator_create) {
+
+  slab_alloc_create_info_t create_info{nullptr, 16, 4 * Kb, 64 * Kb};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  ASSERT_NE(alloc, nullptr);
+
+  destroy(alloc);
+}
+
+TEST(memory, slab_allocator_size_classes) {
+
+  slab_alloc_create_info_t create_info{nullptr, 16, 4 * Kb, 64 * Kb};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  ASSERT_EQ(prefered_size(alloc, 0), 0);
+  ASSERT_EQ(prefered_size(alloc, 1), 16);
+  ASSERT_EQ(prefered_size(alloc, 16), 16);
+  ASSERT_EQ(prefered_size(alloc, 17), 32);
+  ASSERT_EQ(prefered_size(alloc, 129), 256);
+  ASSERT_EQ(prefered_size(alloc, 4 * Kb), 4 * Kb);
+  ASSERT_EQ(prefered_size(alloc, 4 * Kb + 1), 0);
+
+  for (uint64_t size : {1, 16, 17, 72, 129, 1000, 4096}) {
+    memblk blk = allocate(alloc, size);
+
+    ASSERT_NE(blk.ptr, nullptr);
+    ASSERT_EQ(blk.size, prefered_size(alloc, size));
+    ASSERT_TRUE(is_aligned(blk.ptr, alignment_t::b16));
+    ASSERT_TRUE(owns(alloc, blk));
+
+    deallocate(alloc, blk);
+  }
+
+  memblk blk = allocate(alloc, 4 * Kb + 1);
+  ASSERT_EQ(blk.size, 0);
+  ASSERT_EQ(blk.ptr, nullptr);
+
+  destroy(alloc);
+}
+
+TEST(memory, slab_allocator_aligned_alloc_all_dealloc_all) {
+
+  slab_alloc_create_info_t create_info{nullptr, 16, 4 * Kb, 64 * Kb};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  for (uint64_t i = 0; i < 64 * Kb / 256; i++) {
+    memblk blk = allocate(alloc, 200);
+    ASSERT_EQ(blk.size, 256);
+    ASSERT_TRUE(is_aligned(blk.ptr, alignment_t::b64));
+  }
+
+  // only the 256 byte class ran dry
+  ASSERT_EQ(allocate(alloc, 200).ptr, nullptr);
+  ASSERT_NE(allocate(alloc, 100).ptr, nullptr);
+
+  deallocate_all(alloc);
+
+  ASSERT_NE(allocate(alloc, 200).ptr, nullptr);
+
+  destroy(alloc);
+}
+
+TEST(memory, slab_allocator_aligned_alloc_dealloc) {
+
+  stack_alloc_create_info_t root_info{nullptr, 4 * Mb, alignment_t::b64};
+  allocator_t *root = fastware::memory::create(&root_info);
+
+  slab_alloc_create_info_t create_info{root, 16, 4 * Kb, 64 * Kb};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blk = allocate(alloc, 40);
+  memblk blk2 = allocate(alloc, 3000);
+  ASSERT_EQ(blk.size, 64);
+  ASSERT_EQ(blk2.size, 4 * Kb);
+  ASSERT_TRUE(owns(root, blk));
+  ASSERT_TRUE(owns(root, blk2));
+
+  deallocate(alloc, blk);
+
+  memblk blk3 = allocate(alloc, 33);
+  ASSERT_EQ(blk3.ptr, blk.ptr);
+
+  destroy(alloc);
+  destroy(root);
+}
+
+TEST(memory, slab_allocator_trim) {
+
+  slab_alloc_create_info_t create_info{nullptr, 16, 4 * Kb, 64 * Kb};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  // nothing handed out yet, every class pool is untouched
+  const uint64_t untouched = trim(alloc);
+  ASSERT_GT(untouched, 0);
+
+  memblk blk = allocate(alloc, 4 * Kb);
+  ASSERT_NE(blk.ptr, nullptr);
+  ASSERT_EQ(trim(alloc), untouched - 4 * Kb);
+
+  destroy(alloc);
+}
@@ -0,0 +1,177 @@
+#include <fastware/memory.h>
+#include <fastware/slot_map.h>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+using namespace fastware::memory;
+
+TEST(memory, slot_map_create) {
+
+  stack_alloc_create_info_t create_info{nullptr, 4 * Kb, alignment_t::b16};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  auto map = slot_map_t<uint64_t>::create(alloc, 64);
+  ASSERT_TRUE(map.valid());
+  ASSERT_EQ(map.count, 0);
+  ASSERT_TRUE(is_aligned(map.values, alignment_t::b8));
+  ASSERT_EQ(map.get(null_slot_handle), nullptr);
+
+  // not enough room left on the stack
+  auto too_big = slot_map_t<uint64_t>::create(alloc, 1024);
+  ASSERT_FALSE(too_big.valid());
+  ASSERT_EQ(too_big.insert(1), null_slot_handle);
+
+  map.destroy();
+  ASSERT_EQ(allocate(alloc, 4 * Kb).size, 4 * Kb);
+
+  destroy(alloc);
+}
+
+TEST(memory, slot_map_insert_get_erase) {
+
+  tlsf_alloc_create_info_t create_info{nullptr, 4 * Kb, alignment_t::b16};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+  auto map = slot_map_t<int>::create(alloc, 4);
+
+  slot_handle_t a = map.insert(1);
+  slot_handle_t b = map.insert(2);
+  slot_handle_t c = map.insert(3);
+  ASSERT_NE(a, null_slot_handle);
+  ASSERT_EQ(*map.get(a), 1);
+  ASSERT_EQ(*map.get(b), 2);
+  ASSERT_EQ(*map.get(c), 3);
+
+  // the last value fills the hole, its handle still finds it
+  ASSERT_TRUE(map.erase(a));
+  ASSERT_EQ(map.count, 2);
+  ASSERT_EQ(map.values[0], 3);
+  ASSERT_EQ(*map.get(c), 3);
+  ASSERT_EQ(map.handle_at(0), c);
+
+  // stale handles are caught, also once the slot is reused
+  ASSERT_EQ(map.get(a), nullptr);
+  ASSERT_FALSE(map.erase(a));
+  slot_handle_t d = map.insert(4);
+  ASSERT_EQ(d.id & slot_index_mask, a.id & slot_index_mask);
+  ASSERT_NE(d, a);
+  ASSERT_EQ(map.get(a), nullptr);
+  ASSERT_EQ(*map.get(d), 4);
+
+  ASSERT_NE(map.insert(5), null_slot_handle);
+  ASSERT_TRUE(map.full());
+  ASSERT_EQ(map.insert(6), null_slot_handle);
+
+  map.clear();
+  ASSERT_EQ(map.count, 0);
+  ASSERT_EQ(map.get(b), nullptr);
+  ASSERT_EQ(map.get(d), nullptr);
+
+  map.destroy();
+  destroy(alloc);
+}
+
+TEST(memory, slot_map_iterates_live_values) {
+
+  tlsf_alloc_create_info_t create_info{nullptr, 64 * Kb, alignment_t::b16};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+  auto map = slot_map_t<uint32_t>::create(alloc, 1000);
+
+  std::vector<slot_handle_t> handles;
+  for (uint32_t i = 0; i < 1000; i++) {
+    handles.push_back(map.insert(i));
+  }
+  for (uint32_t i = 0; i < 1000; i += 2) {
+    ASSERT_TRUE(map.erase(handles[i]));
+  }
+
+  ASSERT_EQ(map.count, 500);
+  uint64_t sum = 0;
+  for (uint32_t value : map) {
+    ASSERT_EQ(value % 2, 1);
+    sum += value;
+  }
+  ASSERT_EQ(sum, 500 * 500);
+
+  for (uint32_t i = 1; i < 1000; i += 2) {
+    ASSERT_EQ(*map.get(handles[i]), i);
+  }
+
+  map.destroy();
+  destroy(alloc);
+}
+
+TEST(memory, slot_map_sort_keeps_handles) {
+
+  tlsf_alloc_create_info_t create_info{nullptr, 64 * Kb, alignment_t::b16};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+  auto map = slot_map_t<uint32_t>::create(alloc, 512);
+
+  std::mt19937 rng(7);
+  std::vector<std::pair<slot_handle_t, uint32_t>> inserted;
+  for (uint32_t i = 0; i < 512; i++) {
+    const uint32_t value = rng();
+    inserted.push_back({map.insert(value), value});
+  }
+  // churn a bit so slots and dense indices no longer line up
+  for (uint32_t i = 0; i < 512; i += 3) {
+    map.erase(inserted[i].first);
+  }
+
+  ASSERT_TRUE(map.sort([](uint32_t lhs, uint32_t rhs) { return lhs < rhs; }));
+
+  ASSERT_TRUE(std::is_sorted(map.begin(), map.end()));
+  for (uint32_t i = 0; i < 512; i++) {
+    const uint32_t *value = map.get(inserted[i].first);
+    if (i % 3 == 0) {
+      ASSERT_EQ(value, nullptr);
+    } else {
+      ASSERT_NE(value, nullptr);
+      ASSERT_EQ(*value, inserted[i].second);
+    }
+  }
+  for (uint32_t i = 0; i < map.count; i++) {
+    ASSERT_EQ(map.get(map.handle_at(i)), &map.values[i]);
+  }
+
+  map.destroy();
+  destroy(alloc);
+}
+
+TEST(memory, slot_map_retires_exhausted_slots) {
+
+  stack_alloc_create_info_t create_info{nullptr, 1 * Kb, alignment_t::b16};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+  auto map = slot_map_t<int>::create(alloc, 2);
+
+  slot_handle_t first = map.insert(0);
+  slot_handle_t other = map.insert(1);
+  map.erase(first);
+  ASSERT_EQ(map.slots[0].generation, 2);
+  // skip ahead to the last generation, 4 billion reuses take too long
+  map.slots[0].generation = max_slot_generation;
+  slot_handle_t last = map.insert(2);
+  ASSERT_EQ(last.id >> slot_index_bits, max_slot_generation);
+  ASSERT_EQ(*map.get(last), 2);
+
+  // the slot is not handed out again, no handle to it finds anything
+  ASSERT_TRUE(map.erase(last));
+  ASSERT_TRUE(map.full());
+  ASSERT_EQ(map.insert(3), null_slot_handle);
+  ASSERT_EQ(map.get(first), nullptr);
+  ASSERT_EQ(map.get(last), nullptr);
+  ASSERT_EQ(map.get(null_slot_handle), nullptr);
+  ASSERT_FALSE(map.erase(last));
+  ASSERT_EQ(*map.get(other), 1);
+
+  // the other slot still cycles
+  map.erase(other);
+  slot_handle_t reused = map.insert(4);
+  ASSERT_EQ(reused.id & slot_index_mask, other.id & slot_index_mask);
+  ASSERT_EQ(map.get(other), nullptr);
+  ASSERT_EQ(*map.get(reused), 4);
+
+  map.destroy();
+  destroy(alloc);
+}
@@ -0,0 +1,139 @@
+#include <fastware/memory.h>
+#include <fastware/soa_vector.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+using namespace fastware::memory;
+
+// Sizes that leave every column with a different tail to pad
+struct soa_normal_t {
+  float m[9];
+};
+
+TEST(memory, soa_vector_columns_aligned) {
+
+  tlsf_alloc_create_info_t create_info{nullptr, 64 * Kb, alignment_t::b16};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  auto vector = soa_vector_t<uint8_t, soa_normal_t, double>::create(alloc, 10);
+  ASSERT_TRUE(vector.valid());
+  ASSERT_EQ(vector.capacity, 10);
+  ASSERT_EQ(vector.count, 0);
+  ASSERT_TRUE(is_aligned(vector.data<0>(), alignment_t::b64));
+  ASSERT_TRUE(is_aligned(vector.data<1>(), alignment_t::b64));
+  ASSERT_TRUE(is_aligned(vector.data<2>(), alignment_t::b64));
+
+  for (uint32_t i = 0; i < 10; i++) {
+    ASSERT_TRUE(vector.push_back(uint8_t(i), {{float(i)}}, i * 0.5));
+  }
+  ASSERT_EQ(vector.capacity, 10);
+  ASSERT_EQ(vector.column<1>().size(), 10);
+  double sum = 0;
+  for (double value : vector.column<2>()) {
+    sum += value;
+  }
+  ASSERT_EQ(sum, 22.5);
+  ASSERT_EQ(vector.column<1>()[7].m[0], 7.0f);
+
+  vector.destroy();
+  ASSERT_FALSE(vector.valid());
+  ASSERT_NE(allocate(alloc, 60 * Kb).ptr, nullptr);
+
+  destroy(alloc);
+}
+
+TEST(memory, soa_vector_grows_keeping_values) {
+
+  // in place on the top of the stack, moved in the heap
+  stack_alloc_create_info_t stack_info{nullptr, 1 * Mb, alignment_t::b8};
+  allocator_t *stack = fastware::memory::create(&stack_info);
+  tlsf_alloc_create_info_t tlsf_info{nullptr, 1 * Mb, alignment_t::b16};
+  allocator_t *tlsf = fastware::memory::create(&tlsf_info);
+
+  for (allocator_t *alloc : {stack, tlsf}) {
+    auto vector =
+        soa_vector_t<uint16_t, soa_normal_t, uint64_t>::create(alloc, 0);
+    ASSERT_FALSE(vector.valid());
+    // something after the first block so the heap has to move it
+    memblk fence{};
+
+    for (uint32_t i = 0; i < 5000; i++) {
+      ASSERT_TRUE(vector.push_back(uint16_t(i), {{float(i), 1.0f}},
+                                   uint64_t(i) * 3));
+      if (i == 0 && alloc == tlsf) {
+        fence = allocate(alloc, 16);
+      }
+      ASSERT_TRUE(is_aligned(vector.data<2>(), alignment_t::b64));
+    }
+    ASSERT_GE(vector.capacity, 5000);
+
+    for (uint32_t i = 0; i < 5000; i++) {
+      ASSERT_EQ(vector.data<0>()[i], uint16_t(i));
+      ASSERT_EQ(vector.data<1>()[i].m[0], float(i));
+      ASSERT_EQ(vector.data<1>()[i].m[1], 1.0f);
+      ASSERT_EQ(vector.data<2>()[i], uint64_t(i) * 3);
+    }
+
+    vector.destroy();
+    if (fence.ptr) {
+      deallocate(alloc, fence);
+    }
+  }
+
+  destroy(tlsf);
+  destroy(stack);
+}
+
+TEST(memory, soa_vector_swap_remove) {
+
+  stack_alloc_create_info_t create_info{nullptr, 4 * Kb, alignment_t::b16};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  auto vector = soa_vector_t<uint32_t, float>::create(alloc, 4);
+  vector.push_back(1, 1.0f);
+  vector.push_back(2, 2.0f);
+  vector.push_back(3, 3.0f);
+
+  vector.swap_remove(0);
+  ASSERT_EQ(vector.count, 2);
+  ASSERT_EQ(vector.data<0>()[0], 3);
+  ASSERT_EQ(vector.data<1>()[0], 3.0f);
+  ASSERT_EQ(vector.data<0>()[1], 2);
+
+  vector.swap_remove(1);
+  ASSERT_EQ(vector.count, 1);
+  ASSERT_EQ(vector.column<1>()[0], 3.0f);
+
+  vector.clear();
+  ASSERT_EQ(vector.count, 0);
+  ASSERT_TRUE(vector.column<0>().empty());
+
+  vector.destroy();
+  destroy(alloc);
+}
+
+TEST(memory, soa_vector_out_of_memory_keeps_values) {
+
+  stack_alloc_create_info_t create_info{nullptr, 1 * Kb, alignment_t::b64};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  auto vector = soa_vector_t<uint64_t, uint32_t>::create(alloc, 16);
+  for (uint32_t i = 0; i < 16; i++) {
+    ASSERT_TRUE(vector.push_back(i, i));
+  }
+  // 32 values would take 128 + 128 bytes, past what the stack holds
+  memblk fence = allocate(alloc, 700);
+  ASSERT_NE(fence.ptr, nullptr);
+  ASSERT_FALSE(vector.push_back(16, 16));
+  ASSERT_EQ(vector.count, 16);
+  ASSERT_EQ(vector.capacity, 16);
+  ASSERT_EQ(vector.data<0>()[15], 15);
+
+  ASSERT_FALSE(vector.resize(64));
+  ASSERT_TRUE(vector.resize(8));
+  ASSERT_EQ(vector.count, 8);
+
+  vector.destroy();
+  destroy(alloc);
+}
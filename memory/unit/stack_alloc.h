@@ -1,6 +1,8 @@
 #include <fastware/memory.h>
 #include <gtest/gtest.h>
 
+#include <cstring>
+
 using namespace fastware::memory;
 
 TEST(memory, stack_allocator_create) {
@@ -123,3 +125,74 @@ TEST(memory, stack_allocator_aligned_alloc_dealloc) {
 
   destroy(alloc);
 }
+
+TEST(memory, stack_allocator_backing) {
+
+  const uint64_t backings[]{
+      backing_flags_t::populate, backing_flags_t::huge_pages,
+      backing_flags_t::transparent_huge_pages | backing_flags_t::populate};
+
+  for (uint64_t backing : backings) {
+    stack_alloc_create_info_t create_info{nullptr, 4 * Mb, alignment_t::b64,
+                                          stack_flags_t::none, backing};
+
+    allocator_t *alloc = fastware::memory::create(&create_info);
+
+    ASSERT_NE(alloc, nullptr);
+
+    memblk blk = allocate(alloc, 3 * Mb);
+    ASSERT_NE(blk.ptr, nullptr);
+    ASSERT_TRUE(is_aligned(blk.ptr, alignment_t::b64));
+    static_cast<char *>(blk.ptr)[blk.size - 1] = 1;
+
+    destroy(alloc);
+  }
+}
+
+TEST(memory, stack_allocator_allocate_n) {
+
+  stack_alloc_create_info_t create_info{nullptr, 1 * Kb, alignment_t::b16};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blks[8];
+  ASSERT_EQ(allocate_n(alloc, 17, 8, blks), 8);
+  for (uint64_t i = 0; i < 8; i++) {
+    ASSERT_EQ(blks[i].size, 32);
+    ASSERT_TRUE(is_aligned(blks[i].ptr, alignment_t::b16));
+    ASSERT_EQ(address{.raw = blks[i].ptr} - address{.raw = blks[0].ptr},
+              i * 32);
+  }
+
+  // the batch pops entirely and the stack starts over
+  deallocate_n(alloc, blks, 8);
+  ASSERT_EQ(allocate(alloc, 17).ptr, blks[0].ptr);
+  deallocate_all(alloc);
+
+  // only as many as fit
+  memblk many[64];
+  ASSERT_EQ(allocate_n(alloc, 100, 64, many), 1 * Kb / 112);
+  ASSERT_EQ(allocate_n(alloc, 100, 64, many), 0);
+
+  destroy(alloc);
+}
+
+TEST(memory, stack_allocator_trim) {
+
+  stack_alloc_create_info_t create_info{nullptr, 64 * Kb, alignment_t::b16,
+                                        stack_flags_t::none,
+                                        backing_flags_t::populate};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blk = allocate(alloc, 64 * Kb);
+  memset(blk.ptr, 0xAB, blk.size);
+  deallocate_all(alloc);
+
+  memblk live = allocate(alloc, 100);
+  ASSERT_GE(trim(alloc), 60 * Kb);
+  ASSERT_EQ(static_cast<unsigned char *>(live.ptr)[0], 0xAB);
+  ASSERT_EQ(static_cast<unsigned char *>(blk.ptr)[32 * Kb], 0);
+
+  destroy(alloc);
+}
@@ -0,0 +1,152 @@
+#include <fastware/memory.h>
+#include <fastware/std_allocator.h>
+#include <gtest/gtest.h>
+
+#include <list>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+using namespace fastware::memory;
+
+TEST(memory, std_allocator_pmr_vector_on_stack) {
+
+  stack_alloc_create_info_t create_info{nullptr, 64 * Kb, alignment_t::b16};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+  fastware::memory::memory_resource resource{alloc};
+
+  {
+    std::pmr::vector<uint64_t> values{&resource};
+    for (uint64_t i = 0; i < 1000; i++) {
+      values.push_back(i);
+    }
+    ASSERT_TRUE(owns(alloc, {{values.data()}, 0}));
+    for (uint64_t i = 0; i < 1000; i++) {
+      ASSERT_EQ(values[i], i);
+    }
+  }
+
+  deallocate_all(alloc);
+  destroy(alloc);
+}
+
+TEST(memory, std_allocator_pmr_unordered_map_on_slab) {
+
+  slab_alloc_create_info_t create_info{nullptr, 16, 16 * Kb, 256 * Kb};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+  fastware::memory::memory_resource resource{alloc};
+
+  {
+    std::pmr::unordered_map<uint64_t, uint64_t> values{&resource};
+    for (uint64_t i = 0; i < 500; i++) {
+      values[i * 7] = i;
+    }
+    for (uint64_t i = 0; i < 500; i += 2) {
+      values.erase(i * 7);
+    }
+    ASSERT_EQ(values.size(), 250);
+    for (uint64_t i = 1; i < 500; i += 2) {
+      ASSERT_EQ(values.at(i * 7), i);
+    }
+  }
+
+  // every node and bucket array went back to its class pool
+  for (uint64_t size = 16; size <= 16 * Kb; size *= 2) {
+    memblk blk = allocate(alloc, size);
+    ASSERT_NE(blk.ptr, nullptr);
+    deallocate(alloc, blk);
+  }
+
+  destroy(alloc);
+}
+
+TEST(memory, std_allocator_list_on_pool) {
+
+  pool_alloc_create_info_t create_info{nullptr, 32, alignment_t::b16, 100};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  {
+    std::list<uint64_t, std_allocator<uint64_t>> values{
+        std_allocator<uint64_t>{alloc}};
+    for (uint64_t i = 0; i < 100; i++) {
+      values.push_back(i);
+    }
+    // every node came from the pool, which is now full
+    ASSERT_EQ(allocate(alloc, 32).ptr, nullptr);
+
+    values.remove_if([](uint64_t value) { return value % 2; });
+    ASSERT_EQ(values.size(), 50);
+    for (uint64_t i = 0; i < 50; i++) {
+      values.push_front(i);
+    }
+  }
+
+  memblk blks[100];
+  ASSERT_EQ(allocate_n(alloc, 32, 100, blks), 100);
+
+  destroy(alloc);
+}
+
+TEST(memory, std_allocator_equality) {
+
+  stack_alloc_create_info_t create_info{nullptr, 1 * Kb, alignment_t::b16};
+
+  allocator_t *first = fastware::memory::create(&create_info);
+  allocator_t *second = fastware::memory::create(&create_info);
+
+  ASSERT_TRUE(std_allocator<uint64_t>{first} == std_allocator<char>{first});
+  ASSERT_FALSE(std_allocator<uint64_t>{first} == std_allocator<char>{second});
+
+  fastware::memory::memory_resource first_resource{first};
+  fastware::memory::memory_resource other_resource{first};
+  ASSERT_TRUE(first_resource.is_equal(first_resource));
+  ASSERT_FALSE(first_resource.is_equal(other_resource));
+  ASSERT_EQ(first_resource.allocator(), other_resource.allocator());
+
+  destroy(second);
+  destroy(first);
+}
+
+TEST(memory, std_allocator_list_on_fallback) {
+
+  pool_alloc_create_info_t primary_info{nullptr, 32, alignment_t::b16, 4};
+  allocator_t *primary = fastware::memory::create(&primary_info);
+
+  pool_alloc_create_info_t pool_info{nullptr, 64, alignment_t::b16, 16,
+                                     pool_flags_t::concurrent};
+  allocator_t *pool = fastware::memory::create(&pool_info);
+  thread_cache_create_info_t cache_info{nullptr, pool, 8};
+  allocator_t *secondary = fastware::memory::create(&cache_info);
+
+  fallback_alloc_create_info_t create_info{nullptr, primary, secondary};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  {
+    std::list<uint64_t, std_allocator<uint64_t>> values{
+        std_allocator<uint64_t>{alloc}};
+    for (uint64_t i = 0; i < 8; i++) {
+      values.push_back(i);
+    }
+    // the nodes past the primary are 64 byte blocks of the secondary
+    ASSERT_EQ(allocate(primary, 32).ptr, nullptr);
+    ASSERT_EQ(allocated_size(alloc, &values.front(), 32), 32);
+    ASSERT_EQ(allocated_size(alloc, &values.back(), 32), 64);
+  }
+
+  destroy(alloc);
+  destroy(secondary);
+
+  // every node went back to where it came from
+  for (int i = 0; i < 4; i++) {
+    ASSERT_NE(allocate(primary, 32).ptr, nullptr);
+  }
+  for (int i = 0; i < 16; i++) {
+    ASSERT_NE(allocate(pool, 64).ptr, nullptr);
+  }
+
+  destroy(pool);
+  destroy(primary);
+}
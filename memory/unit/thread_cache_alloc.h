@@ -0,0 +1,202 @@
+#include <fastware/memory.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace fastware::memory;
+
+TEST(memory, thread_cache_allocator_create) {
+
+  pool_alloc_create_info_t pool_info{nullptr, 32, alignment_t::b32, 32,
+                                     pool_flags_t::concurrent};
+  allocator_t *pool = fastware::memory::create(&pool_info);
+
+  thread_cache_create_info_t create_info{nullptr, pool, 8};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  ASSERT_NE(alloc, nullptr);
+  ASSERT_EQ(prefered_size(alloc, 17), 32);
+
+  destroy(alloc);
+  destroy(pool);
+}
+
+TEST(memory, thread_cache_allocator_aligned_alloc_all) {
+
+  pool_alloc_create_info_t pool_info{nullptr, 32, alignment_t::b32, 32,
+                                     pool_flags_t::concurrent};
+  allocator_t *pool = fastware::memory::create(&pool_info);
+
+  thread_cache_create_info_t create_info{nullptr, pool, 8};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  for (int i = 0; i < 32; i++) {
+    memblk blk = allocate(alloc, 17);
+
+    ASSERT_EQ(blk.size, 32);
+    ASSERT_TRUE(is_aligned(blk.ptr, alignment_t::b32));
+    ASSERT_TRUE(owns(alloc, blk));
+  }
+
+  memblk blk = allocate(alloc, 17);
+  ASSERT_EQ(blk.size, 0);
+  ASSERT_EQ(blk.ptr, nullptr);
+
+  deallocate_all(alloc);
+
+  for (int i = 0; i < 32; i++) {
+    ASSERT_NE(allocate(alloc, 17).ptr, nullptr);
+  }
+
+  destroy(alloc);
+  destroy(pool);
+}
+
+TEST(memory, thread_cache_allocator_aligned_alloc_dealloc) {
+
+  pool_alloc_create_info_t pool_info{nullptr, 32, alignment_t::b32, 32,
+                                     pool_flags_t::concurrent};
+  allocator_t *pool = fastware::memory::create(&pool_info);
+
+  thread_cache_create_info_t create_info{nullptr, pool, 8};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blk = allocate(alloc, 17);
+  memblk blk2 = allocate(alloc, 17);
+  ASSERT_NE(blk.ptr, blk2.ptr);
+
+  deallocate(alloc, blk);
+
+  memblk blk3 = allocate(alloc, 17);
+  ASSERT_EQ(blk3.ptr, blk.ptr);
+
+  deallocate(alloc, blk2);
+  deallocate(alloc, blk3);
+
+  // magazines are flushed back into the pool on destroy
+  destroy(alloc);
+
+  for (int i = 0; i < 32; i++) {
+    ASSERT_NE(allocate(pool, 32).ptr, nullptr);
+  }
+  ASSERT_EQ(allocate(pool, 32).ptr, nullptr);
+
+  destroy(pool);
+}
+
+TEST(memory, thread_cache_allocator_cross_thread_dealloc) {
+
+  constexpr int block_count = 4096;
+  constexpr int pair_count = 4;
+
+  pool_alloc_create_info_t pool_info{nullptr, 64, alignment_t::b64,
+                                     block_count, pool_flags_t::concurrent};
+  allocator_t *pool = fastware::memory::create(&pool_info);
+
+  thread_cache_create_info_t create_info{nullptr, pool, 32};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  struct channel_t {
+    std::atomic<void *> slots[64];
+  };
+  std::vector<channel_t> channels(pair_count);
+  for (auto &channel : channels) {
+    for (auto &slot : channel.slots) {
+      slot.store(nullptr);
+    }
+  }
+
+  constexpr int transfers = 20000;
+  std::vector<std::thread> threads;
+  for (int p = 0; p < pair_count; p++) {
+    threads.emplace_back([&, p] {
+      for (int i = 0; i < transfers; i++) {
+        memblk blk = allocate(alloc, 64);
+        while (blk.ptr == nullptr) {
+          std::this_thread::yield();
+          blk = allocate(alloc, 64);
+        }
+        auto &slot = channels[p].slots[i % 64];
+        while (slot.load(std::memory_order_acquire) != nullptr) {
+          std::this_thread::yield();
+        }
+        slot.store(blk.ptr, std::memory_order_release);
+      }
+    });
+    threads.emplace_back([&, p] {
+      for (int i = 0; i < transfers; i++) {
+        auto &slot = channels[p].slots[i % 64];
+        void *ptr = nullptr;
+        while ((ptr = slot.load(std::memory_order_acquire)) == nullptr) {
+          std::this_thread::yield();
+        }
+        slot.store(nullptr, std::memory_order_release);
+        deallocate(alloc, {ptr, 64});
+      }
+    });
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  destroy(alloc);
+
+  for (int i = 0; i < block_count; i++) {
+    ASSERT_NE(allocate(pool, 64).ptr, nullptr);
+  }
+  ASSERT_EQ(allocate(pool, 64).ptr, nullptr);
+
+  destroy(pool);
+}
+
+TEST(memory, thread_cache_allocator_all_thread_slots) {
+
+  // one more thread than magazines, so at least one goes to the pool
+  constexpr int thread_count = 65;
+
+  // blocks wider than their alignment, so 17 bytes do not align up to one
+  pool_alloc_create_info_t pool_info{nullptr, 64, alignment_t::b16, 1024,
+                                     pool_flags_t::concurrent};
+  allocator_t *pool = fastware::memory::create(&pool_info);
+
+  thread_cache_create_info_t create_info{nullptr, pool, 8};
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  std::vector<memblk> blocks(thread_count);
+  std::atomic_int allocated{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_count; t++) {
+    threads.emplace_back([&, t] {
+      blocks[t] = allocate(alloc, 17);
+      allocated.fetch_add(1);
+      // hold the slot until every thread allocated
+      while (allocated.load() != thread_count) {
+        std::this_thread::yield();
+      }
+      if (blocks[t].ptr) {
+        deallocate(alloc, blocks[t]);
+      }
+    });
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  for (const memblk &blk : blocks) {
+    ASSERT_NE(blk.ptr, nullptr);
+    ASSERT_EQ(blk.size, 64);
+  }
+
+  destroy(alloc);
+
+  for (int i = 0; i < 1024; i++) {
+    ASSERT_NE(allocate(pool, 64).ptr, nullptr);
+  }
+  ASSERT_EQ(allocate(pool, 64).ptr, nullptr);
+
+  destroy(pool);
+}
@@ -0,0 +1,127 @@
+#include <fastware/memory.h>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+using namespace fastware::memory;
+
+TEST(memory, tlsf_allocator_create) {
+
+  tlsf_alloc_create_info_t create_info{nullptr, 64 * Kb, alignment_t::b16};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  ASSERT_NE(alloc, nullptr);
+
+  destroy(alloc);
+}
+
+TEST(memory, tlsf_allocator_aligned_alloc) {
+
+  tlsf_alloc_create_info_t create_info{nullptr, 64 * Kb, alignment_t::b32};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blk = allocate(alloc, 17);
+
+  ASSERT_GE(blk.size, 32);
+  ASSERT_TRUE(is_aligned(blk.ptr, alignment_t::b32));
+  ASSERT_TRUE(owns(alloc, blk));
+
+  destroy(alloc);
+}
+
+TEST(memory, tlsf_allocator_aligned_alloc_all_dealloc_all) {
+
+  tlsf_alloc_create_info_t create_info{nullptr, 64 * Kb, alignment_t::b16};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  int count = 0;
+  memblk blk = allocate(alloc, 48);
+  while (blk.ptr != nullptr) {
+    ASSERT_TRUE(is_aligned(blk.ptr, alignment_t::b16));
+    count++;
+    blk = allocate(alloc, 48);
+  }
+  // 48 byte payload plus 16 byte header
+  ASSERT_EQ(count, 64 * Kb / 64);
+
+  deallocate_all(alloc);
+
+  memblk whole = allocate(alloc, 64 * Kb - 16);
+  ASSERT_NE(whole.ptr, nullptr);
+
+  destroy(alloc);
+}
+
+TEST(memory, tlsf_allocator_dealloc_middle_coalesce) {
+
+  tlsf_alloc_create_info_t create_info{nullptr, 4 * Kb, alignment_t::b16};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blk1 = allocate(alloc, 1000);
+  memblk blk2 = allocate(alloc, 1000);
+  memblk blk3 = allocate(alloc, 1000);
+  ASSERT_NE(blk3.ptr, nullptr);
+
+  // freeing in the middle is reused straight away
+  deallocate(alloc, blk2);
+  memblk blk4 = allocate(alloc, 1000);
+  ASSERT_EQ(blk4.ptr, blk2.ptr);
+
+  // neighbours merge back into a single block
+  deallocate(alloc, blk1);
+  deallocate(alloc, blk3);
+  deallocate(alloc, blk4);
+
+  memblk whole = allocate(alloc, 4 * Kb - 16);
+  ASSERT_NE(whole.ptr, nullptr);
+  ASSERT_EQ(whole.ptr, blk1.ptr);
+
+  destroy(alloc);
+}
+
+TEST(memory, tlsf_allocator_random_alloc_dealloc) {
+
+  stack_alloc_create_info_t root_info{nullptr, 2 * Mb, alignment_t::b64};
+  allocator_t *root = fastware::memory::create(&root_info);
+
+  tlsf_alloc_create_info_t create_info{root, Mb, alignment_t::b64};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  std::mt19937 rng(7);
+  std::vector<memblk> live;
+  for (int i = 0; i < 20000; i++) {
+    if (live.empty() || rng() % 3 != 0) {
+      const uint64_t size = 1 + rng() % 4096;
+      memblk blk = allocate(alloc, size);
+      if (blk.ptr == nullptr) {
+        continue;
+      }
+      ASSERT_GE(blk.size, size);
+      ASSERT_TRUE(is_aligned(blk.ptr, alignment_t::b64));
+      ASSERT_TRUE(owns(root, blk));
+      memset(blk.ptr, 0xAB, blk.size);
+      live.push_back(blk);
+    } else {
+      const uint64_t idx = rng() % live.size();
+      deallocate(alloc, live[idx]);
+      live[idx] = live.back();
+      live.pop_back();
+    }
+  }
+
+  for (auto blk : live) {
+    deallocate(alloc, blk);
+  }
+
+  memblk whole = allocate(alloc, Mb - 64);
+  ASSERT_NE(whole.ptr, nullptr);
+
+  destroy(alloc);
+  destroy(root);
+}
@@ -0,0 +1,75 @@
+#include <fastware/memory.h>
+#include <fastware/typed_allocator.h>
+#include <gtest/gtest.h>
+
+using namespace fastware::memory;
+
+TEST(memory, typed_stack_allocator_matches_erased) {
+
+  stack_alloc_create_info_t create_info{nullptr, 1 * Kb, alignment_t::b16};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+  typed_allocator<stack_allocator_t> typed =
+      typed_allocator<stack_allocator_t>::from(alloc);
+
+  ASSERT_EQ(typed.prefered_size(17), prefered_size(alloc, 17));
+
+  memblk first = typed.allocate(17);
+  memblk second = allocate(alloc, 17);
+
+  ASSERT_NE(first.ptr, nullptr);
+  ASSERT_EQ(first.size, 32);
+  ASSERT_EQ(static_cast<char *>(second.ptr) - static_cast<char *>(first.ptr),
+            32);
+  ASSERT_TRUE(typed.owns(second));
+  ASSERT_TRUE(owns(alloc, first));
+
+  // only the top of the stack can be handed back
+  typed.deallocate(first);
+  ASSERT_EQ(allocate(alloc, 17).ptr,
+            static_cast<char *>(second.ptr) + second.size);
+
+  typed.deallocate_all();
+  ASSERT_EQ(typed.allocate(17).ptr, first.ptr);
+
+  memblk blk = typed.allocate(2 * Kb);
+  ASSERT_EQ(blk.ptr, nullptr);
+  ASSERT_EQ(blk.size, 0);
+
+  destroy(alloc);
+}
+
+TEST(memory, typed_pool_allocator_matches_erased) {
+
+  pool_alloc_create_info_t create_info{nullptr, 64, alignment_t::b64, 4};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+  typed_allocator<pool_allocator_t> typed =
+      typed_allocator<pool_allocator_t>::from(alloc);
+
+  ASSERT_EQ(typed.prefered_size(1), 64);
+  ASSERT_EQ(typed.prefered_size(65), 0);
+
+  memblk blocks[4];
+  for (uint64_t i = 0; i < 4; i++) {
+    // interleave both front-ends on the same free list
+    blocks[i] = i % 2 ? typed.allocate(64) : allocate(alloc, 64);
+    ASSERT_NE(blocks[i].ptr, nullptr);
+    ASSERT_TRUE(is_aligned(blocks[i].ptr, alignment_t::b64));
+    ASSERT_TRUE(typed.owns(blocks[i]));
+  }
+  ASSERT_EQ(typed.allocate(64).ptr, nullptr);
+
+  typed.deallocate(blocks[2]);
+  ASSERT_EQ(allocate(alloc, 64).ptr, blocks[2].ptr);
+
+  deallocate(alloc, blocks[1]);
+  ASSERT_EQ(typed.allocate(64).ptr, blocks[1].ptr);
+
+  typed.deallocate_all();
+  for (uint64_t i = 0; i < 4; i++) {
+    ASSERT_NE(typed.allocate(64).ptr, nullptr);
+  }
+
+  destroy(alloc);
+}
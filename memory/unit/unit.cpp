@@ -1,5 +1,25 @@
+#include "affix_alloc.h"
+#include "allocation_trace.h"
+#include "allocator_stats.h"
+#include "bitmap_pool_alloc.h"
+#include "budget_alloc.h"
+#include "concurrent_pool_alloc.h"
+#include "concurrent_stack_alloc.h"
+#include "fallback_alloc.h"
+#include "frame_arena_alloc.h"
+#include "page_map.h"
 #include "pool_alloc.h"
+#include "reallocate.h"
+#include "segregator_alloc.h"
+#include "slab_alloc.h"
+#include "slot_map.h"
+#include "soa_vector.h"
 #include "stack_alloc.h"
+#include "std_allocator.h"
+#include "thread_cache_alloc.h"
+#include "tlsf_alloc.h"
+#include "typed_alloc.h"
+#include "virtual_stack_alloc.h"
 
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,118 @@
+#include <fastware/memory.h>
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+using namespace fastware::memory;
+
+TEST(memory, virtual_stack_allocator_create) {
+
+  stack_alloc_create_info_t create_info{nullptr, 16 * Gb, alignment_t::b64,
+                                        stack_flags_t::virtual_memory};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  ASSERT_NE(alloc, nullptr);
+
+  destroy(alloc);
+}
+
+TEST(memory, virtual_stack_allocator_grow) {
+
+  stack_alloc_create_info_t create_info{nullptr, Gb, alignment_t::b64,
+                                        stack_flags_t::virtual_memory};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blk = allocate(alloc, 17);
+  ASSERT_EQ(blk.size, 64);
+  ASSERT_TRUE(is_aligned(blk.ptr, alignment_t::b64));
+
+  // well past the first commit
+  memblk big = allocate(alloc, 3 * Mb + 5);
+  ASSERT_NE(big.ptr, nullptr);
+  ASSERT_TRUE(owns(alloc, big));
+  memset(big.ptr, 0xCD, big.size);
+
+  memblk blk2 = allocate(alloc, 17);
+  ASSERT_GT(blk2.ptr, big.ptr);
+  static_cast<char *>(blk2.ptr)[0] = 1;
+
+  destroy(alloc);
+}
+
+TEST(memory, virtual_stack_allocator_aligned_alloc_all_dealloc_all) {
+
+  stack_alloc_create_info_t create_info{nullptr, Mb, alignment_t::b32,
+                                        stack_flags_t::virtual_memory};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  int count = 0;
+  memblk blk = allocate(alloc, 17);
+  while (blk.ptr != nullptr) {
+    ASSERT_EQ(blk.size, 32);
+    ASSERT_TRUE(is_aligned(blk.ptr, alignment_t::b32));
+    count++;
+    blk = allocate(alloc, 17);
+  }
+  ASSERT_GE(count, Mb / 32);
+
+  deallocate_all(alloc);
+
+  memblk blk2 = allocate(alloc, 17);
+  ASSERT_NE(blk2.ptr, nullptr);
+
+  destroy(alloc);
+}
+
+TEST(memory, virtual_stack_allocator_decommit_on_reset) {
+
+  stack_alloc_create_info_t create_info{
+      nullptr, 64 * Mb, alignment_t::b64,
+      stack_flags_t::virtual_memory | stack_flags_t::decommit_on_reset};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  memblk blk = allocate(alloc, 4 * Mb);
+  memset(blk.ptr, 0xCD, blk.size);
+
+  deallocate_all(alloc);
+
+  // the allocator header survives, released pages come back zeroed
+  memblk blk2 = allocate(alloc, 4 * Mb);
+  ASSERT_EQ(blk2.ptr, blk.ptr);
+  const unsigned char *bytes = static_cast<unsigned char *>(blk2.ptr);
+  ASSERT_EQ(bytes[blk2.size - 1], 0);
+  ASSERT_EQ(bytes[blk2.size / 2], 0);
+
+  destroy(alloc);
+}
+
+TEST(memory, virtual_stack_allocator_allocate_n) {
+
+  stack_alloc_create_info_t create_info{nullptr, 1 * Mb, alignment_t::b16,
+                                        stack_flags_t::virtual_memory};
+
+  allocator_t *alloc = fastware::memory::create(&create_info);
+
+  // more than the reservation holds, falls back to one at a time
+  static memblk blks[2 * Kb];
+  const uint64_t taken = allocate_n(alloc, 1 * Kb, 2 * Kb, blks);
+  ASSERT_GE(taken, 1 * Kb);
+  ASSERT_LT(taken, 2 * Kb);
+  for (uint64_t i = 0; i < taken; i++) {
+    // committed as the batch grew
+    static_cast<char *>(blks[i].ptr)[blks[i].size - 1] = 1;
+  }
+
+  deallocate_n(alloc, blks, taken);
+
+  // fits in one go this time
+  ASSERT_EQ(allocate_n(alloc, 1 * Kb, 1 * Kb, blks), 1 * Kb);
+  ASSERT_EQ(static_cast<char *>(blks[1 * Kb - 1].ptr) -
+                static_cast<char *>(blks[0].ptr),
+            (1 * Kb - 1) * 1 * Kb);
+
+  destroy(alloc);
+}
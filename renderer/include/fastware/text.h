@@ -15,6 +15,8 @@ void create_atlas(const create_text_atlas_info_t *infos, uint32_t count,
 void create_buffers(const uint32_t *lengths, uint32_t count,
                     text_buffer_t *results);
 
+// Staging data comes from allocator and is never freed here, pass a frame
+// arena so it stays valid while the uploads are in flight
 void update_buffers(memory::allocator_t *allocator,
                     const update_text_buffer_info_t *infos, uint32_t count,
                     uint32_t *index_sizes);
@@ -187,13 +187,6 @@ void update_buffers(memory::allocator_t *allocator,
                     const update_text_buffer_info_t *infos, uint32_t count,
                     uint32_t *index_sizes) {
 
-  memory::stack_alloc_create_info_t alloc_info{.parent = allocator,
-                                               .size = memory::Mb * 2,
-                                               .alignment =
-                                                   memory::alignment_t::b64};
-
-  memory::allocator_t *alloc = memory::create(&alloc_info);
-
   constexpr auto rotate = [](vec2_t origin, vec2_t location, float rotation) {
     vec2_t trans = glms_vec2_sub(location, origin);
     float_t rad = glm_rad(rotation);
@@ -212,19 +205,27 @@ void update_buffers(memory::allocator_t *allocator,
 
     assert(section_size <= info.buffer->section_size);
 
-    index_sizes[i] = 6 * info.length;
-
     printf("Text: %s, Length: %u, Section(L): %u, Index(L): %u\n", info.text,
            info.length, section_size, index_size);
 
-    memory::memblk blk_vert = memory::allocate(alloc, section_size);
-    memory::memblk blk_orig = memory::allocate(alloc, section_size);
-    memory::memblk blk_glyph = memory::allocate(alloc, section_size);
-    memory::memblk blk_elem = memory::allocate(alloc, index_size);
+    // vertex, origin and glyph sections in one bump
+    memory::memblk blk_sections[3]{};
+    const uint64_t taken =
+        memory::allocate_n(allocator, section_size, 3, blk_sections);
+    const memory::memblk blk_elem =
+        taken == 3 ? memory::allocate(allocator, index_size) : memory::memblk{};
+    if (blk_elem.ptr == nullptr) {
+      // out of memory, the text is not drawn this time
+      printf("text buffer error: %s\n", info.text);
+      index_sizes[i] = 0;
+      continue;
+    }
+
+    index_sizes[i] = 6 * info.length;
 
-    vec2_t *vert_data = cast<vec2_t *>(blk_vert.ptr);
-    vec2_t *orig_data = cast<vec2_t *>(blk_orig.ptr);
-    vec2_t *glypth_data = cast<vec2_t *>(blk_glyph.ptr);
+    vec2_t *vert_data = cast<vec2_t *>(blk_sections[0].ptr);
+    vec2_t *orig_data = cast<vec2_t *>(blk_sections[1].ptr);
+    vec2_t *glypth_data = cast<vec2_t *>(blk_sections[2].ptr);
     uint32_t *idx_data = cast<uint32_t *>(blk_elem.ptr);
 
     float_t pos_x = info.pos.x;
@@ -308,10 +309,8 @@ void update_buffers(memory::allocator_t *allocator,
                              .data = idx_data}};
 
     buffer::update(update_infos, 4);
-    memory::deallocate_all(alloc);
   }
 
-  memory::destroy(alloc);
   // https://github.com/Samson-Mano/opengl_textrendering/blob/master/opengl_textrendering/src/label_text_store.cpp
 }
 